@@ -124,7 +124,17 @@ struct gmx_domdec_master_t
     rvec  *vbuf;   /* Buffer for state scattering and gathering */
 };
 
-#define DD_NLOAD_MAX 9
+/* The number of bins per cell along a dimension for the load profile
+ * used with predictive dynamic load balancing.
+ */
+#define DD_DLB_PROF_NBIN 4
+
+#define DD_NLOAD_MAX (9 + DIM*DD_DLB_PROF_NBIN)
+
+/* Initial, minimum and maximum damping of the predicted DLB boundary shifts */
+static const real dd_dlb_predict_damp_init = 0.75;
+static const real dd_dlb_predict_damp_min  = 0.1;
+static const real dd_dlb_predict_damp_max  = 1.0;
 
 const char *edlbs_names[edlbsNR] = { "off", "auto", "locked", "on" };
 
@@ -160,6 +170,38 @@ static const ivec dd_zp1[dd_zp1n] = {{0, 0, 2}};
 #define dd_zp0n 1
 static const ivec dd_zp0[dd_zp0n] = {{0, 0, 1}};
 
+/* The 3D neutral-territory setup, only used without DLB.
+ * Next to the home zone we have a plate of four zones in the plane
+ * of DD dimensions 0 and 1 and a tower of two zones along dimension 2.
+ * The home zone sees all zones up to the tower, the plate zones see
+ * the tower, which gives each cell pair within the cut-off exactly once.
+ */
+#define dd_znt3n  7
+#define dd_zpnt3n 5
+static const ivec dd_zont3[dd_znt3n] =
+{{0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {1, 1, 0}, {1, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+static const ivec dd_zpnt3[dd_zpnt3n] = {{0, 0, 6}, {1, 5, 7}, {2, 5, 7}, {3, 5, 7}, {4, 5, 7}};
+
+/* A neutral-territory communication pulse: we send the atoms in zones
+ * zone0 to zone1 along DD dimension index dimind in direction
+ * and append what we receive as new zones, in the order of dd_zont3.
+ */
+typedef struct {
+    int dimind;    /* The DD dimension index */
+    int direction; /* dddirBackward receives from the upper neighbor */
+    int zone0;     /* The first zone to send */
+    int zone1;     /* The last zone to send + 1 */
+} dd_nt_pulse_t;
+
+static const dd_nt_pulse_t dd_nt_pulse[DD_NT_NPULSE] =
+{
+    {0, dddirBackward, 0, 1},
+    {1, dddirBackward, 0, 2},
+    {1, dddirForward,  1, 2},
+    {2, dddirBackward, 0, 1},
+    {2, dddirForward,  0, 1}
+};
+
 /* Factors used to avoid problems due to rounding issues */
 #define DD_CELL_MARGIN       1.0001
 #define DD_CELL_MARGIN2      1.00005
@@ -365,98 +407,338 @@ void dd_get_constraint_range(gmx_domdec_t *dd, int *at_start, int *at_end)
     *at_end   = dd->comm->nat[ddnatCON];
 }
 
+/* Descriptor of the halo data we send in a communication pulse.
+ * With shared halos this is passed to the neighbor instead of the data,
+ * the neighbor then reads the data directly from our memory.
+ */
+typedef struct {
+    const rvec *v;       /* The coordinate or force array to read from */
+    const int  *index;   /* The charge groups to send, NULL for contiguous v */
+    const int  *cgindex; /* The charge group to atom index */
+    int         ncg;     /* The number of charge groups in index */
+    gmx_bool    bPBC;    /* Do we need to apply shift? */
+    gmx_bool    bScrew;  /* Do we need to apply screw pbc? */
+    rvec        shift;   /* The shift vector */
+    real        box_yy;  /* box[YY][YY] for screw pbc */
+    real        box_zz;  /* box[ZZ][ZZ] for screw pbc */
+} dd_halo_shared_t;
+
+/* Gathers the, possibly shifted, coordinates for the charge groups
+ * in hs->index from hs->v into buf.
+ */
+static void dd_gather_halo_x(const dd_halo_shared_t *hs, rvec *buf)
+{
+    int i, j, at0, at1, n;
+
+    n = 0;
+    if (!hs->bPBC)
+    {
+        for (i = 0; i < hs->ncg; i++)
+        {
+            at0 = hs->cgindex[hs->index[i]];
+            at1 = hs->cgindex[hs->index[i]+1];
+            for (j = at0; j < at1; j++)
+            {
+                copy_rvec(hs->v[j], buf[n]);
+                n++;
+            }
+        }
+    }
+    else if (!hs->bScrew)
+    {
+        for (i = 0; i < hs->ncg; i++)
+        {
+            at0 = hs->cgindex[hs->index[i]];
+            at1 = hs->cgindex[hs->index[i]+1];
+            for (j = at0; j < at1; j++)
+            {
+                /* We need to shift the coordinates */
+                rvec_add(hs->v[j], hs->shift, buf[n]);
+                n++;
+            }
+        }
+    }
+    else
+    {
+        for (i = 0; i < hs->ncg; i++)
+        {
+            at0 = hs->cgindex[hs->index[i]];
+            at1 = hs->cgindex[hs->index[i]+1];
+            for (j = at0; j < at1; j++)
+            {
+                /* Shift x */
+                buf[n][XX] = hs->v[j][XX] + hs->shift[XX];
+                /* Rotate y and z.
+                 * This operation requires a special shift force
+                 * treatment, which is performed in calc_vir.
+                 */
+                buf[n][YY] = hs->box_yy - hs->v[j][YY];
+                buf[n][ZZ] = hs->box_zz - hs->v[j][ZZ];
+                n++;
+            }
+        }
+    }
+}
+
+/* Descriptor of the halo forces we send in a communication pulse
+ * with shared halos. The neighbor reads the forces of the atoms in
+ * the zone ranges of ind directly from f.
+ */
+typedef struct {
+    const rvec             *f;        /* The force array to read from */
+    const gmx_domdec_ind_t *ind;      /* The pulse setup of the sender */
+    int                     nzone;    /* The number of zones in ind */
+    int                     at0;      /* The first atom with bInPlace */
+    gmx_bool                bInPlace; /* Are the atoms contiguous from at0? */
+} dd_halo_shared_f_t;
+
+/* With shared halos, tells the neighbor we read from in direction
+ * that we are done reading and waits for the neighbor reading from us.
+ * After this the halo data of the pulse can be modified again.
+ */
+static void dd_halo_shared_done(const gmx_domdec_t *dd, int ddimind,
+                                int direction,
+                                gmx_bool bRead, gmx_bool bReadByNeighbor)
+{
+    int done_s, done_r;
+
+    done_s = 1;
+    dd_sendrecv_int(dd, ddimind, direction,
+                    &done_s, bRead ? 1 : 0,
+                    &done_r, bReadByNeighbor ? 1 : 0);
+}
+
+/* With shared halos, waits until the neighbors are done reading
+ * the halo data given by comm->sharedHaloPending. This is only needed
+ * when the next halo communication does not imply this, i.e. when
+ * dd_move_x or dd_move_f is called twice in a row or before the atoms
+ * are redistributed.
+ */
+static void dd_halo_shared_flush(gmx_domdec_t *dd)
+{
+    gmx_domdec_comm_t *comm;
+    gmx_domdec_ind_t  *ind;
+    int                nzone, d, p;
+
+    comm = dd->comm;
+
+    if (comm->sharedHaloPending == ddshNONE)
+    {
+        return;
+    }
+
+    nzone = 1;
+    for (d = 0; d < dd->ndim; d++)
+    {
+        for (p = 0; p < comm->cd[d].np; p++)
+        {
+            ind = &comm->cd[d].ind[p];
+            if (comm->sharedHaloPending == ddshX)
+            {
+                dd_halo_shared_done(dd, d, dddirForward,
+                                    ind->nrecv[nzone+1] > 0,
+                                    ind->nsend[nzone+1] > 0);
+            }
+            else
+            {
+                dd_halo_shared_done(dd, d, dddirBackward,
+                                    ind->nsend[nzone+1] > 0,
+                                    ind->nrecv[nzone+1] > 0);
+            }
+        }
+        nzone += nzone;
+    }
+
+    comm->sharedHaloPending = ddshNONE;
+}
+
+/* Communicates the halo coordinates with the neutral-territory zones */
+static void dd_move_x_nt(gmx_domdec_t *dd, matrix box, rvec x[])
+{
+    gmx_domdec_comm_t   *comm;
+    const dd_nt_pulse_t *pulse;
+    gmx_domdec_ind_t    *ind;
+    dd_halo_shared_t     hs;
+    int                  nat_tot, p, dim, nzone_send;
+
+    comm = dd->comm;
+
+    hs.v       = x;
+    hs.cgindex = dd->cgindex;
+    hs.bScrew  = FALSE;
+
+    nat_tot = dd->nat_home;
+    for (p = 0; p < DD_NT_NPULSE; p++)
+    {
+        pulse      = &dd_nt_pulse[p];
+        dim        = dd->dim[pulse->dimind];
+        ind        = &comm->ntind[p];
+        nzone_send = pulse->zone1 - pulse->zone0;
+
+        /* Going down from the first cell or up from the last cell
+         * we cross the periodic boundary.
+         */
+        if (pulse->direction == dddirBackward)
+        {
+            hs.bPBC = (dd->ci[dim] == 0);
+            copy_rvec(box[dim], hs.shift);
+        }
+        else
+        {
+            hs.bPBC = (dd->ci[dim] == dd->nc[dim] - 1);
+            svmul(-1, box[dim], hs.shift);
+        }
+        hs.index = ind->index;
+        hs.ncg   = ind->nsend[nzone_send];
+
+        dd_gather_halo_x(&hs, comm->vbuf.v);
+        dd_sendrecv_rvec(dd, pulse->dimind, pulse->direction,
+                         comm->vbuf.v, ind->nsend[nzone_send+1],
+                         x + nat_tot,  ind->nrecv[nzone_send+1]);
+        nat_tot += ind->nrecv[nzone_send+1];
+    }
+}
+
+/* Communicates and adds the halo forces with the neutral-territory zones */
+static void dd_move_f_nt(gmx_domdec_t *dd, rvec f[], rvec *fshift)
+{
+    gmx_domdec_comm_t   *comm;
+    const dd_nt_pulse_t *pulse;
+    gmx_domdec_ind_t    *ind;
+    rvec                *buf;
+    int                  nat_tot, p, dim, nzone_send, i, j, n, is;
+    gmx_bool             bShiftForcesNeedPbc;
+    ivec                 vis;
+
+    comm = dd->comm;
+
+    buf = comm->vbuf.v;
+
+    nat_tot = dd->nat_tot;
+    for (p = DD_NT_NPULSE - 1; p >= 0; p--)
+    {
+        pulse      = &dd_nt_pulse[p];
+        dim        = dd->dim[pulse->dimind];
+        ind        = &comm->ntind[p];
+        nzone_send = pulse->zone1 - pulse->zone0;
+
+        clear_ivec(vis);
+        if (pulse->direction == dddirBackward)
+        {
+            bShiftForcesNeedPbc = (dd->ci[dim] == 0);
+            vis[dim]            = 1;
+        }
+        else
+        {
+            bShiftForcesNeedPbc = (dd->ci[dim] == dd->nc[dim] - 1);
+            vis[dim]            = -1;
+        }
+        bShiftForcesNeedPbc = (bShiftForcesNeedPbc && fshift != NULL);
+        is                  = IVEC2IS(vis);
+
+        /* The forces go back in the opposite direction of the coordinates */
+        nat_tot -= ind->nrecv[nzone_send+1];
+        dd_sendrecv_rvec(dd, pulse->dimind,
+                         pulse->direction == dddirBackward ? dddirForward : dddirBackward,
+                         f + nat_tot, ind->nrecv[nzone_send+1],
+                         buf,         ind->nsend[nzone_send+1]);
+
+        n = 0;
+        for (i = 0; i < ind->nsend[nzone_send]; i++)
+        {
+            for (j = dd->cgindex[ind->index[i]]; j < dd->cgindex[ind->index[i]+1]; j++)
+            {
+                rvec_inc(f[j], buf[n]);
+                if (bShiftForcesNeedPbc)
+                {
+                    rvec_inc(fshift[is], buf[n]);
+                }
+                n++;
+            }
+        }
+    }
+}
+
 void dd_move_x(gmx_domdec_t *dd, matrix box, rvec x[])
 {
-    int                    nzone, nat_tot, n, d, p, i, j, at0, at1, zone;
-    int                   *index, *cgindex;
+    int                    nzone, nat_tot, d, p, i, j, zone;
     gmx_domdec_comm_t     *comm;
     gmx_domdec_comm_dim_t *cd;
     gmx_domdec_ind_t      *ind;
-    rvec                   shift = {0, 0, 0}, *buf, *rbuf;
-    gmx_bool               bPBC, bScrew;
+    dd_halo_shared_t       hs, hs_r;
+    rvec                  *buf, *rbuf;
 
     comm = dd->comm;
 
-    cgindex = dd->cgindex;
+    if (comm->bNeutralTerritory)
+    {
+        dd_move_x_nt(dd, box, x);
+        return;
+    }
 
     buf = comm->vbuf.v;
 
+    hs.v       = x;
+    hs.cgindex = dd->cgindex;
+    hs.box_yy  = box[YY][YY];
+    hs.box_zz  = box[ZZ][ZZ];
+    clear_rvec(hs.shift);
+
+    if (dd->bSharedHalo && comm->sharedHaloPending == ddshX)
+    {
+        /* Our last coordinates might still be read */
+        dd_halo_shared_flush(dd);
+    }
+
     nzone   = 1;
     nat_tot = dd->nat_home;
     for (d = 0; d < dd->ndim; d++)
     {
-        bPBC   = (dd->ci[dd->dim[d]] == 0);
-        bScrew = (bPBC && dd->bScrewPBC && dd->dim[d] == XX);
-        if (bPBC)
+        hs.bPBC   = (dd->ci[dd->dim[d]] == 0);
+        hs.bScrew = (hs.bPBC && dd->bScrewPBC && dd->dim[d] == XX);
+        if (hs.bPBC)
         {
-            copy_rvec(box[dd->dim[d]], shift);
+            copy_rvec(box[dd->dim[d]], hs.shift);
         }
         cd = &comm->cd[d];
         for (p = 0; p < cd->np; p++)
         {
-            ind   = &cd->ind[p];
-            index = ind->index;
-            n     = 0;
-            if (!bPBC)
-            {
-                for (i = 0; i < ind->nsend[nzone]; i++)
-                {
-                    at0 = cgindex[index[i]];
-                    at1 = cgindex[index[i]+1];
-                    for (j = at0; j < at1; j++)
-                    {
-                        copy_rvec(x[j], buf[n]);
-                        n++;
-                    }
-                }
-            }
-            else if (!bScrew)
+            ind      = &cd->ind[p];
+            hs.index = ind->index;
+            hs.ncg   = ind->nsend[nzone];
+
+            if (cd->bInPlace)
             {
-                for (i = 0; i < ind->nsend[nzone]; i++)
-                {
-                    at0 = cgindex[index[i]];
-                    at1 = cgindex[index[i]+1];
-                    for (j = at0; j < at1; j++)
-                    {
-                        /* We need to shift the coordinates */
-                        rvec_add(x[j], shift, buf[n]);
-                        n++;
-                    }
-                }
+                rbuf = x + nat_tot;
             }
             else
             {
-                for (i = 0; i < ind->nsend[nzone]; i++)
-                {
-                    at0 = cgindex[index[i]];
-                    at1 = cgindex[index[i]+1];
-                    for (j = at0; j < at1; j++)
-                    {
-                        /* Shift x */
-                        buf[n][XX] = x[j][XX] + shift[XX];
-                        /* Rotate y and z.
-                         * This operation requires a special shift force
-                         * treatment, which is performed in calc_vir.
-                         */
-                        buf[n][YY] = box[YY][YY] - x[j][YY];
-                        buf[n][ZZ] = box[ZZ][ZZ] - x[j][ZZ];
-                        n++;
-                    }
-                }
+                rbuf = comm->vbuf2.v;
             }
-
-            if (cd->bInPlace)
+            if (!dd->bSharedHalo)
             {
-                rbuf = x + nat_tot;
+                dd_gather_halo_x(&hs, buf);
+                /* Send and receive the coordinates */
+                dd_sendrecv_rvec(dd, d, dddirBackward,
+                                 buf,  ind->nsend[nzone+1],
+                                 rbuf, ind->nrecv[nzone+1]);
             }
             else
             {
-                rbuf = comm->vbuf2.v;
+                /* Exchange descriptors and gather the coordinates
+                 * directly from the memory of our neighbor.
+                 * Receiving the descriptor also tells us that our
+                 * neighbor is done reading the forces of this pulse
+                 * in the last dd_move_f call.
+                 */
+                dd_sendrecv_bytes(dd, d, dddirBackward,
+                                  &hs,   ind->nsend[nzone+1] > 0 ? sizeof(hs) : 0,
+                                  &hs_r, ind->nrecv[nzone+1] > 0 ? sizeof(hs_r) : 0);
+                if (ind->nrecv[nzone+1] > 0)
+                {
+                    dd_gather_halo_x(&hs_r, rbuf);
+                }
             }
-            /* Send and receive the coordinates */
-            dd_sendrecv_rvec(dd, d, dddirBackward,
-                             buf,  ind->nsend[nzone+1],
-                             rbuf, ind->nrecv[nzone+1]);
             if (!cd->bInPlace)
             {
                 j = 0;
@@ -473,6 +755,11 @@ void dd_move_x(gmx_domdec_t *dd, matrix box, rvec x[])
         }
         nzone += nzone;
     }
+
+    if (dd->bSharedHalo)
+    {
+        comm->sharedHaloPending = ddshX;
+    }
 }
 
 void dd_move_f(gmx_domdec_t *dd, rvec f[], rvec *fshift)
@@ -483,16 +770,32 @@ void dd_move_f(gmx_domdec_t *dd, rvec f[], rvec *fshift)
     gmx_domdec_comm_dim_t *cd;
     gmx_domdec_ind_t      *ind;
     rvec                  *buf, *sbuf;
+    const rvec            *rbuf;
+    dd_halo_shared_f_t     hf, hf_r;
     ivec                   vis;
     int                    is;
     gmx_bool               bShiftForcesNeedPbc, bScrew;
 
     comm = dd->comm;
 
+    if (comm->bNeutralTerritory)
+    {
+        dd_move_f_nt(dd, f, fshift);
+        return;
+    }
+
     cgindex = dd->cgindex;
 
     buf = comm->vbuf.v;
 
+    hf.f = f;
+
+    if (dd->bSharedHalo && comm->sharedHaloPending == ddshF)
+    {
+        /* Our last forces might still be read */
+        dd_halo_shared_flush(dd);
+    }
+
     nzone   = comm->zones.n/2;
     nat_tot = dd->nat_tot;
     for (d = dd->ndim-1; d >= 0; d--)
@@ -515,27 +818,70 @@ void dd_move_f(gmx_domdec_t *dd, rvec f[], rvec *fshift)
         {
             ind      = &cd->ind[p];
             nat_tot -= ind->nrecv[nzone+1];
-            if (cd->bInPlace)
+            if (!dd->bSharedHalo)
             {
-                sbuf = f + nat_tot;
+                if (cd->bInPlace)
+                {
+                    sbuf = f + nat_tot;
+                }
+                else
+                {
+                    sbuf = comm->vbuf2.v;
+                    j    = 0;
+                    for (zone = 0; zone < nzone; zone++)
+                    {
+                        for (i = ind->cell2at0[zone]; i < ind->cell2at1[zone]; i++)
+                        {
+                            copy_rvec(f[i], sbuf[j]);
+                            j++;
+                        }
+                    }
+                }
+                /* Communicate the forces */
+                dd_sendrecv_rvec(dd, d, dddirForward,
+                                 sbuf, ind->nrecv[nzone+1],
+                                 buf,  ind->nsend[nzone+1]);
+                rbuf = buf;
             }
             else
             {
-                sbuf = comm->vbuf2.v;
-                j    = 0;
-                for (zone = 0; zone < nzone; zone++)
-                {
-                    for (i = ind->cell2at0[zone]; i < ind->cell2at1[zone]; i++)
+                /* Exchange descriptors, we add the forces directly
+                 * from the memory of our neighbor. We do not pack
+                 * into a send buffer, since that would be reused in
+                 * the next pulse while our neighbor might still read.
+                 * Receiving the descriptor also tells us that our
+                 * neighbor is done reading the coordinates of this
+                 * pulse in the last dd_move_x call.
+                 */
+                hf.ind      = ind;
+                hf.nzone    = nzone;
+                hf.at0      = nat_tot;
+                hf.bInPlace = cd->bInPlace;
+                dd_sendrecv_bytes(dd, d, dddirForward,
+                                  &hf,   ind->nrecv[nzone+1] > 0 ? sizeof(hf) : 0,
+                                  &hf_r, ind->nsend[nzone+1] > 0 ? sizeof(hf_r) : 0);
+                rbuf = NULL;
+                if (ind->nsend[nzone+1] > 0)
+                {
+                    if (hf_r.bInPlace)
                     {
-                        copy_rvec(f[i], sbuf[j]);
-                        j++;
+                        rbuf = hf_r.f + hf_r.at0;
+                    }
+                    else
+                    {
+                        n = 0;
+                        for (zone = 0; zone < hf_r.nzone; zone++)
+                        {
+                            for (i = hf_r.ind->cell2at0[zone]; i < hf_r.ind->cell2at1[zone]; i++)
+                            {
+                                copy_rvec(hf_r.f[i], buf[n]);
+                                n++;
+                            }
+                        }
+                        rbuf = buf;
                     }
                 }
             }
-            /* Communicate the forces */
-            dd_sendrecv_rvec(dd, d, dddirForward,
-                             sbuf, ind->nrecv[nzone+1],
-                             buf,  ind->nsend[nzone+1]);
             index = ind->index;
             /* Add the received forces */
             n = 0;
@@ -547,7 +893,7 @@ void dd_move_f(gmx_domdec_t *dd, rvec f[], rvec *fshift)
                     at1 = cgindex[index[i]+1];
                     for (j = at0; j < at1; j++)
                     {
-                        rvec_inc(f[j], buf[n]);
+                        rvec_inc(f[j], rbuf[n]);
                         n++;
                     }
                 }
@@ -563,9 +909,9 @@ void dd_move_f(gmx_domdec_t *dd, rvec f[], rvec *fshift)
                     at1 = cgindex[index[i]+1];
                     for (j = at0; j < at1; j++)
                     {
-                        rvec_inc(f[j], buf[n]);
+                        rvec_inc(f[j], rbuf[n]);
                         /* Add this force to the shift force */
-                        rvec_inc(fshift[is], buf[n]);
+                        rvec_inc(fshift[is], rbuf[n]);
                         n++;
                     }
                 }
@@ -579,13 +925,13 @@ void dd_move_f(gmx_domdec_t *dd, rvec f[], rvec *fshift)
                     for (j = at0; j < at1; j++)
                     {
                         /* Rotate the force */
-                        f[j][XX] += buf[n][XX];
-                        f[j][YY] -= buf[n][YY];
-                        f[j][ZZ] -= buf[n][ZZ];
+                        f[j][XX] += rbuf[n][XX];
+                        f[j][YY] -= rbuf[n][YY];
+                        f[j][ZZ] -= rbuf[n][ZZ];
                         if (fshift)
                         {
                             /* Add this force to the shift force */
-                            rvec_inc(fshift[is], buf[n]);
+                            rvec_inc(fshift[is], rbuf[n]);
                         }
                         n++;
                     }
@@ -594,6 +940,11 @@ void dd_move_f(gmx_domdec_t *dd, rvec f[], rvec *fshift)
         }
         nzone /= 2;
     }
+
+    if (dd->bSharedHalo)
+    {
+        comm->sharedHaloPending = ddshF;
+    }
 }
 
 void dd_atom_spread_real(gmx_domdec_t *dd, real v[])
@@ -1259,6 +1610,91 @@ void dd_collect_vec(gmx_domdec_t *dd,
     }
 }
 
+void dd_collect_vec_group(gmx_domdec_t *dd,
+                          t_state *state_local, rvec *lv, rvec *v,
+                          const unsigned char *grpnr)
+{
+    gmx_domdec_master_t *ma;
+    int                 *rcounts = NULL, *disps = NULL;
+    int                  nsend, n, i, c, a;
+    rvec                *sbuf, *buf = NULL;
+    t_block             *cgs_gl;
+
+    if (grpnr == NULL || state_local->ddp_count != dd->ddp_count)
+    {
+        /* All atoms are selected or we can not map the home atoms
+         * to global indices, collect the whole vector.
+         */
+        dd_collect_vec(dd, state_local, lv, v);
+
+        return;
+    }
+
+    dd_collect_cg(dd, state_local);
+
+    /* Pack the selected home atoms in home atom order */
+    vec_rvec_check_alloc(&dd->comm->vbuf, dd->nat_home);
+    sbuf  = dd->comm->vbuf.v;
+    nsend = 0;
+    for (i = 0; i < dd->nat_home; i++)
+    {
+        if (grpnr[dd->gatindex[i]] == 0)
+        {
+            copy_rvec(lv[i], sbuf[nsend++]);
+        }
+    }
+
+    ma     = dd->ma;
+    cgs_gl = &dd->comm->cgs_gl;
+
+    if (DDMASTER(dd))
+    {
+        /* The master knows the home atoms of all ranks,
+         * so it can determine the counts without communication.
+         */
+        rcounts = ma->ibuf;
+        disps   = ma->ibuf + dd->nnodes;
+        for (n = 0; n < dd->nnodes; n++)
+        {
+            a = 0;
+            for (i = ma->index[n]; i < ma->index[n+1]; i++)
+            {
+                for (c = cgs_gl->index[ma->cg[i]]; c < cgs_gl->index[ma->cg[i]+1]; c++)
+                {
+                    if (grpnr[c] == 0)
+                    {
+                        a++;
+                    }
+                }
+            }
+            rcounts[n] = a*sizeof(rvec);
+            disps[n]   = (n == 0 ? 0 : disps[n-1] + rcounts[n-1]);
+        }
+
+        buf = ma->vbuf;
+    }
+
+    dd_gatherv(dd, nsend*sizeof(rvec), sbuf, rcounts, disps, buf);
+
+    if (DDMASTER(dd))
+    {
+        a = 0;
+        for (n = 0; n < dd->nnodes; n++)
+        {
+            for (i = ma->index[n]; i < ma->index[n+1]; i++)
+            {
+                for (c = cgs_gl->index[ma->cg[i]]; c < cgs_gl->index[ma->cg[i]+1]; c++)
+                {
+                    if (grpnr[c] == 0)
+                    {
+                        copy_rvec(buf[a++], v[c]);
+                    }
+                }
+            }
+        }
+    }
+}
+
 
 void dd_collect_state(gmx_domdec_t *dd,
                       t_state *state_local, t_state *state)
@@ -3125,6 +3561,131 @@ static void dd_cell_sizes_dlb_root_enforce_limits(gmx_domdec_t *dd,
 }
 
 
+/* Predict the DLB cell sizes along a row from the load profiles.
+ * Each cell reports how its load is distributed over DD_DLB_PROF_NBIN
+ * equally sized slabs. Assuming the load density is constant within a slab,
+ * we can place the boundaries such that the predicted load is equal
+ * for all cells in one shot. The shift towards the predicted boundaries
+ * is damped with a factor that is reduced when the imbalance grew
+ * since the previous DLB step, which signals overshooting or noise,
+ * and increased when the imbalance decreased.
+ */
+static void set_dd_cell_sizes_dlb_root_predict(gmx_domdec_comm_t *comm,
+                                               int d, int ncd,
+                                               domdec_root_t *root,
+                                               real change_limit)
+{
+    const domdec_load_t *load = &comm->load[d];
+    real                *cell_size, *cell_f_pred;
+    real                 load_aver, load_i, imb_max;
+    real                 w, cum, cost, width, f0, change, change_max, sc;
+    int                  i, b, k;
+
+    cell_size   = root->buf_ncd;
+    cell_f_pred = root->cell_f_pred;
+
+    load_aver = 0;
+    for (i = 0; i < ncd; i++)
+    {
+        load_aver += load->load[i*load->nload+2];
+    }
+    load_aver /= ncd;
+    if (load_aver <= 0)
+    {
+        for (i = 0; i < ncd; i++)
+        {
+            cell_size[i] = root->cell_f[i+1] - root->cell_f[i];
+        }
+        return;
+    }
+
+    imb_max = 0;
+    for (i = 0; i < ncd; i++)
+    {
+        load_i  = load->load[i*load->nload+2];
+        imb_max = std::max(imb_max, std::abs(load_i - load_aver)/load_aver);
+    }
+    if (root->imb_prev > 0)
+    {
+        if (imb_max > root->imb_prev)
+        {
+            root->damp = std::max(dd_dlb_predict_damp_min, root->damp/2);
+        }
+        else
+        {
+            root->damp = std::min(dd_dlb_predict_damp_max, root->damp*3/2);
+        }
+    }
+    root->imb_prev = imb_max;
+
+    /* Walk over the bins of all cells and determine the positions
+     * where the cumulative load reaches multiples of the average.
+     */
+    k   = 1;
+    cum = 0;
+    for (i = 0; i < ncd && k < ncd; i++)
+    {
+        load_i = load->load[i*load->nload+2];
+        w      = 0;
+        for (b = 0; b < DD_DLB_PROF_NBIN; b++)
+        {
+            w += root->load_prof[i*DD_DLB_PROF_NBIN+b];
+        }
+        width = (root->cell_f[i+1] - root->cell_f[i])/DD_DLB_PROF_NBIN;
+        for (b = 0; b < DD_DLB_PROF_NBIN && k < ncd; b++)
+        {
+            if (w > 0)
+            {
+                cost = load_i*root->load_prof[i*DD_DLB_PROF_NBIN+b]/w;
+            }
+            else
+            {
+                /* No profile available, assume a uniform load */
+                cost = load_i/DD_DLB_PROF_NBIN;
+            }
+            f0 = root->cell_f[i] + b*width;
+            while (k < ncd && cost > 0 && cum + cost >= k*load_aver)
+            {
+                cell_f_pred[k] = f0 + width*(k*load_aver - cum)/cost;
+                k++;
+            }
+            cum += cost;
+        }
+    }
+    /* Rounding can leave the last boundaries unset */
+    for (; k < ncd; k++)
+    {
+        cell_f_pred[k] = root->cell_f[k];
+    }
+
+    /* Convert the predicted boundaries to damped shifts and limit
+     * the relative change of the cell sizes. As for the normal DLB,
+     * we use the same scaling for the whole row.
+     */
+    for (k = 1; k < ncd; k++)
+    {
+        cell_f_pred[k] = root->damp*(cell_f_pred[k] - root->cell_f[k]);
+    }
+    cell_f_pred[0]   = 0;
+    cell_f_pred[ncd] = 0;
+    change_max       = 0;
+    for (i = 0; i < ncd; i++)
+    {
+        change     = (cell_f_pred[i+1] - cell_f_pred[i])/(root->cell_f[i+1] - root->cell_f[i]);
+        change_max = std::max(change_max, std::abs(change));
+    }
+    sc = 1;
+    if (change_max > change_limit)
+    {
+        sc = change_limit/change_max;
+    }
+    for (i = 0; i < ncd; i++)
+    {
+        cell_size[i] = root->cell_f[i+1] - root->cell_f[i] +
+            sc*(cell_f_pred[i+1] - cell_f_pred[i]);
+    }
+}
+
 static void set_dd_cell_sizes_dlb_root(gmx_domdec_t *dd,
                                        int d, int dim, domdec_root_t *root,
                                        gmx_ddbox_t *ddbox, gmx_bool bDynamicBox,
@@ -3163,6 +3724,10 @@ static void set_dd_cell_sizes_dlb_root(gmx_domdec_t *dd,
             cell_size[i] = 1.0/ncd;
         }
     }
+    else if (dd_load_count(comm) > 0 && comm->bDLBPredict)
+    {
+        set_dd_cell_sizes_dlb_root_predict(comm, d, ncd, root, change_limit);
+    }
     else if (dd_load_count(comm) > 0)
     {
         load_aver  = comm->load[d].sum_m/ncd;
@@ -4961,14 +5526,69 @@ static void clear_dd_cycle_counts(gmx_domdec_t *dd)
     dd->comm->flop_n = 0;
 }
 
-static void get_load_distribution(gmx_domdec_t *dd, gmx_wallcycle_t wcycle)
+/* Distributes the force load over DD_DLB_PROF_NBIN slabs of our cell
+ * along each DD dimension, proportionally to the number of home atoms
+ * in each slab. The profiles are used for predictive DLB.
+ */
+static void dd_home_load_profile(const gmx_domdec_t *dd, const rvec *x,
+                                 float load, float *prof)
+{
+    const gmx_domdec_comm_t *comm;
+    int                      d, dim, a, b, count[DD_DLB_PROF_NBIN];
+    real                     x0, inv_width;
+
+    comm = dd->comm;
+
+    for (d = 0; d < dd->ndim; d++)
+    {
+        dim = dd->dim[d];
+        for (b = 0; b < DD_DLB_PROF_NBIN; b++)
+        {
+            count[b] = 0;
+        }
+        if (comm->tric_dir[dim] || dd->nat_home == 0)
+        {
+            /* We can not easily bin along triclinic dimensions,
+             * assume a uniform distribution.
+             */
+            for (b = 0; b < DD_DLB_PROF_NBIN; b++)
+            {
+                count[b] = 1;
+            }
+        }
+        else
+        {
+            x0        = comm->cell_x0[dim];
+            inv_width = DD_DLB_PROF_NBIN/(comm->cell_x1[dim] - comm->cell_x0[dim]);
+            for (a = 0; a < dd->nat_home; a++)
+            {
+                /* Atoms that moved out of our cell go in the edge bins */
+                b = static_cast<int>((x[a][dim] - x0)*inv_width);
+                b = std::max(0, std::min(DD_DLB_PROF_NBIN - 1, b));
+                count[b]++;
+            }
+        }
+        a = 0;
+        for (b = 0; b < DD_DLB_PROF_NBIN; b++)
+        {
+            a += count[b];
+        }
+        for (b = 0; b < DD_DLB_PROF_NBIN; b++)
+        {
+            prof[d*DD_DLB_PROF_NBIN+b] = load*count[b]/a;
+        }
+    }
+}
+
+static void get_load_distribution(gmx_domdec_t *dd, const rvec *x,
+                                  gmx_wallcycle_t wcycle)
 {
     gmx_domdec_comm_t *comm;
     domdec_load_t     *load;
     domdec_root_t     *root = NULL;
-    int                d, dim, i, pos;
+    int                d, dim, i, pos, b;
     float              cell_frac = 0, sbuf[DD_NLOAD_MAX];
-    gmx_bool           bSepPME;
+    gmx_bool           bSepPME, bProf;
 
     if (debug)
     {
@@ -4981,6 +5601,8 @@ static void get_load_distribution(gmx_domdec_t *dd, gmx_wallcycle_t wcycle)
 
     bSepPME = (dd->pme_nodeid >= 0);
 
+    bProf = (dlbIsOn(comm) && comm->bDLBPredict);
+
     if (dd->ndim == 0 && bSepPME)
     {
         /* Without decomposition, but with PME nodes, we need the load */
@@ -5015,6 +5637,11 @@ static void get_load_distribution(gmx_domdec_t *dd, gmx_wallcycle_t wcycle)
                         sbuf[pos++] = comm->cell_f_min1[d];
                     }
                 }
+                if (bProf)
+                {
+                    dd_home_load_profile(dd, x, sbuf[0], sbuf + pos);
+                    pos += dd->ndim*DD_DLB_PROF_NBIN;
+                }
                 if (bSepPME)
                 {
                     sbuf[pos++] = comm->cycl[ddCyclPPduringPME];
@@ -5036,6 +5663,14 @@ static void get_load_distribution(gmx_domdec_t *dd, gmx_wallcycle_t wcycle)
                         sbuf[pos++] = comm->cell_f_min1[d];
                     }
                 }
+                if (bProf)
+                {
+                    /* Pass on the profiles along dimensions 0 to d */
+                    for (b = 0; b < (d + 1)*DD_DLB_PROF_NBIN; b++)
+                    {
+                        sbuf[pos++] = comm->load[d+1].prof[b];
+                    }
+                }
                 if (bSepPME)
                 {
                     sbuf[pos++] = comm->load[d+1].mdf;
@@ -5065,6 +5700,13 @@ static void get_load_distribution(gmx_domdec_t *dd, gmx_wallcycle_t wcycle)
                 load->flags    = 0;
                 load->mdf      = 0;
                 load->pme      = 0;
+                if (bProf)
+                {
+                    for (b = 0; b < d*DD_DLB_PROF_NBIN; b++)
+                    {
+                        load->prof[b] = 0;
+                    }
+                }
                 pos            = 0;
                 for (i = 0; i < dd->nc[dim]; i++)
                 {
@@ -5097,6 +5739,20 @@ static void get_load_distribution(gmx_domdec_t *dd, gmx_wallcycle_t wcycle)
                             root->cell_f_min1[i] = load->load[pos++];
                         }
                     }
+                    if (bProf)
+                    {
+                        /* Sum the profiles along the lower dimensions
+                         * and store the profile along our dimension per cell.
+                         */
+                        for (b = 0; b < d*DD_DLB_PROF_NBIN; b++)
+                        {
+                            load->prof[b] += load->load[pos++];
+                        }
+                        for (b = 0; b < DD_DLB_PROF_NBIN; b++)
+                        {
+                            root->load_prof[i*DD_DLB_PROF_NBIN+b] = load->load[pos++];
+                        }
+                    }
                     if (bSepPME)
                     {
                         load->mdf = std::max(load->mdf, load->load[pos]);
@@ -5395,6 +6051,9 @@ static void make_load_communicator(gmx_domdec_t *dd, int dim_ind, ivec loc)
                     snew(root->bound_max, dd->nc[dim]);
                 }
                 snew(root->buf_ncd, dd->nc[dim]);
+                snew(root->load_prof, dd->nc[dim]*DD_DLB_PROF_NBIN);
+                snew(root->cell_f_pred, dd->nc[dim]+1);
+                root->damp = dd_dlb_predict_damp_init;
             }
             else
             {
@@ -5405,6 +6064,7 @@ static void make_load_communicator(gmx_domdec_t *dd, int dim_ind, ivec loc)
         if (dd->ci[dim] == dd->master_ci[dim])
         {
             snew(dd->comm->load[dim_ind].load, dd->nc[dim]*DD_NLOAD_MAX);
+            snew(dd->comm->load[dim_ind].prof, DIM*DD_DLB_PROF_NBIN);
         }
     }
 }
@@ -5522,6 +6182,7 @@ void setup_dd_grid(FILE *fplog, gmx_domdec_t *dd)
     int                     d, dim, i, j, m;
     ivec                    tmp, s;
     int                     nzone, nzonep;
+    const ivec             *dd_zone_order;
     ivec                    dd_zp[DD_MAXIZONE];
     gmx_domdec_zones_t     *zones;
     gmx_domdec_ns_ranges_t *izone;
@@ -5551,14 +6212,28 @@ void setup_dd_grid(FILE *fplog, gmx_domdec_t *dd)
                 dd->nc[XX], dd->nc[YY], dd->nc[ZZ],
                 dd->ci[XX], dd->ci[YY], dd->ci[ZZ]);
     }
+    dd_zone_order = dd_zo;
     switch (dd->ndim)
     {
         case 3:
-            nzone  = dd_z3n;
-            nzonep = dd_zp3n;
-            for (i = 0; i < nzonep; i++)
+            if (dd->comm->bNeutralTerritory)
+            {
+                dd_zone_order = dd_zont3;
+                nzone         = dd_znt3n;
+                nzonep        = dd_zpnt3n;
+                for (i = 0; i < nzonep; i++)
+                {
+                    copy_ivec(dd_zpnt3[i], dd_zp[i]);
+                }
+            }
+            else
             {
-                copy_ivec(dd_zp3[i], dd_zp[i]);
+                nzone  = dd_z3n;
+                nzonep = dd_zp3n;
+                for (i = 0; i < nzonep; i++)
+                {
+                    copy_ivec(dd_zp3[i], dd_zp[i]);
+                }
             }
             break;
         case 2:
@@ -5599,7 +6274,7 @@ void setup_dd_grid(FILE *fplog, gmx_domdec_t *dd)
         clear_ivec(zones->shift[i]);
         for (d = 0; d < dd->ndim; d++)
         {
-            zones->shift[i][dd->dim[d]] = dd_zo[i][m++];
+            zones->shift[i][dd->dim[d]] = dd_zone_order[i][m++];
         }
     }
 
@@ -5851,14 +6526,8 @@ static gmx_domdec_master_t *init_gmx_domdec_master_t(gmx_domdec_t *dd,
         snew(ma->cell_x[i], dd->nc[i]+1);
     }
 
-    if (dd->nnodes <= GMX_DD_NNODES_SENDRECV)
-    {
-        ma->vbuf = NULL;
-    }
-    else
-    {
-        snew(ma->vbuf, natoms);
-    }
+    /* Also used with few ranks, for collecting atom subsets */
+    snew(ma->vbuf, natoms);
 
     return ma;
 }
@@ -6410,7 +7079,18 @@ gmx_domdec_t *init_domain_decomposition(FILE *fplog, t_commrec *cr,
     dd->bScrewPBC = (ir->ePBC == epbcSCREW);
 
     dd->bSendRecv2      = dd_getenv(fplog, "GMX_DD_USE_SENDRECV2", 0);
+#ifdef GMX_THREAD_MPI
+    /* All thread-MPI ranks share the address space, so we can read
+     * the halo data directly from the memory of our neighbors.
+     */
+    dd->bSharedHalo     = (dd_getenv(fplog, "GMX_DD_SHARED_HALO", 0) != 0);
+#else
+    dd->bSharedHalo     = FALSE;
+#endif
+    /* Use the neutral-territory zones, checked in set_dd_parameters */
+    comm->bNeutralTerritory = (dd_getenv(fplog, "GMX_DD_NEUTRAL_TERRITORY", 0) != 0);
     comm->dlb_scale_lim = dd_getenv(fplog, "GMX_DLB_MAX_BOX_SCALING", 10);
+    comm->bDLBPredict   = (dd_getenv(fplog, "GMX_DLB_PREDICT", 0) != 0);
     comm->eFlop         = dd_getenv(fplog, "GMX_DLB_BASED_ON_FLOPS", 0);
     recload             = dd_getenv(fplog, "GMX_DD_RECORD_LOAD", 1);
     comm->nstSortCG     = dd_getenv(fplog, "GMX_DD_NST_SORT_CHARGE_GROUPS", 1);
@@ -7172,6 +7852,82 @@ gmx_bool dd_bonded_molpbc(gmx_domdec_t *dd, int ePBC)
               (dd->nc[ZZ] > 1 || ePBC == epbcXY)));
 }
 
+/* Turns off the requested neutral-territory zones, with a note, when
+ * this setup does not support the system or decomposition. When used,
+ * dynamic load balancing is turned off, since the zone setup assumes
+ * cell boundaries aligned with those of the neighbors.
+ */
+static void check_dd_neutral_territory(FILE *fplog, gmx_domdec_t *dd,
+                                       const t_inputrec *ir,
+                                       const gmx_ddbox_t *ddbox)
+{
+    gmx_domdec_comm_t *comm;
+    const char        *reason;
+    int                d, dim;
+    real               cellsize;
+
+    comm = dd->comm;
+
+    reason = NULL;
+    if (ir->cutoff_scheme != ecutsVERLET)
+    {
+        reason = "they require the Verlet cut-off scheme";
+    }
+    else if (ir->ePBC != epbcXYZ || dd->ndim != 3)
+    {
+        reason = "they require pbc=xyz and decomposition along all three dimensions";
+    }
+    else if (comm->dlbState == edlbsOn || dd->bSharedHalo)
+    {
+        reason = "they do not support dynamic load balancing or GMX_DD_SHARED_HALO";
+    }
+    else if (comm->bInterCGMultiBody || comm->bBondComm ||
+             dd->bInterCGcons || dd->bInterCGsettles || dd->vsite_comm != NULL)
+    {
+        reason = "they only support two-body bonded interactions between atoms in different cells";
+    }
+    else
+    {
+        for (d = 0; d < dd->ndim; d++)
+        {
+            dim      = dd->dim[d];
+            cellsize = ddbox->box_size[dim]/dd->nc[dim];
+            if (ddbox->tric_dir[dim])
+            {
+                reason = "they require a rectangular box";
+            }
+            else if (cellsize < comm->cutoff ||
+                     (d > 0 && dd->nc[dim] == 2 && cellsize < 2*comm->cutoff))
+            {
+                reason = "the cells are smaller than the cut-off, or than twice the cut-off along the second or third dimension with two cells";
+            }
+        }
+    }
+
+    if (reason != NULL)
+    {
+        comm->bNeutralTerritory = FALSE;
+
+        if (DDMASTER(dd))
+        {
+            fprintf(stderr, "\nNOTE: Not using the neutral-territory zones, since %s\n", reason);
+        }
+        if (fplog)
+        {
+            fprintf(fplog, "\nNOTE: Not using the neutral-territory zones, since %s\n", reason);
+        }
+    }
+    else
+    {
+        comm->dlbState = edlbsOffForever;
+
+        if (fplog)
+        {
+            fprintf(fplog, "Using the neutral-territory zones for the halo communication, dynamic load balancing is turned off\n");
+        }
+    }
+}
+
 void set_dd_parameters(FILE *fplog, gmx_domdec_t *dd, real dlb_scale,
                        t_inputrec *ir, gmx_ddbox_t *ddbox)
 {
@@ -7213,6 +7969,10 @@ void set_dd_parameters(FILE *fplog, gmx_domdec_t *dd, real dlb_scale,
     {
         fprintf(debug, "The DD cut-off is %f\n", comm->cutoff);
     }
+    if (comm->bNeutralTerritory)
+    {
+        check_dd_neutral_territory(fplog, dd, ir, ddbox);
+    }
     if (comm->dlbState != edlbsOffForever)
     {
         set_cell_limits_dlb(dd, dlb_scale, ir, ddbox);
@@ -7921,6 +8681,168 @@ get_zone_pulse_cgs(gmx_domdec_t *dd,
     *nsend_z_ptr = nsend_z;
 }
 
+/* Sets up the halo communication and communicates the halo atoms
+ * for the neutral-territory zones. All conditions for this setup are
+ * checked in set_dd_parameters, except for the cell sizes, which can
+ * change during the run.
+ */
+static void setup_dd_communication_nt(gmx_domdec_t *dd, matrix box,
+                                      t_forcerec *fr, t_state *state, rvec **f)
+{
+    gmx_domdec_comm_t   *comm;
+    gmx_domdec_zones_t  *zones;
+    const dd_nt_pulse_t *pulse;
+    gmx_domdec_ind_t    *ind;
+    int                  p, d, dim, nzone, nzone_send, zone, cg, cg_gl, nrcg;
+    int                  pos_cg, nat_tot, nsend, nat;
+    int                 *zone_cg_range, *index_gl, *cgindex;
+    rvec                *cg_cm;
+    gmx_bool             bBackward;
+
+    comm  = dd->comm;
+    zones = &comm->zones;
+
+    for (d = 0; d < dd->ndim; d++)
+    {
+        dim = dd->dim[d];
+        /* With two cells an atom could be sent in both directions
+         * to the same neighbor, so we need twice the cut-off there.
+         */
+        if (comm->cd[d].np > 1 ||
+            (d > 0 && dd->nc[dim] == 2 &&
+             comm->cell_x1[dim] - comm->cell_x0[dim] < 2*comm->cutoff))
+        {
+            gmx_fatal(FARGS, "The domain decomposition cell size along %c became too small for the neutral-territory zones, run without GMX_DD_NEUTRAL_TERRITORY",
+                      dim2char(dim));
+        }
+    }
+
+    cg_cm         = state->x;
+    zone_cg_range = zones->cg_range;
+    index_gl      = dd->index_gl;
+    cgindex       = dd->cgindex;
+
+    zone_cg_range[0]   = 0;
+    zone_cg_range[1]   = dd->ncg_home;
+    comm->zone_ncg1[0] = dd->ncg_home;
+    pos_cg             = dd->ncg_home;
+
+    nat_tot = dd->nat_home;
+    nzone   = 1;
+    for (p = 0; p < DD_NT_NPULSE; p++)
+    {
+        pulse      = &dd_nt_pulse[p];
+        dim        = dd->dim[pulse->dimind];
+        ind        = &comm->ntind[p];
+        nzone_send = pulse->zone1 - pulse->zone0;
+        bBackward  = (pulse->direction == dddirBackward);
+
+        nsend = 0;
+        nat   = 0;
+        for (zone = pulse->zone0; zone < pulse->zone1; zone++)
+        {
+            ind->nsend[zone - pulse->zone0] = 0;
+            for (cg = zone_cg_range[zone]; cg < zone_cg_range[zone+1]; cg++)
+            {
+                /* Receiving from above we send the atoms near our lower
+                 * boundary down and vice versa.
+                 */
+                if (( bBackward && cg_cm[cg][dim] - comm->cell_x0[dim] < comm->cutoff) ||
+                    (!bBackward && comm->cell_x1[dim] - cg_cm[cg][dim] < comm->cutoff))
+                {
+                    if (nsend + 1 > ind->nalloc)
+                    {
+                        ind->nalloc = over_alloc_large(nsend + 1);
+                        srenew(ind->index, ind->nalloc);
+                    }
+                    if (nsend + 1 > comm->nalloc_int)
+                    {
+                        comm->nalloc_int = over_alloc_large(nsend + 1);
+                        srenew(comm->buf_int, comm->nalloc_int);
+                    }
+                    vec_rvec_check_alloc(&comm->vbuf, nsend + 1);
+
+                    ind->index[nsend]    = cg;
+                    comm->buf_int[nsend] = index_gl[cg];
+                    if (bBackward && dd->ci[dim] == 0)
+                    {
+                        rvec_add(cg_cm[cg], box[dim], comm->vbuf.v[nsend]);
+                    }
+                    else if (!bBackward && dd->ci[dim] == dd->nc[dim] - 1)
+                    {
+                        rvec_sub(cg_cm[cg], box[dim], comm->vbuf.v[nsend]);
+                    }
+                    else
+                    {
+                        copy_rvec(cg_cm[cg], comm->vbuf.v[nsend]);
+                    }
+                    ind->nsend[zone - pulse->zone0]++;
+                    nsend++;
+                    nat += cgindex[cg+1] - cgindex[cg];
+                }
+            }
+        }
+        ind->nsend[nzone_send]   = nsend;
+        ind->nsend[nzone_send+1] = nat;
+        /* Communicate the number of cg's and atoms to receive */
+        dd_sendrecv_int(dd, pulse->dimind, pulse->direction,
+                        ind->nsend, nzone_send+2,
+                        ind->nrecv, nzone_send+2);
+
+        /* The rvec buffer is also used for the atoms in dd_move_x/f */
+        vec_rvec_check_alloc(&comm->vbuf, nat);
+
+        /* Make space for the global cg indices */
+        if (pos_cg + ind->nrecv[nzone_send] > dd->cg_nalloc
+            || dd->cg_nalloc == 0)
+        {
+            dd->cg_nalloc = over_alloc_dd(pos_cg + ind->nrecv[nzone_send]);
+            srenew(index_gl, dd->cg_nalloc);
+            srenew(cgindex, dd->cg_nalloc+1);
+        }
+        dd_sendrecv_int(dd, pulse->dimind, pulse->direction,
+                        comm->buf_int,  nsend,
+                        index_gl + pos_cg, ind->nrecv[nzone_send]);
+
+        /* Communicate the, already shifted, centers */
+        dd_check_alloc_ncg(fr, state, f, pos_cg + ind->nrecv[nzone_send]);
+        cg_cm = state->x;
+        dd_sendrecv_rvec(dd, pulse->dimind, pulse->direction,
+                         comm->vbuf.v,   nsend,
+                         cg_cm + pos_cg, ind->nrecv[nzone_send]);
+
+        /* Each zone we send becomes a new zone at the receiver */
+        for (zone = 0; zone < nzone_send; zone++)
+        {
+            for (cg = 0; cg < ind->nrecv[zone]; cg++)
+            {
+                cg_gl              = index_gl[pos_cg];
+                fr->cginfo[pos_cg] = ddcginfo(fr->cginfo_mb, cg_gl);
+                nrcg               = GET_CGINFO_NATOMS(fr->cginfo[pos_cg]);
+                cgindex[pos_cg+1]  = cgindex[pos_cg] + nrcg;
+                pos_cg++;
+            }
+            comm->zone_ncg1[nzone] = ind->nrecv[zone];
+            nzone++;
+            zone_cg_range[nzone] = pos_cg;
+        }
+        nat_tot += ind->nrecv[nzone_send+1];
+    }
+    dd->index_gl = index_gl;
+    dd->cgindex  = cgindex;
+
+    dd->ncg_tot          = zone_cg_range[zones->n];
+    dd->nat_tot          = nat_tot;
+    comm->nat[ddnatHOME] = dd->nat_home;
+    for (d = ddnatZONE; d < ddnatNR; d++)
+    {
+        comm->nat[d] = dd->nat_tot;
+    }
+
+    dd_set_cginfo(dd->index_gl, dd->ncg_home, dd->ncg_tot,
+                  NULL, comm->bLocalCG);
+}
+
 static void setup_dd_communication(gmx_domdec_t *dd,
                                    matrix box, gmx_ddbox_t *ddbox,
                                    t_forcerec *fr, t_state *state, rvec **f)
@@ -7951,6 +8873,12 @@ static void setup_dd_communication(gmx_domdec_t *dd,
 
     comm  = dd->comm;
 
+    if (comm->bNeutralTerritory)
+    {
+        setup_dd_communication_nt(dd, box, fr, state, f);
+        return;
+    }
+
     switch (fr->cutoff_scheme)
     {
         case ecutsGROUP:
@@ -8513,6 +9441,14 @@ static void set_zones_size(gmx_domdec_t *dd,
                     }
                 }
             }
+            else if (zones->shift[z][dim] < 0)
+            {
+                /* Only the neutral-territory zones, without DLB,
+                 * extend below our cell.
+                 */
+                zones->size[z].x0[dim] = comm->cell_x0[dim] - rcs;
+                zones->size[z].x1[dim] = comm->cell_x0[dim];
+            }
         }
 
         /* Loop over the i-zones to set the upper limit of each
@@ -9103,6 +10039,12 @@ void print_dd_statistics(t_commrec *cr, t_inputrec *ir, FILE *fplog)
                 gmx_incons(" Unknown type for DD statistics");
         }
     }
+    if (dd_num_incremental_top_updates(cr->dd) >= 0)
+    {
+        fprintf(fplog,
+                " #incremental local topology updates on this rank: %d\n",
+                dd_num_incremental_top_updates(cr->dd));
+    }
     fprintf(fplog, "\n");
 
     if (comm->bRecordLoad && EI_DYNAMICS(ir->eI))
@@ -9149,6 +10091,12 @@ void dd_partition_system(FILE                *fplog,
     dd   = cr->dd;
     comm = dd->comm;
 
+    if (dd->bSharedHalo)
+    {
+        /* Neighbors might still read halo data that we will now modify */
+        dd_halo_shared_flush(dd);
+    }
+
     bBoxChanged = (bMasterState || inputrecDeform(ir));
     if (ir->epc != epcNO)
     {
@@ -9215,7 +10163,7 @@ void dd_partition_system(FILE                *fplog,
         if (bDoDLB || bLogLoad || bCheckWhetherToTurnDlbOn ||
             (bVerbose && (ir->nstlist == 0 || nstglobalcomm <= ir->nstlist)))
         {
-            get_load_distribution(dd, wcycle);
+            get_load_distribution(dd, state_local->x, wcycle);
             if (DDMASTER(dd))
             {
                 if (bLogLoad)
@@ -9694,6 +10642,11 @@ void dd_partition_system(FILE                *fplog,
     if (comm->nstDDDump > 0 && step % comm->nstDDDump == 0)
     {
         dd_move_x(dd, state_local->box, state_local->x);
+        if (dd->bSharedHalo)
+        {
+            /* The coordinates can change before the next dd_move_f */
+            dd_halo_shared_flush(dd);
+        }
         write_dd_pdb("dd_dump", step, "dump", top_global, cr,
                      -1, state_local->x, state_local->box);
     }
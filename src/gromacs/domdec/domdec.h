@@ -214,6 +214,16 @@ void setup_dd_grid(FILE *fplog, struct gmx_domdec_t *dd);
 void dd_collect_vec(struct gmx_domdec_t *dd,
                     t_state *state_local, rvec *lv, rvec *v);
 
+/*! \brief Collects only the atoms with \p grpnr equal to 0 of local rvec arrays \p lv to \p v on the master rank
+ *
+ * Only the selected atoms are communicated, the other elements of \p v
+ * are left unchanged. \p grpnr is indexed by global atom index,
+ * NULL selects all atoms.
+ */
+void dd_collect_vec_group(struct gmx_domdec_t *dd,
+                          t_state *state_local, rvec *lv, rvec *v,
+                          const unsigned char *grpnr);
+
 /*! \brief Collects the local state \p state_local to \p state on the master rank */
 void dd_collect_state(struct gmx_domdec_t *dd,
                       t_state *state_local, t_state *state);
@@ -322,6 +332,9 @@ void dd_make_reverse_top(FILE *fplog,
                          gmx_vsite_t *vsite,
                          t_inputrec *ir, gmx_bool bBCheck);
 
+/*! \brief Returns the number of incremental local bonded updates done, -1 when these are not used */
+int dd_num_incremental_top_updates(const struct gmx_domdec_t *dd);
+
 /*! \brief Store the local charge group index in \p lcgs */
 void dd_make_local_cgs(struct gmx_domdec_t *dd, t_block *lcgs);
 
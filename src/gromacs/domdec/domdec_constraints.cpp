@@ -246,12 +246,11 @@ static void atoms_to_settles(gmx_domdec_t *dd,
     gmx_mtop_atomlookup_t   alook;
     int                     settle;
     int                     nral, sa;
-    int                     cg, a, a_gl, a_glsa, a_gls[3], a_locs[3];
+    int                     cg, a, a_gl, a_gls[3], a_locs[3];
     int                     mb, molnr, a_mol, offset;
     const gmx_molblock_t   *molb;
     const t_iatom          *ia1;
     gmx_bool                a_home[3];
-    int                     nlocal;
     gmx_bool                bAssign;
 
     ga2la  = dd->ga2la;
@@ -279,20 +278,19 @@ static void atoms_to_settles(gmx_domdec_t *dd,
 
                     ia1 = mtop->moltype[molb->type].ilist[F_SETTLE].iatoms;
 
+                    for (sa = 0; sa < nral; sa++)
+                    {
+                        a_gls[sa] = offset + ia1[settle*(1+nral)+1+sa];
+                    }
+                    ga2la_get_home_batch(ga2la, nral, a_gls, a_locs, a_home);
+                    /* Assign the settle to the rank with the first home atom */
                     bAssign = FALSE;
-                    nlocal  = 0;
                     for (sa = 0; sa < nral; sa++)
                     {
-                        a_glsa     = offset + ia1[settle*(1+nral)+1+sa];
-                        a_gls[sa]  = a_glsa;
-                        a_home[sa] = ga2la_get_home(ga2la, a_glsa, &a_locs[sa]);
                         if (a_home[sa])
                         {
-                            if (nlocal == 0 && a_gl == a_glsa)
-                            {
-                                bAssign = TRUE;
-                            }
-                            nlocal++;
+                            bAssign = (a_gl == a_gls[sa]);
+                            break;
                         }
                     }
 
@@ -308,7 +306,7 @@ static void atoms_to_settles(gmx_domdec_t *dd,
 
                         for (sa = 0; sa < nral; sa++)
                         {
-                            if (ga2la_get_home(ga2la, a_gls[sa], &a_locs[sa]))
+                            if (a_home[sa])
                             {
                                 ils_local->iatoms[ils_local->nr++] = a_locs[sa];
                             }
@@ -52,6 +52,9 @@
 
 /*! \cond INTERNAL */
 
+//! The number of communication pulses with the neutral-territory zone setup
+#define DD_NT_NPULSE 5
+
 typedef struct
 {
     /* The numbers of charge groups to send and receive for each cell
@@ -89,6 +92,10 @@ typedef struct
     real     *bound_max;   /**< Temp. var.: upper limit for cell boundary     */
     gmx_bool  bLimited;    /**< State var.: is DLB limited in this row        */
     real     *buf_ncd;     /**< Temp. var.                                    */
+    float    *load_prof;   /**< Temp. var.: load profile per cell, predictive DLB only */
+    real     *cell_f_pred; /**< Temp. var.: predicted cell boundaries, predictive DLB only */
+    real      imb_prev;    /**< State var.: max. rel. imbalance at the previous DLB step */
+    real      damp;        /**< State var.: damping of the predicted boundary shifts */
 } domdec_root_t;
 
 /*! \brief Struct for compute load commuication
@@ -107,6 +114,7 @@ typedef struct
     float  mdf;       /**< The PP time during which PME can overlap */
     float  pme;       /**< The PME-only rank load */
     int    flags;     /**< Bit flags that tell if DLB was limited, per dimension */
+    float *prof;      /**< Load profiles along the lower dimensions, summed over the row, predictive DLB only */
 } domdec_load_t;
 
 typedef struct
@@ -144,6 +152,19 @@ enum {
     ddnatHOME, ddnatZONE, ddnatVSITE, ddnatCON, ddnatNR
 };
 
+/*! \brief Which of our halo data neighbors might still be reading with shared halos
+ *
+ * Without an explicit acknowledgement, a neighbor is known to be done
+ * reading our coordinates once it sends us its forces, and done reading
+ * our forces once it sends us its next coordinate descriptor.
+ */
+enum {
+    ddshNONE,                  /**< Neighbors do not read our halo data */
+    ddshX,                     /**< Neighbors might read our coordinates */
+    ddshF,                     /**< Neighbors might read our forces */
+    ddshNR                     /**< The number of shared halo states */
+};
+
 /*! \brief Enum of dynamic load balancing states */
 enum {
     edlbsOffForever,           /**< DLB is off and will never be turned on */
@@ -285,6 +306,12 @@ struct gmx_domdec_comm_t
 
     /** The coordinate/force communication setup and indices */
     gmx_domdec_comm_dim_t cd[DIM];
+    /** With shared halos, which of our halo data neighbors might still read */
+    int                   sharedHaloPending;
+    /** Use the neutral-territory zones instead of the eighth shell */
+    gmx_bool              bNeutralTerritory;
+    /** The pulse setup with bNeutralTerritory, replaces \p cd */
+    gmx_domdec_ind_t      ntind[DD_NT_NPULSE];
     /** The maximum number of cells to communicate with in one dimension */
     int                   maxpulse;
 
@@ -343,7 +370,9 @@ struct gmx_domdec_comm_t
 #endif
 
     /** Maximum DLB scaling per load balancing step in percent */
-    int dlb_scale_lim;
+    int      dlb_scale_lim;
+    /** Predict the cell boundaries from the load profile inside the cells */
+    gmx_bool bDLBPredict;
 
     /* Cycle counters */
     float  cycl[ddCyclNr];             /**< Total cycles counted */
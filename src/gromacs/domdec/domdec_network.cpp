@@ -154,6 +154,38 @@ void dd_sendrecv_rvec(const struct gmx_domdec_t gmx_unused *dd,
 #endif
 }
 
+void dd_sendrecv_bytes(const struct gmx_domdec_t gmx_unused *dd,
+                       int gmx_unused ddimind, int gmx_unused direction,
+                       void gmx_unused *buf_s, int gmx_unused n_s,
+                       void gmx_unused *buf_r, int gmx_unused n_r)
+{
+#ifdef GMX_MPI
+    int        rank_s, rank_r;
+    MPI_Status stat;
+
+    rank_s = dd->neighbor[ddimind][direction == dddirForward ? 0 : 1];
+    rank_r = dd->neighbor[ddimind][direction == dddirForward ? 1 : 0];
+
+    if (n_s && n_r)
+    {
+        MPI_Sendrecv(buf_s, n_s, MPI_BYTE, rank_s, 0,
+                     buf_r, n_r, MPI_BYTE, rank_r, 0,
+                     dd->mpi_comm_all, &stat);
+    }
+    else if (n_s)
+    {
+        MPI_Send(    buf_s, n_s, MPI_BYTE, rank_s, 0,
+                     dd->mpi_comm_all);
+    }
+    else if (n_r)
+    {
+        MPI_Recv(    buf_r, n_r, MPI_BYTE, rank_r, 0,
+                     dd->mpi_comm_all, &stat);
+    }
+
+#endif
+}
+
 void dd_sendrecv2_rvec(const struct gmx_domdec_t gmx_unused *dd,
                        int gmx_unused ddimind,
                        rvec gmx_unused *buf_s_fw, int gmx_unused n_s_fw,
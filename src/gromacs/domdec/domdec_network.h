@@ -92,6 +92,20 @@ dd_sendrecv_rvec(const struct gmx_domdec_t *dd,
                  rvec *buf_r, int n_r);
 
 
+/*! \brief Move bytes in the comm. region one cell along the domain decomposition
+ *
+ * Moves in dimension indexed by ddimind, either forward
+ * (direction=dddirFoward) or backward (direction=dddirBackward).
+ * Used for passing small descriptors of data which is read directly
+ * from the memory of the neighbor.
+ */
+void
+dd_sendrecv_bytes(const struct gmx_domdec_t *dd,
+                  int ddimind, int direction,
+                  void *buf_s, int n_s,
+                  void *buf_r, int n_r);
+
+
 /*! \brief Move revc's in the comm. region one cell along the domain decomposition
  *
  * Moves in dimension indexed by ddimind, simultaneously in the forward
@@ -54,7 +54,7 @@
 //! Max number of zones in domain decomposition
 #define DD_MAXZONE  8
 //! Max number of izones in domain decomposition
-#define DD_MAXIZONE 4
+#define DD_MAXIZONE 5
 //! Are we the master node for domain decomposition
 #define DDMASTER(dd)       ((dd)->rank == (dd)->masterrank)
 
@@ -125,6 +125,10 @@ struct gmx_domdec_t {
     MPI_Comm               mpi_comm_all;
     /* Use MPI_Sendrecv communication instead of non-blocking calls */
     gmx_bool               bSendRecv2;
+    /* Read the halo data directly from the memory of the neighbor,
+     * only possible when all ranks share an address space (thread-MPI)
+     */
+    gmx_bool               bSharedHalo;
     /* The local DD cell index and rank */
     ivec                   ci;
     int                    rank;
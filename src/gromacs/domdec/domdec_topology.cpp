@@ -51,6 +51,7 @@
 
 #include <algorithm>
 #include <string>
+#include <vector>
 
 #include "gromacs/domdec/domdec.h"
 #include "gromacs/domdec/domdec_network.h"
@@ -125,6 +126,20 @@ struct gmx_reverse_top_t
     gmx_bool         bIntermolecularInteractions; /**< Do we have intermolecular interactions? */
     reverse_ilist_t  ril_intermol;                /**< Intermolecular reverse ilist */
 
+    /* Data for incrementally updating the local topology */
+    gmx_bool         bIncremental;               /**< Can we update the local bondeds incrementally? */
+    reverse_ilist_t *ril_mt_all;                 /**< Reverse ilist for all moltypes, linked to all atoms */
+    gmx_bool         bHavePrev;                  /**< Do \p gatindex_prev and \p zone_at_prev match the current local topology? */
+    int              nzone_prev;                 /**< The number of zones for the last local topology */
+    int              zone_at_prev[DD_MAXZONE+1]; /**< The local atom ranges of the zones for the last local topology */
+    int             *gatindex_prev;              /**< The global atom indices for the last local topology */
+    int             *prev_to_new;                /**< The current local index for each atom of the last local topology, -1 when it left or changed zone */
+    int              nalloc_prev;                /**< Allocation size of \p gatindex_prev and \p prev_to_new */
+    gmx_bool        *bAtomChanged;               /**< Tells if a local atom is new or changed zone */
+    int              nalloc_changed;             /**< Allocation size of \p bAtomChanged */
+    t_ilist          il_prev[F_NRE];             /**< Storage for the last local bondeds, swapped with the local topology */
+    int              nincremental;               /**< The number of incremental updates done */
+
     /* Work data structures for multi-threading */
     int            nthread;           /**< The number of threads to be used */
     thread_work_t *th_work;           /**< Thread work array for local topology generation */
@@ -795,6 +810,34 @@ void dd_make_reverse_top(FILE *fplog,
 
     gmx_reverse_top_t *rt = dd->reverse_top;
 
+    /* Incremental updates of the local bondeds require that assignment
+     * only depends on the zones of the atoms, so no vsites, which are
+     * assigned recursively, and no position restraints, which need
+     * per molecule reference positions.
+     */
+    rt->bIncremental = (getenv("GMX_DD_INCREMENTAL_TOP") != NULL &&
+                        vsite == NULL &&
+                        !rt->bIntermolecularInteractions &&
+                        gmx_mtop_ftype_count(mtop, F_POSRES) == 0 &&
+                        gmx_mtop_ftype_count(mtop, F_FBPOSRES) == 0);
+    if (rt->bIncremental)
+    {
+        int mt;
+
+        snew(rt->ril_mt_all, mtop->nmoltype);
+        for (mt = 0; mt < mtop->nmoltype; mt++)
+        {
+            make_reverse_ilist(mtop->moltype[mt].ilist, &mtop->moltype[mt].atoms,
+                               NULL,
+                               rt->bConstr, rt->bSettle, rt->bBCheck, TRUE,
+                               &rt->ril_mt_all[mt]);
+        }
+        if (fplog)
+        {
+            fprintf(fplog, "Will update the local bonded interactions incrementally when no distance checks are required\n");
+        }
+    }
+
     if (rt->ril_mt_tot_size >= 200000 &&
         mtop->mols.nr > 1 &&
         mtop->nmolblock == 1 && mtop->molblock[0].nmol == 1)
@@ -1302,6 +1345,64 @@ static void combine_idef(t_idef *dest, const thread_work_t *src, int nsrc,
     }
 }
 
+/*! \brief Returns whether a two-body interaction between atoms in zones \p iz and \p kz should be assigned to this rank
+ *
+ * Both zones should be smaller than zones->n.
+ */
+static gmx_inline gmx_bool
+two_body_zones_assigned(const gmx_domdec_zones_t *zones, int iz, int kz)
+{
+    return ((iz < zones->nizone &&
+             iz <= kz &&
+             kz >= zones->izone[iz].j0 &&
+             kz <  zones->izone[iz].j1) ||
+            (kz < zones->nizone &&
+                  iz > kz &&
+             iz >= zones->izone[kz].j0 &&
+             iz <  zones->izone[kz].j1));
+}
+
+/*! \brief Returns whether a multi-body interaction with atoms in cells \p kz should be assigned to this rank
+ *
+ * This is the case when all atoms are in our zones (not communicated
+ * for constraints) and the minimum zone shift in each dimension is zero.
+ * On return \p k_zero and \p k_plus contain, per dimension, the last
+ * atom (counting from 1) with zero and non-zero shift, respectively,
+ * for the extra distance check needed with 2 DD cells.
+ */
+static gmx_inline gmx_bool
+multi_body_zones_assigned(const gmx_domdec_zones_t *zones,
+                          int nral, const int *kz,
+                          ivec k_zero, ivec k_plus)
+{
+    int k, d;
+
+    clear_ivec(k_zero);
+    clear_ivec(k_plus);
+    for (k = 1; k <= nral; k++)
+    {
+        if (kz[k-1] >= zones->n)
+        {
+            /* This atom comes from more than one cell away */
+            return FALSE;
+        }
+
+        for (d = 0; d < DIM; d++)
+        {
+            if (zones->shift[kz[k-1]][d] == 0)
+            {
+                k_zero[d] = k;
+            }
+            else
+            {
+                k_plus[d] = k;
+            }
+        }
+    }
+
+    return (k_zero[XX] && k_zero[YY] && k_zero[ZZ]);
+}
+
 /*! \brief Check and when available assign bonded interactions for local atom i
  */
 static gmx_inline void
@@ -1427,14 +1528,7 @@ check_assign_interactions_atom(int i, int i_gl,
                         kz -= zones->n;
                     }
                     /* Check zone interaction assignments */
-                    bUse = ((iz < zones->nizone &&
-                             iz <= kz &&
-                             kz >= zones->izone[iz].j0 &&
-                             kz <  zones->izone[iz].j1) ||
-                            (kz < zones->nizone &&
-                                  iz > kz &&
-                             iz >= zones->izone[kz].j0 &&
-                             iz <  zones->izone[kz].j1));
+                    bUse = two_body_zones_assigned(zones, iz, kz);
                     if (bUse)
                     {
                         tiatoms[1] = i;
@@ -1459,54 +1553,23 @@ check_assign_interactions_atom(int i, int i_gl,
                  */
                 ivec k_zero, k_plus;
                 int  k;
+                int  k_gl[MAXATOMLIST], kz[MAXATOMLIST];
 
-                bUse = TRUE;
-                clear_ivec(k_zero);
-                clear_ivec(k_plus);
-                for (k = 1; k <= nral && bUse; k++)
+                for (k = 1; k <= nral; k++)
                 {
-                    gmx_bool bLocal;
-                    int      k_gl, a_loc;
-                    int      kz;
-
                     if (!bInterMolInteractions)
                     {
                         /* Get the global index using the offset in the molecule */
-                        k_gl = i_gl + iatoms[k] - i_mol;
+                        k_gl[k-1] = i_gl + iatoms[k] - i_mol;
                     }
                     else
                     {
-                        k_gl = iatoms[k];
-                    }
-                    bLocal = ga2la_get(dd->ga2la, k_gl, &a_loc, &kz);
-                    if (!bLocal || kz >= zones->n)
-                    {
-                        /* We do not have this atom of this interaction
-                         * locally, or it comes from more than one cell
-                         * away.
-                         */
-                        bUse = FALSE;
-                    }
-                    else
-                    {
-                        int d;
-
-                        tiatoms[k] = a_loc;
-                        for (d = 0; d < DIM; d++)
-                        {
-                            if (zones->shift[kz][d] == 0)
-                            {
-                                k_zero[d] = k;
-                            }
-                            else
-                            {
-                                k_plus[d] = k;
-                            }
-                        }
+                        k_gl[k-1] = iatoms[k];
                     }
                 }
-                bUse = (bUse &&
-                        k_zero[XX] && k_zero[YY] && k_zero[ZZ]);
+                /* Look up all atoms at once, so the lookups can overlap */
+                bUse = (ga2la_get_batch(dd->ga2la, nral, k_gl, tiatoms + 1, kz) == nral &&
+                        multi_body_zones_assigned(zones, nral, kz, k_zero, k_plus));
                 if (bRCheckMB)
                 {
                     int d;
@@ -1928,11 +1991,430 @@ static void clear_idef(t_idef *idef)
     }
 }
 
-/*! \brief Generate and store all required local bonded interactions in \p idef and local exclusions in \p lexcls */
+/*! \brief Returns whether the interactions of type \p ftype in the local topology are assigned using \p rt */
+static gmx_bool reverse_top_has_ftype(const gmx_reverse_top_t *rt, int ftype)
+{
+    return ((interaction_function[ftype].flags & (IF_BOND | IF_VSITE)) ||
+            (rt->bConstr && (ftype == F_CONSTR || ftype == F_CONSTRNC)) ||
+            (rt->bSettle && ftype == F_SETTLE));
+}
+
+/*! \brief Store the global indices and zones of the local atoms, for use in the next incremental update */
+static void store_prev_local_atoms(gmx_domdec_t *dd, const gmx_domdec_zones_t *zones)
+{
+    gmx_reverse_top_t *rt;
+    int                zone, nat;
+
+    rt = dd->reverse_top;
+
+    for (zone = 0; zone <= zones->n; zone++)
+    {
+        rt->zone_at_prev[zone] = dd->cgindex[zones->cg_range[zone]];
+    }
+    rt->nzone_prev = zones->n;
+
+    nat = rt->zone_at_prev[zones->n];
+    if (nat > rt->nalloc_prev)
+    {
+        rt->nalloc_prev = over_alloc_dd(nat);
+        srenew(rt->gatindex_prev, rt->nalloc_prev);
+        srenew(rt->prev_to_new, rt->nalloc_prev);
+    }
+    memcpy(rt->gatindex_prev, dd->gatindex, nat*sizeof(*rt->gatindex_prev));
+
+    rt->bHavePrev = TRUE;
+}
+
+/*! \brief Maps the atoms of the last local topology to the current local atoms
+ *
+ * Sets rt->prev_to_new for the local atoms of the last local topology
+ * in the range \p at0 to \p at1 and flags the current local atoms they
+ * map to as unchanged. Atoms that left or moved to another zone map to -1.
+ */
+static void map_prev_local_atoms(gmx_domdec_t *dd, int at0, int at1)
+{
+    gmx_reverse_top_t *rt;
+    int                zone, a0, a1, a, n, i;
+    int                a_loc[GA2LA_BATCH_SIZE], cell[GA2LA_BATCH_SIZE];
+
+    rt = dd->reverse_top;
+
+    for (zone = 0; zone < rt->nzone_prev; zone++)
+    {
+        a0 = std::max(at0, rt->zone_at_prev[zone]);
+        a1 = std::min(at1, rt->zone_at_prev[zone + 1]);
+        for (a = a0; a < a1; a += GA2LA_BATCH_SIZE)
+        {
+            n = std::min(a1 - a, GA2LA_BATCH_SIZE);
+            ga2la_get_batch(dd->ga2la, n, rt->gatindex_prev + a, a_loc, cell);
+            for (i = 0; i < n; i++)
+            {
+                if (cell[i] == zone)
+                {
+                    rt->prev_to_new[a + i]     = a_loc[i];
+                    rt->bAtomChanged[a_loc[i]] = FALSE;
+                }
+                else
+                {
+                    rt->prev_to_new[a + i] = -1;
+                }
+            }
+        }
+    }
+}
+
+/*! \brief Adds the interactions of \p il_prev with all atoms unchanged to \p il, renumbered
+ *
+ * Only the interactions with index \p i0 up to \p i1 are considered.
+ */
+static void keep_unchanged_interactions(const gmx_reverse_top_t *rt,
+                                        int ftype, const t_ilist *il_prev,
+                                        int i0, int i1,
+                                        t_ilist *il)
+{
+    int            nral, i, k;
+    t_iatom        tiatoms[1 + MAXATOMLIST];
+    const t_iatom *iatoms;
+    gmx_bool       bKeep;
+
+    nral = NRAL(ftype);
+    for (i = i0; i < i1; i++)
+    {
+        iatoms     = il_prev->iatoms + i*(1 + nral);
+        tiatoms[0] = iatoms[0];
+        bKeep      = TRUE;
+        for (k = 1; k <= nral && bKeep; k++)
+        {
+            tiatoms[k] = rt->prev_to_new[iatoms[k]];
+            bKeep      = (tiatoms[k] >= 0);
+        }
+        if (bKeep)
+        {
+            add_ifunc(nral, tiatoms, il);
+        }
+    }
+}
+
+/*! \brief Assigns the interactions of the changed local atoms \p at0 to \p at1 to \p idef
+ *
+ * Each interaction is added by its first changed atom, using the same
+ * zone assignment rules as make_bondeds_zone.
+ */
+static void assign_changed_atom_interactions(gmx_domdec_t *dd,
+                                             const gmx_domdec_zones_t *zones,
+                                             int at0, int at1,
+                                             t_idef *idef)
+{
+    gmx_reverse_top_t *rt;
+    int                nzone_bondeds, a, a_gl, j, k, ftype, nral;
+    t_iatom            tiatoms[1 + MAXATOMLIST];
+    int                k_gl[MAXATOMLIST], kz[MAXATOMLIST];
+    ivec               k_zero, k_plus;
+
+    rt = dd->reverse_top;
+
+    nzone_bondeds = (rt->bInterCGInteractions ? zones->n : 1);
+
+    for (a = at0; a < at1; a++)
+    {
+        int        mb, mt, mol, a_mol;
+        const int *index, *rtil;
+
+        if (!rt->bAtomChanged[a])
+        {
+            continue;
+        }
+
+        a_gl = dd->gatindex[a];
+        global_atomnr_to_moltype_ind(rt, a_gl, &mb, &mt, &mol, &a_mol);
+        index = rt->ril_mt_all[mt].index;
+        rtil  = rt->ril_mt_all[mt].il;
+
+        j = index[a_mol];
+        while (j < index[a_mol + 1])
+        {
+            const t_iatom *iatoms;
+            gmx_bool       bUse;
+
+            ftype  = rtil[j++];
+            iatoms = rtil + j;
+            nral   = NRAL(ftype);
+            j     += 1 + nral;
+
+            for (k = 1; k <= nral; k++)
+            {
+                k_gl[k - 1] = a_gl + iatoms[k] - a_mol;
+            }
+            if (ga2la_get_batch(dd->ga2la, nral, k_gl, tiatoms + 1, kz) < nral ||
+                kz[0] >= nzone_bondeds)
+            {
+                continue;
+            }
+            /* Only the first changed atom in the interaction adds it */
+            bUse = TRUE;
+            for (k = 1; k <= nral && tiatoms[k] != a; k++)
+            {
+                if (rt->bAtomChanged[tiatoms[k]])
+                {
+                    bUse = FALSE;
+                }
+            }
+            if (!bUse)
+            {
+                continue;
+            }
+
+            if (ftype == F_SETTLE || nral == 1)
+            {
+                bUse = (kz[0] == 0);
+            }
+            else if (nral == 2)
+            {
+                bUse = two_body_zones_assigned(zones, kz[0],
+                                               kz[1] >= zones->n ? kz[1] - zones->n : kz[1]);
+            }
+            else
+            {
+                bUse = multi_body_zones_assigned(zones, nral, kz, k_zero, k_plus);
+            }
+            if (bUse)
+            {
+                tiatoms[0] = iatoms[0];
+                add_ifunc(nral, tiatoms, &idef->il[ftype]);
+            }
+        }
+    }
+}
+
+/*! \brief Incrementally update the local bondeds in \p idef, returns the local bonded count
+ *
+ * Whether a bonded interaction is assigned to this rank only depends
+ * on the zones of its atoms. Thus all interactions of the previous local
+ * topology, which is still present in \p idef, for which all atoms are
+ * still present in the same zone are kept, after renumbering, and only
+ * the interactions involving an atom that is new or that changed zone
+ * are looked up in the reverse topology. This is only correct without
+ * bonded distance checks and requires no virtual sites, position
+ * restraints or intermolecular interactions; these are checked by
+ * the caller.
+ */
+static int make_bondeds_incremental(gmx_domdec_t *dd,
+                                    const gmx_domdec_zones_t *zones,
+                                    t_idef *idef)
+{
+    gmx_reverse_top_t *rt;
+    int                nat, nat_prev, nbonded_local;
+    int                ftype, thread;
+
+    rt = dd->reverse_top;
+
+    nat      = dd->cgindex[zones->cg_range[zones->n]];
+    nat_prev = rt->zone_at_prev[rt->nzone_prev];
+
+    if (nat > rt->nalloc_changed)
+    {
+        rt->nalloc_changed = over_alloc_dd(nat);
+        srenew(rt->bAtomChanged, rt->nalloc_changed);
+    }
+
+    /* Move the previous local bondeds out of idef, swapping avoids a copy */
+    for (ftype = 0; ftype < F_NRE; ftype++)
+    {
+        t_ilist il_tmp;
+
+        il_tmp             = rt->il_prev[ftype];
+        rt->il_prev[ftype] = idef->il[ftype];
+        idef->il[ftype]    = il_tmp;
+        idef->il[ftype].nr = 0;
+    }
+
+    /* Flag all atoms as changed, mapping the previous atoms clears
+     * the flag for the atoms that stayed in the same zone.
+     */
+#pragma omp parallel for num_threads(rt->nthread) schedule(static)
+    for (thread = 0; thread < rt->nthread; thread++)
+    {
+        int a;
+
+        for (a = (nat*thread)/rt->nthread; a < (nat*(thread + 1))/rt->nthread; a++)
+        {
+            rt->bAtomChanged[a] = TRUE;
+        }
+    }
+
+#pragma omp parallel for num_threads(rt->nthread) schedule(static)
+    for (thread = 0; thread < rt->nthread; thread++)
+    {
+        try
+        {
+            map_prev_local_atoms(dd,
+                                 (nat_prev*thread)/rt->nthread,
+                                 (nat_prev*(thread + 1))/rt->nthread);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+    }
+
+#pragma omp parallel for num_threads(rt->nthread) schedule(static)
+    for (thread = 0; thread < rt->nthread; thread++)
+    {
+        try
+        {
+            t_idef *idef_t;
+            int     ftype_t;
+
+            if (thread == 0)
+            {
+                idef_t = idef;
+            }
+            else
+            {
+                idef_t = &rt->th_work[thread].idef;
+                clear_idef(idef_t);
+            }
+
+            /* Keep the interactions with all atoms unchanged */
+            for (ftype_t = 0; ftype_t < F_NRE; ftype_t++)
+            {
+                if (reverse_top_has_ftype(rt, ftype_t))
+                {
+                    const t_ilist *il_prev = &rt->il_prev[ftype_t];
+                    int            nint    = il_prev->nr/(1 + NRAL(ftype_t));
+
+                    keep_unchanged_interactions(rt, ftype_t, il_prev,
+                                                (nint*thread)/rt->nthread,
+                                                (nint*(thread + 1))/rt->nthread,
+                                                &idef_t->il[ftype_t]);
+                }
+            }
+
+            /* Look up the interactions of the changed atoms */
+            assign_changed_atom_interactions(dd, zones,
+                                             (nat*thread)/rt->nthread,
+                                             (nat*(thread + 1))/rt->nthread,
+                                             idef_t);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+    }
+
+    if (rt->nthread > 1)
+    {
+        combine_idef(idef, rt->th_work, rt->nthread, NULL);
+    }
+
+    /* Count the assigned interactions as check_assign_interactions_atom does */
+    nbonded_local = 0;
+    for (ftype = 0; ftype < F_NRE; ftype++)
+    {
+        if (idef->il[ftype].nr > 0 &&
+            (ftype == F_SETTLE || rt->bBCheck ||
+             !(interaction_function[ftype].flags & IF_LIMZERO)))
+        {
+            nbonded_local += idef->il[ftype].nr/(1 + NRAL(ftype));
+        }
+    }
+
+    rt->nincremental++;
+    if (debug)
+    {
+        int a, nchanged = 0;
+
+        for (a = 0; a < nat; a++)
+        {
+            if (rt->bAtomChanged[a])
+            {
+                nchanged++;
+            }
+        }
+        fprintf(debug, "Incremental local topology update %d: %d out of %d atoms changed\n",
+                rt->nincremental, nchanged, nat);
+    }
+
+    return nbonded_local;
+}
+
+/*! \brief Comparison functor for sorting the interactions in an ilist */
+class InteractionLess
+{
+    public:
+        //! Constructor for interactions in \p iatoms with \p nral atoms
+        InteractionLess(const t_iatom *iatoms, int nral) : iatoms_(iatoms), nral_(nral) {}
+
+        //! Returns whether interaction \p i orders before interaction \p j
+        bool operator()(int i, int j) const
+        {
+            return std::lexicographical_compare(iatoms_ + i*(1 + nral_),
+                                                iatoms_ + (i + 1)*(1 + nral_),
+                                                iatoms_ + j*(1 + nral_),
+                                                iatoms_ + (j + 1)*(1 + nral_));
+        }
+
+    private:
+        const t_iatom *iatoms_;
+        int            nral_;
+};
+
+/*! \brief Returns whether \p il1 and \p il2 contain the same interactions, in any order */
+static gmx_bool ilists_have_same_interactions(const t_ilist *il1, const t_ilist *il2, int nral)
+{
+    int              nint, i, k;
+    std::vector<int> order1, order2;
+
+    if (il1->nr != il2->nr)
+    {
+        return FALSE;
+    }
+
+    nint = il1->nr/(1 + nral);
+    for (i = 0; i < nint; i++)
+    {
+        order1.push_back(i);
+        order2.push_back(i);
+    }
+    std::sort(order1.begin(), order1.end(), InteractionLess(il1->iatoms, nral));
+    std::sort(order2.begin(), order2.end(), InteractionLess(il2->iatoms, nral));
+    for (i = 0; i < nint; i++)
+    {
+        for (k = 0; k <= nral; k++)
+        {
+            if (il1->iatoms[order1[i]*(1 + nral) + k] != il2->iatoms[order2[i]*(1 + nral) + k])
+            {
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+/*! \brief Checks that the incrementally updated bondeds in \p il_incr match the full rebuild in \p idef */
+static void check_incremental_bondeds(const gmx_reverse_top_t *rt,
+                                      const t_ilist *il_incr, const t_idef *idef)
+{
+    int ftype;
+
+    for (ftype = 0; ftype < F_NRE; ftype++)
+    {
+        if (reverse_top_has_ftype(rt, ftype) &&
+            !ilists_have_same_interactions(&il_incr[ftype], &idef->il[ftype], NRAL(ftype)))
+        {
+            gmx_incons(gmx::formatString("The incrementally updated local %s interactions, %d, do not match those of the full local topology generation, %d",
+                                         interaction_function[ftype].longname,
+                                         il_incr[ftype].nr/(1 + NRAL(ftype)),
+                                         idef->il[ftype].nr/(1 + NRAL(ftype))).c_str());
+        }
+    }
+}
+
+/*! \brief Generate and store all required local bonded interactions in \p idef and local exclusions in \p lexcls
+ *
+ * With \p bBondeds=FALSE only the exclusions are generated and \p idef
+ * is left untouched.
+ */
 static int make_local_bondeds_excls(gmx_domdec_t *dd,
                                     gmx_domdec_zones_t *zones,
                                     const gmx_mtop_t *mtop,
                                     const int *cginfo,
+                                    gmx_bool bBondeds,
                                     gmx_bool bRCheckMB, ivec rcheck, gmx_bool bRCheck2B,
                                     real rc,
                                     int *la2lc, t_pbc *pbc_null, rvec *cg_cm,
@@ -1976,7 +2458,10 @@ static int make_local_bondeds_excls(gmx_domdec_t *dd,
     rc2 = rc*rc;
 
     /* Clear the counts */
-    clear_idef(idef);
+    if (bBondeds)
+    {
+        clear_idef(idef);
+    }
     nbonded_local = 0;
 
     lexcls->nr    = 0;
@@ -2011,6 +2496,7 @@ static int make_local_bondeds_excls(gmx_domdec_t *dd,
                     idef_t = &rt->th_work[thread].idef;
                     clear_idef(idef_t);
                 }
+                rt->th_work[thread].nbonded = 0;
 
                 if (vsite && vsite->bHaveChargeGroups && vsite->n_intercg_vsite > 0)
                 {
@@ -2031,15 +2517,18 @@ static int make_local_bondeds_excls(gmx_domdec_t *dd,
                     vsite_pbc_nalloc = NULL;
                 }
 
-                rt->th_work[thread].nbonded =
-                    make_bondeds_zone(dd, zones,
-                                      mtop->molblock,
-                                      bRCheckMB, rcheck, bRCheck2B, rc2,
-                                      la2lc, pbc_null, cg_cm, idef->iparams,
-                                      idef_t,
-                                      vsite_pbc, vsite_pbc_nalloc,
-                                      izone,
-                                      dd->cgindex[cg0t], dd->cgindex[cg1t]);
+                if (bBondeds)
+                {
+                    rt->th_work[thread].nbonded =
+                        make_bondeds_zone(dd, zones,
+                                          mtop->molblock,
+                                          bRCheckMB, rcheck, bRCheck2B, rc2,
+                                          la2lc, pbc_null, cg_cm, idef->iparams,
+                                          idef_t,
+                                          vsite_pbc, vsite_pbc_nalloc,
+                                          izone,
+                                          dd->cgindex[cg0t], dd->cgindex[cg1t]);
+                }
 
                 if (izone < nzone_excl)
                 {
@@ -2079,7 +2568,7 @@ static int make_local_bondeds_excls(gmx_domdec_t *dd,
             GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
         }
 
-        if (rt->nthread > 1)
+        if (bBondeds && rt->nthread > 1)
         {
             combine_idef(idef, rt->th_work, rt->nthread, vsite);
         }
@@ -2121,6 +2610,13 @@ static int make_local_bondeds_excls(gmx_domdec_t *dd,
     return nbonded_local;
 }
 
+int dd_num_incremental_top_updates(const gmx_domdec_t *dd)
+{
+    const gmx_reverse_top_t *rt = dd->reverse_top;
+
+    return (rt->bIncremental ? rt->nincremental : -1);
+}
+
 void dd_make_local_cgs(gmx_domdec_t *dd, t_block *lcgs)
 {
     lcgs->nr    = dd->ncg_tot;
@@ -2202,14 +2698,68 @@ void dd_make_local_top(gmx_domdec_t *dd, gmx_domdec_zones_t *zones,
         }
     }
 
+    /* Without distance checks we can update the bondeds incrementally */
+    gmx_reverse_top_t *rt = dd->reverse_top;
+    gmx_bool           bIncremental;
+
+    bIncremental = (rt->bIncremental && rt->bHavePrev &&
+                    !bRCheckMB && !bRCheck2B &&
+                    zones->n == rt->nzone_prev);
+
     dd->nbonded_local =
         make_local_bondeds_excls(dd, zones, mtop, fr->cginfo,
+                                 !bIncremental,
                                  bRCheckMB, rcheck, bRCheck2B, rc,
                                  dd->la2lc,
                                  pbc_null, cgcm_or_x,
                                  &ltop->idef, vsite,
                                  &ltop->excls, &nexcl);
 
+    if (bIncremental)
+    {
+        dd->nbonded_local = make_bondeds_incremental(dd, zones, &ltop->idef);
+
+        if (debug)
+        {
+            /* Check the incremental update against a full generation,
+             * the previous bondeds are no longer needed, so we can use
+             * their storage for the incrementally updated bondeds.
+             */
+            int ftype;
+
+            for (ftype = 0; ftype < F_NRE; ftype++)
+            {
+                t_ilist il_tmp;
+
+                il_tmp               = rt->il_prev[ftype];
+                rt->il_prev[ftype]   = ltop->idef.il[ftype];
+                ltop->idef.il[ftype] = il_tmp;
+            }
+            dd->nbonded_local =
+                make_local_bondeds_excls(dd, zones, mtop, fr->cginfo,
+                                         TRUE,
+                                         bRCheckMB, rcheck, bRCheck2B, rc,
+                                         dd->la2lc,
+                                         pbc_null, cgcm_or_x,
+                                         &ltop->idef, vsite,
+                                         &ltop->excls, &nexcl);
+            check_incremental_bondeds(rt, rt->il_prev, &ltop->idef);
+        }
+    }
+
+    if (rt->bIncremental)
+    {
+        if (!bRCheckMB && !bRCheck2B)
+        {
+            store_prev_local_atoms(dd, zones);
+        }
+        else
+        {
+            /* The assignment with distance checks can not be reused */
+            rt->bHavePrev = FALSE;
+        }
+    }
+
     /* The ilist is not sorted yet,
      * we can only do this when we have the charge arrays.
      */
@@ -3,7 +3,7 @@
  *
  * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
  * Copyright (c) 2001-2004, The GROMACS development team.
- * Copyright (c) 2010,2014,2015, by the GROMACS development team, led by
+ * Copyright (c) 2010,2014,2015,2016, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -52,30 +52,73 @@
 #include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/smalloc.h"
 
-/*! \libinternal \brief Structure for the local atom info for a plain list */
+/*! \libinternal \brief Structure for the local atom info */
 typedef struct {
     int  la;   /**< The local atom index */
     int  cell; /**< The DD zone index for neighboring domains, zone+zone otherwise */
 } gmx_laa_t;
 
-/*! \libinternal \brief Structure for the local atom info for a hash table */
-typedef struct {
-    int  ga;   /**< The global atom index */
-    int  la;   /**< The local atom index */
-    int  cell; /**< The DD zone index for neighboring domains, zone+zone otherwise */
-    int  next; /**< Index in the list of the next element with the same hash, -1 if none */
-} gmx_lal_t;
-
-/*! \libinternal \brief Structure for all global to local mapping information */
+/*! \libinternal \brief Structure for all global to local mapping information
+ *
+ * With the hash table, the keys are stored in a separate array from
+ * the values, so probing only touches the compact key array.
+ * Collisions are resolved with linear probing.
+ */
 struct gmx_ga2la_t {
-    gmx_bool   bDirectList;        /**< Use a direct list */
-    int        mod;                /**< The hash size */
-    int        nalloc;             /**< The alloction size of laa or la1 */
-    gmx_laa_t *laa;                /**< The direct list */
-    gmx_lal_t *lal;                /**< The hash table list */
-    int        start_space_search; /**< Index in lal at which to start looking for empty space */
+    gmx_bool   bDirectList; /**< Use a direct list */
+    int        nalloc;      /**< The alloction size of laa, for the hash table a power of 2 */
+    int        mask;        /**< The hash table size - 1 */
+    int        shift;       /**< The shift for the multiplicative hash */
+    int        nentry;      /**< The number of entries in the hash table */
+    int       *ga;          /**< The hash table keys, global atom indices, -1 when empty */
+    gmx_laa_t *laa;         /**< The direct list or the hash table values */
 };
 
+/*! \brief The number of consecutive global atoms that map to consecutive hash table entries */
+#define GA2LA_HASH_BLOCK_LOG2 2
+
+/*! \brief The number of lookups to interleave in the batched lookup functions */
+#define GA2LA_BATCH_SIZE 8
+
+/*! \brief Returns the home index in the hash table for global atom a_gl
+ *
+ * Blocks of consecutive global atoms, which are often looked up together,
+ * map to consecutive entries so they share cache lines. The blocks are
+ * scattered with Fibonacci hashing to avoid clustering of the probes.
+ *
+ * \param[in] ga2la The global to local atom struct
+ * \param[in] a_gl  The global atom index
+ */
+static inline int ga2la_hash_index(const gmx_ga2la_t *ga2la, int a_gl)
+{
+    unsigned int block = static_cast<unsigned int>(a_gl) >> GA2LA_HASH_BLOCK_LOG2;
+
+    return static_cast<int>((((block*2654435769U) >> ga2la->shift) << GA2LA_HASH_BLOCK_LOG2) |
+                            (a_gl & ((1 << GA2LA_HASH_BLOCK_LOG2) - 1)));
+}
+
+/*! \brief Returns the index in the hash table of global atom a_gl, -1 if not present
+ *
+ * \param[in] ga2la The global to local atom struct
+ * \param[in] a_gl  The global atom index
+ */
+static inline int ga2la_hash_find(const gmx_ga2la_t *ga2la, int a_gl)
+{
+    int ind;
+
+    ind = ga2la_hash_index(ga2la, a_gl);
+    while (ga2la->ga[ind] >= 0)
+    {
+        if (ga2la->ga[ind] == a_gl)
+        {
+            return ind;
+        }
+        ind = (ind + 1) & ga2la->mask;
+    }
+
+    return -1;
+}
+
 /*! \brief Clear all the entries in the ga2la list
  *
  * \param[in,out] ga2la The global to local atom struct
@@ -95,11 +138,34 @@ static void ga2la_clear(gmx_ga2la_t *ga2la)
     {
         for (i = 0; i < ga2la->nalloc; i++)
         {
-            ga2la->lal[i].ga   = -1;
-            ga2la->lal[i].next = -1;
+            ga2la->ga[i] = -1;
         }
-        ga2la->start_space_search = ga2la->mod;
+        ga2la->nentry = 0;
+    }
+}
+
+/*! \brief Sets the size of the, empty, hash table
+ *
+ * \param[in,out] ga2la      The global to local atom struct
+ * \param[in]     nentry_max The number of entries to reserve space for
+ */
+static void ga2la_hash_set_size(gmx_ga2la_t *ga2la, int nentry_max)
+{
+    int nlog2;
+
+    /* With linear probing the number of probes increases quickly
+     * with the load factor, so we keep the table at most half full.
+     */
+    nlog2 = GA2LA_HASH_BLOCK_LOG2 + 1;
+    while ((1 << nlog2) < 2*nentry_max)
+    {
+        nlog2++;
     }
+    ga2la->nalloc = (1 << nlog2);
+    ga2la->mask   = ga2la->nalloc - 1;
+    ga2la->shift  = 32 - (nlog2 - GA2LA_HASH_BLOCK_LOG2);
+    srenew(ga2la->ga, ga2la->nalloc);
+    srenew(ga2la->laa, ga2la->nalloc);
 }
 
 /*! \brief Initializes and returns a pointer to a gmx_ga2la_t structure
@@ -117,14 +183,14 @@ static gmx_ga2la_t *ga2la_init(int natoms_total, int natoms_local)
     /* There are two methods implemented for finding the local atom number
      * belonging to a global atom number:
      * 1) a simple, direct array
-     * 2) a hash table consisting of list of linked lists indexed with
-     *    the global number modulo mod.
+     * 2) an open addressing hash table with linear probing
      * Memory requirements:
      * 1) nat_tot*2 ints
-     * 2) nat_loc*(2+1-2(1-e^-1/2))*4 ints
+     * 2) between nat_loc*2*3 and nat_loc*4*3 ints
      * where nat_loc is the number of atoms in the home + communicated zones.
      * Method 1 is faster for low parallelization, 2 for high parallelization.
-     * We switch to method 2 when it uses less than half the memory method 1.
+     * We switch to method 2 when it uses less than roughly half the memory
+     * of method 1.
      */
     ga2la->bDirectList = (natoms_total <= 1024 ||
                           natoms_total <= natoms_local*9);
@@ -136,16 +202,7 @@ static gmx_ga2la_t *ga2la_init(int natoms_total, int natoms_local)
     }
     else
     {
-        /* Make the direct list twice as long as the number of local atoms.
-         * The fraction of entries in the list with:
-         * 0   size lists: e^-1/f
-         * >=1 size lists: 1 - e^-1/f
-         * where f is: the direct list length / #local atoms
-         * The fraction of atoms not in the direct list is: 1-f(1-e^-1/f).
-         */
-        ga2la->mod    = 2*natoms_local;
-        ga2la->nalloc = over_alloc_dd(ga2la->mod);
-        snew(ga2la->lal, ga2la->nalloc);
+        ga2la_hash_set_size(ga2la, natoms_local);
     }
 
     ga2la_clear(ga2la);
@@ -153,6 +210,28 @@ static gmx_ga2la_t *ga2la_init(int natoms_total, int natoms_local)
     return ga2la;
 }
 
+/*! \brief Inserts an entry in the hash table, which should not be present
+ *
+ * \param[in,out] ga2la The global to local atom struct
+ * \param[in]     a_gl  The global atom index
+ * \param[in]     a_loc The local atom index
+ * \param[in]     cell  The cell index
+ */
+static inline void ga2la_hash_insert(gmx_ga2la_t *ga2la, int a_gl, int a_loc, int cell)
+{
+    int ind;
+
+    ind = ga2la_hash_index(ga2la, a_gl);
+    while (ga2la->ga[ind] >= 0)
+    {
+        ind = (ind + 1) & ga2la->mask;
+    }
+    ga2la->ga[ind]       = a_gl;
+    ga2la->laa[ind].la   = a_loc;
+    ga2la->laa[ind].cell = cell;
+    ga2la->nentry++;
+}
+
 /*! \brief Sets the ga2la entry for global atom a_gl
  *
  * \param[in,out] ga2la The global to local atom struct
@@ -162,8 +241,6 @@ static gmx_ga2la_t *ga2la_init(int natoms_total, int natoms_local)
  */
 static void ga2la_set(gmx_ga2la_t *ga2la, int a_gl, int a_loc, int cell)
 {
-    int ind, ind_prev, i;
-
     if (ga2la->bDirectList)
     {
         ga2la->laa[a_gl].la   = a_loc;
@@ -172,40 +249,31 @@ static void ga2la_set(gmx_ga2la_t *ga2la, int a_gl, int a_loc, int cell)
         return;
     }
 
-    ind = a_gl % ga2la->mod;
-
-    if (ga2la->lal[ind].ga >= 0)
+    if (2*(ga2la->nentry + 1) > ga2la->nalloc)
     {
-        /* Search the last entry in the linked list for this index */
-        ind_prev = ind;
-        while (ga2la->lal[ind_prev].next >= 0)
+        /* The table is more than half full, double the size and rehash */
+        int       *ga_old, nalloc_old, i;
+        gmx_laa_t *laa_old;
+
+        ga_old     = ga2la->ga;
+        laa_old    = ga2la->laa;
+        nalloc_old = ga2la->nalloc;
+        ga2la->ga  = NULL;
+        ga2la->laa = NULL;
+        ga2la_hash_set_size(ga2la, 2*ga2la->nentry);
+        ga2la_clear(ga2la);
+        for (i = 0; i < nalloc_old; i++)
         {
-            ind_prev = ga2la->lal[ind_prev].next;
-        }
-        /* Search for space in the array */
-        ind = ga2la->start_space_search;
-        while (ind < ga2la->nalloc && ga2la->lal[ind].ga >= 0)
-        {
-            ind++;
-        }
-        /* If we are at the end of the list we need to increase the size */
-        if (ind == ga2la->nalloc)
-        {
-            ga2la->nalloc = over_alloc_dd(ind+1);
-            srenew(ga2la->lal, ga2la->nalloc);
-            for (i = ind; i < ga2la->nalloc; i++)
+            if (ga_old[i] >= 0)
             {
-                ga2la->lal[i].ga   = -1;
-                ga2la->lal[i].next = -1;
+                ga2la_hash_insert(ga2la, ga_old[i], laa_old[i].la, laa_old[i].cell);
             }
         }
-        ga2la->lal[ind_prev].next = ind;
-
-        ga2la->start_space_search = ind + 1;
+        sfree(ga_old);
+        sfree(laa_old);
     }
-    ga2la->lal[ind].ga   = a_gl;
-    ga2la->lal[ind].la   = a_loc;
-    ga2la->lal[ind].cell = cell;
+
+    ga2la_hash_insert(ga2la, a_gl, a_loc, cell);
 }
 
 /*! \brief Delete the ga2la entry for global atom a_gl
@@ -215,7 +283,7 @@ static void ga2la_set(gmx_ga2la_t *ga2la, int a_gl, int a_loc, int cell)
  */
 static void ga2la_del(gmx_ga2la_t *ga2la, int a_gl)
 {
-    int ind, ind_prev;
+    int ind, next, home;
 
     if (ga2la->bDirectList)
     {
@@ -224,36 +292,36 @@ static void ga2la_del(gmx_ga2la_t *ga2la, int a_gl)
         return;
     }
 
-    ind_prev = -1;
-    ind      = a_gl % ga2la->mod;
-    do
+    ind = ga2la_hash_find(ga2la, a_gl);
+    if (ind < 0)
     {
-        if (ga2la->lal[ind].ga == a_gl)
-        {
-            if (ind_prev >= 0)
-            {
-                ga2la->lal[ind_prev].next = ga2la->lal[ind].next;
-
-                /* This index is a linked entry, so we free an entry.
-                 * Check if we are creating the first empty space.
-                 */
-                if (ind < ga2la->start_space_search)
-                {
-                    ga2la->start_space_search = ind;
-                }
-            }
-            ga2la->lal[ind].ga   = -1;
-            ga2la->lal[ind].cell = -1;
-            ga2la->lal[ind].next = -1;
+        return;
+    }
 
-            return;
+    /* Shift entries after the deleted one back when their probe
+     * sequence passes through the freed entry, so lookups don't need
+     * tombstones.
+     */
+    next = ind;
+    while (TRUE)
+    {
+        next = (next + 1) & ga2la->mask;
+        if (ga2la->ga[next] < 0)
+        {
+            break;
+        }
+        home = ga2la_hash_index(ga2la, ga2la->ga[next]);
+        /* Move the entry when its home index is not cyclically in (ind,next] */
+        if ((next > ind && (home <= ind || home > next)) ||
+            (next < ind && (home <= ind && home > next)))
+        {
+            ga2la->ga[ind]  = ga2la->ga[next];
+            ga2la->laa[ind] = ga2la->laa[next];
+            ind             = next;
         }
-        ind_prev = ind;
-        ind      = ga2la->lal[ind].next;
     }
-    while (ind >= 0);
-
-    return;
+    ga2la->ga[ind] = -1;
+    ga2la->nentry--;
 }
 
 /*! \brief Change the local atom for present ga2la entry for global atom a_gl
@@ -273,20 +341,11 @@ static void ga2la_change_la(gmx_ga2la_t *ga2la, int a_gl, int a_loc)
         return;
     }
 
-    ind = a_gl % ga2la->mod;
-    do
+    ind = ga2la_hash_find(ga2la, a_gl);
+    if (ind >= 0)
     {
-        if (ga2la->lal[ind].ga == a_gl)
-        {
-            ga2la->lal[ind].la = a_loc;
-
-            return;
-        }
-        ind = ga2la->lal[ind].next;
+        ga2la->laa[ind].la = a_loc;
     }
-    while (ind >= 0);
-
-    return;
 }
 
 /*! \brief Returns if the global atom a_gl available locally
@@ -309,19 +368,14 @@ static gmx_bool ga2la_get(const gmx_ga2la_t *ga2la, int a_gl, int *a_loc, int *c
         return (ga2la->laa[a_gl].cell >= 0);
     }
 
-    ind = a_gl % ga2la->mod;
-    do
+    ind = ga2la_hash_find(ga2la, a_gl);
+    if (ind >= 0)
     {
-        if (ga2la->lal[ind].ga == a_gl)
-        {
-            *a_loc = ga2la->lal[ind].la;
-            *cell  = ga2la->lal[ind].cell;
+        *a_loc = ga2la->laa[ind].la;
+        *cell  = ga2la->laa[ind].cell;
 
-            return TRUE;
-        }
-        ind = ga2la->lal[ind].next;
+        return TRUE;
     }
-    while (ind >= 0);
 
     return FALSE;
 }
@@ -344,25 +398,13 @@ static gmx_bool ga2la_get_home(const gmx_ga2la_t *ga2la, int a_gl, int *a_loc)
         return (ga2la->laa[a_gl].cell == 0);
     }
 
-    ind = a_gl % ga2la->mod;
-    do
+    ind = ga2la_hash_find(ga2la, a_gl);
+    if (ind >= 0 && ga2la->laa[ind].cell == 0)
     {
-        if (ga2la->lal[ind].ga == a_gl)
-        {
-            if (ga2la->lal[ind].cell == 0)
-            {
-                *a_loc = ga2la->lal[ind].la;
+        *a_loc = ga2la->laa[ind].la;
 
-                return TRUE;
-            }
-            else
-            {
-                return FALSE;
-            }
-        }
-        ind = ga2la->lal[ind].next;
+        return TRUE;
     }
-    while (ind >= 0);
 
     return FALSE;
 }
@@ -382,18 +424,134 @@ static gmx_bool ga2la_is_home(const gmx_ga2la_t *ga2la, int a_gl)
         return (ga2la->laa[a_gl].cell == 0);
     }
 
-    ind = a_gl % ga2la->mod;
-    do
+    ind = ga2la_hash_find(ga2la, a_gl);
+
+    return (ind >= 0 && ga2la->laa[ind].cell == 0);
+}
+
+/*! \brief Looks up the hash table entries for n global atoms
+ *
+ * The first probes of up to GA2LA_BATCH_SIZE atoms are independent
+ * loads, which the CPU can overlap, instead of resolving each lookup
+ * before starting the next one.
+ *
+ * \param[in]  ga2la The global to local atom struct
+ * \param[in]  n     The number of global atoms
+ * \param[in]  a_gl  The global atom indices, size n
+ * \param[out] ind   The indices in the hash table, -1 for atoms not present, size n
+ */
+static inline void ga2la_hash_find_batch(const gmx_ga2la_t *ga2la, int n, const int *a_gl,
+                                         int *ind)
+{
+    int b0, b1, i;
+    int key[GA2LA_BATCH_SIZE];
+
+    for (b0 = 0; b0 < n; b0 += GA2LA_BATCH_SIZE)
     {
-        if (ga2la->lal[ind].ga == a_gl)
+        b1 = (n < b0 + GA2LA_BATCH_SIZE ? n : b0 + GA2LA_BATCH_SIZE);
+        for (i = b0; i < b1; i++)
         {
-            return (ga2la->lal[ind].cell == 0);
+            ind[i]    = ga2la_hash_index(ga2la, a_gl[i]);
+            key[i-b0] = ga2la->ga[ind[i]];
+        }
+        for (i = b0; i < b1; i++)
+        {
+            if (key[i-b0] != a_gl[i])
+            {
+                ind[i] = (key[i-b0] < 0 ? -1 : ga2la_hash_find(ga2la, a_gl[i]));
+            }
         }
-        ind = ga2la->lal[ind].next;
     }
-    while (ind >= 0);
+}
 
-    return FALSE;
+/*! \brief Looks up n global atoms, equivalent to calling ga2la_get for each
+ *
+ * \param[in]  ga2la The global to local atom struct
+ * \param[in]  n     The number of global atoms
+ * \param[in]  a_gl  The global atom indices, size n
+ * \param[out] a_loc The local atom indices, only valid for atoms that are available locally, size n
+ * \param[out] cell  The zone as returned by ga2la_get, -1 for atoms not available locally, size n
+ * \return the number of atoms available locally
+ */
+static int ga2la_get_batch(const gmx_ga2la_t *ga2la, int n, const int *a_gl,
+                           int *a_loc, int *cell)
+{
+    int i, nlocal;
+
+    nlocal = 0;
+    if (ga2la->bDirectList)
+    {
+        for (i = 0; i < n; i++)
+        {
+            a_loc[i] = ga2la->laa[a_gl[i]].la;
+            cell[i]  = ga2la->laa[a_gl[i]].cell;
+            if (cell[i] >= 0)
+            {
+                nlocal++;
+            }
+        }
+
+        return nlocal;
+    }
+
+    /* We use cell as temporary storage for the hash table indices */
+    ga2la_hash_find_batch(ga2la, n, a_gl, cell);
+    for (i = 0; i < n; i++)
+    {
+        if (cell[i] >= 0)
+        {
+            a_loc[i] = ga2la->laa[cell[i]].la;
+            cell[i]  = ga2la->laa[cell[i]].cell;
+            nlocal++;
+        }
+    }
+
+    return nlocal;
+}
+
+/*! \brief Looks up n global atoms, equivalent to calling ga2la_get_home for each
+ *
+ * \param[in]  ga2la The global to local atom struct
+ * \param[in]  n     The number of global atoms
+ * \param[in]  a_gl  The global atom indices, size n
+ * \param[out] a_loc The local atom indices, only valid for home atoms, size n
+ * \param[out] bHome Tells if each atom is a home atom, size n
+ * \return the number of home atoms
+ */
+static int ga2la_get_home_batch(const gmx_ga2la_t *ga2la, int n, const int *a_gl,
+                                int *a_loc, gmx_bool *bHome)
+{
+    int i, nhome;
+
+    nhome = 0;
+    if (ga2la->bDirectList)
+    {
+        for (i = 0; i < n; i++)
+        {
+            a_loc[i] = ga2la->laa[a_gl[i]].la;
+            bHome[i] = (ga2la->laa[a_gl[i]].cell == 0);
+            if (bHome[i])
+            {
+                nhome++;
+            }
+        }
+
+        return nhome;
+    }
+
+    /* We use a_loc as temporary storage for the hash table indices */
+    ga2la_hash_find_batch(ga2la, n, a_gl, a_loc);
+    for (i = 0; i < n; i++)
+    {
+        bHome[i] = (a_loc[i] >= 0 && ga2la->laa[a_loc[i]].cell == 0);
+        if (bHome[i])
+        {
+            a_loc[i] = ga2la->laa[a_loc[i]].la;
+            nhome++;
+        }
+    }
+
+    return nhome;
 }
 
 #endif
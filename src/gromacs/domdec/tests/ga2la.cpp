@@ -0,0 +1,361 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2016, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests the global to local atom lookup, in particular deletion from
+ * the open-addressing hash table.
+ *
+ * \ingroup module_domdec
+ */
+#include "gmxpre.h"
+
+#include "gromacs/domdec/ga2la.h"
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+/*! \brief The number of global atoms, large enough to select the hash table */
+const int c_numAtomsTotal = 1 << 20;
+
+/*! \brief Reference contents of the table, the local atom index and cell for each global atom */
+typedef std::map<int, std::pair<int, int> > ReferenceMap;
+
+/*! \brief Test fixture owning a gmx_ga2la_t */
+class Ga2laTest : public ::testing::Test
+{
+    public:
+        Ga2laTest() : ga2la_(NULL)
+        {
+        }
+        ~Ga2laTest()
+        {
+            if (ga2la_ != NULL)
+            {
+                sfree(ga2la_->ga);
+                sfree(ga2la_->laa);
+                sfree(ga2la_);
+            }
+        }
+
+        //! Creates a hash table with room for \p numAtomsLocal atoms
+        void createHashTable(int numAtomsLocal)
+        {
+            ga2la_ = ga2la_init(c_numAtomsTotal, numAtomsLocal);
+            ASSERT_FALSE(ga2la_->bDirectList);
+        }
+
+        //! Returns \p count global atoms, starting at \p start, that hash to \p home
+        std::vector<int> atomsWithHomeIndex(int home, int count, int start = 0)
+        {
+            std::vector<int> atoms;
+            for (int a = start; static_cast<int>(atoms.size()) < count; a++)
+            {
+                if (ga2la_hash_index(ga2la_, a) == home)
+                {
+                    atoms.push_back(a);
+                }
+            }
+            return atoms;
+        }
+
+        /*! \brief Checks that exactly the entries in \p ref are present
+         *
+         * Also checks that each entry can be reached by probing from
+         * its home index, i.e. that deletion left no gaps in the
+         * probe sequences.
+         */
+        void checkEntries(const ReferenceMap &ref)
+        {
+            int numOccupied = 0;
+            for (int i = 0; i < ga2la_->nalloc; i++)
+            {
+                if (ga2la_->ga[i] >= 0)
+                {
+                    numOccupied++;
+                    for (int j = ga2la_hash_index(ga2la_, ga2la_->ga[i]); j != i; j = (j + 1) & ga2la_->mask)
+                    {
+                        EXPECT_GE(ga2la_->ga[j], 0) << "Empty entry in the probe sequence of atom " << ga2la_->ga[i];
+                    }
+                }
+            }
+            EXPECT_EQ(static_cast<int>(ref.size()), ga2la_->nentry);
+            EXPECT_EQ(ga2la_->nentry, numOccupied);
+
+            for (const auto &entry : ref)
+            {
+                int a_loc, cell;
+                EXPECT_TRUE(ga2la_get(ga2la_, entry.first, &a_loc, &cell)) << "Atom " << entry.first << " is missing";
+                EXPECT_EQ(entry.second.first, a_loc);
+                EXPECT_EQ(entry.second.second, cell);
+            }
+        }
+
+        //! Sets atom \p a_gl in the table and in \p ref, with the cell derived from \p a_loc
+        void set(ReferenceMap *ref, int a_gl, int a_loc)
+        {
+            ga2la_set(ga2la_, a_gl, a_loc, a_loc % 3);
+            (*ref)[a_gl] = std::make_pair(a_loc, a_loc % 3);
+        }
+
+        //! Deletes atom \p a_gl from the table and from \p ref
+        void del(ReferenceMap *ref, int a_gl)
+        {
+            ga2la_del(ga2la_, a_gl);
+            ref->erase(a_gl);
+        }
+
+        //! The struct under test
+        gmx_ga2la_t *ga2la_;
+};
+
+TEST_F(Ga2laTest, FindsCollidingAtoms)
+{
+    createHashTable(8);
+    std::vector<int>   atoms = atomsWithHomeIndex(5, 4);
+    ReferenceMap ref;
+    for (size_t i = 0; i < atoms.size(); i++)
+    {
+        set(&ref, atoms[i], i);
+    }
+    checkEntries(ref);
+
+    std::vector<int> missing = atomsWithHomeIndex(5, 1, atoms.back() + 1);
+    int              a_loc, cell;
+    EXPECT_FALSE(ga2la_get(ga2la_, missing[0], &a_loc, &cell));
+}
+
+TEST_F(Ga2laTest, DeletesEachOfCollidingAtoms)
+{
+    createHashTable(8);
+    /* Two interleaved collision chains, so deletion has to skip
+     * entries that must stay in place.
+     */
+    std::vector<int> atoms  = atomsWithHomeIndex(4, 3);
+    std::vector<int> atoms5 = atomsWithHomeIndex(5, 3);
+    atoms.insert(atoms.begin() + 1, atoms5.begin(), atoms5.end());
+
+    for (size_t d = 0; d < atoms.size(); d++)
+    {
+        ga2la_clear(ga2la_);
+        ReferenceMap ref;
+        for (size_t i = 0; i < atoms.size(); i++)
+        {
+            set(&ref, atoms[i], 10 + i);
+        }
+        del(&ref, atoms[d]);
+        SCOPED_TRACE("Deleted atom " + std::to_string(atoms[d]));
+        checkEntries(ref);
+        int a_loc, cell;
+        EXPECT_FALSE(ga2la_get(ga2la_, atoms[d], &a_loc, &cell));
+    }
+}
+
+TEST_F(Ga2laTest, DeletesAcrossTheWrapOfTheTable)
+{
+    createHashTable(8);
+    /* Atoms with home index mask and mask-1 fill the last two entries
+     * and continue at the start of the table. Atoms with home index 0
+     * come after them and should not move in front of their home index.
+     */
+    std::vector<int> atoms  = atomsWithHomeIndex(ga2la_->mask, 3);
+    std::vector<int> before = atomsWithHomeIndex(ga2la_->mask - 1, 1);
+    std::vector<int> atoms0 = atomsWithHomeIndex(0, 2);
+    atoms.insert(atoms.begin(), before.begin(), before.end());
+    atoms.insert(atoms.end(), atoms0.begin(), atoms0.end());
+    ASSERT_LE(2*static_cast<int>(atoms.size()), ga2la_->nalloc);
+
+    for (size_t d = 0; d < atoms.size(); d++)
+    {
+        ga2la_clear(ga2la_);
+        ReferenceMap ref;
+        for (size_t i = 0; i < atoms.size(); i++)
+        {
+            set(&ref, atoms[i], 20 + i);
+        }
+        EXPECT_GE(ga2la_->ga[0], 0) << "The test atoms should wrap around the end of the table";
+        del(&ref, atoms[d]);
+        SCOPED_TRACE("Deleted atom " + std::to_string(atoms[d]));
+        checkEntries(ref);
+    }
+}
+
+TEST_F(Ga2laTest, ChangesTheLocalIndex)
+{
+    createHashTable(8);
+    std::vector<int>   atoms = atomsWithHomeIndex(3, 3);
+    ReferenceMap ref;
+    for (size_t i = 0; i < atoms.size(); i++)
+    {
+        set(&ref, atoms[i], 3*i);
+    }
+    ga2la_change_la(ga2la_, atoms[1], 42);
+
+    int a_loc, cell;
+    ASSERT_TRUE(ga2la_get(ga2la_, atoms[1], &a_loc, &cell));
+    EXPECT_EQ(42, a_loc);
+    EXPECT_EQ(0, cell) << "Only the local index should change";
+    ASSERT_TRUE(ga2la_get(ga2la_, atoms[2], &a_loc, &cell));
+    EXPECT_EQ(6, a_loc);
+    EXPECT_EQ(3, ga2la_->nentry);
+}
+
+TEST_F(Ga2laTest, MatchesAReferenceMapUnderManyChanges)
+{
+    /* A small table and a small range of atoms give many collisions,
+     * and the table has to grow several times.
+     */
+    createHashTable(4);
+    ReferenceMap ref;
+    unsigned int       state = 12345;
+    for (int step = 0; step < 2000; step++)
+    {
+        state     = state*1103515245U + 12345U;
+        int a_gl  = (state >> 8) % 300;
+        int op    = (state >> 20) % 4;
+        if (ref.count(a_gl) == 0)
+        {
+            set(&ref, a_gl, step);
+        }
+        else if (op == 0)
+        {
+            ga2la_change_la(ga2la_, a_gl, step);
+            ref[a_gl].first = step;
+        }
+        else
+        {
+            del(&ref, a_gl);
+        }
+        if (step % 50 == 0)
+        {
+            SCOPED_TRACE("After step " + std::to_string(step));
+            checkEntries(ref);
+        }
+    }
+    checkEntries(ref);
+    EXPECT_GT(ga2la_->nalloc, 8);
+}
+
+/*! \brief Checks that the batched lookups agree with the single lookups */
+void checkBatchLookups(const gmx_ga2la_t *ga2la, const std::vector<int> &atoms)
+{
+    int              n = atoms.size();
+    std::vector<int> a_loc(n), cell(n), a_loc_home(n);
+    std::vector<int> bHome(n);
+
+    int              nlocal = ga2la_get_batch(ga2la, n, atoms.data(), a_loc.data(), cell.data());
+    int              nhome  = ga2la_get_home_batch(ga2la, n, atoms.data(), a_loc_home.data(), bHome.data());
+
+    int              nlocalRef = 0, nhomeRef = 0;
+    for (int i = 0; i < n; i++)
+    {
+        int      a_loc_ref, cell_ref;
+        gmx_bool bLocal = ga2la_get(ga2la, atoms[i], &a_loc_ref, &cell_ref);
+        if (bLocal)
+        {
+            nlocalRef++;
+            EXPECT_EQ(a_loc_ref, a_loc[i]) << "for atom " << atoms[i];
+            EXPECT_EQ(cell_ref, cell[i]) << "for atom " << atoms[i];
+        }
+        else
+        {
+            EXPECT_LT(cell[i], 0) << "for atom " << atoms[i];
+        }
+
+        gmx_bool bHomeRef = ga2la_get_home(ga2la, atoms[i], &a_loc_ref);
+        EXPECT_EQ(bHomeRef, bHome[i]) << "for atom " << atoms[i];
+        if (bHomeRef)
+        {
+            nhomeRef++;
+            EXPECT_EQ(a_loc_ref, a_loc_home[i]) << "for atom " << atoms[i];
+        }
+        EXPECT_EQ(bHomeRef, ga2la_is_home(ga2la, atoms[i])) << "for atom " << atoms[i];
+    }
+    EXPECT_EQ(nlocalRef, nlocal);
+    EXPECT_EQ(nhomeRef, nhome);
+}
+
+TEST_F(Ga2laTest, BatchLookupMatchesSingleLookup)
+{
+    createHashTable(32);
+    /* Chains of colliding atoms, so most lookups need more than
+     * the first probe.
+     */
+    std::vector<int> atoms;
+    for (int home = 0; home < 8; home++)
+    {
+        std::vector<int> chain = atomsWithHomeIndex(2*home, 5);
+        for (int i = 0; i < 4; i++)
+        {
+            /* Cell 0 is home, the other cells are halo zones */
+            ga2la_set(ga2la_, chain[i], atoms.size(), (home + i) % 4);
+        }
+        /* The last atom of each chain is not present */
+        atoms.insert(atoms.end(), chain.begin(), chain.end());
+    }
+    ga2la_del(ga2la_, atoms[6]);
+
+    /* A count that is not a multiple of the batch size */
+    atoms.push_back(atoms[3]);
+    ASSERT_NE(0, static_cast<int>(atoms.size()) % GA2LA_BATCH_SIZE);
+    checkBatchLookups(ga2la_, atoms);
+}
+
+TEST(Ga2laDirectListTest, BatchLookupMatchesSingleLookup)
+{
+    gmx_ga2la_t     *ga2la = ga2la_init(500, 500);
+    ASSERT_TRUE(ga2la->bDirectList);
+
+    std::vector<int> atoms;
+    for (int a = 0; a < 100; a += 3)
+    {
+        ga2la_set(ga2la, 2*a, a, a % 4);
+        atoms.push_back(2*a);
+        atoms.push_back(2*a + 1);
+    }
+    ga2la_del(ga2la, 2*9);
+    checkBatchLookups(ga2la, atoms);
+
+    sfree(ga2la->laa);
+    sfree(ga2la);
+}
+
+} // namespace
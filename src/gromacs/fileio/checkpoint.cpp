@@ -97,7 +97,7 @@
  * But old code can not read a new entry that is present in the file
  * (but can read a new format when new entries are not present).
  */
-static const int cpt_version = 16;
+static const int cpt_version = 18;
 
 
 const char *est_names[estNR] =
@@ -764,6 +764,7 @@ static void do_cpt_header(XDR *xd, gmx_bool bRead, int *file_version,
                           int *nlambda, int *flags_state,
                           int *flags_eks, int *flags_enh, int *flags_dfh,
                           int *nED, int *eSwapCoords,
+                          int *nstlist_tuned, double *replex_ref_t,
                           FILE *list)
 {
     bool_t res = 0;
@@ -909,6 +910,22 @@ static void do_cpt_header(XDR *xd, gmx_bool bRead, int *file_version,
     {
         do_cpt_int_err(xd, "swap", eSwapCoords, list);
     }
+    if (*file_version >= 17)
+    {
+        do_cpt_int_err(xd, "tuned nstlist", nstlist_tuned, list);
+    }
+    else
+    {
+        *nstlist_tuned = 0;
+    }
+    if (*file_version >= 18)
+    {
+        do_cpt_double_err(xd, "replica exchange ref_t", replex_ref_t, list);
+    }
+    else
+    {
+        *replex_ref_t = 0;
+    }
 }
 
 static int do_cpt_footer(XDR *xd, int file_version)
@@ -1469,6 +1486,7 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
                       ivec domdecCells, int nppnodes,
                       int eIntegrator, int simulation_part,
                       gmx_bool bExpanded, int elamstats,
+                      int nstlist_tuned, double replex_ref_t,
                       gmx_int64_t step, double t, t_state *state)
 {
     t_fileio            *fp;
@@ -1601,7 +1619,7 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
                   &state->natoms, &state->ngtc, &state->nnhpres,
                   &state->nhchainlength, &(state->dfhist.nlambda), &state->flags, &flags_eks, &flags_enh, &flags_dfh,
                   &state->edsamstate.nED, &state->swapstate.eSwapCoords,
-                  NULL);
+                  &nstlist_tuned, &replex_ref_t, NULL);
 
     sfree(version);
     sfree(btime);
@@ -1839,7 +1857,8 @@ static void check_match(FILE *fplog,
 }
 
 static void read_checkpoint(const char *fn, FILE **pfplog,
-                            t_commrec *cr, ivec dd_nc,
+                            t_commrec *cr, ivec dd_nc, int *nstlist_tuned,
+                            double *replex_ref_t,
                             int eIntegrator, int *init_fep_state, gmx_int64_t *step, double *t,
                             t_state *state, gmx_bool *bReadEkin,
                             int *simulation_part,
@@ -1885,7 +1904,8 @@ static void read_checkpoint(const char *fn, FILE **pfplog,
                   &nppnodes_f, dd_nc_f, &npmenodes_f,
                   &natoms, &ngtc, &nnhpres, &nhchainlength, &nlambda,
                   &fflags, &flags_eks, &flags_enh, &flags_dfh,
-                  &state->edsamstate.nED, &state->swapstate.eSwapCoords, NULL);
+                  &state->edsamstate.nED, &state->swapstate.eSwapCoords,
+                  nstlist_tuned, replex_ref_t, NULL);
 
     if (bAppendOutputFiles &&
         file_version >= 13 && double_prec != GMX_CPT_BUILD_DP)
@@ -2237,19 +2257,21 @@ static void read_checkpoint(const char *fn, FILE **pfplog,
 
 
 void load_checkpoint(const char *fn, FILE **fplog,
-                     t_commrec *cr, ivec dd_nc,
+                     t_commrec *cr, ivec dd_nc, int *nstlist_tuned,
                      t_inputrec *ir, t_state *state,
                      gmx_bool *bReadEkin,
                      gmx_bool bAppend, gmx_bool bForceAppend)
 {
     gmx_int64_t     step;
     double          t;
+    double          replex_ref_t = 0;
+    int             g;
 
     if (SIMMASTER(cr))
     {
         /* Read the state from the checkpoint file */
         read_checkpoint(fn, fplog,
-                        cr, dd_nc,
+                        cr, dd_nc, nstlist_tuned, &replex_ref_t,
                         ir->eI, &(ir->fepvals->init_fep_state), &step, &t, state, bReadEkin,
                         &ir->simulation_part, bAppend, bForceAppend);
     }
@@ -2257,6 +2279,8 @@ void load_checkpoint(const char *fn, FILE **fplog,
     {
         gmx_bcast(sizeof(cr->npmenodes), &cr->npmenodes, cr);
         gmx_bcast(DIM*sizeof(dd_nc[0]), dd_nc, cr);
+        gmx_bcast(sizeof(*nstlist_tuned), nstlist_tuned, cr);
+        gmx_bcast(sizeof(replex_ref_t), &replex_ref_t, cr);
         gmx_bcast(sizeof(step), &step, cr);
         gmx_bcast(sizeof(*bReadEkin), bReadEkin, cr);
     }
@@ -2267,6 +2291,17 @@ void load_checkpoint(const char *fn, FILE **fplog,
     }
     ir->init_step        = step;
     ir->simulation_part += 1;
+    if (replex_ref_t > 0)
+    {
+        /* Continue at the temperature reached by replica exchange */
+        for (g = 0; g < ir->opts.ngtc; g++)
+        {
+            if (ir->opts.ref_t[g] > 0)
+            {
+                ir->opts.ref_t[g] = replex_ref_t;
+            }
+        }
+    }
 }
 
 void read_checkpoint_part_and_step(const char  *filename,
@@ -2279,7 +2314,8 @@ void read_checkpoint_part_and_step(const char  *filename,
     int       eIntegrator;
     int       nppnodes, npme;
     ivec      dd_nc;
-    int       flags_eks, flags_enh, flags_dfh;
+    int       flags_eks, flags_enh, flags_dfh, nstlist_tuned;
+    double    replex_ref_t;
     double    t;
     t_state   state;
     t_fileio *fp;
@@ -2302,7 +2338,8 @@ void read_checkpoint_part_and_step(const char  *filename,
                   &eIntegrator, simulation_part, step, &t, &nppnodes, dd_nc, &npme,
                   &state.natoms, &state.ngtc, &state.nnhpres, &state.nhchainlength,
                   &(state.dfhist.nlambda), &state.flags, &flags_eks, &flags_enh, &flags_dfh,
-                  &state.edsamstate.nED, &state.swapstate.eSwapCoords, NULL);
+                  &state.edsamstate.nED, &state.swapstate.eSwapCoords,
+                  &nstlist_tuned, &replex_ref_t, NULL);
 
     gmx_fio_close(fp);
 }
@@ -2317,7 +2354,8 @@ static void read_checkpoint_data(t_fileio *fp, int *simulation_part,
     int                  eIntegrator;
     int                  nppnodes, npme;
     ivec                 dd_nc;
-    int                  flags_eks, flags_enh, flags_dfh;
+    int                  flags_eks, flags_enh, flags_dfh, nstlist_tuned;
+    double               replex_ref_t;
     int                  nfiles_loc;
     gmx_file_position_t *files_loc = NULL;
     int                  ret;
@@ -2327,7 +2365,8 @@ static void read_checkpoint_data(t_fileio *fp, int *simulation_part,
                   &eIntegrator, simulation_part, step, t, &nppnodes, dd_nc, &npme,
                   &state->natoms, &state->ngtc, &state->nnhpres, &state->nhchainlength,
                   &(state->dfhist.nlambda), &state->flags, &flags_eks, &flags_enh, &flags_dfh,
-                  &state->edsamstate.nED, &state->swapstate.eSwapCoords, NULL);
+                  &state->edsamstate.nED, &state->swapstate.eSwapCoords,
+                  &nstlist_tuned, &replex_ref_t, NULL);
     ret =
         do_cpt_state(gmx_fio_getxdr(fp), TRUE, state->flags, state, NULL);
     if (ret)
@@ -2462,7 +2501,8 @@ void list_checkpoint(const char *fn, FILE *out)
     double               t;
     ivec                 dd_nc;
     t_state              state;
-    int                  flags_eks, flags_enh, flags_dfh;
+    int                  flags_eks, flags_enh, flags_dfh, nstlist_tuned;
+    double               replex_ref_t;
     int                  ret;
     gmx_file_position_t *outputfiles;
     int                  nfiles;
@@ -2476,7 +2516,7 @@ void list_checkpoint(const char *fn, FILE *out)
                   &state.natoms, &state.ngtc, &state.nnhpres, &state.nhchainlength,
                   &(state.dfhist.nlambda), &state.flags,
                   &flags_eks, &flags_enh, &flags_dfh, &state.edsamstate.nED,
-                  &state.swapstate.eSwapCoords, out);
+                  &state.swapstate.eSwapCoords, &nstlist_tuned, &replex_ref_t, out);
     ret = do_cpt_state(gmx_fio_getxdr(fp), TRUE, state.flags, &state, out);
     if (ret)
     {
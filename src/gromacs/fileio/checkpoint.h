@@ -60,12 +60,16 @@ struct t_trxframe;
 /* Write a checkpoint to <fn>.cpt
  * Appends the _step<step>.cpt with bNumberAndKeep,
  * otherwise moves the previous <fn>.cpt to <fn>_prev.cpt
+ * nstlist_tuned is the nstlist value chosen by run-time tuning, 0 if none.
+ * replex_ref_t is the reference temperature reached by exchanging
+ * temperatures in replica exchange, 0 if none.
  */
 void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
                       FILE *fplog, t_commrec *cr,
                       ivec domdecCells, int nppnodes,
                       int eIntegrator, int simulation_part,
                       gmx_bool bExpanded, int elamstats,
+                      int nstlist_tuned, double replex_ref_t,
                       gmx_int64_t step, double t,
                       t_state *state);
 
@@ -78,9 +82,13 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
  * files so they can be appended.
  * With bAppend and bForceAppend: truncate anyhow if the system does not
  * support file locking.
+ * Returns in nstlist_tuned the nstlist value chosen by run-time tuning
+ * in the run that wrote the checkpoint, 0 if none.
+ * When the checkpoint stores a reference temperature reached by
+ * replica exchange, the reference temperatures in ir are set to it.
  */
 void load_checkpoint(const char *fn, FILE **fplog,
-                     t_commrec *cr, ivec dd_nc,
+                     t_commrec *cr, ivec dd_nc, int *nstlist_tuned,
                      t_inputrec *ir, t_state *state,
                      gmx_bool *bReadEkin,
                      gmx_bool bAppend, gmx_bool bForceAppend);
@@ -55,6 +55,7 @@
    WARNING WARNING WARNING WARNING */
 
 #include "thread_mpi/lock.h"
+#include "thread_mpi/threads.h"
 
 #include "gromacs/fileio/xdrf.h"
 
@@ -68,6 +69,7 @@ struct t_fileio
     XDR         *xdr;                  /* the xdr data pointer */
     enum xdr_op  xdrmode;              /* the xdr mode */
     int          iFTP;                 /* the file type identifier */
+    tMPI_Thread_t owner;               /* the thread that opened the file */
 
     t_fileio    *next, *prev;          /* next and previous file pointers in the
                                           linked list */
@@ -355,6 +355,7 @@ t_fileio *gmx_fio_open(const char *fn, const char *mode)
     fio->bRead             = bRead;
     fio->bReadWrite        = bReadWrite;
     fio->bDouble           = (sizeof(real) == sizeof(double));
+    fio->owner             = tMPI_Thread_self();
 
     /* and now insert this file into the list of open files. */
     gmx_fio_insert(fio);
@@ -590,6 +591,7 @@ int gmx_fio_get_output_file_positions(gmx_file_position_t **p_outputfiles,
     int                   nfiles, nalloc;
     gmx_file_position_t * outputfiles;
     t_fileio             *cur;
+    tMPI_Thread_t         self;
 
     nfiles = 0;
 
@@ -597,12 +599,21 @@ int gmx_fio_get_output_file_positions(gmx_file_position_t **p_outputfiles,
     nalloc = 100;
     snew(outputfiles, nalloc);
 
+    /* With multiple simulations in one thread-MPI process the output
+     * files of the other simulations are open as well. The output files
+     * of a simulation are opened by its master rank, which is also the
+     * rank that asks for the positions, so we only list files opened by
+     * this thread.
+     */
+    self = tMPI_Thread_self();
+
     cur = gmx_fio_get_first();
     while (cur)
     {
         /* Skip the checkpoint files themselves, since they could be open when
            we call this routine... */
-        if (!cur->bRead && cur->iFTP != efCPT)
+        if (!cur->bRead && cur->iFTP != efCPT &&
+            tMPI_Thread_equal(cur->owner, self))
         {
             /* This is an output file currently open for writing, add it */
             if (nfiles == nalloc)
@@ -283,6 +283,14 @@ void gmx_init_intranode_counters(t_commrec *cr)
     rank_intranode     = cr->sim_nodeid;
     nrank_pp_intranode = cr->nnodes - cr->npmenodes;
     rank_pp_intranode  = cr->nodeid;
+    if (MULTISIM(cr))
+    {
+        /* With thread-MPI all simulations run in this process */
+        rank_intranode     += cr->ms->sim*nrank_intranode;
+        nrank_intranode    *= cr->ms->nsim;
+        rank_pp_intranode  += cr->ms->sim*nrank_pp_intranode;
+        nrank_pp_intranode *= cr->ms->nsim;
+    }
 #endif
 
     if (debug)
@@ -400,6 +408,33 @@ void gmx_sumd(int gmx_unused nr, double gmx_unused r[], const t_commrec gmx_unus
 #endif
 }
 
+gmx_bool gmx_sumd_start(int nr, double r[], const t_commrec *cr,
+                        MPI_Request gmx_unused *request)
+{
+#if defined GMX_LIB_MPI && defined MPI_IN_PLACE_EXISTS && MPI_VERSION >= 3
+    if (!cr->nc.bUse)
+    {
+        MPI_Iallreduce(MPI_IN_PLACE, r, nr, MPI_DOUBLE, MPI_SUM,
+                       cr->mpi_comm_mygroup, request);
+
+        return TRUE;
+    }
+#endif
+    /* Thread-MPI and the two step summing have no nonblocking variant */
+    gmx_sumd(nr, r, cr);
+
+    return FALSE;
+}
+
+void gmx_sumd_finish(MPI_Request gmx_unused *request)
+{
+#if defined GMX_LIB_MPI && MPI_VERSION >= 3
+    MPI_Wait(request, MPI_STATUS_IGNORE);
+#else
+    gmx_call("gmx_sumd_finish");
+#endif
+}
+
 void gmx_sumf(int gmx_unused nr, float gmx_unused r[], const t_commrec gmx_unused *cr)
 {
 #ifndef GMX_MPI
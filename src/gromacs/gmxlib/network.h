@@ -90,6 +90,17 @@ void gmx_sumf(int nr, float r[], const struct t_commrec *cr);
 void gmx_sumd(int nr, double r[], const struct t_commrec *cr);
 /* Calculate the global sum of an array of doubles */
 
+gmx_bool gmx_sumd_start(int nr, double r[], const struct t_commrec *cr,
+                        MPI_Request *request);
+/* Start calculating the global sum of an array of doubles.
+ * Returns TRUE when a nonblocking sum was started, which should be
+ * completed with gmx_sumd_finish before r is accessed. Returns FALSE
+ * when the nonblocking sum is not supported and the sum is complete.
+ */
+
+void gmx_sumd_finish(MPI_Request *request);
+/* Complete a nonblocking global sum started with gmx_sumd_start */
+
 void gmx_sumi_sim(int nr, int r[], const struct gmx_multisim_t *ms);
 /* Calculate the sum over the simulations of an array of ints */
 
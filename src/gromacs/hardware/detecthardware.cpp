@@ -1080,6 +1080,39 @@ static std::string detected_hardware_string(const gmx_hw_info_t *hwinfo,
     s += gmx::formatString("    SIMD instructions selected at GROMACS compile time: %s\n",
                            gmx::simdString(gmx::simdCompiled()).c_str());
 
+    const gmx::HardwareTopology &hwTop = *hwinfo->hardwareTopology;
+
+    if (hwTop.supportLevel() >= gmx::HardwareTopology::SupportLevel::Basic)
+    {
+        const gmx::HardwareTopology::Machine &machine = hwTop.machine();
+
+        s += gmx::formatString("  Hardware topology: %s\n",
+                               hwTop.supportLevel() >= gmx::HardwareTopology::SupportLevel::Full ? "Full" : "Basic");
+        s += gmx::formatString("    Sockets: %d   Cores per socket: %d   Logical cores per core: %d\n",
+                               static_cast<int>(machine.sockets.size()),
+                               static_cast<int>(machine.sockets[0].cores.size()),
+                               static_cast<int>(machine.sockets[0].cores[0].hwThreads.size()));
+        if (!machine.lastLevelCaches.empty())
+        {
+            const gmx::HardwareTopology::Cache &llc = machine.lastLevelCaches[0];
+
+            s += gmx::formatString("    Last-level caches: %d x L%d",
+                                   static_cast<int>(machine.lastLevelCaches.size()),
+                                   llc.level);
+            if (llc.size > 0)
+            {
+                s += gmx::formatString(" %d KB", static_cast<int>(llc.size/1024));
+            }
+            s += gmx::formatString(", shared by %d logical cores each\n",
+                                   static_cast<int>(llc.logicalProcessorId.size()));
+        }
+        if (!machine.numa.empty())
+        {
+            s += gmx::formatString("    NUMA nodes: %d\n",
+                                   static_cast<int>(machine.numa.size()));
+        }
+    }
+
     if (bGPUBinary && (hwinfo->ngpu_compatible_tot > 0 ||
                        hwinfo->gpu_info.n_dev > 0))
     {
@@ -47,12 +47,17 @@
 
 #include "config.h"
 
+#include <cstdlib>
+
 #include <algorithm>
+#include <fstream>
+#include <string>
 #include <vector>
 
 #include <thread>
 
 #include "gromacs/hardware/cpuinfo.h"
+#include "gromacs/utility/basedefinitions.h"
 
 #ifdef HAVE_UNISTD_H
 #    include <unistd.h>       // sysconf()
@@ -115,6 +120,128 @@ parseFromCpuInfo(const gmx::CpuInfo           &cpuInfo,
 
 }
 
+/*! \brief Read the first line of a text file, e.g. in sysfs
+ *
+ *  \param  path  File to read
+ *  \return The first line, or an empty string if the file cannot be read.
+ */
+std::string
+readFirstLine(const std::string &path)
+{
+    std::ifstream file(path);
+    std::string   line;
+
+    if (file)
+    {
+        std::getline(file, line);
+    }
+    return line;
+}
+
+/*! \brief Add last-level cache and ccNUMA information from Linux sysfs
+ *
+ *  \param  machine  Machine tree structure where information will be assigned.
+ *                   The logical processors must already be set.
+ *  \return true if the last-level caches could be detected.
+ */
+bool
+parseFromSysfs(HardwareTopology::Machine *machine)
+{
+#if defined __linux__
+    const std::string              cpuDir   = "/sys/devices/system/cpu/cpu";
+    const std::string              nodeDir  = "/sys/devices/system/node/node";
+    const int                      nLogical = machine->logicalProcessorCount;
+    int                            llcLevel = 0;
+    std::size_t                    llcSize  = 0;
+    std::vector<std::string>       llcList(nLogical);
+    std::vector<std::vector<int> > lists;
+
+    // Find the highest data or unified cache level of each logical processor
+    for (int i = 0; i < nLogical; i++)
+    {
+        int level = 0;
+
+        for (int index = 0;; index++)
+        {
+            std::string cacheDir = cpuDir + std::to_string(i) + "/cache/index" + std::to_string(index) + "/";
+            std::string levelStr = readFirstLine(cacheDir + "level");
+
+            if (levelStr.empty())
+            {
+                break;
+            }
+            if (readFirstLine(cacheDir + "type") == "Instruction")
+            {
+                continue;
+            }
+            int l = std::atoi(levelStr.c_str());
+            if (l >= level)
+            {
+                level      = l;
+                llcList[i] = readFirstLine(cacheDir + "shared_cpu_list");
+                if (l >= llcLevel)
+                {
+                    // Sizes are reported as e.g. "16384K"
+                    std::string sizeStr = readFirstLine(cacheDir + "size");
+                    llcSize = std::strtoul(sizeStr.c_str(), NULL, 10);
+                    if (sizeStr.find('K') != std::string::npos)
+                    {
+                        llcSize *= 1024;
+                    }
+                    else if (sizeStr.find('M') != std::string::npos)
+                    {
+                        llcSize *= 1024*1024;
+                    }
+                }
+            }
+        }
+        if (level == 0 || (llcLevel > 0 && level != llcLevel))
+        {
+            // Missing or inconsistent cache information
+            return false;
+        }
+        llcLevel = level;
+    }
+
+    for (int i = 0; i < nLogical; i++)
+    {
+        std::vector<int> list = parseCpuList(llcList[i]);
+        if (std::find(lists.begin(), lists.end(), list) == lists.end())
+        {
+            lists.push_back(list);
+        }
+    }
+    if (!listsPartitionProcessors(&lists, nLogical))
+    {
+        return false;
+    }
+    for (auto &list : lists)
+    {
+        machine->lastLevelCaches.push_back( { llcLevel, llcSize, list } );
+    }
+
+    // The ccNUMA nodes are optional, on single-node machines they might not be present
+    lists.clear();
+    for (int node : parseCpuList(readFirstLine("/sys/devices/system/node/online")))
+    {
+        lists.push_back(parseCpuList(readFirstLine(nodeDir + std::to_string(node) + "/cpulist")));
+    }
+    if (!lists.empty() && listsPartitionProcessors(&lists, nLogical))
+    {
+        for (auto &list : lists)
+        {
+            machine->numa.push_back( { list } );
+        }
+    }
+
+    return true;
+#else
+    GMX_UNUSED_VALUE(machine);
+
+    return false;
+#endif
+}
+
 /*! \brief Try to detect the number of logical processors.
  *
  *  \return The number of hardware processing units, or 0 if it fails.
@@ -160,6 +287,68 @@ detectLogicalProcessorCount()
 
 }   // namespace anonymous
 
+std::vector<int>
+parseCpuList(const std::string &cpuList)
+{
+    std::vector<int> result;
+    const char      *p = cpuList.c_str();
+
+    while (*p != '\0' && *p != '\n')
+    {
+        char *end;
+        long  first = std::strtol(p, &end, 10);
+        long  last  = first;
+
+        if (end == p || first < 0)
+        {
+            return std::vector<int>();
+        }
+        p = end;
+        if (*p == '-')
+        {
+            p++;
+            last = std::strtol(p, &end, 10);
+            if (end == p || last < first)
+            {
+                return std::vector<int>();
+            }
+            p = end;
+        }
+        for (long i = first; i <= last; i++)
+        {
+            result.push_back(static_cast<int>(i));
+        }
+        if (*p == ',')
+        {
+            p++;
+        }
+    }
+    return result;
+}
+
+bool
+listsPartitionProcessors(std::vector<std::vector<int> > *lists,
+                         int                             nLogical)
+{
+    std::vector<int> count(nLogical, 0);
+
+    for (auto &list : *lists)
+    {
+        list.erase(std::remove_if(list.begin(), list.end(),
+                                  [nLogical](int i) { return i >= nLogical; }),
+                   list.end());
+        for (int i : list)
+        {
+            count[i]++;
+        }
+    }
+    lists->erase(std::remove_if(lists->begin(), lists->end(),
+                                [](const std::vector<int> &l) { return l.empty(); }),
+                 lists->end());
+
+    return std::all_of(count.begin(), count.end(), [](int c) { return c == 1; });
+}
+
 // static
 HardwareTopology HardwareTopology::detect()
 {
@@ -172,6 +361,11 @@ HardwareTopology HardwareTopology::detect()
         // There is topology information in cpuInfo
         parseFromCpuInfo(cpuInfo, &result.machine_);
         result.supportLevel_ = SupportLevel::Basic;
+
+        if (parseFromSysfs(&result.machine_))
+        {
+            result.supportLevel_ = SupportLevel::Full;
+        }
     }
     else
     {
@@ -192,4 +386,34 @@ HardwareTopology::HardwareTopology()
 {
 }
 
+std::vector<int>
+HardwareTopology::lastLevelCacheIndices() const
+{
+    std::vector<int> index(std::max(machine_.logicalProcessorCount, 0), -1);
+
+    for (std::size_t c = 0; c < machine_.lastLevelCaches.size(); c++)
+    {
+        for (int i : machine_.lastLevelCaches[c].logicalProcessorId)
+        {
+            index[i] = static_cast<int>(c);
+        }
+    }
+    return index;
+}
+
+std::vector<int>
+HardwareTopology::numaNodeIndices() const
+{
+    std::vector<int> index(std::max(machine_.logicalProcessorCount, 0), -1);
+
+    for (std::size_t n = 0; n < machine_.numa.size(); n++)
+    {
+        for (int i : machine_.numa[n].logicalProcessorId)
+        {
+            index[i] = static_cast<int>(n);
+        }
+    }
+    return index;
+}
+
 } // namespace gmx
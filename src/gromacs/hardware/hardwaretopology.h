@@ -43,6 +43,9 @@
 #ifndef GMX_HARDWARE_HARDWARETOPOLOGY_H
 #define GMX_HARDWARE_HARDWARETOPOLOGY_H
 
+#include <cstddef>
+
+#include <string>
 #include <vector>
 
 #include "gromacs/hardware/cpuinfo.h"
@@ -78,7 +81,7 @@ class HardwareTopology
         };
 
         // For now the structures describing the machine are very basic, but they
-        // will grow to include e.g. cache and core-group information in the future.
+        // will grow to include e.g. core-group information in the future.
 
         /*! \libinternal \brief Information about a single hardware thread in a core */
         struct HWThread
@@ -98,6 +101,20 @@ class HardwareTopology
             std::vector<Core>      cores;          //!< All the cores in this socket
         };
 
+        /*! \libinternal \brief Information about a cache shared by a group of logical processors */
+        struct Cache
+        {
+            int                    level;              //!< Cache level, e.g. 3 for an L3 cache
+            std::size_t            size;               //!< Cache size in bytes, 0 if unknown
+            std::vector<int>       logicalProcessorId; //!< Logical processors sharing this cache
+        };
+
+        /*! \libinternal \brief Information about a single ccNUMA node */
+        struct NumaNode
+        {
+            std::vector<int>       logicalProcessorId; //!< Logical processors in this node
+        };
+
         /*! \libinternal \brief Information about socket, core and hwthread for a logical processor */
         struct LogicalProcessor
         {
@@ -126,6 +143,8 @@ class HardwareTopology
             int                            logicalProcessorCount; //!< Number of logical processors in system
             std::vector<LogicalProcessor>  logicalProcessors;     //!< Map logical processors to socket/core
             std::vector<Socket>            sockets;               //!< All the sockets in the system
+            std::vector<Cache>             lastLevelCaches;       //!< All instances of the last-level cache
+            std::vector<NumaNode>          numa;                  //!< All ccNUMA nodes in the system
         };
 
     public:
@@ -160,7 +179,8 @@ class HardwareTopology
          *  - With SupportLevel::Basic, you can access the vectors of sockets,
          *    cores, and hardware threads, and query what logical processorId
          *    each hardware thread corresponds to.
-         *  - SupportLevel::Full adds cache, memory and ccNUMA information.
+         *  - SupportLevel::Full adds the last-level caches and ccNUMA nodes,
+         *    each with the logical processors that share them.
          *  - SupportLevel::FullWithDevices also adds the PCI express bus.
          *
          *  While data that is not valid has been initialized to special values,
@@ -170,6 +190,22 @@ class HardwareTopology
         const Machine &
         machine() const { return machine_; }
 
+        /*! \brief Returns the index of the last-level cache for each logical processor
+         *
+         *  The returned vector has machine().logicalProcessorCount entries,
+         *  all set to -1 when the support level is lower than SupportLevel::Full.
+         */
+        std::vector<int>
+        lastLevelCacheIndices() const;
+
+        /*! \brief Returns the index of the ccNUMA node for each logical processor
+         *
+         *  The returned vector has machine().logicalProcessorCount entries,
+         *  all set to -1 when the support level is lower than SupportLevel::Full.
+         */
+        std::vector<int>
+        numaNodeIndices() const;
+
     private:
 
         HardwareTopology();
@@ -178,6 +214,27 @@ class HardwareTopology
         Machine             machine_;      //!< The machine map
 };
 
+/*! \brief Parse a Linux cpu list string, e.g. "0-3,8-11"
+ *
+ *  \param  cpuList  The list, ranges separated by commas
+ *  \return The indices in the list, empty if the string could not be parsed.
+ */
+std::vector<int>
+parseCpuList(const std::string &cpuList);
+
+/*! \brief Check that lists of logical processors partition the machine
+ *
+ *  Processors beyond the detected logical processor count, and lists
+ *  that are empty after removing those, are removed.
+ *
+ *  \param  lists    The lists with logical processor indices
+ *  \param  nLogical The number of logical processors
+ *  \return true when every logical processor occurs in exactly one list.
+ */
+bool
+listsPartitionProcessors(std::vector<std::vector<int> > *lists,
+                         int                             nLogical);
+
 }
 
 #endif // GMX_HARDWARE_HARDWARETOPOLOGY_H
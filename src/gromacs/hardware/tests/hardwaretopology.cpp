@@ -43,6 +43,9 @@
 
 #include "gromacs/hardware/hardwaretopology.h"
 
+#include <string>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 namespace
@@ -103,4 +106,102 @@ TEST(HardwareTopologyTest, Execute)
     }
 }
 
+TEST(HardwareTopologyTest, PlacesEachProcessorInOneLastLevelCache)
+{
+    gmx::HardwareTopology hwTop(gmx::HardwareTopology::detect());
+
+    std::string           commonMsg =
+        "\nGROMACS might still work, but it will likely hurt your performance."
+        "\nPlease mail gmx-developers@gromacs.org so we can try to fix it.";
+
+    if (hwTop.supportLevel() >= gmx::HardwareTopology::SupportLevel::Full)
+    {
+        // Every logical processor should be in exactly one last-level cache
+        std::vector<int> count(hwTop.machine().logicalProcessorCount, 0);
+        for (auto &c : hwTop.machine().lastLevelCaches)
+        {
+            for (int idx : c.logicalProcessorId)
+            {
+                ASSERT_LT(idx, hwTop.machine().logicalProcessorCount)
+                << "Impossible logical processor index in cache information. " << commonMsg << std::endl;
+                count[idx]++;
+            }
+        }
+        for (std::size_t i = 0; i < count.size(); i++)
+        {
+            EXPECT_EQ(1, count[i])
+            << "Logical processor " << i << " is not in exactly one last-level cache. " << commonMsg << std::endl;
+        }
+
+        std::vector<int> llcIndex = hwTop.lastLevelCacheIndices();
+        for (std::size_t i = 0; i < llcIndex.size(); i++)
+        {
+            EXPECT_GE(llcIndex[i], 0)
+            << "No last-level cache index for logical processor " << i << ". " << commonMsg << std::endl;
+        }
+    }
+}
+
+TEST(HardwareTopologyTest, ParsesCpuLists)
+{
+    EXPECT_EQ(std::vector<int>({0, 1, 2, 3}), gmx::parseCpuList("0-3"));
+    EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 8, 9}), gmx::parseCpuList("0-3,8-9\n"));
+    EXPECT_EQ(std::vector<int>({5}), gmx::parseCpuList("5"));
+    EXPECT_EQ(std::vector<int>({1, 4, 6, 7}), gmx::parseCpuList("1,4,6-7"));
+    EXPECT_EQ(std::vector<int>({2}), gmx::parseCpuList("2-2"));
+}
+
+TEST(HardwareTopologyTest, ReturnsEmptyCpuListForEmptyOrMalformedInput)
+{
+    EXPECT_TRUE(gmx::parseCpuList("").empty());
+    EXPECT_TRUE(gmx::parseCpuList("\n").empty());
+    EXPECT_TRUE(gmx::parseCpuList("a").empty());
+    EXPECT_TRUE(gmx::parseCpuList("-1").empty());
+    EXPECT_TRUE(gmx::parseCpuList("3-1").empty());
+    EXPECT_TRUE(gmx::parseCpuList("1-").empty());
+    EXPECT_TRUE(gmx::parseCpuList("1,,2").empty());
+    EXPECT_TRUE(gmx::parseCpuList("0-3x").empty());
+}
+
+TEST(HardwareTopologyTest, AcceptsListsThatPartitionProcessors)
+{
+    std::vector<std::vector<int> > lists = { { 0, 1, 4, 5 }, { 2, 3, 6, 7 } };
+
+    EXPECT_TRUE(gmx::listsPartitionProcessors(&lists, 8));
+    EXPECT_EQ(2U, lists.size());
+}
+
+TEST(HardwareTopologyTest, RemovesProcessorsBeyondTheCount)
+{
+    // E.g. sysfs lists CPUs that are present but not online
+    std::vector<std::vector<int> > lists = { { 0, 1, 8, 9 }, { 2, 3 }, { 10, 11 } };
+
+    EXPECT_TRUE(gmx::listsPartitionProcessors(&lists, 4));
+    ASSERT_EQ(2U, lists.size());
+    EXPECT_EQ(std::vector<int>({0, 1}), lists[0]);
+    EXPECT_EQ(std::vector<int>({2, 3}), lists[1]);
+}
+
+TEST(HardwareTopologyTest, RejectsOverlappingLists)
+{
+    std::vector<std::vector<int> > lists = { { 0, 1, 2 }, { 2, 3 } };
+
+    EXPECT_FALSE(gmx::listsPartitionProcessors(&lists, 4));
+
+    std::vector<std::vector<int> > duplicates = { { 0, 1, 1 }, { 2, 3 } };
+
+    EXPECT_FALSE(gmx::listsPartitionProcessors(&duplicates, 4));
+}
+
+TEST(HardwareTopologyTest, RejectsIncompleteLists)
+{
+    std::vector<std::vector<int> > lists = { { 0, 1 }, { 3 } };
+
+    EXPECT_FALSE(gmx::listsPartitionProcessors(&lists, 4));
+
+    std::vector<std::vector<int> > noLists;
+
+    EXPECT_FALSE(gmx::listsPartitionProcessors(&noLists, 2));
+}
+
 } // namespace
@@ -203,6 +203,29 @@ gmx_sparsematrix_increment_value(gmx_sparsematrix_t *    A,
 }
 
 
+void
+gmx_sparsematrix_set_row(gmx_sparsematrix_t *             A,
+                         int                              row,
+                         int                              n,
+                         const gmx_sparsematrix_entry_t * entries)
+{
+    int i;
+
+    assert(row < A->nrow);
+    assert(A->ndata[row] == 0);
+
+    if (n > A->nalloc[row])
+    {
+        A->nalloc[row] = n;
+        srenew(A->data[row], A->nalloc[row]);
+    }
+    for (i = 0; i < n; i++)
+    {
+        A->data[row][i] = entries[i];
+    }
+    A->ndata[row] = n;
+}
+
 /* Routine to compare column values of two entries, used for quicksort of each row.
  *
  * The data entries to compare are of the type gmx_sparsematrix_entry_t, but quicksort
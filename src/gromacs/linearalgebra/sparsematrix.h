@@ -172,6 +172,18 @@ gmx_sparsematrix_increment_value(gmx_sparsematrix_t *    A,
 
 
 
+/*! \brief Set all entries of a row which does not have entries yet.
+ *
+ *  The n entries are copied and should be sorted on ascending column.
+ *  This is much faster than adding the entries one by one with
+ *  gmx_sparsematrix_increment_value, since no search is needed.
+ */
+void
+gmx_sparsematrix_set_row        (gmx_sparsematrix_t *             A,
+                                 int                              row,
+                                 int                              n,
+                                 const gmx_sparsematrix_entry_t * entries);
+
 /*! \brief Sort elements in each column and remove zeros.
  *
  *  Sparse matrix access is faster when the elements are stored in
@@ -1824,6 +1824,62 @@ do_dih_fup_noshiftf_precalc(int i, int j, int k, int l,
     rvec_inc(f[l], f_l);
 }
 
+/* As do_dih_fup_noshiftf_precalc above, but with shift forces */
+static gmx_inline void
+do_dih_fup_precalc(int i, int j, int k, int l,
+                   real p, real q,
+                   real f_i_x, real f_i_y, real f_i_z,
+                   real mf_l_x, real mf_l_y, real mf_l_z,
+                   const rvec x[], rvec f[], rvec fshift[],
+                   const t_pbc *pbc, const t_graph *g)
+{
+    rvec f_i, f_j, f_k, f_l;
+    rvec uvec, vvec, svec, dx;
+    ivec jt, dt_ij, dt_kj, dt_lj;
+    int  t1, t2, t3;
+
+    f_i[XX] = f_i_x;
+    f_i[YY] = f_i_y;
+    f_i[ZZ] = f_i_z;
+    f_l[XX] = -mf_l_x;
+    f_l[YY] = -mf_l_y;
+    f_l[ZZ] = -mf_l_z;
+    svmul(p, f_i, uvec);
+    svmul(q, f_l, vvec);
+    rvec_sub(uvec, vvec, svec);
+    rvec_sub(f_i, svec, f_j);
+    rvec_add(f_l, svec, f_k);
+    rvec_inc(f[i], f_i);
+    rvec_dec(f[j], f_j);
+    rvec_dec(f[k], f_k);
+    rvec_inc(f[l], f_l);
+
+    if (g)
+    {
+        copy_ivec(SHIFT_IVEC(g, j), jt);
+        ivec_sub(SHIFT_IVEC(g, i), jt, dt_ij);
+        ivec_sub(SHIFT_IVEC(g, k), jt, dt_kj);
+        ivec_sub(SHIFT_IVEC(g, l), jt, dt_lj);
+        t1 = IVEC2IS(dt_ij);
+        t2 = IVEC2IS(dt_kj);
+        t3 = IVEC2IS(dt_lj);
+    }
+    else
+    {
+        /* The SIMD code only returns the PBC corrected distances,
+         * so we need to determine the shift indices here.
+         */
+        t1 = pbc_rvec_sub(pbc, x[i], x[j], dx);
+        t2 = pbc_rvec_sub(pbc, x[k], x[j], dx);
+        t3 = pbc_rvec_sub(pbc, x[l], x[j], dx);
+    }
+
+    rvec_inc(fshift[t1], f_i);
+    rvec_dec(fshift[CENTRAL], f_j);
+    rvec_dec(fshift[t2], f_k);
+    rvec_inc(fshift[t3], f_l);
+}
+
 
 real dopdihs(real cpA, real cpB, real phiA, real phiB, int mult,
              real phi, real lambda, real *V, real *F)
@@ -2010,22 +2066,113 @@ pdihs_noener(int nbonds,
 
 #if GMX_SIMD_HAVE_REAL
 
-/* As pdihs_noner above, but using SIMD to calculate many dihedrals at once */
-void
-pdihs_noener_simd(int nbonds,
-                  const t_iatom forceatoms[], const t_iparams forceparams[],
-                  const rvec x[], rvec f[],
-                  const t_pbc *pbc, const t_graph gmx_unused *g,
-                  real gmx_unused lambda,
-                  const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
-                  int gmx_unused *global_atom_index)
+/* Spread the forces of GMX_SIMD_REAL_WIDTH dihedrals, of which the first
+ * nlane are valid, over the atoms, given minus the derivative of
+ * the potential with respect to the dihedral angle in mddphi_S and
+ * m, n, p and q as returned by dih_angle_simd.
+ * When fshift!=NULL, shift forces are also computed.
+ */
+static gmx_inline void
+dih_fup_simd(const int *ai, const int *aj, const int *ak, const int *al,
+             int nlane,
+             gmx_simd_real_t mddphi_S,
+             gmx_simd_real_t nrkj_m2_S, gmx_simd_real_t nrkj_n2_S,
+             gmx_simd_real_t mx_S, gmx_simd_real_t my_S, gmx_simd_real_t mz_S,
+             gmx_simd_real_t nx_S, gmx_simd_real_t ny_S, gmx_simd_real_t nz_S,
+             const real *p, const real *q,
+             real *dr,
+             const rvec x[], rvec f[], rvec fshift[],
+             const t_pbc *pbc, const t_graph *g)
+{
+    gmx_simd_real_t sf_i_S, msf_l_S;
+    int             s;
+
+    sf_i_S   = gmx_simd_mul_r(mddphi_S, nrkj_m2_S);
+    msf_l_S  = gmx_simd_mul_r(mddphi_S, nrkj_n2_S);
+
+    /* After this m?_S will contain f[i] */
+    mx_S     = gmx_simd_mul_r(sf_i_S, mx_S);
+    my_S     = gmx_simd_mul_r(sf_i_S, my_S);
+    mz_S     = gmx_simd_mul_r(sf_i_S, mz_S);
+
+    /* After this m?_S will contain -f[l] */
+    nx_S     = gmx_simd_mul_r(msf_l_S, nx_S);
+    ny_S     = gmx_simd_mul_r(msf_l_S, ny_S);
+    nz_S     = gmx_simd_mul_r(msf_l_S, nz_S);
+
+    gmx_simd_store_r(dr + 0*GMX_SIMD_REAL_WIDTH, mx_S);
+    gmx_simd_store_r(dr + 1*GMX_SIMD_REAL_WIDTH, my_S);
+    gmx_simd_store_r(dr + 2*GMX_SIMD_REAL_WIDTH, mz_S);
+    gmx_simd_store_r(dr + 3*GMX_SIMD_REAL_WIDTH, nx_S);
+    gmx_simd_store_r(dr + 4*GMX_SIMD_REAL_WIDTH, ny_S);
+    gmx_simd_store_r(dr + 5*GMX_SIMD_REAL_WIDTH, nz_S);
+
+    if (fshift == NULL)
+    {
+        for (s = 0; s < nlane; s++)
+        {
+            do_dih_fup_noshiftf_precalc(ai[s], aj[s], ak[s], al[s],
+                                        p[s], q[s],
+                                        dr[     XX *GMX_SIMD_REAL_WIDTH+s],
+                                        dr[     YY *GMX_SIMD_REAL_WIDTH+s],
+                                        dr[     ZZ *GMX_SIMD_REAL_WIDTH+s],
+                                        dr[(DIM+XX)*GMX_SIMD_REAL_WIDTH+s],
+                                        dr[(DIM+YY)*GMX_SIMD_REAL_WIDTH+s],
+                                        dr[(DIM+ZZ)*GMX_SIMD_REAL_WIDTH+s],
+                                        f);
+        }
+    }
+    else
+    {
+        for (s = 0; s < nlane; s++)
+        {
+            do_dih_fup_precalc(ai[s], aj[s], ak[s], al[s],
+                               p[s], q[s],
+                               dr[     XX *GMX_SIMD_REAL_WIDTH+s],
+                               dr[     YY *GMX_SIMD_REAL_WIDTH+s],
+                               dr[     ZZ *GMX_SIMD_REAL_WIDTH+s],
+                               dr[(DIM+XX)*GMX_SIMD_REAL_WIDTH+s],
+                               dr[(DIM+YY)*GMX_SIMD_REAL_WIDTH+s],
+                               dr[(DIM+ZZ)*GMX_SIMD_REAL_WIDTH+s],
+                               x, f, fshift, pbc, g);
+        }
+    }
+}
+
+/* Return the sum of the first nlane elements of e_S, e is aligned storage */
+static gmx_inline real
+sum_lanes_simd(real *e, gmx_simd_real_t e_S, int nlane)
+{
+    real vtot;
+    int  s;
+
+    gmx_simd_store_r(e, e_S);
+    vtot = 0;
+    for (s = 0; s < nlane; s++)
+    {
+        vtot += e[s];
+    }
+
+    return vtot;
+}
+
+/* SIMD kernel for proper dihedrals, returns the energy.
+ * When fshift=NULL, no energies and shift forces are calculated
+ * and 0 is returned.
+ */
+static real
+low_pdihs_simd(int nbonds,
+               const t_iatom forceatoms[], const t_iparams forceparams[],
+               const rvec x[], rvec f[], rvec fshift[],
+               const t_pbc *pbc, const t_graph *g)
 {
     const int             nfa1 = 5;
-    int                   i, iu, s;
+    int                   i, iu, s, nlane;
     int                   type, ai[GMX_SIMD_REAL_WIDTH], aj[GMX_SIMD_REAL_WIDTH], ak[GMX_SIMD_REAL_WIDTH], al[GMX_SIMD_REAL_WIDTH];
     real                  dr_array[3*DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *dr;
     real                  buf_array[7*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *buf;
-    real                 *cp, *phi0, *mult, *p, *q;
+    real                 *cp, *phi0, *mult, *p, *q, *e;
+    real                  vtot;
     gmx_simd_real_t       phi0_S, phi_S;
     gmx_simd_real_t       mx_S, my_S, mz_S;
     gmx_simd_real_t       nx_S, ny_S, nz_S;
@@ -2033,9 +2180,10 @@ pdihs_noener_simd(int nbonds,
     gmx_simd_real_t       cp_S, mdphi_S, mult_S;
     gmx_simd_real_t       sin_S, cos_S;
     gmx_simd_real_t       mddphi_S;
-    gmx_simd_real_t       sf_i_S, msf_l_S;
     pbc_simd_t            pbc_simd;
 
+    gmx_simd_real_t       one_S = gmx_simd_set1_r(1.0);
+
     /* Ensure SIMD register alignment */
     dr  = gmx_simd_align_r(dr_array);
     buf = gmx_simd_align_r(buf_array);
@@ -2046,9 +2194,12 @@ pdihs_noener_simd(int nbonds,
     mult  = buf + 2*GMX_SIMD_REAL_WIDTH;
     p     = buf + 3*GMX_SIMD_REAL_WIDTH;
     q     = buf + 4*GMX_SIMD_REAL_WIDTH;
+    e     = buf + 5*GMX_SIMD_REAL_WIDTH;
 
     set_pbc_simd(pbc, &pbc_simd);
 
+    vtot = 0;
+
     /* nbonds is the number of dihedrals times nfa1, here we step GMX_SIMD_REAL_WIDTH dihs */
     for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH*nfa1)
     {
@@ -2074,6 +2225,7 @@ pdihs_noener_simd(int nbonds,
                 iu += nfa1;
             }
         }
+        nlane = std::min(GMX_SIMD_REAL_WIDTH, (nbonds - i)/nfa1);
 
         /* Caclulate GMX_SIMD_REAL_WIDTH dihedral angles at once */
         dih_angle_simd(x, ai, aj, ak, al, &pbc_simd,
@@ -2094,74 +2246,72 @@ pdihs_noener_simd(int nbonds,
         /* Calculate GMX_SIMD_REAL_WIDTH sines at once */
         gmx_simd_sincos_r(mdphi_S, &sin_S, &cos_S);
         mddphi_S = gmx_simd_mul_r(gmx_simd_mul_r(cp_S, mult_S), sin_S);
-        sf_i_S   = gmx_simd_mul_r(mddphi_S, nrkj_m2_S);
-        msf_l_S  = gmx_simd_mul_r(mddphi_S, nrkj_n2_S);
-
-        /* After this m?_S will contain f[i] */
-        mx_S     = gmx_simd_mul_r(sf_i_S, mx_S);
-        my_S     = gmx_simd_mul_r(sf_i_S, my_S);
-        mz_S     = gmx_simd_mul_r(sf_i_S, mz_S);
-
-        /* After this m?_S will contain -f[l] */
-        nx_S     = gmx_simd_mul_r(msf_l_S, nx_S);
-        ny_S     = gmx_simd_mul_r(msf_l_S, ny_S);
-        nz_S     = gmx_simd_mul_r(msf_l_S, nz_S);
-
-        gmx_simd_store_r(dr + 0*GMX_SIMD_REAL_WIDTH, mx_S);
-        gmx_simd_store_r(dr + 1*GMX_SIMD_REAL_WIDTH, my_S);
-        gmx_simd_store_r(dr + 2*GMX_SIMD_REAL_WIDTH, mz_S);
-        gmx_simd_store_r(dr + 3*GMX_SIMD_REAL_WIDTH, nx_S);
-        gmx_simd_store_r(dr + 4*GMX_SIMD_REAL_WIDTH, ny_S);
-        gmx_simd_store_r(dr + 5*GMX_SIMD_REAL_WIDTH, nz_S);
 
-        iu = i;
-        s  = 0;
-        do
+        if (fshift != NULL)
         {
-            do_dih_fup_noshiftf_precalc(ai[s], aj[s], ak[s], al[s],
-                                        p[s], q[s],
-                                        dr[     XX *GMX_SIMD_REAL_WIDTH+s],
-                                        dr[     YY *GMX_SIMD_REAL_WIDTH+s],
-                                        dr[     ZZ *GMX_SIMD_REAL_WIDTH+s],
-                                        dr[(DIM+XX)*GMX_SIMD_REAL_WIDTH+s],
-                                        dr[(DIM+YY)*GMX_SIMD_REAL_WIDTH+s],
-                                        dr[(DIM+ZZ)*GMX_SIMD_REAL_WIDTH+s],
-                                        f);
-            s++;
-            iu += nfa1;
+            vtot += sum_lanes_simd(e, gmx_simd_mul_r(cp_S, gmx_simd_add_r(one_S, cos_S)), nlane);
         }
-        while (s < GMX_SIMD_REAL_WIDTH && iu < nbonds);
+
+        dih_fup_simd(ai, aj, ak, al, nlane, mddphi_S, nrkj_m2_S, nrkj_n2_S,
+                     mx_S, my_S, mz_S, nx_S, ny_S, nz_S, p, q, dr,
+                     x, f, fshift, pbc, g);
     }
+
+    return vtot;
+}
+
+/* As pdihs_noner above, but using SIMD to calculate many dihedrals at once */
+void
+pdihs_noener_simd(int nbonds,
+                  const t_iatom forceatoms[], const t_iparams forceparams[],
+                  const rvec x[], rvec f[],
+                  const t_pbc *pbc, const t_graph gmx_unused *g,
+                  real gmx_unused lambda,
+                  const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                  int gmx_unused *global_atom_index)
+{
+    low_pdihs_simd(nbonds, forceatoms, forceparams, x, f, NULL, pbc, NULL);
+}
+
+/* As pdihs above, but using SIMD to calculate many dihedrals at once.
+ * Only the A-state parameters are used, so no dV/dlambda is computed.
+ */
+real
+pdihs_simd(int nbonds,
+           const t_iatom forceatoms[], const t_iparams forceparams[],
+           const rvec x[], rvec f[], rvec fshift[],
+           const t_pbc *pbc, const t_graph *g,
+           real gmx_unused lambda, real gmx_unused *dvdlambda,
+           const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+           int gmx_unused *global_atom_index)
+{
+    return low_pdihs_simd(nbonds, forceatoms, forceparams, x, f, fshift, pbc, g);
 }
 
-/* This is mostly a copy of pdihs_noener_simd above, but with using
+/* This is mostly a copy of low_pdihs_simd above, but with using
  * the RB potential instead of a harmonic potential.
- * This function can replace rbdihs() when no energy and virial are needed.
  */
-void
-rbdihs_noener_simd(int nbonds,
-                   const t_iatom forceatoms[], const t_iparams forceparams[],
-                   const rvec x[], rvec f[],
-                   const t_pbc *pbc, const t_graph gmx_unused *g,
-                   real gmx_unused lambda,
-                   const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
-                   int gmx_unused *global_atom_index)
+static real
+low_rbdihs_simd(int nbonds,
+                const t_iatom forceatoms[], const t_iparams forceparams[],
+                const rvec x[], rvec f[], rvec fshift[],
+                const t_pbc *pbc, const t_graph *g)
 {
     const int             nfa1 = 5;
-    int                   i, iu, s, j;
+    int                   i, iu, s, j, nlane;
     int                   type, ai[GMX_SIMD_REAL_WIDTH], aj[GMX_SIMD_REAL_WIDTH], ak[GMX_SIMD_REAL_WIDTH], al[GMX_SIMD_REAL_WIDTH];
     real                  dr_array[3*DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *dr;
     real                  buf_array[(NR_RBDIHS + 4)*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *buf;
-    real                 *parm, *p, *q;
+    real                 *parm, *p, *q, *e;
+    real                  vtot;
 
     gmx_simd_real_t       phi_S;
-    gmx_simd_real_t       ddphi_S, cosfac_S;
+    gmx_simd_real_t       ddphi_S, cosfac_S, v_S;
     gmx_simd_real_t       mx_S, my_S, mz_S;
     gmx_simd_real_t       nx_S, ny_S, nz_S;
     gmx_simd_real_t       nrkj_m2_S, nrkj_n2_S;
     gmx_simd_real_t       parm_S, c_S;
     gmx_simd_real_t       sin_S, cos_S;
-    gmx_simd_real_t       sf_i_S, msf_l_S;
     pbc_simd_t            pbc_simd;
 
     gmx_simd_real_t       pi_S  = gmx_simd_set1_r(M_PI);
@@ -2175,9 +2325,12 @@ rbdihs_noener_simd(int nbonds,
     parm  = buf;
     p     = buf + (NR_RBDIHS + 0)*GMX_SIMD_REAL_WIDTH;
     q     = buf + (NR_RBDIHS + 1)*GMX_SIMD_REAL_WIDTH;
+    e     = buf + (NR_RBDIHS + 2)*GMX_SIMD_REAL_WIDTH;
 
     set_pbc_simd(pbc, &pbc_simd);
 
+    vtot = 0;
+
     /* nbonds is the number of dihedrals times nfa1, here we step GMX_SIMD_REAL_WIDTH dihs */
     for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH*nfa1)
     {
@@ -2193,10 +2346,10 @@ rbdihs_noener_simd(int nbonds,
             ak[s] = forceatoms[iu+3];
             al[s] = forceatoms[iu+4];
 
-            /* We don't need the first parameter, since that's a constant
-             * which only affects the energies, not the forces.
+            /* The first parameter is a constant which only affects
+             * the energies, not the forces.
              */
-            for (j = 1; j < NR_RBDIHS; j++)
+            for (j = 0; j < NR_RBDIHS; j++)
             {
                 parm[j*GMX_SIMD_REAL_WIDTH + s] =
                     forceparams[type].rbdihs.rbcA[j];
@@ -2208,6 +2361,7 @@ rbdihs_noener_simd(int nbonds,
                 iu += nfa1;
             }
         }
+        nlane = std::min(GMX_SIMD_REAL_WIDTH, (nbonds - i)/nfa1);
 
         /* Caclulate GMX_SIMD_REAL_WIDTH dihedral angles at once */
         dih_angle_simd(x, ai, aj, ak, al, &pbc_simd,
@@ -2225,6 +2379,7 @@ rbdihs_noener_simd(int nbonds,
         gmx_simd_sincos_r(phi_S, &sin_S, &cos_S);
 
         ddphi_S   = gmx_simd_setzero_r();
+        v_S       = gmx_simd_load_r(parm);
         c_S       = one_S;
         cosfac_S  = one_S;
         for (j = 1; j < NR_RBDIHS; j++)
@@ -2232,52 +2387,53 @@ rbdihs_noener_simd(int nbonds,
             parm_S   = gmx_simd_load_r(parm + j*GMX_SIMD_REAL_WIDTH);
             ddphi_S  = gmx_simd_fmadd_r(gmx_simd_mul_r(c_S, parm_S), cosfac_S, ddphi_S);
             cosfac_S = gmx_simd_mul_r(cosfac_S, cos_S);
+            v_S      = gmx_simd_fmadd_r(parm_S, cosfac_S, v_S);
             c_S      = gmx_simd_add_r(c_S, one_S);
         }
 
+        if (fshift != NULL)
+        {
+            vtot += sum_lanes_simd(e, v_S, nlane);
+        }
+
         /* Note that here we do not use the minus sign which is present
-         * in the normal RB code. This is corrected for through (m)sf below.
+         * in the normal RB code. This is corrected for through (m)sf
+         * in dih_fup_simd.
          */
         ddphi_S  = gmx_simd_mul_r(ddphi_S, sin_S);
 
-        sf_i_S   = gmx_simd_mul_r(ddphi_S, nrkj_m2_S);
-        msf_l_S  = gmx_simd_mul_r(ddphi_S, nrkj_n2_S);
-
-        /* After this m?_S will contain f[i] */
-        mx_S     = gmx_simd_mul_r(sf_i_S, mx_S);
-        my_S     = gmx_simd_mul_r(sf_i_S, my_S);
-        mz_S     = gmx_simd_mul_r(sf_i_S, mz_S);
+        dih_fup_simd(ai, aj, ak, al, nlane, ddphi_S, nrkj_m2_S, nrkj_n2_S,
+                     mx_S, my_S, mz_S, nx_S, ny_S, nz_S, p, q, dr,
+                     x, f, fshift, pbc, g);
+    }
 
-        /* After this m?_S will contain -f[l] */
-        nx_S     = gmx_simd_mul_r(msf_l_S, nx_S);
-        ny_S     = gmx_simd_mul_r(msf_l_S, ny_S);
-        nz_S     = gmx_simd_mul_r(msf_l_S, nz_S);
+    return vtot;
+}
 
-        gmx_simd_store_r(dr + 0*GMX_SIMD_REAL_WIDTH, mx_S);
-        gmx_simd_store_r(dr + 1*GMX_SIMD_REAL_WIDTH, my_S);
-        gmx_simd_store_r(dr + 2*GMX_SIMD_REAL_WIDTH, mz_S);
-        gmx_simd_store_r(dr + 3*GMX_SIMD_REAL_WIDTH, nx_S);
-        gmx_simd_store_r(dr + 4*GMX_SIMD_REAL_WIDTH, ny_S);
-        gmx_simd_store_r(dr + 5*GMX_SIMD_REAL_WIDTH, nz_S);
+/* This function can replace rbdihs() when no energy and virial are needed */
+void
+rbdihs_noener_simd(int nbonds,
+                   const t_iatom forceatoms[], const t_iparams forceparams[],
+                   const rvec x[], rvec f[],
+                   const t_pbc *pbc, const t_graph gmx_unused *g,
+                   real gmx_unused lambda,
+                   const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                   int gmx_unused *global_atom_index)
+{
+    low_rbdihs_simd(nbonds, forceatoms, forceparams, x, f, NULL, pbc, NULL);
+}
 
-        iu = i;
-        s  = 0;
-        do
-        {
-            do_dih_fup_noshiftf_precalc(ai[s], aj[s], ak[s], al[s],
-                                        p[s], q[s],
-                                        dr[     XX *GMX_SIMD_REAL_WIDTH+s],
-                                        dr[     YY *GMX_SIMD_REAL_WIDTH+s],
-                                        dr[     ZZ *GMX_SIMD_REAL_WIDTH+s],
-                                        dr[(DIM+XX)*GMX_SIMD_REAL_WIDTH+s],
-                                        dr[(DIM+YY)*GMX_SIMD_REAL_WIDTH+s],
-                                        dr[(DIM+ZZ)*GMX_SIMD_REAL_WIDTH+s],
-                                        f);
-            s++;
-            iu += nfa1;
-        }
-        while (s < GMX_SIMD_REAL_WIDTH && iu < nbonds);
-    }
+/* This function can replace rbdihs() when no free-energy perturbation is used */
+real
+rbdihs_simd(int nbonds,
+            const t_iatom forceatoms[], const t_iparams forceparams[],
+            const rvec x[], rvec f[], rvec fshift[],
+            const t_pbc *pbc, const t_graph *g,
+            real gmx_unused lambda, real gmx_unused *dvdlambda,
+            const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+            int gmx_unused *global_atom_index)
+{
+    return low_rbdihs_simd(nbonds, forceatoms, forceparams, x, f, fshift, pbc, g);
 }
 
 #endif /* GMX_SIMD_HAVE_REAL */
@@ -2354,6 +2510,138 @@ real idihs(int nbonds,
     return vtot;
 }
 
+#if GMX_SIMD_HAVE_REAL
+
+/* SIMD kernel for improper dihedrals, returns the energy.
+ * When fshift=NULL, no energies and shift forces are calculated
+ * and 0 is returned.
+ */
+static real
+low_idihs_simd(int nbonds,
+               const t_iatom forceatoms[], const t_iparams forceparams[],
+               const rvec x[], rvec f[], rvec fshift[],
+               const t_pbc *pbc, const t_graph *g)
+{
+    const int             nfa1 = 5;
+    int                   i, iu, s, nlane;
+    int                   type, ai[GMX_SIMD_REAL_WIDTH], aj[GMX_SIMD_REAL_WIDTH], ak[GMX_SIMD_REAL_WIDTH], al[GMX_SIMD_REAL_WIDTH];
+    real                  dr_array[3*DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *dr;
+    real                  buf_array[5*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *buf;
+    real                 *kk, *phi0, *p, *q, *e;
+    real                  vtot;
+    gmx_simd_real_t       phi_S, dp_S;
+    gmx_simd_real_t       mx_S, my_S, mz_S;
+    gmx_simd_real_t       nx_S, ny_S, nz_S;
+    gmx_simd_real_t       nrkj_m2_S, nrkj_n2_S;
+    gmx_simd_real_t       kk_S, mddphi_S;
+    pbc_simd_t            pbc_simd;
+
+    gmx_simd_real_t       half_S     = gmx_simd_set1_r(0.5);
+    gmx_simd_real_t       twopi_S    = gmx_simd_set1_r(2*M_PI);
+    gmx_simd_real_t       invtwopi_S = gmx_simd_set1_r(1/(2*M_PI));
+
+    /* Ensure SIMD register alignment */
+    dr  = gmx_simd_align_r(dr_array);
+    buf = gmx_simd_align_r(buf_array);
+
+    /* Extract aligned pointer for parameters and variables */
+    kk    = buf + 0*GMX_SIMD_REAL_WIDTH;
+    phi0  = buf + 1*GMX_SIMD_REAL_WIDTH;
+    p     = buf + 2*GMX_SIMD_REAL_WIDTH;
+    q     = buf + 3*GMX_SIMD_REAL_WIDTH;
+    e     = buf + 4*GMX_SIMD_REAL_WIDTH;
+
+    set_pbc_simd(pbc, &pbc_simd);
+
+    vtot = 0;
+
+    /* nbonds is the number of dihedrals times nfa1, here we step GMX_SIMD_REAL_WIDTH dihs */
+    for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH*nfa1)
+    {
+        /* Collect atoms quadruplets for GMX_SIMD_REAL_WIDTH dihedrals.
+         * iu indexes into forceatoms, we should not let iu go beyond nbonds.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu+1];
+            aj[s] = forceatoms[iu+2];
+            ak[s] = forceatoms[iu+3];
+            al[s] = forceatoms[iu+4];
+
+            kk[s]   = forceparams[type].harmonic.krA;
+            phi0[s] = forceparams[type].harmonic.rA*DEG2RAD;
+
+            /* At the end fill the arrays with identical entries */
+            if (iu + nfa1 < nbonds)
+            {
+                iu += nfa1;
+            }
+        }
+        nlane = std::min(GMX_SIMD_REAL_WIDTH, (nbonds - i)/nfa1);
+
+        /* Caclulate GMX_SIMD_REAL_WIDTH dihedral angles at once */
+        dih_angle_simd(x, ai, aj, ak, al, &pbc_simd,
+                       dr,
+                       &phi_S,
+                       &mx_S, &my_S, &mz_S,
+                       &nx_S, &ny_S, &nz_S,
+                       &nrkj_m2_S,
+                       &nrkj_n2_S,
+                       p, q);
+
+        /* As in idihs, take phi-phi0 modulo (-Pi,Pi) */
+        dp_S     = gmx_simd_sub_r(phi_S, gmx_simd_load_r(phi0));
+        dp_S     = gmx_simd_fnmadd_r(gmx_simd_round_r(gmx_simd_mul_r(dp_S, invtwopi_S)), twopi_S, dp_S);
+
+        kk_S     = gmx_simd_load_r(kk);
+        mddphi_S = gmx_simd_mul_r(kk_S, dp_S);
+
+        if (fshift != NULL)
+        {
+            vtot += sum_lanes_simd(e, gmx_simd_mul_r(half_S, gmx_simd_mul_r(mddphi_S, dp_S)), nlane);
+        }
+
+        /* Here we need minus the derivative */
+        mddphi_S = gmx_simd_sub_r(gmx_simd_setzero_r(), mddphi_S);
+
+        dih_fup_simd(ai, aj, ak, al, nlane, mddphi_S, nrkj_m2_S, nrkj_n2_S,
+                     mx_S, my_S, mz_S, nx_S, ny_S, nz_S, p, q, dr,
+                     x, f, fshift, pbc, g);
+    }
+
+    return vtot;
+}
+
+/* As idihs above, but using SIMD and without energies and shift forces */
+void
+idihs_noener_simd(int nbonds,
+                  const t_iatom forceatoms[], const t_iparams forceparams[],
+                  const rvec x[], rvec f[],
+                  const t_pbc *pbc, const t_graph gmx_unused *g,
+                  real gmx_unused lambda,
+                  const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                  int gmx_unused *global_atom_index)
+{
+    low_idihs_simd(nbonds, forceatoms, forceparams, x, f, NULL, pbc, NULL);
+}
+
+/* As idihs above, but using SIMD and only the A-state parameters */
+real
+idihs_simd(int nbonds,
+           const t_iatom forceatoms[], const t_iparams forceparams[],
+           const rvec x[], rvec f[], rvec fshift[],
+           const t_pbc *pbc, const t_graph *g,
+           real gmx_unused lambda, real gmx_unused *dvdlambda,
+           const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+           int gmx_unused *global_atom_index)
+{
+    return low_idihs_simd(nbonds, forceatoms, forceparams, x, f, fshift, pbc, g);
+}
+
+#endif /* GMX_SIMD_HAVE_REAL */
+
 static real low_angres(int nbonds,
                        const t_iatom forceatoms[], const t_iparams forceparams[],
                        const rvec x[], rvec f[], rvec fshift[],
@@ -3049,6 +3337,152 @@ cmap_setup_grid_index(int ip, int grid_spacing, int *ipm1, int *ipp1, int *ipp2)
 
 }
 
+/*! \brief Interpolate the CMAP energy and its derivatives
+ *
+ * Returns in \p e_out the energy of CMAP type \p cmapA for the dihedral
+ * angles \p phi1 and \p phi2 (in radians, in the range [-pi,pi]) and
+ * in \p df1_out and \p df2_out the derivatives with respect to both angles.
+ */
+static void
+cmap_interpolate(const gmx_cmap_t *cmap_grid, int cmapA,
+                 real phi1, real phi2,
+                 real *e_out, real *df1_out, real *df2_out)
+{
+    int         i, j, k, idx;
+    int         iphi1, ip1m1, ip1p1, ip1p2;
+    int         iphi2, ip2m1, ip2p1, ip2p2;
+    int         l1, l2, l3;
+    int         pos1, pos2, pos3, pos4;
+
+    real        ty[4], ty1[4], ty2[4], ty12[4], tc[16], tx[16];
+    real        xphi1, xphi2;
+    real        dx, xx, tt, tu, e, df1, df2;
+    real        fac;
+
+    const real *cmapd;
+
+    int         loop_index[4][4] = {
+        {0, 4, 8, 12},
+        {1, 5, 9, 13},
+        {2, 6, 10, 14},
+        {3, 7, 11, 15}
+    };
+
+    cmapd = cmap_grid->cmapdata[cmapA].cmap;
+
+    xphi1 = phi1 + M_PI; /* 1 */
+    xphi2 = phi2 + M_PI; /* 1 */
+
+    /* Range mangling */
+    if (xphi1 < 0)
+    {
+        xphi1 = xphi1 + 2*M_PI;
+    }
+    else if (xphi1 >= 2*M_PI)
+    {
+        xphi1 = xphi1 - 2*M_PI;
+    }
+
+    if (xphi2 < 0)
+    {
+        xphi2 = xphi2 + 2*M_PI;
+    }
+    else if (xphi2 >= 2*M_PI)
+    {
+        xphi2 = xphi2 - 2*M_PI;
+    }
+
+    /* Number of grid points */
+    dx = 2*M_PI / cmap_grid->grid_spacing;
+
+    /* Where on the grid are we */
+    iphi1 = static_cast<int>(xphi1/dx);
+    iphi2 = static_cast<int>(xphi2/dx);
+
+    iphi1 = cmap_setup_grid_index(iphi1, cmap_grid->grid_spacing, &ip1m1, &ip1p1, &ip1p2);
+    iphi2 = cmap_setup_grid_index(iphi2, cmap_grid->grid_spacing, &ip2m1, &ip2p1, &ip2p2);
+
+    pos1    = iphi1*cmap_grid->grid_spacing+iphi2;
+    pos2    = ip1p1*cmap_grid->grid_spacing+iphi2;
+    pos3    = ip1p1*cmap_grid->grid_spacing+ip2p1;
+    pos4    = iphi1*cmap_grid->grid_spacing+ip2p1;
+
+    ty[0]   = cmapd[pos1*4];
+    ty[1]   = cmapd[pos2*4];
+    ty[2]   = cmapd[pos3*4];
+    ty[3]   = cmapd[pos4*4];
+
+    ty1[0]   = cmapd[pos1*4+1];
+    ty1[1]   = cmapd[pos2*4+1];
+    ty1[2]   = cmapd[pos3*4+1];
+    ty1[3]   = cmapd[pos4*4+1];
+
+    ty2[0]   = cmapd[pos1*4+2];
+    ty2[1]   = cmapd[pos2*4+2];
+    ty2[2]   = cmapd[pos3*4+2];
+    ty2[3]   = cmapd[pos4*4+2];
+
+    ty12[0]   = cmapd[pos1*4+3];
+    ty12[1]   = cmapd[pos2*4+3];
+    ty12[2]   = cmapd[pos3*4+3];
+    ty12[3]   = cmapd[pos4*4+3];
+
+    /* Switch to degrees */
+    dx    = 360.0 / cmap_grid->grid_spacing;
+    xphi1 = xphi1 * RAD2DEG;
+    xphi2 = xphi2 * RAD2DEG;
+
+    for (i = 0; i < 4; i++) /* 16 */
+    {
+        tx[i]    = ty[i];
+        tx[i+4]  = ty1[i]*dx;
+        tx[i+8]  = ty2[i]*dx;
+        tx[i+12] = ty12[i]*dx*dx;
+    }
+
+    idx = 0;
+    for (i = 0; i < 4; i++) /* 1056 */
+    {
+        for (j = 0; j < 4; j++)
+        {
+            xx = 0;
+            for (k = 0; k < 16; k++)
+            {
+                xx = xx + cmap_coeff_matrix[k*16+idx]*tx[k];
+            }
+
+            idx++;
+            tc[i*4+j] = xx;
+        }
+    }
+
+    tt    = (xphi1-iphi1*dx)/dx;
+    tu    = (xphi2-iphi2*dx)/dx;
+
+    e     = 0;
+    df1   = 0;
+    df2   = 0;
+
+    for (i = 3; i >= 0; i--)
+    {
+        l1 = loop_index[i][3];
+        l2 = loop_index[i][2];
+        l3 = loop_index[i][1];
+
+        e     = tt * e    + ((tc[i*4+3]*tu+tc[i*4+2])*tu + tc[i*4+1])*tu+tc[i*4];
+        df1   = tu * df1  + (3.0*tc[l1]*tt+2.0*tc[l2])*tt+tc[l3];
+        df2   = tt * df2  + (3.0*tc[i*4+3]*tu+2.0*tc[i*4+2])*tu+tc[i*4+1];
+    }
+
+    fac     = RAD2DEG/dx;
+    df1     = df1   * fac;
+    df2     = df2   * fac;
+
+    *e_out   = e;
+    *df1_out = df1;
+    *df2_out = df2;
+}
+
 real
 cmap_dihs(int nbonds,
           const t_iatom forceatoms[], const t_iparams forceparams[],
@@ -3059,25 +3493,19 @@ cmap_dihs(int nbonds,
           const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
           int  gmx_unused *global_atom_index)
 {
-    int         i, j, k, n, idx;
+    int         i, n;
     int         ai, aj, ak, al, am;
     int         a1i, a1j, a1k, a1l, a2i, a2j, a2k, a2l;
     int         type, cmapA;
     int         t11, t21, t31, t12, t22, t32;
-    int         iphi1, ip1m1, ip1p1, ip1p2;
-    int         iphi2, ip2m1, ip2p1, ip2p2;
-    int         l1, l2, l3;
-    int         pos1, pos2, pos3, pos4;
 
-    real        ty[4], ty1[4], ty2[4], ty12[4], tc[16], tx[16];
-    real        phi1, cos_phi1, sin_phi1, sign1, xphi1;
-    real        phi2, cos_phi2, sin_phi2, sign2, xphi2;
-    real        dx, xx, tt, tu, e, df1, df2, vtot;
+    real        phi1, cos_phi1, sin_phi1, sign1;
+    real        phi2, cos_phi2, sin_phi2, sign2;
+    real        e, df1, df2, vtot;
     real        ra21, rb21, rg21, rg1, rgr1, ra2r1, rb2r1, rabr1;
     real        ra22, rb22, rg22, rg2, rgr2, ra2r2, rb2r2, rabr2;
     real        fg1, hg1, fga1, hgb1, gaa1, gbb1;
     real        fg2, hg2, fga2, hgb2, gaa2, gbb2;
-    real        fac;
 
     rvec        r1_ij, r1_kj, r1_kl, m1, n1;
     rvec        r2_ij, r2_kj, r2_kl, m2, n2;
@@ -3089,15 +3517,6 @@ cmap_dihs(int nbonds,
     ivec        jt1, dt1_ij, dt1_kj, dt1_lj;
     ivec        jt2, dt2_ij, dt2_kj, dt2_lj;
 
-    const real *cmapd;
-
-    int         loop_index[4][4] = {
-        {0, 4, 8, 12},
-        {1, 5, 9, 13},
-        {2, 6, 10, 14},
-        {3, 7, 11, 15}
-    };
-
     /* Total CMAP energy */
     vtot = 0;
 
@@ -3113,7 +3532,6 @@ cmap_dihs(int nbonds,
 
         /* Which CMAP type is this */
         cmapA = forceparams[type].cmap.cmapA;
-        cmapd = cmap_grid->cmapdata[cmapA].cmap;
 
         /* First torsion */
         a1i   = ai;
@@ -3174,8 +3592,6 @@ cmap_dihs(int nbonds,
             }
         }
 
-        xphi1 = phi1 + M_PI; /* 1 */
-
         /* Second torsion */
         a2i   = aj;
         a2j   = ak;
@@ -3235,112 +3651,7 @@ cmap_dihs(int nbonds,
             }
         }
 
-        xphi2 = phi2 + M_PI; /* 1 */
-
-        /* Range mangling */
-        if (xphi1 < 0)
-        {
-            xphi1 = xphi1 + 2*M_PI;
-        }
-        else if (xphi1 >= 2*M_PI)
-        {
-            xphi1 = xphi1 - 2*M_PI;
-        }
-
-        if (xphi2 < 0)
-        {
-            xphi2 = xphi2 + 2*M_PI;
-        }
-        else if (xphi2 >= 2*M_PI)
-        {
-            xphi2 = xphi2 - 2*M_PI;
-        }
-
-        /* Number of grid points */
-        dx = 2*M_PI / cmap_grid->grid_spacing;
-
-        /* Where on the grid are we */
-        iphi1 = static_cast<int>(xphi1/dx);
-        iphi2 = static_cast<int>(xphi2/dx);
-
-        iphi1 = cmap_setup_grid_index(iphi1, cmap_grid->grid_spacing, &ip1m1, &ip1p1, &ip1p2);
-        iphi2 = cmap_setup_grid_index(iphi2, cmap_grid->grid_spacing, &ip2m1, &ip2p1, &ip2p2);
-
-        pos1    = iphi1*cmap_grid->grid_spacing+iphi2;
-        pos2    = ip1p1*cmap_grid->grid_spacing+iphi2;
-        pos3    = ip1p1*cmap_grid->grid_spacing+ip2p1;
-        pos4    = iphi1*cmap_grid->grid_spacing+ip2p1;
-
-        ty[0]   = cmapd[pos1*4];
-        ty[1]   = cmapd[pos2*4];
-        ty[2]   = cmapd[pos3*4];
-        ty[3]   = cmapd[pos4*4];
-
-        ty1[0]   = cmapd[pos1*4+1];
-        ty1[1]   = cmapd[pos2*4+1];
-        ty1[2]   = cmapd[pos3*4+1];
-        ty1[3]   = cmapd[pos4*4+1];
-
-        ty2[0]   = cmapd[pos1*4+2];
-        ty2[1]   = cmapd[pos2*4+2];
-        ty2[2]   = cmapd[pos3*4+2];
-        ty2[3]   = cmapd[pos4*4+2];
-
-        ty12[0]   = cmapd[pos1*4+3];
-        ty12[1]   = cmapd[pos2*4+3];
-        ty12[2]   = cmapd[pos3*4+3];
-        ty12[3]   = cmapd[pos4*4+3];
-
-        /* Switch to degrees */
-        dx    = 360.0 / cmap_grid->grid_spacing;
-        xphi1 = xphi1 * RAD2DEG;
-        xphi2 = xphi2 * RAD2DEG;
-
-        for (i = 0; i < 4; i++) /* 16 */
-        {
-            tx[i]    = ty[i];
-            tx[i+4]  = ty1[i]*dx;
-            tx[i+8]  = ty2[i]*dx;
-            tx[i+12] = ty12[i]*dx*dx;
-        }
-
-        idx = 0;
-        for (i = 0; i < 4; i++) /* 1056 */
-        {
-            for (j = 0; j < 4; j++)
-            {
-                xx = 0;
-                for (k = 0; k < 16; k++)
-                {
-                    xx = xx + cmap_coeff_matrix[k*16+idx]*tx[k];
-                }
-
-                idx++;
-                tc[i*4+j] = xx;
-            }
-        }
-
-        tt    = (xphi1-iphi1*dx)/dx;
-        tu    = (xphi2-iphi2*dx)/dx;
-
-        e     = 0;
-        df1   = 0;
-        df2   = 0;
-
-        for (i = 3; i >= 0; i--)
-        {
-            l1 = loop_index[i][3];
-            l2 = loop_index[i][2];
-            l3 = loop_index[i][1];
-
-            e     = tt * e    + ((tc[i*4+3]*tu+tc[i*4+2])*tu + tc[i*4+1])*tu+tc[i*4];
-            df1   = tu * df1  + (3.0*tc[l1]*tt+2.0*tc[l2])*tt+tc[l3];
-            df2   = tt * df2  + (3.0*tc[i*4+3]*tu+2.0*tc[i*4+2])*tu+tc[i*4+1];
-        }
-
-        fac     = RAD2DEG/dx;
-        df1     = df1   * fac;
-        df2     = df2   * fac;
+        cmap_interpolate(cmap_grid, cmapA, phi1, phi2, &e, &df1, &df2);
 
         /* CMAP energy */
         vtot += e;
@@ -3438,7 +3749,7 @@ cmap_dihs(int nbonds,
         rvec_inc(fshift[t21], f1_k);
         rvec_inc(fshift[t31], f1_l);
 
-        rvec_inc(fshift[t21], f2_i);
+        rvec_inc(fshift[t12], f2_i);
         rvec_inc(fshift[CENTRAL], f2_j);
         rvec_inc(fshift[t22], f2_k);
         rvec_inc(fshift[t32], f2_l);
@@ -3447,6 +3758,130 @@ cmap_dihs(int nbonds,
 }
 
 
+#if GMX_SIMD_HAVE_REAL
+
+real
+cmap_dihs_simd(int nbonds,
+               const t_iatom forceatoms[], const t_iparams forceparams[],
+               const gmx_cmap_t *cmap_grid,
+               const rvec x[], rvec f[], rvec fshift[],
+               const struct t_pbc *pbc, const struct t_graph *g,
+               real gmx_unused lambda, real gmx_unused *dvdlambda,
+               const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+               int  gmx_unused *global_atom_index)
+{
+    const int             nfa1 = 6;
+    int                   i, iu, s, nlane;
+    int                   type, cmapA[GMX_SIMD_REAL_WIDTH];
+    int                   ai[GMX_SIMD_REAL_WIDTH], aj[GMX_SIMD_REAL_WIDTH], ak[GMX_SIMD_REAL_WIDTH], al[GMX_SIMD_REAL_WIDTH], am[GMX_SIMD_REAL_WIDTH];
+    real                  dr_array[3*DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *dr;
+    real                  buf_array[8*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *buf;
+    real                 *phi1, *phi2, *mdf1, *mdf2, *p1, *q1, *p2, *q2;
+    real                  e, df1, df2, vtot;
+    gmx_simd_real_t       phi1_S, phi2_S;
+    gmx_simd_real_t       m1x_S, m1y_S, m1z_S, n1x_S, n1y_S, n1z_S;
+    gmx_simd_real_t       m2x_S, m2y_S, m2z_S, n2x_S, n2y_S, n2z_S;
+    gmx_simd_real_t       nrkj_m2_1_S, nrkj_n2_1_S, nrkj_m2_2_S, nrkj_n2_2_S;
+    pbc_simd_t            pbc_simd;
+
+    /* Ensure SIMD register alignment */
+    dr  = gmx_simd_align_r(dr_array);
+    buf = gmx_simd_align_r(buf_array);
+
+    /* Extract aligned pointer for parameters and variables */
+    phi1  = buf + 0*GMX_SIMD_REAL_WIDTH;
+    phi2  = buf + 1*GMX_SIMD_REAL_WIDTH;
+    mdf1  = buf + 2*GMX_SIMD_REAL_WIDTH;
+    mdf2  = buf + 3*GMX_SIMD_REAL_WIDTH;
+    p1    = buf + 4*GMX_SIMD_REAL_WIDTH;
+    q1    = buf + 5*GMX_SIMD_REAL_WIDTH;
+    p2    = buf + 6*GMX_SIMD_REAL_WIDTH;
+    q2    = buf + 7*GMX_SIMD_REAL_WIDTH;
+
+    set_pbc_simd(pbc, &pbc_simd);
+
+    vtot = 0;
+
+    for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH*nfa1)
+    {
+        /* Collect the five atoms for GMX_SIMD_REAL_WIDTH CMAP terms.
+         * iu indexes into forceatoms, we should not let iu go beyond nbonds.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            type     = forceatoms[iu];
+            ai[s]    = forceatoms[iu+1];
+            aj[s]    = forceatoms[iu+2];
+            ak[s]    = forceatoms[iu+3];
+            al[s]    = forceatoms[iu+4];
+            am[s]    = forceatoms[iu+5];
+            cmapA[s] = forceparams[type].cmap.cmapA;
+
+            /* At the end fill the arrays with identical entries */
+            if (iu + nfa1 < nbonds)
+            {
+                iu += nfa1;
+            }
+        }
+        nlane = std::min(GMX_SIMD_REAL_WIDTH, (nbonds - i)/nfa1);
+
+        /* The two torsions, both for GMX_SIMD_REAL_WIDTH CMAP terms */
+        dih_angle_simd(x, ai, aj, ak, al, &pbc_simd,
+                       dr,
+                       &phi1_S,
+                       &m1x_S, &m1y_S, &m1z_S,
+                       &n1x_S, &n1y_S, &n1z_S,
+                       &nrkj_m2_1_S,
+                       &nrkj_n2_1_S,
+                       p1, q1);
+        dih_angle_simd(x, aj, ak, al, am, &pbc_simd,
+                       dr,
+                       &phi2_S,
+                       &m2x_S, &m2y_S, &m2z_S,
+                       &n2x_S, &n2y_S, &n2z_S,
+                       &nrkj_m2_2_S,
+                       &nrkj_n2_2_S,
+                       p2, q2);
+
+        gmx_simd_store_r(phi1, phi1_S);
+        gmx_simd_store_r(phi2, phi2_S);
+
+        /* The grid interpolation involves table lookups per CMAP type,
+         * so we do it lane by lane.
+         */
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            if (s < nlane)
+            {
+                cmap_interpolate(cmap_grid, cmapA[s], phi1[s], phi2[s],
+                                 &e, &df1, &df2);
+                vtot    += e;
+                mdf1[s]  = -df1;
+                mdf2[s]  = -df2;
+            }
+            else
+            {
+                mdf1[s]  = 0;
+                mdf2[s]  = 0;
+            }
+        }
+
+        dih_fup_simd(ai, aj, ak, al, nlane, gmx_simd_load_r(mdf1),
+                     nrkj_m2_1_S, nrkj_n2_1_S,
+                     m1x_S, m1y_S, m1z_S, n1x_S, n1y_S, n1z_S, p1, q1, dr,
+                     x, f, fshift, pbc, g);
+        dih_fup_simd(aj, ak, al, am, nlane, gmx_simd_load_r(mdf2),
+                     nrkj_m2_2_S, nrkj_n2_2_S,
+                     m2x_S, m2y_S, m2z_S, n2x_S, n2y_S, n2z_S, p2, q2, dr,
+                     x, f, fshift, pbc, g);
+    }
+
+    return vtot;
+}
+
+#endif /* GMX_SIMD_HAVE_REAL */
+
 //! \cond
 /***********************************************************
  *
@@ -165,6 +165,61 @@ void
                        const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
                        int gmx_unused *global_atom_index);
 
+/* As idihs(), when not needing energy or shift force, using SIMD to calculate many dihedrals at once. */
+void
+    idihs_noener_simd(int nbonds,
+                      const t_iatom forceatoms[], const t_iparams forceparams[],
+                      const rvec x[], rvec f[],
+                      const struct t_pbc *pbc,
+                      const struct t_graph gmx_unused *g,
+                      real gmx_unused lambda,
+                      const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                      int gmx_unused *global_atom_index);
+
+/* The SIMD versions below compute energies and shift forces, but only
+ * use the A-state parameters, so they can not be used with free-energy
+ * perturbation. They can replace pdihs(), rbdihs() and idihs().
+ */
+real
+    pdihs_simd(int nbonds,
+               const t_iatom forceatoms[], const t_iparams forceparams[],
+               const rvec x[], rvec f[], rvec fshift[],
+               const struct t_pbc *pbc, const struct t_graph *g,
+               real gmx_unused lambda, real gmx_unused *dvdlambda,
+               const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+               int gmx_unused *global_atom_index);
+
+real
+    rbdihs_simd(int nbonds,
+                const t_iatom forceatoms[], const t_iparams forceparams[],
+                const rvec x[], rvec f[], rvec fshift[],
+                const struct t_pbc *pbc, const struct t_graph *g,
+                real gmx_unused lambda, real gmx_unused *dvdlambda,
+                const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                int gmx_unused *global_atom_index);
+
+real
+    idihs_simd(int nbonds,
+               const t_iatom forceatoms[], const t_iparams forceparams[],
+               const rvec x[], rvec f[], rvec fshift[],
+               const struct t_pbc *pbc, const struct t_graph *g,
+               real gmx_unused lambda, real gmx_unused *dvdlambda,
+               const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+               int gmx_unused *global_atom_index);
+
+/* As cmap_dihs(), but using SIMD for the dihedral angles and forces.
+ * When fshift=NULL no shift forces are calculated.
+ */
+real
+    cmap_dihs_simd(int nbonds,
+                   const t_iatom forceatoms[], const t_iparams forceparams[],
+                   const gmx_cmap_t *cmap_grid,
+                   const rvec x[], rvec f[], rvec fshift[],
+                   const struct t_pbc *pbc, const struct t_graph *g,
+                   real gmx_unused lambda, real gmx_unused *dvdlambda,
+                   const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                   int  gmx_unused *global_atom_index);
+
 #endif
 
 //! \endcond
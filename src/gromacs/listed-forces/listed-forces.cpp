@@ -293,11 +293,25 @@ calc_one_bond(int thread,
                nice to account to its own subtimer, but first
                wallcycle needs to be extended to support calling from
                multiple threads. */
-            v = cmap_dihs(nbn, iatoms+nb0,
-                          idef->iparams, &idef->cmap_grid,
-                          x, f, fshift,
-                          pbc, g, lambda[efptFTYPE], &(dvdl[efptFTYPE]),
-                          md, fcd, global_atom_index);
+#if GMX_SIMD_HAVE_REAL
+            if (bUseSIMD)
+            {
+                /* CMAP has no B-state, so we can always use SIMD */
+                v = cmap_dihs_simd(nbn, iatoms+nb0,
+                                   idef->iparams, &idef->cmap_grid,
+                                   x, f, bCalcEnerVir ? fshift : NULL,
+                                   pbc, g, lambda[efptFTYPE], &(dvdl[efptFTYPE]),
+                                   md, fcd, global_atom_index);
+            }
+            else
+#endif
+            {
+                v = cmap_dihs(nbn, iatoms+nb0,
+                              idef->iparams, &idef->cmap_grid,
+                              x, f, fshift,
+                              pbc, g, lambda[efptFTYPE], &(dvdl[efptFTYPE]),
+                              md, fcd, global_atom_index);
+            }
         }
 #if GMX_SIMD_HAVE_REAL
         else if (ftype == F_ANGLES && bUseSIMD &&
@@ -348,6 +362,31 @@ calc_one_bond(int thread,
                                global_atom_index);
             v = 0;
         }
+        else if (ftype == F_IDIHS && bUseSIMD &&
+                 !bCalcEnerVir && fr->efep == efepNO)
+        {
+            /* No energies, shift forces, dvdl */
+            idihs_noener_simd(nbn, idef->il[ftype].iatoms+nb0,
+                              idef->iparams,
+                              x, f,
+                              pbc, g, lambda[efptFTYPE], md, fcd,
+                              global_atom_index);
+            v = 0;
+        }
+        else if ((ftype == F_PDIHS || ftype == F_RBDIHS || ftype == F_IDIHS) &&
+                 bUseSIMD && fr->efep == efepNO)
+        {
+            /* Energies and shift forces, but no dvdl */
+            t_ifunc *simdFunc = (ftype == F_PDIHS  ? pdihs_simd :
+                                 ftype == F_RBDIHS ? rbdihs_simd :
+                                 idihs_simd);
+
+            v = simdFunc(nbn, iatoms+nb0,
+                         idef->iparams,
+                         x, f, fshift,
+                         pbc, g, lambda[efptFTYPE], &(dvdl[efptFTYPE]),
+                         md, fcd, global_atom_index);
+        }
 #endif
         else
         {
@@ -386,39 +425,20 @@ ftype_is_bonded_potential(int ftype)
         (ftype < F_GB12 || ftype > F_GB14);
 }
 
-void calc_listed(const struct gmx_multisim_t *ms,
-                 struct gmx_wallcycle        *wcycle,
-                 const t_idef *idef,
-                 const rvec x[], history_t *hist,
-                 rvec f[], t_forcerec *fr,
-                 const struct t_pbc *pbc,
-                 const struct t_pbc *pbc_full,
-                 const struct t_graph *g,
-                 gmx_enerdata_t *enerd, t_nrnb *nrnb,
-                 real *lambda,
-                 const t_mdatoms *md,
-                 t_fcdata *fcd, int *global_atom_index,
-                 int force_flags)
+void calc_listed_restraints(const struct gmx_multisim_t *ms,
+                            struct gmx_wallcycle        *wcycle,
+                            const t_idef *idef,
+                            const rvec x[], history_t *hist,
+                            t_forcerec *fr,
+                            const struct t_pbc *pbc,
+                            const struct t_pbc *pbc_full,
+                            gmx_enerdata_t *enerd, t_nrnb *nrnb,
+                            real *lambda,
+                            const t_mdatoms *md,
+                            t_fcdata *fcd)
 {
-    struct bonded_threading_t *bt;
-    gmx_bool                   bCalcEnerVir;
-    int                        i;
-    /* The dummy array is to have a place to store the dhdl at other values
-       of lambda, which will be thrown away in the end */
-    real                       dvdl[efptNR];
-    const  t_pbc              *pbc_null;
-    int                        thread;
-
-    bt = fr->bonded_threading;
-
-    assert(bt->nthreads == idef->nthreads);
-
-    bCalcEnerVir = (force_flags & (GMX_FORCE_VIRIAL | GMX_FORCE_ENERGY));
+    const  t_pbc *pbc_null;
 
-    for (i = 0; i < efptNR; i++)
-    {
-        dvdl[i] = 0.0;
-    }
     if (fr->bMolPBC)
     {
         pbc_null = pbc;
@@ -428,13 +448,6 @@ void calc_listed(const struct gmx_multisim_t *ms,
         pbc_null = NULL;
     }
 
-#ifdef DEBUG
-    if (g && debug)
-    {
-        p_graph(debug, "Bondage is fun", g);
-    }
-#endif
-
     if ((idef->il[F_POSRES].nr > 0) ||
         (idef->il[F_FBPOSRES].nr > 0) ||
         (idef->il[F_ORIRES].nr > 0) ||
@@ -482,55 +495,86 @@ void calc_listed(const struct gmx_multisim_t *ms,
 
         wallcycle_sub_stop(wcycle, ewcsRESTRAINTS);
     }
+}
 
-    wallcycle_sub_start(wcycle, ewcsLISTED);
-#pragma omp parallel for num_threads(bt->nthreads) schedule(static)
-    for (thread = 0; thread < bt->nthreads; thread++)
+void calc_listed_thread(int thread,
+                        const t_idef *idef,
+                        const rvec x[],
+                        rvec f[], t_forcerec *fr,
+                        const struct t_pbc *pbc,
+                        const struct t_graph *g,
+                        gmx_enerdata_t *enerd, t_nrnb *nrnb,
+                        real *lambda, real *dvdl,
+                        const t_mdatoms *md,
+                        t_fcdata *fcd, int *global_atom_index,
+                        int force_flags)
+{
+    struct bonded_threading_t *bt;
+    gmx_bool                   bCalcEnerVir;
+    const  t_pbc              *pbc_null;
+    int                        ftype;
+    real                      *epot, v;
+    /* thread stuff */
+    rvec                      *ft, *fshift;
+    real                      *dvdlt;
+    gmx_grppairener_t         *grpp;
+
+    bt = fr->bonded_threading;
+
+    bCalcEnerVir = (force_flags & (GMX_FORCE_VIRIAL | GMX_FORCE_ENERGY));
+
+    if (fr->bMolPBC)
     {
-        try
-        {
-            int                ftype;
-            real              *epot, v;
-            /* thread stuff */
-            rvec              *ft, *fshift;
-            real              *dvdlt;
-            gmx_grppairener_t *grpp;
-
-            if (thread == 0)
-            {
-                ft     = f;
-                fshift = fr->fshift;
-                epot   = enerd->term;
-                grpp   = &enerd->grpp;
-                dvdlt  = dvdl;
-            }
-            else
-            {
-                zero_thread_output(bt, thread);
+        pbc_null = pbc;
+    }
+    else
+    {
+        pbc_null = NULL;
+    }
 
-                ft     = bt->f_t[thread].f;
-                fshift = bt->f_t[thread].fshift;
-                epot   = bt->f_t[thread].ener;
-                grpp   = &bt->f_t[thread].grpp;
-                dvdlt  = bt->f_t[thread].dvdl;
-            }
-            /* Loop over all bonded force types to calculate the bonded forces */
-            for (ftype = 0; (ftype < F_NRE); ftype++)
-            {
-                if (idef->il[ftype].nr > 0 && ftype_is_bonded_potential(ftype))
-                {
-                    v = calc_one_bond(thread, ftype, idef, x,
-                                      ft, fshift, fr, pbc_null, g, grpp,
-                                      nrnb, lambda, dvdlt,
-                                      md, fcd, bCalcEnerVir,
-                                      global_atom_index);
-                    epot[ftype] += v;
-                }
-            }
+    if (thread == 0)
+    {
+        ft     = f;
+        fshift = fr->fshift;
+        epot   = enerd->term;
+        grpp   = &enerd->grpp;
+        dvdlt  = dvdl;
+    }
+    else
+    {
+        zero_thread_output(bt, thread);
+
+        ft     = bt->f_t[thread].f;
+        fshift = bt->f_t[thread].fshift;
+        epot   = bt->f_t[thread].ener;
+        grpp   = &bt->f_t[thread].grpp;
+        dvdlt  = bt->f_t[thread].dvdl;
+    }
+    /* Loop over all bonded force types to calculate the bonded forces */
+    for (ftype = 0; (ftype < F_NRE); ftype++)
+    {
+        if (idef->il[ftype].nr > 0 && ftype_is_bonded_potential(ftype))
+        {
+            v = calc_one_bond(thread, ftype, idef, x,
+                              ft, fshift, fr, pbc_null, g, grpp,
+                              nrnb, lambda, dvdlt,
+                              md, fcd, bCalcEnerVir,
+                              global_atom_index);
+            epot[ftype] += v;
         }
-        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
     }
-    wallcycle_sub_stop(wcycle, ewcsLISTED);
+}
+
+void reduce_listed_thread_output(struct gmx_wallcycle *wcycle,
+                                 rvec f[], t_forcerec *fr,
+                                 gmx_enerdata_t *enerd, real *dvdl,
+                                 t_fcdata *fcd,
+                                 int force_flags)
+{
+    struct bonded_threading_t *bt;
+    int                        i;
+
+    bt = fr->bonded_threading;
 
     if (bt->nthreads > 1)
     {
@@ -538,7 +582,7 @@ void calc_listed(const struct gmx_multisim_t *ms,
         reduce_thread_output(fr->natoms_force, f, fr->fshift,
                              enerd->term, &enerd->grpp, dvdl,
                              bt,
-                             bCalcEnerVir,
+                             force_flags & (GMX_FORCE_VIRIAL | GMX_FORCE_ENERGY),
                              force_flags & GMX_FORCE_DHDL);
         wallcycle_sub_stop(wcycle, ewcsLISTED_BUF_OPS);
     }
@@ -560,6 +604,63 @@ void calc_listed(const struct gmx_multisim_t *ms,
     }
 }
 
+void calc_listed(const struct gmx_multisim_t *ms,
+                 struct gmx_wallcycle        *wcycle,
+                 const t_idef *idef,
+                 const rvec x[], history_t *hist,
+                 rvec f[], t_forcerec *fr,
+                 const struct t_pbc *pbc,
+                 const struct t_pbc *pbc_full,
+                 const struct t_graph *g,
+                 gmx_enerdata_t *enerd, t_nrnb *nrnb,
+                 real *lambda,
+                 const t_mdatoms *md,
+                 t_fcdata *fcd, int *global_atom_index,
+                 int force_flags)
+{
+    struct bonded_threading_t *bt;
+    int                        i;
+    /* The dummy array is to have a place to store the dhdl at other values
+       of lambda, which will be thrown away in the end */
+    real                       dvdl[efptNR];
+    int                        thread;
+
+    bt = fr->bonded_threading;
+
+    assert(bt->nthreads == idef->nthreads);
+
+    for (i = 0; i < efptNR; i++)
+    {
+        dvdl[i] = 0.0;
+    }
+
+#ifdef DEBUG
+    if (g && debug)
+    {
+        p_graph(debug, "Bondage is fun", g);
+    }
+#endif
+
+    calc_listed_restraints(ms, wcycle, idef, x, hist, fr, pbc, pbc_full,
+                           enerd, nrnb, lambda, md, fcd);
+
+    wallcycle_sub_start(wcycle, ewcsLISTED);
+#pragma omp parallel for num_threads(bt->nthreads) schedule(static)
+    for (thread = 0; thread < bt->nthreads; thread++)
+    {
+        try
+        {
+            calc_listed_thread(thread, idef, x, f, fr, pbc, g,
+                               enerd, nrnb, lambda, dvdl, md, fcd,
+                               global_atom_index, force_flags);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+    }
+    wallcycle_sub_stop(wcycle, ewcsLISTED);
+
+    reduce_listed_thread_output(wcycle, f, fr, enerd, dvdl, fcd, force_flags);
+}
+
 void calc_listed_lambda(const t_idef *idef,
                         const rvec x[],
                         t_forcerec *fr,
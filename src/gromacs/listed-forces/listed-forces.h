@@ -95,6 +95,48 @@ extern "C" {
 gmx_bool
 ftype_is_bonded_potential(int ftype);
 
+/*! \brief Calculates the position restraints and the restraint
+ * quantities that are needed before calc_listed_thread() can be called.
+ *
+ * Note that pbc_full is used only for position restraints, and is
+ * not initialized if there are none. */
+void calc_listed_restraints(const struct gmx_multisim_t *ms,
+                            struct gmx_wallcycle *wcycle,
+                            const t_idef *idef,
+                            const rvec x[], history_t *hist,
+                            t_forcerec *fr,
+                            const struct t_pbc *pbc, const struct t_pbc *pbc_full,
+                            gmx_enerdata_t *enerd, t_nrnb *nrnb, real *lambda,
+                            const t_mdatoms *md,
+                            struct t_fcdata *fcd);
+
+/*! \brief Calculates the listed force interactions of bonded thread \p thread.
+ *
+ * Should be called once for each of the fr->bonded_threading->nthreads
+ * bonded threads, each by a single OpenMP thread, after which
+ * reduce_listed_thread_output() should be called. Thread 0 writes to f,
+ * fr->fshift, enerd and dvdl, the other threads to thread-local buffers.
+ */
+void calc_listed_thread(int thread,
+                        const t_idef *idef,
+                        const rvec x[],
+                        rvec f[], t_forcerec *fr,
+                        const struct t_pbc *pbc,
+                        const struct t_graph *g,
+                        gmx_enerdata_t *enerd, t_nrnb *nrnb,
+                        real *lambda, real *dvdl,
+                        const t_mdatoms *md,
+                        struct t_fcdata *fcd, int *global_atom_index,
+                        int force_flags);
+
+/*! \brief Reduces the thread-local output of calc_listed_thread() into f,
+ * fr->fshift and enerd and adds \p dvdl to enerd. */
+void reduce_listed_thread_output(struct gmx_wallcycle *wcycle,
+                                 rvec f[], t_forcerec *fr,
+                                 gmx_enerdata_t *enerd, real *dvdl,
+                                 struct t_fcdata *fcd,
+                                 int force_flags);
+
 /*! \brief Calculates all listed force interactions.
  *
  * Note that pbc_full is used only for position restraints, and is
@@ -87,6 +87,13 @@ struct bonded_threading_t
      * over the threads. We dedice which to use based on the number of threads.
      */
     int bonded_max_nthread_uniform; /**< Maximum thread count for uniform distribution of bondeds over threads */
+
+    /* Work arrays for sorting the interactions by atom locality */
+    int           *sort_key;           /**< Locality key per interaction */
+    int           *sort_order;         /**< Sorted order of the interactions */
+    int            sort_nalloc;        /**< Allocation size of sort_key and sort_order */
+    t_iatom       *sort_iatoms;        /**< Buffer for the reordered iatoms */
+    int            sort_iatoms_nalloc; /**< Allocation size of sort_iatoms */
 };
 
 
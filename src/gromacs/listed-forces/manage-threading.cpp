@@ -69,6 +69,135 @@ typedef struct {
     int      nat;   /**< nr of atoms involved in a single ftype interaction */
 } ilist_data_t;
 
+/*! \brief Returns the locality key of interaction \p ia with \p nral atoms
+ *
+ * This is the lowest atom index in the interaction. Local atoms are
+ * ordered spatially by the domain decomposition, and otherwise usually
+ * by molecule, so interactions with close keys touch nearby atoms.
+ */
+static gmx_inline int interaction_locality_key(const t_iatom *ia, int nral)
+{
+    int key = ia[1];
+    for (int a = 2; a <= nral; a++)
+    {
+        key = std::min(key, ia[a]);
+    }
+
+    return key;
+}
+
+/*! \brief Sorts interactions \p start to \p end in \p il by locality
+ *
+ * \p start and \p end are indices into il->iatoms. A stable sort is
+ * used, so consecutive interactions with identical atoms, such as
+ * multiple proper dihedrals, stay consecutive, which pdihs_noener() uses.
+ * Returns whether the order changed.
+ */
+static gmx_bool sort_ilist_range_by_locality(t_ilist            *il,
+                                             int                 nral,
+                                             int                 start,
+                                             int                 end,
+                                             bonded_threading_t *bt)
+{
+    const int nat1 = nral + 1;
+    int       n    = (end - start)/nat1;
+    gmx_bool  bSorted;
+
+    if (n > bt->sort_nalloc)
+    {
+        bt->sort_nalloc = over_alloc_large(n);
+        srenew(bt->sort_key,   bt->sort_nalloc);
+        srenew(bt->sort_order, bt->sort_nalloc);
+    }
+    int *key   = bt->sort_key;
+    int *order = bt->sort_order;
+
+    bSorted = TRUE;
+    for (int i = 0; i < n; i++)
+    {
+        key[i]   = interaction_locality_key(il->iatoms + start + i*nat1, nral);
+        order[i] = i;
+        if (i > 0 && key[i] < key[i - 1])
+        {
+            bSorted = FALSE;
+        }
+    }
+    if (bSorted)
+    {
+        return FALSE;
+    }
+
+    std::stable_sort(order, order + n,
+                     [key](int a, int b) -> bool { return key[a] < key[b]; });
+
+    if (end - start > bt->sort_iatoms_nalloc)
+    {
+        bt->sort_iatoms_nalloc = over_alloc_large(end - start);
+        srenew(bt->sort_iatoms, bt->sort_iatoms_nalloc);
+    }
+    for (int i = 0; i < n; i++)
+    {
+        for (int a = 0; a < nat1; a++)
+        {
+            bt->sort_iatoms[i*nat1 + a] = il->iatoms[start + order[i]*nat1 + a];
+        }
+    }
+    for (int i = 0; i < end - start; i++)
+    {
+        il->iatoms[start + i] = bt->sort_iatoms[i];
+    }
+
+    return TRUE;
+}
+
+/*! \brief Sorts all listed interactions by atom locality
+ *
+ * This is done every time the local topology changes, i.e. at
+ * DD repartitioning, before dividing the interactions over the threads.
+ * With the interactions sorted, each thread gets a contiguous range
+ * of atoms, which minimizes the number of force blocks touched by
+ * multiple threads and thus the cost of the thread force reduction.
+ * Perturbed and non-perturbed interactions are sorted separately.
+ * Distance and orientation restraints are not sorted, since their
+ * order matters.
+ */
+static void sort_bondeds_by_locality(t_idef *idef, bonded_threading_t *bt)
+{
+    int nsorted = 0;
+
+    if (idef->ilsort != ilsortNO_FE && idef->ilsort != ilsortFE_SORTED)
+    {
+        return;
+    }
+
+    for (int f = 0; f < F_NRE; f++)
+    {
+        t_ilist *il = &idef->il[f];
+
+        if (!ftype_is_bonded_potential(f) || il->nr == 0 ||
+            f == F_DISRES || f == F_ORIRES)
+        {
+            continue;
+        }
+
+        int nr_np = (idef->ilsort == ilsortFE_SORTED ? il->nr_nonperturbed : il->nr);
+        if (sort_ilist_range_by_locality(il, NRAL(f), 0, nr_np, bt))
+        {
+            nsorted++;
+        }
+        if (sort_ilist_range_by_locality(il, NRAL(f), nr_np, il->nr, bt))
+        {
+            nsorted++;
+        }
+    }
+
+    if (debug)
+    {
+        fprintf(debug, "Sorted %d listed interaction ranges by locality\n",
+                nsorted);
+    }
+}
+
 /*! \brief Divides listed interactions over threads
  *
  * This routine attempts to divide all interactions of the ntype bondeds
@@ -97,7 +226,7 @@ static void divide_bondeds_by_locality(int                 ntype,
         ind[f]    = 0;
         /* Initialize the next atom index array */
         assert(ild[f].il->nr > 0);
-        at_ind[f] = ild[f].il->iatoms[1];
+        at_ind[f] = interaction_locality_key(ild[f].il->iatoms, ild[f].nat);
     }
 
     nat_sum = 0;
@@ -128,15 +257,9 @@ static void divide_bondeds_by_locality(int                 ntype,
         while (nat_sum < nat_thread)
         {
             /* To divide bonds based on atom order, we compare
-             * the index of the first atom in the bonded interaction.
-             * This works well, since the domain decomposition generates
-             * bondeds in order of the atoms by looking up interactions
-             * which are linked to the first atom in each interaction.
-             * It usually also works well without DD, since than the atoms
-             * in bonded interactions are usually in increasing order.
-             * If they are not assigned in increasing order, the balancing
-             * is still good, but the memory access and reduction cost will
-             * be higher.
+             * the lowest atom index in the bonded interaction.
+             * This works well, since sort_bondeds_by_locality has
+             * sorted the interactions on this same key.
              */
             int f_min;
 
@@ -160,7 +283,8 @@ static void divide_bondeds_by_locality(int                 ntype,
             /* Update the first unassigned atom index for this type */
             if (ind[f_min] < ild[f_min].il->nr)
             {
-                at_ind[f_min] = ild[f_min].il->iatoms[ind[f_min] + 1];
+                at_ind[f_min] = interaction_locality_key(ild[f_min].il->iatoms + ind[f_min],
+                                                         ild[f_min].nat);
             }
             else
             {
@@ -370,6 +494,12 @@ void setup_bonded_threading(t_forcerec *fr, t_idef *idef)
 
     assert(bt->nthreads >= 1);
 
+    if (bt->nthreads > 1)
+    {
+        /* Sort the interactions, so threads get contiguous atom ranges */
+        sort_bondeds_by_locality(idef, bt);
+    }
+
     /* Divide the bonded interaction over the threads */
     divide_bondeds_over_threads(idef,
                                 bt->nthreads,
@@ -504,6 +634,12 @@ void init_bonded_threading(FILE *fplog, int nenergrp,
         bt->mask         = NULL;
         bt->block_nalloc = 0;
 
+        bt->sort_key           = NULL;
+        bt->sort_order         = NULL;
+        bt->sort_nalloc        = 0;
+        bt->sort_iatoms        = NULL;
+        bt->sort_iatoms_nalloc = 0;
+
         /* The optimal value after which to switch from uniform to localized
          * bonded interaction distribution is 3, 4 or 5 depending on the system
          * and hardware.
@@ -0,0 +1,370 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2016, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests that the SIMD dihedral and CMAP kernels give the same energies,
+ * forces and shift forces as the plain-C kernels.
+ *
+ * \ingroup module_listed-forces
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/listed-forces/bonded.h"
+#include "gromacs/math/units.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/pbcutil/ishift.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/topology/idef.h"
+#include "gromacs/utility/real.h"
+
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+#if GMX_SIMD_HAVE_REAL
+
+/*! \brief Signature shared by the dihedral kernels with energies */
+typedef real (*DihedralKernel)(int nbonds,
+                               const t_iatom forceatoms[], const t_iparams forceparams[],
+                               const rvec x[], rvec f[], rvec fshift[],
+                               const struct t_pbc *pbc, const struct t_graph *g,
+                               real lambda, real *dvdlambda,
+                               const t_mdatoms *md, t_fcdata *fcd,
+                               int *global_atom_index);
+
+/*! \brief Signature shared by the SIMD dihedral kernels without energies */
+typedef void (*DihedralNoEnerKernel)(int nbonds,
+                                     const t_iatom forceatoms[], const t_iparams forceparams[],
+                                     const rvec x[], rvec f[],
+                                     const struct t_pbc *pbc, const struct t_graph *g,
+                                     real lambda,
+                                     const t_mdatoms *md, t_fcdata *fcd,
+                                     int *global_atom_index);
+
+//! The forces and energy computed by one kernel
+struct KernelOutput
+{
+    //! Energy
+    real              energy;
+    //! Forces, DIM reals per atom
+    std::vector<real> f;
+    //! Shift forces, DIM reals per shift vector
+    std::vector<real> fshift;
+};
+
+/*! \brief Test fixture for comparing SIMD and plain-C listed kernels
+ *
+ * Sets up a chain of atoms scattered around a corner of a periodic
+ * box, so the dihedrals cover a range of angles. The atoms are put
+ * in the box, so most bonds cross the periodic boundary and the
+ * interactions have non-central shift forces.
+ */
+class ListedForcesSimdTest : public ::testing::Test
+{
+    public:
+        //! Number of atoms in the test system
+        static const int numAtoms_ = 80;
+
+        void SetUp()
+        {
+            clear_mat(box_);
+            box_[XX][XX] = 2.1;
+            box_[YY][YY] = 2.3;
+            box_[ZZ][ZZ] = 2.2;
+            set_pbc(&pbc_, epbcXYZ, box_);
+
+            x_.resize(numAtoms_);
+            for (int a = 0; a < numAtoms_; a++)
+            {
+                rvec pos;
+
+                pos[XX] = 0.3*std::cos(0.9*a);
+                pos[YY] = 0.3*std::sin(1.7*a);
+                pos[ZZ] = 0.3*std::cos(2.3*a + 0.4);
+                for (int d = 0; d < DIM; d++)
+                {
+                    x_[a][d] = pos[d] - box_[d][d]*std::floor(pos[d]/box_[d][d]);
+                }
+            }
+        }
+
+        //! Returns a topology of numInteractions chained interactions of nratoms atoms each
+        std::vector<t_iatom> makeIatoms(int numInteractions, int nratoms, int numTypes)
+        {
+            std::vector<t_iatom> iatoms;
+
+            for (int i = 0; i < numInteractions; i++)
+            {
+                iatoms.push_back(i % numTypes);
+                for (int a = 0; a < nratoms; a++)
+                {
+                    iatoms.push_back((i*3 + a) % numAtoms_);
+                }
+            }
+
+            return iatoms;
+        }
+
+        //! Runs a kernel with energies and shift forces
+        KernelOutput runKernel(DihedralKernel               kernel,
+                               const std::vector<t_iatom>  &iatoms,
+                               const std::vector<t_iparams> &iparams)
+        {
+            KernelOutput out;
+            real         dvdlambda = 0;
+
+            out.f.assign(numAtoms_*DIM, 0);
+            out.fshift.assign(SHIFTS*DIM, 0);
+            out.energy = kernel(iatoms.size(), iatoms.data(), iparams.data(),
+                                as_rvec_array(x_.data()),
+                                reinterpret_cast<rvec *>(out.f.data()),
+                                reinterpret_cast<rvec *>(out.fshift.data()),
+                                &pbc_, NULL, 0, &dvdlambda, NULL, NULL, NULL);
+
+            return out;
+        }
+
+        //! Runs a SIMD kernel without energies and shift forces
+        KernelOutput runKernel(DihedralNoEnerKernel         kernel,
+                               const std::vector<t_iatom>  &iatoms,
+                               const std::vector<t_iparams> &iparams)
+        {
+            KernelOutput out;
+
+            out.f.assign(numAtoms_*DIM, 0);
+            kernel(iatoms.size(), iatoms.data(), iparams.data(),
+                   as_rvec_array(x_.data()),
+                   reinterpret_cast<rvec *>(out.f.data()),
+                   &pbc_, NULL, 0, NULL, NULL, NULL);
+            out.energy = 0;
+
+            return out;
+        }
+
+        //! Runs a CMAP kernel
+        KernelOutput runCmapKernel(bool                          bSimd,
+                                   const std::vector<t_iatom>   &iatoms,
+                                   const std::vector<t_iparams> &iparams,
+                                   const gmx_cmap_t             *cmapGrid)
+        {
+            KernelOutput out;
+            real         dvdlambda = 0;
+
+            out.f.assign(numAtoms_*DIM, 0);
+            out.fshift.assign(SHIFTS*DIM, 0);
+            out.energy = (bSimd ? cmap_dihs_simd : cmap_dihs)
+                    (iatoms.size(), iatoms.data(), iparams.data(), cmapGrid,
+                    as_rvec_array(x_.data()),
+                    reinterpret_cast<rvec *>(out.f.data()),
+                    reinterpret_cast<rvec *>(out.fshift.data()),
+                    &pbc_, NULL, 0, &dvdlambda, NULL, NULL, NULL);
+
+            return out;
+        }
+
+        //! Checks that two vectors of force components agree
+        void compareForces(const std::vector<real> &ref,
+                           const std::vector<real> &test)
+        {
+            real fmax = 0;
+
+            ASSERT_EQ(ref.size(), test.size());
+            for (size_t i = 0; i < ref.size(); i++)
+            {
+                fmax = std::max(fmax, std::abs(ref[i]));
+            }
+            /* The SIMD kernels use other but equivalent expressions,
+             * so we can only expect agreement relative to the largest
+             * force component.
+             */
+            gmx::test::FloatingPointTolerance tolerance =
+                gmx::test::absoluteTolerance(fmax*tolerance_);
+            for (size_t i = 0; i < ref.size(); i++)
+            {
+                EXPECT_REAL_EQ_TOL(ref[i], test[i], tolerance) << "component " << i;
+            }
+        }
+
+        //! Checks that a SIMD kernel matches the plain-C kernel
+        void compare(const KernelOutput &ref, const KernelOutput &test,
+                     bool bEnergies)
+        {
+            compareForces(ref.f, test.f);
+            if (bEnergies)
+            {
+                EXPECT_REAL_EQ_TOL(ref.energy, test.energy,
+                                   gmx::test::relativeToleranceAsFloatingPoint(ref.energy, tolerance_));
+                compareForces(ref.fshift, test.fshift);
+            }
+        }
+
+        //! Checks that some shift forces are not central, so PBC is covered
+        void checkNonCentralShiftForces(const KernelOutput &out)
+        {
+            int numNonCentral = 0;
+
+            for (int s = 0; s < SHIFTS; s++)
+            {
+                if (s != CENTRAL && norm2(&out.fshift[s*DIM]) > 0)
+                {
+                    numNonCentral++;
+                }
+            }
+            EXPECT_GT(numNonCentral, 0);
+        }
+
+        //! Relative tolerance for comparing SIMD and plain-C results
+        static const real   tolerance_;
+
+        //! The periodic box
+        matrix              box_;
+        //! The PBC setup for box_
+        t_pbc               pbc_;
+        //! The coordinates
+        std::vector<gmx::RVec> x_;
+};
+
+#ifdef GMX_DOUBLE
+const real ListedForcesSimdTest::tolerance_ = 1e-10;
+#else
+const real ListedForcesSimdTest::tolerance_ = 1e-4;
+#endif
+
+/* We use a number of interactions that is not a multiple of the SIMD
+ * width, so the partially filled last batch is also tested.
+ */
+const int c_numInteractions = 2*GMX_SIMD_REAL_WIDTH + 3;
+
+TEST_F(ListedForcesSimdTest, ProperDihedralsMatch)
+{
+    std::vector<t_iatom>   iatoms = makeIatoms(c_numInteractions, 4, 3);
+    std::vector<t_iparams> iparams(3);
+    for (int t = 0; t < 3; t++)
+    {
+        iparams[t].pdihs.phiA = iparams[t].pdihs.phiB = 40.0*t - 30.0;
+        iparams[t].pdihs.cpA  = iparams[t].pdihs.cpB  = 5.0 + 3.0*t;
+        iparams[t].pdihs.mult = 1 + t;
+    }
+
+    KernelOutput ref = runKernel(pdihs, iatoms, iparams);
+    checkNonCentralShiftForces(ref);
+    compare(ref, runKernel(pdihs_simd, iatoms, iparams), true);
+    compare(ref, runKernel(pdihs_noener_simd, iatoms, iparams), false);
+}
+
+TEST_F(ListedForcesSimdTest, RyckaertBellemansDihedralsMatch)
+{
+    std::vector<t_iatom>   iatoms = makeIatoms(c_numInteractions, 4, 2);
+    std::vector<t_iparams> iparams(2);
+    for (int t = 0; t < 2; t++)
+    {
+        for (int i = 0; i < NR_RBDIHS; i++)
+        {
+            iparams[t].rbdihs.rbcA[i] = iparams[t].rbdihs.rbcB[i] = (i % 2 == 0 ? 4.0 : -3.0)/(i + 1 + t);
+        }
+    }
+
+    KernelOutput ref = runKernel(rbdihs, iatoms, iparams);
+    checkNonCentralShiftForces(ref);
+    compare(ref, runKernel(rbdihs_simd, iatoms, iparams), true);
+    compare(ref, runKernel(rbdihs_noener_simd, iatoms, iparams), false);
+}
+
+TEST_F(ListedForcesSimdTest, ImproperDihedralsMatch)
+{
+    std::vector<t_iatom>   iatoms = makeIatoms(c_numInteractions, 4, 2);
+    std::vector<t_iparams> iparams(2);
+    for (int t = 0; t < 2; t++)
+    {
+        iparams[t].harmonic.rA  = iparams[t].harmonic.rB  = 20.0 + 150.0*t;
+        iparams[t].harmonic.krA = iparams[t].harmonic.krB = 40.0 + 20.0*t;
+    }
+
+    KernelOutput ref = runKernel(idihs, iatoms, iparams);
+    checkNonCentralShiftForces(ref);
+    compare(ref, runKernel(idihs_simd, iatoms, iparams), true);
+    compare(ref, runKernel(idihs_noener_simd, iatoms, iparams), false);
+}
+
+TEST_F(ListedForcesSimdTest, CmapDihedralsMatch)
+{
+    const int              gridSpacing = 24;
+    const int              numGrids    = 2;
+    std::vector<t_iatom>   iatoms      = makeIatoms(c_numInteractions, 5, numGrids);
+    std::vector<t_iparams> iparams(numGrids);
+
+    /* Fill the grids with a smooth periodic function and its derivatives */
+    std::vector<real>           gridData[numGrids];
+    std::vector<gmx_cmapdata_t> cmapData(numGrids);
+    for (int t = 0; t < numGrids; t++)
+    {
+        iparams[t].cmap.cmapA = iparams[t].cmap.cmapB = t;
+        for (int i = 0; i < gridSpacing; i++)
+        {
+            for (int j = 0; j < gridSpacing; j++)
+            {
+                real phi = -M_PI + i*2*M_PI/gridSpacing;
+                real psi = -M_PI + j*2*M_PI/gridSpacing;
+                real a   = 3.0 + t;
+
+                gridData[t].push_back(a*std::cos(phi + t)*std::sin(2*psi));
+                gridData[t].push_back(-a*std::sin(phi + t)*std::sin(2*psi));
+                gridData[t].push_back(2*a*std::cos(phi + t)*std::cos(2*psi));
+                gridData[t].push_back(-2*a*std::sin(phi + t)*std::cos(2*psi));
+            }
+        }
+        cmapData[t].cmap = gridData[t].data();
+    }
+    gmx_cmap_t cmapGrid;
+    cmapGrid.ngrid        = numGrids;
+    cmapGrid.grid_spacing = gridSpacing;
+    cmapGrid.cmapdata     = cmapData.data();
+
+    KernelOutput ref = runCmapKernel(false, iatoms, iparams, &cmapGrid);
+    checkNonCentralShiftForces(ref);
+    compare(ref, runCmapKernel(true, iatoms, iparams, &cmapGrid), true);
+}
+
+#endif
+
+} // namespace
@@ -0,0 +1,265 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2016, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests the sorting of listed interactions by atom locality that
+ * setup_bonded_threading() does before dividing them over threads.
+ *
+ * \ingroup module_listed-forces
+ */
+#include "gmxpre.h"
+
+#include "gromacs/listed-forces/manage-threading.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/mdtypes/forcerec.h"
+#include "gromacs/topology/idef.h"
+#include "gromacs/topology/ifunc.h"
+#include "gromacs/utility/smalloc.h"
+
+namespace
+{
+
+//! The number of threads, more than the maximum for the uniform division
+const int c_numThreads = 8;
+
+//! The number of local atoms
+const int c_numAtoms   = 64;
+
+/*! \brief Test fixture with a local topology and the bonded threading setup */
+class BondedLocalityTest : public ::testing::Test
+{
+    public:
+        BondedLocalityTest() : idef_(), iatoms_(F_NRE), iparams_(4)
+        {
+            numThreadsOrig_ = gmx_omp_nthreads_get(emntBonded);
+            gmx_omp_nthreads_set(emntBonded, c_numThreads);
+            snew(fr_, 1);
+            fr_->natoms_force = c_numAtoms;
+            init_bonded_threading(NULL, 1, &fr_->bonded_threading);
+
+            /* Types 2 and 3 are distance restraints with different labels */
+            iparams_[2].disres.label = 0;
+            iparams_[3].disres.label = 1;
+            idef_.ntypes  = iparams_.size();
+            idef_.iparams = iparams_.data();
+            idef_.ilsort  = ilsortNO_FE;
+        }
+        ~BondedLocalityTest()
+        {
+            gmx_omp_nthreads_set(emntBonded, numThreadsOrig_);
+            sfree(idef_.il_thread_division);
+            sfree(fr_);
+        }
+
+        //! Sets the interactions of type \p ftype, with the first \p numNonPerturbed not perturbed
+        void setInteractions(int ftype, const std::vector<t_iatom> &iatoms, int numNonPerturbed)
+        {
+            iatoms_[ftype]                   = iatoms;
+            idef_.il[ftype].nr               = iatoms_[ftype].size();
+            idef_.il[ftype].nr_nonperturbed  = numNonPerturbed*(1 + NRAL(ftype));
+            idef_.il[ftype].iatoms           = iatoms_[ftype].data();
+        }
+
+        //! Returns the interactions of type \p ftype
+        std::vector<t_iatom> interactions(int ftype) const
+        {
+            return std::vector<t_iatom>(idef_.il[ftype].iatoms,
+                                        idef_.il[ftype].iatoms + idef_.il[ftype].nr);
+        }
+
+        //! The local topology
+        t_idef                               idef_;
+        //! Storage for the interactions of each type
+        std::vector<std::vector<t_iatom> >   iatoms_;
+        //! Storage for the interaction parameters
+        std::vector<t_iparams>               iparams_;
+        //! The force record with the bonded threading setup
+        t_forcerec                          *fr_;
+        //! The number of bonded threads before the test
+        int                                  numThreadsOrig_;
+};
+
+TEST_F(BondedLocalityTest, SortsByLowestAtomAndKeepsMultipleDihedralsTogether)
+{
+    /* Two proper dihedrals on atoms 10-13 and two on atoms 5-8, as
+     * produced for multiple dihedrals, plus dihedrals with the same
+     * lowest atom that should stay after them.
+     */
+    setInteractions(F_PDIHS,
+                    { 0, 40, 41, 42, 43,
+                      0, 10, 11, 12, 13,
+                      1, 10, 11, 12, 13,
+                      0, 30, 31, 32, 33,
+                      0, 12, 10, 20, 21,
+                      0,  5,  6,  7,  8,
+                      1,  5,  6,  7,  8,
+                      0,  9, 10, 11,  5 }, 8);
+    setInteractions(F_BONDS,
+                    { 0, 50, 51,
+                      0,  2,  1,
+                      0, 20, 21 }, 3);
+
+    setup_bonded_threading(fr_, &idef_);
+
+    EXPECT_EQ(std::vector<t_iatom>({ 0,  5,  6,  7,  8,
+                                     1,  5,  6,  7,  8,
+                                     0,  9, 10, 11,  5,
+                                     0, 10, 11, 12, 13,
+                                     1, 10, 11, 12, 13,
+                                     0, 12, 10, 20, 21,
+                                     0, 30, 31, 32, 33,
+                                     0, 40, 41, 42, 43 }), interactions(F_PDIHS));
+    EXPECT_EQ(std::vector<t_iatom>({ 0,  2,  1,
+                                     0, 20, 21,
+                                     0, 50, 51 }), interactions(F_BONDS));
+}
+
+TEST_F(BondedLocalityTest, KeepsTheOrderOfDihedralsWithTheSameLowestAtom)
+{
+    /* Many dihedrals share their lowest atom, so an unstable sort
+     * would reorder them. Every third atom group has two dihedrals
+     * on the same atoms.
+     */
+    const int            numGroups = 16;
+    std::vector<t_iatom> dihedrals;
+    for (int g = 0; g < numGroups; g++)
+    {
+        int lowest = (g*7) % 12;
+        for (int d = 0; d < 3; d++)
+        {
+            int type = 0;
+            do
+            {
+                dihedrals.insert(dihedrals.end(),
+                                 { type, 20 + g, lowest, 40 + d, 50 + g });
+                type++;
+            }
+            while (type < 2 && g % 3 == 0 && d == 1);
+        }
+    }
+    setInteractions(F_PDIHS, dihedrals, dihedrals.size()/5);
+
+    setup_bonded_threading(fr_, &idef_);
+
+    std::vector<t_iatom> sorted = interactions(F_PDIHS);
+    ASSERT_EQ(dihedrals.size(), sorted.size());
+    /* With a stable sort the result is the original list, with the
+     * interactions taken per lowest atom in their original order.
+     */
+    std::vector<t_iatom> expected;
+    for (int lowest = 0; lowest < 12; lowest++)
+    {
+        for (size_t i = 0; i < dihedrals.size(); i += 5)
+        {
+            if (dihedrals[i + 2] == lowest)
+            {
+                expected.insert(expected.end(), dihedrals.begin() + i, dihedrals.begin() + i + 5);
+            }
+        }
+    }
+    EXPECT_EQ(expected, sorted);
+}
+
+TEST_F(BondedLocalityTest, KeepsPerturbedInteractionsAfterTheOthers)
+{
+    /* The perturbed bonds have lower atom indices than some
+     * non-perturbed bonds, but should stay after all of them.
+     */
+    idef_.ilsort = ilsortFE_SORTED;
+    setInteractions(F_BONDS,
+                    { 0, 50, 51,
+                      0, 20, 21,
+                      0, 30, 31,
+                      1,  3,  4,
+                      1, 60, 61,
+                      1,  1,  2 }, 3);
+    setInteractions(F_ANGLES,
+                    { 0, 40, 41, 42,
+                      0,  7,  8,  9 }, 2);
+
+    setup_bonded_threading(fr_, &idef_);
+
+    EXPECT_EQ(std::vector<t_iatom>({ 0, 20, 21,
+                                     0, 30, 31,
+                                     0, 50, 51,
+                                     1,  1,  2,
+                                     1,  3,  4,
+                                     1, 60, 61 }), interactions(F_BONDS));
+    EXPECT_EQ(3*(1 + NRAL(F_BONDS)), idef_.il[F_BONDS].nr_nonperturbed);
+    EXPECT_EQ(std::vector<t_iatom>({ 0,  7,  8,  9,
+                                     0, 40, 41, 42 }), interactions(F_ANGLES));
+}
+
+TEST_F(BondedLocalityTest, DoesNotSortWithUnsortedPerturbedInteractions)
+{
+    idef_.ilsort = ilsortFE_UNSORTED;
+    std::vector<t_iatom> bonds = { 0, 50, 51,
+                                   1,  3,  4,
+                                   0, 20, 21 };
+    setInteractions(F_BONDS, bonds, 3);
+
+    setup_bonded_threading(fr_, &idef_);
+
+    EXPECT_EQ(bonds, interactions(F_BONDS));
+}
+
+TEST_F(BondedLocalityTest, LeavesRestraintsInTheirOrder)
+{
+    std::vector<t_iatom> disres = { 2, 40,  2,
+                                    2, 30, 31,
+                                    3,  3,  1,
+                                    3, 10, 20 };
+    std::vector<t_iatom> orires = { 0, 50,  1,
+                                    0,  2,  3 };
+    setInteractions(F_DISRES, disres, 4);
+    setInteractions(F_ORIRES, orires, 2);
+    setInteractions(F_BONDS,
+                    { 0, 20, 21,
+                      0,  2,  1 }, 2);
+
+    setup_bonded_threading(fr_, &idef_);
+
+    EXPECT_EQ(disres, interactions(F_DISRES));
+    EXPECT_EQ(orires, interactions(F_ORIRES));
+    EXPECT_EQ(std::vector<t_iatom>({ 0,  2,  1,
+                                     0, 20, 21 }), interactions(F_BONDS));
+}
+
+} // namespace
@@ -363,6 +363,21 @@ typedef struct gmx_lincsdata {
     gmx_bool        bCommIter;    /* communicate before each LINCS interation */
     real           *blmf;         /* matrix of mass factors for constraint connections */
     real           *blmf1;        /* as blmf, but with all masses 1 */
+    /* With SIMD the coupling matrix is also stored in a blocked layout:
+     * for each block of GMX_SIMD_REAL_WIDTH consecutive constraints
+     * the connections are stored column by column, padded to the largest
+     * connection count in the block. This allows for aligned SIMD loads
+     * of the matrix elements during the matrix construction and expansion.
+     */
+    int            *blnr_simd;    /* index into the blocked arrays per SIMD block */
+    int            *blbnb_simd;   /* blbnb in blocked layout, padded with the constraint itself */
+    int            *blind_simd;   /* index into blbnb per blocked element, -1 for padding */
+    real           *blmf_simd;    /* blmf in blocked layout, 0 for padding */
+    real           *blmf1_simd;   /* blmf1 in blocked layout, 0 for padding */
+    real           *blcc_simd;    /* the coupling matrix in blocked layout */
+    int             nblock_simd_alloc; /* allocation size of blnr_simd */
+    int             ncc_simd;     /* the number of blocked matrix elements */
+    int             ncc_simd_alloc; /* allocation size of the blocked arrays */
     real           *bllen;        /* the reference bond length */
     int            *nlocat;       /* the local atom count per constraint, can be NULL */
 
@@ -410,6 +425,114 @@ real lincs_rmsd(struct gmx_lincsdata *lincsd, gmx_bool bSD2)
     }
 }
 
+#ifdef LINCS_SIMD
+/* Load GMX_SIMD_REAL_WIDTH rvecs v[index[i]] into SIMD registers,
+ * buf should be aligned and have space for DIM*GMX_SIMD_REAL_WIDTH reals.
+ */
+static gmx_inline void gmx_simdcall
+gather_rvec_index_simd(const rvec * gmx_restrict v,
+                       const int *               index,
+                       real * gmx_restrict       buf,
+                       gmx_simd_real_t          *x,
+                       gmx_simd_real_t          *y,
+                       gmx_simd_real_t          *z)
+{
+    int i, m;
+
+    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+    {
+        for (m = 0; m < DIM; m++)
+        {
+            buf[m*GMX_SIMD_REAL_WIDTH + i] = v[index[i]][m];
+        }
+    }
+    *x = gmx_simd_load_r(buf + 0*GMX_SIMD_REAL_WIDTH);
+    *y = gmx_simd_load_r(buf + 1*GMX_SIMD_REAL_WIDTH);
+    *z = gmx_simd_load_r(buf + 2*GMX_SIMD_REAL_WIDTH);
+}
+
+/* Construct the coupling matrix blcc in the blocked layout */
+static void gmx_simdcall
+calc_blcc_simd(int                       b0,
+               int                       b1,
+               const int *               blnr_simd,
+               const int *               blbnb_simd,
+               const real * gmx_restrict blmf_simd,
+               const rvec * gmx_restrict r,
+               real * gmx_restrict       vbuf1,
+               real * gmx_restrict       vbuf2,
+               real * gmx_restrict       blcc_simd)
+{
+    int bs, e;
+    int index[GMX_SIMD_REAL_WIDTH];
+
+    assert(b0 % GMX_SIMD_REAL_WIDTH == 0);
+
+    for (bs = b0; bs < b1; bs += GMX_SIMD_REAL_WIDTH)
+    {
+        gmx_simd_real_t rx_S, ry_S, rz_S;
+        int             i;
+
+        for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+        {
+            index[i] = bs + i;
+        }
+        gather_rvec_index_simd(r, index, vbuf1, &rx_S, &ry_S, &rz_S);
+
+        for (e = blnr_simd[bs/GMX_SIMD_REAL_WIDTH]; e < blnr_simd[bs/GMX_SIMD_REAL_WIDTH + 1]; e += GMX_SIMD_REAL_WIDTH)
+        {
+            gmx_simd_real_t rnx_S, rny_S, rnz_S, ip_S;
+
+            gather_rvec_index_simd(r, blbnb_simd + e, vbuf2,
+                                   &rnx_S, &rny_S, &rnz_S);
+
+            ip_S = gmx_simd_iprod_r(rx_S, ry_S, rz_S,
+                                    rnx_S, rny_S, rnz_S);
+
+            gmx_simd_store_r(blcc_simd + e,
+                             gmx_simd_mul_r(gmx_simd_load_r(blmf_simd + e), ip_S));
+        }
+    }
+}
+
+/* Do one LINCS matrix multiplication with the matrix in blocked layout */
+static void gmx_simdcall
+lincs_matrix_expand_simd(int                       b0,
+                         int                       b1,
+                         const int *               blnr_simd,
+                         const int *               blbnb_simd,
+                         const real * gmx_restrict blcc_simd,
+                         real * gmx_restrict       vbuf,
+                         const real * gmx_restrict rhs1,
+                         real * gmx_restrict       rhs2,
+                         real * gmx_restrict       sol)
+{
+    int bs, e, i;
+
+    assert(b0 % GMX_SIMD_REAL_WIDTH == 0);
+
+    for (bs = b0; bs < b1; bs += GMX_SIMD_REAL_WIDTH)
+    {
+        gmx_simd_real_t mvb_S;
+
+        mvb_S = gmx_simd_setzero_r();
+        for (e = blnr_simd[bs/GMX_SIMD_REAL_WIDTH]; e < blnr_simd[bs/GMX_SIMD_REAL_WIDTH + 1]; e += GMX_SIMD_REAL_WIDTH)
+        {
+            for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+            {
+                vbuf[i] = rhs1[blbnb_simd[e + i]];
+            }
+            mvb_S = gmx_simd_fmadd_r(gmx_simd_load_r(blcc_simd + e),
+                                     gmx_simd_load_r(vbuf),
+                                     mvb_S);
+        }
+        gmx_simd_store_r(rhs2 + bs, mvb_S);
+        gmx_simd_store_r(sol + bs,
+                         gmx_simd_add_r(gmx_simd_load_r(sol + bs), mvb_S));
+    }
+}
+#endif /* LINCS_SIMD */
+
 /* Do a set of nrec LINCS matrix multiplications.
  * This function will return with up to date thread-local
  * constraint data, without an OpenMP barrier.
@@ -421,7 +544,12 @@ static void lincs_matrix_expand(const struct gmx_lincsdata *lincsd,
 {
     int        b0, b1, nrec, rec;
     const int *blnr  = lincsd->blnr;
+#ifdef LINCS_SIMD
+    /* With SIMD blcc and blbnb use the blocked layout */
+    const int *blbnb = lincsd->blbnb_simd;
+#else
     const int *blbnb = lincsd->blbnb;
+#endif
 
     b0   = li_task->b0;
     b1   = li_task->b1;
@@ -429,12 +557,17 @@ static void lincs_matrix_expand(const struct gmx_lincsdata *lincsd,
 
     for (rec = 0; rec < nrec; rec++)
     {
-        int b;
-
         if (lincsd->bTaskDep)
         {
 #pragma omp barrier
         }
+#ifdef LINCS_SIMD
+        lincs_matrix_expand_simd(b0, b1,
+                                 lincsd->blnr_simd, blbnb, blcc,
+                                 li_task->simd_buf, rhs1, rhs2, sol);
+#else
+        int b;
+
         for (b = b0; b < b1; b++)
         {
             real mvb;
@@ -448,6 +581,7 @@ static void lincs_matrix_expand(const struct gmx_lincsdata *lincsd,
             rhs2[b] = mvb;
             sol[b]  = sol[b] + mvb;
         }
+#endif
 
         real *swap;
 
@@ -501,7 +635,15 @@ static void lincs_matrix_expand(const struct gmx_lincsdata *lincsd,
                 {
                     if (bits & (1 << (n - nr0)))
                     {
+#ifdef LINCS_SIMD
+                        /* Element n - nr0 of constraint b in blocked layout */
+                        int e = lincsd->blnr_simd[b/GMX_SIMD_REAL_WIDTH] +
+                            (n - nr0)*GMX_SIMD_REAL_WIDTH + b % GMX_SIMD_REAL_WIDTH;
+
+                        mvb = mvb + blcc[e]*rhs1[blbnb[e]];
+#else
                         mvb = mvb + blcc[n]*rhs1[blbnb[n]];
+#endif
                     }
                 }
                 rhs2[b] = mvb;
@@ -728,21 +870,36 @@ static void do_lincsp(rvec *x, rvec *f, rvec *fp, t_pbc *pbc,
 
     bla    = lincsd->bla;
     r      = lincsd->tmpv;
+#ifdef LINCS_SIMD
+    /* With SIMD the matrix is stored in the blocked layout */
+    blnr   = lincsd->blnr_simd;
+    blbnb  = lincsd->blbnb_simd;
+    blcc   = lincsd->blcc_simd;
+#else
     blnr   = lincsd->blnr;
     blbnb  = lincsd->blbnb;
+    blcc   = lincsd->tmpncc;
+#endif
     if (econq != econqForce)
     {
         /* Use mass-weighted parameters */
         blc  = lincsd->blc;
+#ifdef LINCS_SIMD
+        blmf = lincsd->blmf_simd;
+#else
         blmf = lincsd->blmf;
+#endif
     }
     else
     {
         /* Use non mass-weighted parameters */
         blc  = lincsd->blc1;
+#ifdef LINCS_SIMD
+        blmf = lincsd->blmf1_simd;
+#else
         blmf = lincsd->blmf1;
+#endif
     }
-    blcc   = lincsd->tmpncc;
     rhs1   = lincsd->tmp1;
     rhs2   = lincsd->tmp2;
     sol    = lincsd->tmp3;
@@ -817,6 +974,12 @@ static void do_lincsp(rvec *x, rvec *f, rvec *fp, t_pbc *pbc,
     }
 
     /* Construct the (sparse) LINCS matrix */
+#ifdef LINCS_SIMD
+    calc_blcc_simd(b0, b1, blnr, blbnb, blmf, r,
+                   lincsd->task[th].simd_buf,
+                   lincsd->task[th].simd_buf + GMX_SIMD_REAL_WIDTH*DIM,
+                   blcc);
+#else
     for (b = b0; b < b1; b++)
     {
         int n;
@@ -826,6 +989,7 @@ static void do_lincsp(rvec *x, rvec *f, rvec *fp, t_pbc *pbc,
             blcc[n] = blmf[n]*iprod(r[b], r[blbnb[n]]);
         } /* 6 nr flops */
     }
+#endif
     /* Together: 23*ncons + 6*nrtot flops */
 
     lincs_matrix_expand(lincsd, &lincsd->task[th], blcc, rhs1, rhs2, sol);
@@ -1084,7 +1248,7 @@ static void do_lincs(rvec *x, rvec *xp, matrix box, t_pbc *pbc,
                      real invdt, rvec * gmx_restrict v,
                      gmx_bool bCalcVir, tensor vir_r_m_dr)
 {
-    int      b0, b1, b, i, j, n, iter;
+    int      b0, b1, b, i, j, iter;
     int     *bla, *blnr, *blbnb;
     rvec    *r;
     real    *blc, *blmf, *bllen, *blcc, *rhs1, *rhs2, *sol, *blc_sol, *mlambda;
@@ -1095,12 +1259,20 @@ static void do_lincs(rvec *x, rvec *xp, matrix box, t_pbc *pbc,
 
     bla     = lincsd->bla;
     r       = lincsd->tmpv;
+#ifdef LINCS_SIMD
+    /* With SIMD the matrix is stored in the blocked layout */
+    blnr    = lincsd->blnr_simd;
+    blbnb   = lincsd->blbnb_simd;
+    blmf    = lincsd->blmf_simd;
+    blcc    = lincsd->blcc_simd;
+#else
     blnr    = lincsd->blnr;
     blbnb   = lincsd->blbnb;
-    blc     = lincsd->blc;
     blmf    = lincsd->blmf;
-    bllen   = lincsd->bllen;
     blcc    = lincsd->tmpncc;
+#endif
+    blc     = lincsd->blc;
+    bllen   = lincsd->bllen;
     rhs1    = lincsd->tmp1;
     rhs2    = lincsd->tmp2;
     sol     = lincsd->tmp3;
@@ -1188,13 +1360,22 @@ static void do_lincs(rvec *x, rvec *xp, matrix box, t_pbc *pbc,
     }
 
     /* Construct the (sparse) LINCS matrix */
+#ifdef LINCS_SIMD
+    calc_blcc_simd(b0, b1, blnr, blbnb, blmf, r,
+                   lincsd->task[th].simd_buf,
+                   lincsd->task[th].simd_buf + GMX_SIMD_REAL_WIDTH*DIM,
+                   blcc);
+#else
     for (b = b0; b < b1; b++)
     {
+        int n;
+
         for (n = blnr[b]; n < blnr[b+1]; n++)
         {
             blcc[n] = blmf[n]*iprod(r[b], r[blbnb[n]]);
         }
     }
+#endif
     /* Together: 26*ncons + 6*nrtot flops */
 
     lincs_matrix_expand(lincsd, &lincsd->task[th], blcc, rhs1, rhs2, sol);
@@ -1440,6 +1621,26 @@ static void set_lincs_matrix_task(struct gmx_lincsdata *li,
             }
         }
     }
+
+#ifdef LINCS_SIMD
+    /* Copy the coefficients to the blocked layout, the blocks of this
+     * task cover the constraints b0 up to the padded end of the task.
+     */
+    if (li_task->b1 > li_task->b0)
+    {
+        int blk0, blk1, e;
+
+        blk0 = li_task->b0/GMX_SIMD_REAL_WIDTH;
+        blk1 = (li_task->b1 + GMX_SIMD_REAL_WIDTH - 1)/GMX_SIMD_REAL_WIDTH;
+        for (e = li->blnr_simd[blk0]; e < li->blnr_simd[blk1]; e++)
+        {
+            int n = li->blind_simd[e];
+
+            li->blmf_simd[e]  = (n >= 0 ? li->blmf[n]  : 0);
+            li->blmf1_simd[e] = (n >= 0 ? li->blmf1[n] : 0);
+        }
+    }
+#endif
 }
 
 /* Sets the elements in the LINCS matrix */
@@ -2082,6 +2283,40 @@ static void set_matrix_indices(struct gmx_lincsdata *li,
                   sizeof(li->blbnb[0]), int_comp);
         }
     }
+
+#ifdef LINCS_SIMD
+    /* Fill the blocked layout, including the SIMD padding of the task */
+    int bs;
+
+    for (bs = li_task->b0; bs < li_task->b1; bs += GMX_SIMD_REAL_WIDTH)
+    {
+        int blk, e0, ncol, k, s;
+
+        blk  = bs/GMX_SIMD_REAL_WIDTH;
+        e0   = li->blnr_simd[blk];
+        ncol = (li->blnr_simd[blk + 1] - e0)/GMX_SIMD_REAL_WIDTH;
+        for (k = 0; k < ncol; k++)
+        {
+            for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+            {
+                int e = e0 + k*GMX_SIMD_REAL_WIDTH + s;
+
+                b = bs + s;
+                if (k < li->blnr[b + 1] - li->blnr[b])
+                {
+                    li->blbnb_simd[e] = li->blbnb[li->blnr[b] + k];
+                    li->blind_simd[e] = li->blnr[b] + k;
+                }
+                else
+                {
+                    /* Pad with a zero coupling to the constraint itself */
+                    li->blbnb_simd[e] = b;
+                    li->blind_simd[e] = -1;
+                }
+            }
+        }
+    }
+#endif
 }
 
 void set_lincs(const t_idef         *idef,
@@ -2323,6 +2558,41 @@ void set_lincs(const t_idef         *idef,
         srenew(li->blbnb, li->ncc_alloc);
     }
 
+#ifdef LINCS_SIMD
+    /* Set the block boundaries of the blocked matrix layout.
+     * Each block gets the maximum number of connections of its constraints.
+     */
+    int nblock, blk;
+
+    nblock = li->nc/GMX_SIMD_REAL_WIDTH;
+    if (nblock + 1 > li->nblock_simd_alloc)
+    {
+        li->nblock_simd_alloc = over_alloc_dd(nblock + 1);
+        srenew(li->blnr_simd, li->nblock_simd_alloc);
+    }
+    li->blnr_simd[0] = 0;
+    for (blk = 0; blk < nblock; blk++)
+    {
+        int ncol = 0;
+
+        for (i = blk*GMX_SIMD_REAL_WIDTH; i < (blk + 1)*GMX_SIMD_REAL_WIDTH; i++)
+        {
+            ncol = std::max(ncol, li->blnr[i + 1] - li->blnr[i]);
+        }
+        li->blnr_simd[blk + 1] = li->blnr_simd[blk] + ncol*GMX_SIMD_REAL_WIDTH;
+    }
+    li->ncc_simd = li->blnr_simd[nblock];
+    if (li->ncc_simd > li->ncc_simd_alloc)
+    {
+        li->ncc_simd_alloc = over_alloc_dd(li->ncc_simd);
+        srenew(li->blbnb_simd, li->ncc_simd_alloc);
+        srenew(li->blind_simd, li->ncc_simd_alloc);
+        resize_real_aligned(&li->blmf_simd, li->ncc_simd_alloc);
+        resize_real_aligned(&li->blmf1_simd, li->ncc_simd_alloc);
+        resize_real_aligned(&li->blcc_simd, li->ncc_simd_alloc);
+    }
+#endif
+
 #pragma omp parallel for num_threads(li->ntask) schedule(static)
     for (th = 0; th < li->ntask; th++)
     {
@@ -2383,6 +2653,10 @@ void set_lincs(const t_idef         *idef,
     {
         fprintf(debug, "Number of constraints is %d, padded %d, couplings %d\n",
                 li->nc_real, li->nc, li->ncc);
+#ifdef LINCS_SIMD
+        fprintf(debug, "Number of couplings in SIMD blocked layout %d\n",
+                li->ncc_simd);
+#endif
     }
 
     if (li->ntask > 1)
@@ -146,6 +146,15 @@ void cshake(const int iatom[], int ncon, int *nnit, int maxnit,
             const real invmass[], const real tt[], real lagr[], int *nerror);
 /* Regular iterative shake */
 
+void cshake_blocks(const int iatom[], int nblock, int ncon, int *nnit, int maxnit,
+                   const real dist2[], real xp[], const real rij[], const real m2[], real omega,
+                   const real invmass[], const real tt[], real lagr[], int *nerror);
+/* Iterative shake of nblock independent blocks of ncon constraints each,
+ * stored consecutively. With SIMD support multiple blocks are constrained
+ * simultaneously. Returns the maximum iteration count over the blocks
+ * in nnit and one more than the index of the failing constraint in nerror.
+ */
+
 void crattle(int iatom[], int ncon, int *nnit, int maxnit,
              real dist2[], real vp[], real rij[], real m2[], real omega,
              real invmass[], real tt[], real lagr[], int *nerror, real invdt);
@@ -44,9 +44,18 @@
 #include "gromacs/mdlib/constr.h"
 #include "gromacs/pbcutil/ishift.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/pbcutil/pbc-simd.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
+#include "gromacs/simd/vector_operations.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/smalloc.h"
 
+#if GMX_SIMD_HAVE_REAL
+/* With SIMD we process GMX_SIMD_REAL_WIDTH waters at once */
+#    define SETTLE_SIMD
+#endif
+
 typedef struct
 {
     real   mO;
@@ -167,6 +176,221 @@ static void check_cons(FILE *fp, char *title, real x[], int OW1, int HW2, int HW
 }
 #endif
 
+#ifdef SETTLE_SIMD
+/* Load the coordinates of GMX_SIMD_REAL_WIDTH atoms with indices a
+ * from the flat coordinate array x into the SIMD vector v_S,
+ * buf should be aligned and have space for DIM*GMX_SIMD_REAL_WIDTH reals.
+ */
+static gmx_inline void gmx_simdcall
+gather_atoms_simd(const real * gmx_restrict x,
+                  const int *               a,
+                  real * gmx_restrict       buf,
+                  gmx_simd_real_t           v_S[DIM])
+{
+    int s, d;
+
+    for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+    {
+        for (d = 0; d < DIM; d++)
+        {
+            buf[d*GMX_SIMD_REAL_WIDTH + s] = x[a[s]*DIM + d];
+        }
+    }
+    for (d = 0; d < DIM; d++)
+    {
+        v_S[d] = gmx_simd_load_r(buf + d*GMX_SIMD_REAL_WIDTH);
+    }
+}
+
+/* Add fac times the SIMD vector v_S to the coordinates
+ * of the GMX_SIMD_REAL_WIDTH atoms with indices a in the flat array x.
+ */
+static gmx_inline void gmx_simdcall
+scatter_add_atoms_simd(real * gmx_restrict   x,
+                       const int *           a,
+                       real * gmx_restrict   buf,
+                       real                  fac,
+                       const gmx_simd_real_t v_S[DIM])
+{
+    int s, d;
+
+    for (d = 0; d < DIM; d++)
+    {
+        gmx_simd_store_r(buf + d*GMX_SIMD_REAL_WIDTH, v_S[d]);
+    }
+    for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+    {
+        for (d = 0; d < DIM; d++)
+        {
+            x[a[s]*DIM + d] += fac*buf[d*GMX_SIMD_REAL_WIDTH + s];
+        }
+    }
+}
+
+/* Extract the atom indices of GMX_SIMD_REAL_WIDTH settles starting
+ * at iatoms. Returns 1 for settles with the oxygen below calcvir_atom_end
+ * and 0 otherwise, so this can be used to mask the virial contributions.
+ */
+static gmx_inline gmx_simd_real_t gmx_simdcall
+settle_indices_simd(const t_iatom *iatoms, int calcvir_atom_end,
+                    int *ow1, int *hw2, int *hw3, real *buf)
+{
+    int s;
+
+    for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+    {
+        ow1[s] = iatoms[s*4 + 1];
+        hw2[s] = iatoms[s*4 + 2];
+        hw3[s] = iatoms[s*4 + 3];
+        buf[s] = (ow1[s] < calcvir_atom_end ? 1 : 0);
+    }
+
+    return gmx_simd_load_r(buf);
+}
+
+/* SIMD version of the settle_proj loop, nsettle should be a multiple
+ * of GMX_SIMD_REAL_WIDTH. calcvir_atom_end is an atom index.
+ */
+static void gmx_simdcall
+settle_proj_simd(const settleparam_t *p,
+                 int nsettle, const t_iatom iatoms[],
+                 const t_pbc *pbc,
+                 const real * gmx_restrict x,
+                 const real * gmx_restrict der, real * gmx_restrict derp,
+                 int calcvir_atom_end, tensor vir_r_m_dder)
+{
+    int             i, d, d2;
+    int             ow1[GMX_SIMD_REAL_WIDTH];
+    int             hw2[GMX_SIMD_REAL_WIDTH];
+    int             hw3[GMX_SIMD_REAL_WIDTH];
+    real            buf_array[DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *buf;
+    gmx_simd_real_t imO_S, imH_S, invdOH_S, invdHH_S, dOH_S, dHH_S;
+    gmx_simd_real_t invmat_S[DIM][DIM];
+    gmx_simd_real_t vir_S[DIM][DIM];
+    pbc_simd_t      pbc_simd;
+
+    /* Ensure register memory alignment */
+    buf = gmx_simd_align_r(buf_array);
+
+    set_pbc_simd(pbc, &pbc_simd);
+
+    imO_S    = gmx_simd_set1_r(p->imO);
+    imH_S    = gmx_simd_set1_r(p->imH);
+    invdOH_S = gmx_simd_set1_r(p->invdOH);
+    invdHH_S = gmx_simd_set1_r(p->invdHH);
+    dOH_S    = gmx_simd_set1_r(p->dOH);
+    dHH_S    = gmx_simd_set1_r(p->dHH);
+    for (d = 0; d < DIM; d++)
+    {
+        for (d2 = 0; d2 < DIM; d2++)
+        {
+            invmat_S[d][d2] = gmx_simd_set1_r(p->invmat[d][d2]);
+            vir_S[d][d2]    = gmx_simd_setzero_r();
+        }
+    }
+
+    for (i = 0; i < nsettle; i += GMX_SIMD_REAL_WIDTH)
+    {
+        gmx_simd_real_t vfac_S;
+        gmx_simd_real_t xo_S[DIM], xh2_S[DIM], xh3_S[DIM];
+        gmx_simd_real_t roh2_S[DIM], roh3_S[DIM], rhh_S[DIM];
+        gmx_simd_real_t dc_S[DIM], fc_S[DIM];
+
+        vfac_S = settle_indices_simd(iatoms + i*4, calcvir_atom_end,
+                                     ow1, hw2, hw3, buf);
+
+        gather_atoms_simd(x, ow1, buf, xo_S);
+        gather_atoms_simd(x, hw2, buf, xh2_S);
+        gather_atoms_simd(x, hw3, buf, xh3_S);
+
+        for (d = 0; d < DIM; d++)
+        {
+            roh2_S[d] = gmx_simd_sub_r(xo_S[d], xh2_S[d]);
+            roh3_S[d] = gmx_simd_sub_r(xo_S[d], xh3_S[d]);
+            rhh_S[d]  = gmx_simd_sub_r(xh2_S[d], xh3_S[d]);
+        }
+        pbc_correct_dx_simd(&roh2_S[XX], &roh2_S[YY], &roh2_S[ZZ], &pbc_simd);
+        pbc_correct_dx_simd(&roh3_S[XX], &roh3_S[YY], &roh3_S[ZZ], &pbc_simd);
+        pbc_correct_dx_simd(&rhh_S[XX], &rhh_S[YY], &rhh_S[ZZ], &pbc_simd);
+        for (d = 0; d < DIM; d++)
+        {
+            roh2_S[d] = gmx_simd_mul_r(invdOH_S, roh2_S[d]);
+            roh3_S[d] = gmx_simd_mul_r(invdOH_S, roh3_S[d]);
+            rhh_S[d]  = gmx_simd_mul_r(invdHH_S, rhh_S[d]);
+        }
+
+        /* Determine the projections of der on the bonds,
+         * we reuse the coordinate registers for der.
+         */
+        gather_atoms_simd(der, ow1, buf, xo_S);
+        gather_atoms_simd(der, hw2, buf, xh2_S);
+        gather_atoms_simd(der, hw3, buf, xh3_S);
+
+        dc_S[0] = gmx_simd_iprod_r(gmx_simd_sub_r(xo_S[XX], xh2_S[XX]),
+                                   gmx_simd_sub_r(xo_S[YY], xh2_S[YY]),
+                                   gmx_simd_sub_r(xo_S[ZZ], xh2_S[ZZ]),
+                                   roh2_S[XX], roh2_S[YY], roh2_S[ZZ]);
+        dc_S[1] = gmx_simd_iprod_r(gmx_simd_sub_r(xo_S[XX], xh3_S[XX]),
+                                   gmx_simd_sub_r(xo_S[YY], xh3_S[YY]),
+                                   gmx_simd_sub_r(xo_S[ZZ], xh3_S[ZZ]),
+                                   roh3_S[XX], roh3_S[YY], roh3_S[ZZ]);
+        dc_S[2] = gmx_simd_iprod_r(gmx_simd_sub_r(xh2_S[XX], xh3_S[XX]),
+                                   gmx_simd_sub_r(xh2_S[YY], xh3_S[YY]),
+                                   gmx_simd_sub_r(xh2_S[ZZ], xh3_S[ZZ]),
+                                   rhh_S[XX], rhh_S[YY], rhh_S[ZZ]);
+
+        /* Determine the correction for the three bonds */
+        for (d = 0; d < DIM; d++)
+        {
+            fc_S[d] = gmx_simd_mul_r(invmat_S[d][0], dc_S[0]);
+            fc_S[d] = gmx_simd_fmadd_r(invmat_S[d][1], dc_S[1], fc_S[d]);
+            fc_S[d] = gmx_simd_fmadd_r(invmat_S[d][2], dc_S[2], fc_S[d]);
+        }
+
+        /* Subtract the corrections from derp */
+        for (d = 0; d < DIM; d++)
+        {
+            xo_S[d]  = gmx_simd_mul_r(imO_S,
+                                      gmx_simd_fmadd_r(fc_S[1], roh3_S[d],
+                                                       gmx_simd_mul_r(fc_S[0], roh2_S[d])));
+            xh2_S[d] = gmx_simd_mul_r(imH_S,
+                                      gmx_simd_fmsub_r(fc_S[2], rhh_S[d],
+                                                       gmx_simd_mul_r(fc_S[0], roh2_S[d])));
+            xh3_S[d] = gmx_simd_mul_r(imH_S,
+                                      gmx_simd_fnmsub_r(fc_S[2], rhh_S[d],
+                                                        gmx_simd_mul_r(fc_S[1], roh3_S[d])));
+        }
+        scatter_add_atoms_simd(derp, ow1, buf, -1, xo_S);
+        scatter_add_atoms_simd(derp, hw2, buf, -1, xh2_S);
+        scatter_add_atoms_simd(derp, hw3, buf, -1, xh3_S);
+
+        /* Determining r \dot m der is easy,
+         * since fc contains the mass weighted corrections for der.
+         */
+        fc_S[0] = gmx_simd_mul_r(vfac_S, gmx_simd_mul_r(dOH_S, fc_S[0]));
+        fc_S[1] = gmx_simd_mul_r(vfac_S, gmx_simd_mul_r(dOH_S, fc_S[1]));
+        fc_S[2] = gmx_simd_mul_r(vfac_S, gmx_simd_mul_r(dHH_S, fc_S[2]));
+        for (d = 0; d < DIM; d++)
+        {
+            for (d2 = 0; d2 < DIM; d2++)
+            {
+                vir_S[d][d2] = gmx_simd_fmadd_r(gmx_simd_mul_r(roh2_S[d], roh2_S[d2]), fc_S[0], vir_S[d][d2]);
+                vir_S[d][d2] = gmx_simd_fmadd_r(gmx_simd_mul_r(roh3_S[d], roh3_S[d2]), fc_S[1], vir_S[d][d2]);
+                vir_S[d][d2] = gmx_simd_fmadd_r(gmx_simd_mul_r(rhh_S[d], rhh_S[d2]), fc_S[2], vir_S[d][d2]);
+            }
+        }
+    }
+
+    for (d = 0; d < DIM; d++)
+    {
+        for (d2 = 0; d2 < DIM; d2++)
+        {
+            vir_r_m_dder[d][d2] += gmx_simd_reduce_r(vir_S[d][d2]);
+        }
+    }
+}
+#endif /* SETTLE_SIMD */
+
 
 void settle_proj(gmx_settledata_t settled, int econq,
                  int nsettle, t_iatom iatoms[],
@@ -183,11 +407,9 @@ void settle_proj(gmx_settledata_t settled, int econq,
     settleparam_t *p;
     real           imO, imH, dOH, dHH, invdOH, invdHH;
     matrix         invmat;
-    int            i, m, m2, ow1, hw2, hw3;
+    int            i, i0, m, m2, ow1, hw2, hw3;
     rvec           roh2, roh3, rhh, dc, fc;
 
-    calcvir_atom_end *= DIM;
-
     if (econq == econqForce)
     {
         p = &settled->mass1;
@@ -204,11 +426,19 @@ void settle_proj(gmx_settledata_t settled, int econq,
     invdOH = p->invdOH;
     invdHH = p->invdHH;
 
+    i0 = 0;
+#ifdef SETTLE_SIMD
+    /* Do the settles in batches of the SIMD width, the rest below */
+    i0 = nsettle - nsettle % GMX_SIMD_REAL_WIDTH;
+    settle_proj_simd(p, i0, iatoms, pbc, x[0], der[0], derp[0],
+                     calcvir_atom_end, vir_r_m_dder);
+#endif
+
 #ifdef PRAGMAS
 #pragma ivdep
 #endif
 
-    for (i = 0; i < nsettle; i++)
+    for (i = i0; i < nsettle; i++)
     {
         ow1 = iatoms[i*4+1];
         hw2 = iatoms[i*4+2];
@@ -275,6 +505,267 @@ void settle_proj(gmx_settledata_t settled, int econq,
     }
 }
 
+#ifdef SETTLE_SIMD
+/* SIMD version of the csettle loop, processes GMX_SIMD_REAL_WIDTH waters
+ * at once. nsettle should be a multiple of GMX_SIMD_REAL_WIDTH.
+ * calcvir_atom_end is an atom index.
+ * Instead of shifting the hydrogens as the plain-C code does with pbc,
+ * we compute the displacement of all atoms and add it to the original
+ * coordinates, which gives the same result without shifts.
+ */
+static void gmx_simdcall
+csettle_simd(const settleparam_t *p,
+             int nsettle, const t_iatom iatoms[],
+             const t_pbc *pbc,
+             const real * gmx_restrict b4, real * gmx_restrict after,
+             real invdt, real * gmx_restrict v, int calcvir_atom_end,
+             tensor vir_r_m_dr,
+             int *error)
+{
+    int             i, s, d, d2;
+    int             ow1[GMX_SIMD_REAL_WIDTH];
+    int             hw2[GMX_SIMD_REAL_WIDTH];
+    int             hw3[GMX_SIMD_REAL_WIDTH];
+    real            buf_array[DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *buf;
+    gmx_simd_real_t zero_S, one_S;
+    gmx_simd_real_t wh_S, ra_S, inv_ra_S, rb_S, rc_S, irc2_S, mO_S, mH_S;
+    gmx_simd_real_t vir_S[DIM][DIM];
+    pbc_simd_t      pbc_simd;
+
+    /* Ensure register memory alignment */
+    buf = gmx_simd_align_r(buf_array);
+
+    set_pbc_simd(pbc, &pbc_simd);
+
+    zero_S   = gmx_simd_setzero_r();
+    one_S    = gmx_simd_set1_r(1.0);
+    wh_S     = gmx_simd_set1_r(p->wh);
+    ra_S     = gmx_simd_set1_r(p->ra);
+    inv_ra_S = gmx_simd_set1_r(1.0/p->ra);
+    rb_S     = gmx_simd_set1_r(p->rb);
+    rc_S     = gmx_simd_set1_r(p->rc);
+    irc2_S   = gmx_simd_set1_r(p->irc2);
+    mO_S     = gmx_simd_set1_r(p->mO);
+    mH_S     = gmx_simd_set1_r(p->mH);
+    for (d = 0; d < DIM; d++)
+    {
+        for (d2 = 0; d2 < DIM; d2++)
+        {
+            vir_S[d][d2] = gmx_simd_setzero_r();
+        }
+    }
+
+    for (i = 0; i < nsettle; i += GMX_SIMD_REAL_WIDTH)
+    {
+        gmx_simd_real_t vfac_S;
+        gmx_simd_real_t xo_S[DIM], xh2_S[DIM], xh3_S[DIM];
+        gmx_simd_real_t b0_S[DIM], c0_S[DIM], doh2_S[DIM], doh3_S[DIM];
+        gmx_simd_real_t a1_S[DIM], b1_S[DIM], c1_S[DIM];
+        gmx_simd_real_t aksxd_S[DIM], aksyd_S[DIM], akszd_S[DIM];
+        gmx_simd_real_t axlng_S, aylng_S, azlng_S;
+        gmx_simd_real_t trns1_S[DIM], trns2_S[DIM], trns3_S[DIM];
+        gmx_simd_real_t xb0d_S, yb0d_S, xc0d_S, yc0d_S, za1d_S;
+        gmx_simd_real_t xb1d_S, yb1d_S, zb1d_S, xc1d_S, yc1d_S, zc1d_S;
+        gmx_simd_real_t sinphi_S, cosphi_S, sinpsi_S, cospsi_S, tmp_S, tmp2_S;
+        gmx_simd_real_t ya2d_S, xb2d_S, yb2d_S, yc2d_S, t1_S, t2_S;
+        gmx_simd_real_t alpa_S, beta_S, gama_S, al2be2_S, sinthe_S, costhe_S;
+        gmx_simd_real_t a3d_S[DIM], b3d_S[DIM], c3d_S[DIM];
+        gmx_simd_real_t da_S[DIM], db_S[DIM], dc_S[DIM];
+        gmx_simd_bool_t bOK_S;
+
+        vfac_S = settle_indices_simd(iatoms + i*4, calcvir_atom_end,
+                                     ow1, hw2, hw3, buf);
+
+        /*    --- Step1  A1' ---      */
+        gather_atoms_simd(b4, ow1, buf, xo_S);
+        gather_atoms_simd(b4, hw2, buf, xh2_S);
+        gather_atoms_simd(b4, hw3, buf, xh3_S);
+        for (d = 0; d < DIM; d++)
+        {
+            b0_S[d] = gmx_simd_sub_r(xh2_S[d], xo_S[d]);
+            c0_S[d] = gmx_simd_sub_r(xh3_S[d], xo_S[d]);
+        }
+        pbc_correct_dx_simd(&b0_S[XX], &b0_S[YY], &b0_S[ZZ], &pbc_simd);
+        pbc_correct_dx_simd(&c0_S[XX], &c0_S[YY], &c0_S[ZZ], &pbc_simd);
+
+        /* We keep the oxygen b4 coordinates in xo_S for the virial */
+        gather_atoms_simd(after, hw2, buf, xh2_S);
+        gather_atoms_simd(after, hw3, buf, xh3_S);
+        gather_atoms_simd(after, ow1, buf, a1_S);
+        for (d = 0; d < DIM; d++)
+        {
+            doh2_S[d] = gmx_simd_sub_r(xh2_S[d], a1_S[d]);
+            doh3_S[d] = gmx_simd_sub_r(xh3_S[d], a1_S[d]);
+        }
+        pbc_correct_dx_simd(&doh2_S[XX], &doh2_S[YY], &doh2_S[ZZ], &pbc_simd);
+        pbc_correct_dx_simd(&doh3_S[XX], &doh3_S[YY], &doh3_S[ZZ], &pbc_simd);
+
+        /* Compute the center of mass using the oxygen position and
+         * the O-H distances, see the comment in csettle.
+         * The coordinates b1 and c1 are relative to the center of mass.
+         */
+        for (d = 0; d < DIM; d++)
+        {
+            a1_S[d] = gmx_simd_fneg_r(gmx_simd_mul_r(gmx_simd_add_r(doh2_S[d], doh3_S[d]), wh_S));
+            b1_S[d] = gmx_simd_add_r(doh2_S[d], a1_S[d]);
+            c1_S[d] = gmx_simd_add_r(doh3_S[d], a1_S[d]);
+        }
+
+        gmx_simd_cprod_r(b0_S[XX], b0_S[YY], b0_S[ZZ],
+                         c0_S[XX], c0_S[YY], c0_S[ZZ],
+                         &akszd_S[XX], &akszd_S[YY], &akszd_S[ZZ]);
+        gmx_simd_cprod_r(a1_S[XX], a1_S[YY], a1_S[ZZ],
+                         akszd_S[XX], akszd_S[YY], akszd_S[ZZ],
+                         &aksxd_S[XX], &aksxd_S[YY], &aksxd_S[ZZ]);
+        gmx_simd_cprod_r(akszd_S[XX], akszd_S[YY], akszd_S[ZZ],
+                         aksxd_S[XX], aksxd_S[YY], aksxd_S[ZZ],
+                         &aksyd_S[XX], &aksyd_S[YY], &aksyd_S[ZZ]);
+
+        axlng_S = gmx_simd_invsqrt_r(gmx_simd_norm2_r(aksxd_S[XX], aksxd_S[YY], aksxd_S[ZZ]));
+        aylng_S = gmx_simd_invsqrt_r(gmx_simd_norm2_r(aksyd_S[XX], aksyd_S[YY], aksyd_S[ZZ]));
+        azlng_S = gmx_simd_invsqrt_r(gmx_simd_norm2_r(akszd_S[XX], akszd_S[YY], akszd_S[ZZ]));
+
+        /* trnsN_S[d] is element trns(d+1)N of the plain-C code */
+        for (d = 0; d < DIM; d++)
+        {
+            trns1_S[d] = gmx_simd_mul_r(aksxd_S[d], axlng_S);
+            trns2_S[d] = gmx_simd_mul_r(aksyd_S[d], aylng_S);
+            trns3_S[d] = gmx_simd_mul_r(akszd_S[d], azlng_S);
+        }
+
+        xb0d_S = gmx_simd_iprod_r(trns1_S[XX], trns1_S[YY], trns1_S[ZZ], b0_S[XX], b0_S[YY], b0_S[ZZ]);
+        yb0d_S = gmx_simd_iprod_r(trns2_S[XX], trns2_S[YY], trns2_S[ZZ], b0_S[XX], b0_S[YY], b0_S[ZZ]);
+        xc0d_S = gmx_simd_iprod_r(trns1_S[XX], trns1_S[YY], trns1_S[ZZ], c0_S[XX], c0_S[YY], c0_S[ZZ]);
+        yc0d_S = gmx_simd_iprod_r(trns2_S[XX], trns2_S[YY], trns2_S[ZZ], c0_S[XX], c0_S[YY], c0_S[ZZ]);
+        za1d_S = gmx_simd_iprod_r(trns3_S[XX], trns3_S[YY], trns3_S[ZZ], a1_S[XX], a1_S[YY], a1_S[ZZ]);
+        xb1d_S = gmx_simd_iprod_r(trns1_S[XX], trns1_S[YY], trns1_S[ZZ], b1_S[XX], b1_S[YY], b1_S[ZZ]);
+        yb1d_S = gmx_simd_iprod_r(trns2_S[XX], trns2_S[YY], trns2_S[ZZ], b1_S[XX], b1_S[YY], b1_S[ZZ]);
+        zb1d_S = gmx_simd_iprod_r(trns3_S[XX], trns3_S[YY], trns3_S[ZZ], b1_S[XX], b1_S[YY], b1_S[ZZ]);
+        xc1d_S = gmx_simd_iprod_r(trns1_S[XX], trns1_S[YY], trns1_S[ZZ], c1_S[XX], c1_S[YY], c1_S[ZZ]);
+        yc1d_S = gmx_simd_iprod_r(trns2_S[XX], trns2_S[YY], trns2_S[ZZ], c1_S[XX], c1_S[YY], c1_S[ZZ]);
+        zc1d_S = gmx_simd_iprod_r(trns3_S[XX], trns3_S[YY], trns3_S[ZZ], c1_S[XX], c1_S[YY], c1_S[ZZ]);
+
+        /* Lanes with an impossible geometry are masked out with bOK_S,
+         * their arguments are set to 1 to avoid floating point exceptions.
+         */
+        sinphi_S = gmx_simd_mul_r(za1d_S, inv_ra_S);
+        tmp_S    = gmx_simd_fnmadd_r(sinphi_S, sinphi_S, one_S);
+        bOK_S    = gmx_simd_cmplt_r(zero_S, tmp_S);
+        tmp_S    = gmx_simd_blendv_r(one_S, tmp_S, bOK_S);
+        tmp2_S   = gmx_simd_invsqrt_r(tmp_S);
+        cosphi_S = gmx_simd_mul_r(tmp_S, tmp2_S);
+        sinpsi_S = gmx_simd_mul_r(gmx_simd_mul_r(gmx_simd_sub_r(zb1d_S, zc1d_S), irc2_S), tmp2_S);
+        tmp2_S   = gmx_simd_fnmadd_r(sinpsi_S, sinpsi_S, one_S);
+        bOK_S    = gmx_simd_and_b(bOK_S, gmx_simd_cmplt_r(zero_S, tmp2_S));
+        tmp2_S   = gmx_simd_blendv_r(one_S, tmp2_S, bOK_S);
+        cospsi_S = gmx_simd_mul_r(tmp2_S, gmx_simd_invsqrt_r(tmp2_S));
+
+        ya2d_S =  gmx_simd_mul_r(ra_S, cosphi_S);
+        xb2d_S =  gmx_simd_fneg_r(gmx_simd_mul_r(rc_S, cospsi_S));
+        t1_S   =  gmx_simd_fneg_r(gmx_simd_mul_r(rb_S, cosphi_S));
+        t2_S   =  gmx_simd_mul_r(gmx_simd_mul_r(rc_S, sinpsi_S), sinphi_S);
+        yb2d_S =  gmx_simd_sub_r(t1_S, t2_S);
+        yc2d_S =  gmx_simd_add_r(t1_S, t2_S);
+
+        /*     --- Step3  al,be,ga            --- */
+        alpa_S   = gmx_simd_mul_r(xb2d_S, gmx_simd_sub_r(xb0d_S, xc0d_S));
+        alpa_S   = gmx_simd_fmadd_r(yb0d_S, yb2d_S, alpa_S);
+        alpa_S   = gmx_simd_fmadd_r(yc0d_S, yc2d_S, alpa_S);
+        beta_S   = gmx_simd_mul_r(xb2d_S, gmx_simd_sub_r(yc0d_S, yb0d_S));
+        beta_S   = gmx_simd_fmadd_r(xb0d_S, yb2d_S, beta_S);
+        beta_S   = gmx_simd_fmadd_r(xc0d_S, yc2d_S, beta_S);
+        gama_S   = gmx_simd_fmsub_r(xb0d_S, yb1d_S, gmx_simd_mul_r(xb1d_S, yb0d_S));
+        gama_S   = gmx_simd_fmadd_r(xc0d_S, yc1d_S, gama_S);
+        gama_S   = gmx_simd_fnmadd_r(xc1d_S, yc0d_S, gama_S);
+        al2be2_S = gmx_simd_fmadd_r(alpa_S, alpa_S, gmx_simd_mul_r(beta_S, beta_S));
+        tmp2_S   = gmx_simd_fnmadd_r(gama_S, gama_S, al2be2_S);
+        tmp2_S   = gmx_simd_blendv_r(one_S, tmp2_S, bOK_S);
+        sinthe_S = gmx_simd_fnmadd_r(beta_S, gmx_simd_mul_r(tmp2_S, gmx_simd_invsqrt_r(tmp2_S)),
+                                     gmx_simd_mul_r(alpa_S, gama_S));
+        sinthe_S = gmx_simd_mul_r(sinthe_S, gmx_simd_invsqrt_r(gmx_simd_mul_r(al2be2_S, al2be2_S)));
+
+        /*  --- Step4  A3' --- */
+        tmp2_S    = gmx_simd_fnmadd_r(sinthe_S, sinthe_S, one_S);
+        tmp2_S    = gmx_simd_blendv_r(one_S, tmp2_S, bOK_S);
+        costhe_S  = gmx_simd_mul_r(tmp2_S, gmx_simd_invsqrt_r(tmp2_S));
+        a3d_S[XX] = gmx_simd_fneg_r(gmx_simd_mul_r(ya2d_S, sinthe_S));
+        a3d_S[YY] = gmx_simd_mul_r(ya2d_S, costhe_S);
+        a3d_S[ZZ] = za1d_S;
+        b3d_S[XX] = gmx_simd_fmsub_r(xb2d_S, costhe_S, gmx_simd_mul_r(yb2d_S, sinthe_S));
+        b3d_S[YY] = gmx_simd_fmadd_r(xb2d_S, sinthe_S, gmx_simd_mul_r(yb2d_S, costhe_S));
+        b3d_S[ZZ] = zb1d_S;
+        c3d_S[XX] = gmx_simd_fnmsub_r(xb2d_S, costhe_S, gmx_simd_mul_r(yc2d_S, sinthe_S));
+        c3d_S[YY] = gmx_simd_fnmadd_r(xb2d_S, sinthe_S, gmx_simd_mul_r(yc2d_S, costhe_S));
+        c3d_S[ZZ] = zc1d_S;
+
+        /*    --- Step5  A3 ---
+         * We directly compute the displacements, masked with bOK_S.
+         */
+        for (d = 0; d < DIM; d++)
+        {
+            gmx_simd_real_t a3_S, b3_S, c3_S;
+
+            a3_S  = gmx_simd_iprod_r(trns1_S[d], trns2_S[d], trns3_S[d], a3d_S[XX], a3d_S[YY], a3d_S[ZZ]);
+            b3_S  = gmx_simd_iprod_r(trns1_S[d], trns2_S[d], trns3_S[d], b3d_S[XX], b3d_S[YY], b3d_S[ZZ]);
+            c3_S  = gmx_simd_iprod_r(trns1_S[d], trns2_S[d], trns3_S[d], c3d_S[XX], c3d_S[YY], c3d_S[ZZ]);
+            da_S[d] = gmx_simd_blendzero_r(gmx_simd_sub_r(a3_S, a1_S[d]), bOK_S);
+            db_S[d] = gmx_simd_blendzero_r(gmx_simd_sub_r(b3_S, b1_S[d]), bOK_S);
+            dc_S[d] = gmx_simd_blendzero_r(gmx_simd_sub_r(c3_S, c1_S[d]), bOK_S);
+        }
+
+        scatter_add_atoms_simd(after, ow1, buf, 1, da_S);
+        scatter_add_atoms_simd(after, hw2, buf, 1, db_S);
+        scatter_add_atoms_simd(after, hw3, buf, 1, dc_S);
+
+        if (v != NULL)
+        {
+            scatter_add_atoms_simd(v, ow1, buf, invdt, da_S);
+            scatter_add_atoms_simd(v, hw2, buf, invdt, db_S);
+            scatter_add_atoms_simd(v, hw3, buf, invdt, dc_S);
+        }
+
+        /* The virial contribution, xo_S contains the b4 oxygen coordinates */
+        for (d2 = 0; d2 < DIM; d2++)
+        {
+            da_S[d2] = gmx_simd_mul_r(gmx_simd_mul_r(vfac_S, mO_S), da_S[d2]);
+            db_S[d2] = gmx_simd_mul_r(gmx_simd_mul_r(vfac_S, mH_S), db_S[d2]);
+            dc_S[d2] = gmx_simd_mul_r(gmx_simd_mul_r(vfac_S, mH_S), dc_S[d2]);
+        }
+        for (d = 0; d < DIM; d++)
+        {
+            gmx_simd_real_t xb_S, xc_S;
+
+            xb_S = gmx_simd_add_r(xo_S[d], b0_S[d]);
+            xc_S = gmx_simd_add_r(xo_S[d], c0_S[d]);
+            for (d2 = 0; d2 < DIM; d2++)
+            {
+                vir_S[d][d2] = gmx_simd_fmadd_r(xo_S[d], da_S[d2], vir_S[d][d2]);
+                vir_S[d][d2] = gmx_simd_fmadd_r(xb_S, db_S[d2], vir_S[d][d2]);
+                vir_S[d][d2] = gmx_simd_fmadd_r(xc_S, dc_S[d2], vir_S[d][d2]);
+            }
+        }
+
+        /* Report a failing settle, as the plain-C code we report the last */
+        gmx_simd_store_r(buf, gmx_simd_blendzero_r(one_S, bOK_S));
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            if (buf[s] == 0)
+            {
+                *error = i + s;
+            }
+        }
+    }
+
+    for (d = 0; d < DIM; d++)
+    {
+        for (d2 = 0; d2 < DIM; d2++)
+        {
+            vir_r_m_dr[d][d2] -= gmx_simd_reduce_r(vir_S[d][d2]);
+        }
+    }
+}
+#endif /* SETTLE_SIMD */
+
 
 void csettle(gmx_settledata_t settled,
              int nsettle, t_iatom iatoms[],
@@ -317,7 +808,7 @@ void csettle(gmx_settledata_t settled,
 
     gmx_bool bOK;
 
-    int      i, ow1, hw2, hw3;
+    int      i, i0, ow1, hw2, hw3;
 
     rvec     dx, sh_hw2 = {0, 0, 0}, sh_hw3 = {0, 0, 0};
     rvec     doh2, doh3;
@@ -325,8 +816,6 @@ void csettle(gmx_settledata_t settled,
 
     *error = -1;
 
-    CalcVirAtomEnd *= 3;
-
     p     = &settled->massw;
     wh    = p->wh;
     rc    = p->rc;
@@ -336,10 +825,20 @@ void csettle(gmx_settledata_t settled,
     mO    = p->mO;
     mH    = p->mH;
 
+    i0 = 0;
+#ifdef SETTLE_SIMD
+    /* Do the settles in batches of the SIMD width, the rest below */
+    i0 = nsettle - nsettle % GMX_SIMD_REAL_WIDTH;
+    csettle_simd(p, i0, iatoms, pbc, b4, after, invdt, v, CalcVirAtomEnd,
+                 vir_r_m_dr, error);
+#endif
+
+    CalcVirAtomEnd *= 3;
+
 #ifdef PRAGMAS
 #pragma ivdep
 #endif
-    for (i = 0; i < nsettle; ++i)
+    for (i = i0; i < nsettle; ++i)
     {
         bOK = TRUE;
         /*    --- Step1  A1' ---      */
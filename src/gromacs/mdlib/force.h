@@ -220,4 +220,7 @@ void free_gpu_resources(const t_forcerec            *fr,
                         const gmx_gpu_info_t        *gpu_info,
                         const gmx_gpu_opt_t         *gpu_opt);
 
+void free_nbnxn_atomdata(const t_forcerec *fr);
+/* Frees the thread synchronization data of the nbnxn atom data */
+
 #endif
@@ -3242,6 +3242,25 @@ void forcerec_set_excl_load(t_forcerec           *fr,
     }
 }
 
+void free_nbnxn_atomdata(const t_forcerec *fr)
+{
+    int i;
+
+    if (fr == NULL || fr->nbv == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < fr->nbv->ngrp; i++)
+    {
+        /* The non-local group can share the atom data of the local one */
+        if (i == 0 || fr->nbv->grp[i].nbat != fr->nbv->grp[0].nbat)
+        {
+            nbnxn_atomdata_done(fr->nbv->grp[i].nbat);
+        }
+    }
+}
+
 /* Frees GPU memory and destroys the GPU context.
  *
  * Note that this function needs to be called even if GPUs are not used
@@ -0,0 +1,147 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2016, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief This file defines a lightweight barrier for threads
+ * inside an OpenMP parallel region.
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include "gmx_omp_barrier.h"
+
+#include <cstdlib>
+
+#include <algorithm>
+#include <thread>
+
+#include "thread_mpi/atomic.h"
+
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
+#include "gromacs/utility/smalloc.h"
+
+/*! \brief Number of pause iterations before a waiting thread yields
+ *
+ * The non-bonded force reduction is reached by all threads at nearly
+ * the same time, so we spin long to avoid the latency of waking up
+ * threads.
+ */
+static const int c_spinCount = 20000;
+
+struct gmx_omp_barrier_t
+{
+    int           nthreads;   /* The number of threads to wait for     */
+    int           nspin;      /* Pause iterations before yielding      */
+    tMPI_Atomic_t count;      /* The number of threads still to arrive */
+    tMPI_Atomic_t generation; /* Incremented when all threads arrived  */
+};
+
+gmx_omp_barrier_t *gmx_omp_barrier_init(int nthreads)
+{
+    gmx_omp_barrier_t *barrier;
+    const char        *env;
+
+    snew(barrier, 1);
+
+    barrier->nthreads = nthreads;
+    barrier->nspin    = c_spinCount;
+    if ((env = getenv("GMX_OMP_BARRIER_SPIN")) != NULL)
+    {
+        barrier->nspin = std::max(0, static_cast<int>(strtol(env, NULL, 10)));
+    }
+    tMPI_Atomic_set(&barrier->count, nthreads);
+    tMPI_Atomic_set(&barrier->generation, 0);
+
+    return barrier;
+}
+
+int gmx_omp_barrier_nthreads(const gmx_omp_barrier_t *barrier)
+{
+    return barrier->nthreads;
+}
+
+void gmx_omp_barrier_wait(gmx_omp_barrier_t *barrier)
+{
+    /* A team of another size would hang or pass the barrier early */
+    GMX_RELEASE_ASSERT(gmx_omp_get_num_threads() == barrier->nthreads,
+                       "The barrier should be reached by the number of threads it was created for");
+
+#ifdef TMPI_ATOMICS
+    int generation, spin;
+
+    if (barrier->nthreads == 1)
+    {
+        return;
+    }
+
+    /* The generation can only change after our own decrement below */
+    generation = tMPI_Atomic_get(&barrier->generation);
+
+    if (tMPI_Atomic_fetch_add(&barrier->count, -1) == 1)
+    {
+        /* We are the last thread: reset the count and release the others */
+        tMPI_Atomic_set(&barrier->count, barrier->nthreads);
+        tMPI_Atomic_memory_barrier();
+        tMPI_Atomic_set(&barrier->generation, generation + 1);
+    }
+    else
+    {
+        spin = 0;
+        while (tMPI_Atomic_get(&barrier->generation) == generation)
+        {
+            if (spin < barrier->nspin)
+            {
+                gmx_pause();
+                spin++;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+    /* Guarantee that no later load happens before the barrier */
+    tMPI_Atomic_memory_barrier();
+#else
+#pragma omp barrier
+#endif
+}
+
+void gmx_omp_barrier_destroy(gmx_omp_barrier_t *barrier)
+{
+    sfree(barrier);
+}
@@ -0,0 +1,82 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2016, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ *
+ * \brief This file declares a lightweight barrier for threads
+ * inside an OpenMP parallel region.
+ *
+ * \inlibraryapi
+ * \ingroup module_mdlib
+ */
+
+#ifndef GMX_MDLIB_GMX_OMP_BARRIER_H
+#define GMX_MDLIB_GMX_OMP_BARRIER_H
+
+/*! \brief Spin-then-yield barrier for the threads of a parallel region
+ *
+ * Waiting threads first spin on an atomic with a pause instruction
+ * and then yield the core until the last thread has arrived. For the
+ * short and regular phases of an MD step this has lower latency than
+ * ending a parallel region and opening a new one. Without native
+ * atomics an OpenMP barrier is used.
+ *
+ * The barrier counts arrivals, so it assumes that exactly the number
+ * of threads it was created for reach it: with fewer threads it would
+ * never release, with more a thread could pass early.
+ */
+struct gmx_omp_barrier_t;
+
+/*! \brief Returns a new barrier for \p nthreads threads
+ *
+ * The spin count can be overridden with the environment variable
+ * GMX_OMP_BARRIER_SPIN.
+ */
+gmx_omp_barrier_t *gmx_omp_barrier_init(int nthreads);
+
+/*! \brief Returns the number of threads the barrier waits for */
+int gmx_omp_barrier_nthreads(const gmx_omp_barrier_t *barrier);
+
+/*! \brief Waits until all threads of the barrier have called this function
+ *
+ * Should be called by all threads of a parallel region with exactly
+ * gmx_omp_barrier_nthreads() threads, this is asserted. Stores before
+ * the barrier are visible to all threads after the barrier.
+ */
+void gmx_omp_barrier_wait(gmx_omp_barrier_t *barrier);
+
+/*! \brief Frees the barrier */
+void gmx_omp_barrier_destroy(gmx_omp_barrier_t *barrier);
+
+#endif
@@ -43,6 +43,8 @@
 #include <cstdlib>
 #include <cstring>
 
+#include "thread_mpi/threads.h"
+
 #include "gromacs/gmxlib/md_logging.h"
 #include "gromacs/gmxlib/network.h"
 #include "gromacs/mdtypes/commrec.h"
@@ -94,6 +96,11 @@ static const char *mod_name[emntNR] =
  * */
 static omp_module_nthreads_t modth = { 0, 0, {0, 0, 0, 0, 0, 0, 0, 0, 0}, FALSE};
 
+#ifdef GMX_THREAD_MPI
+/** Lock for setting up modth from the masters of multiple simulations. */
+static tMPI_Thread_mutex_t modth_lock = TMPI_THREAD_MUTEX_INITIALIZER;
+#endif
+
 
 /** Determine the number of threads for module \p mod.
  *
@@ -256,9 +263,9 @@ static void manage_number_of_openmp_threads(FILE               *fplog,
 
 #ifdef GMX_THREAD_MPI
     /* modth is shared among tMPI threads, so for thread safety, the
-     * detection is done on the master only. It is not thread-safe
-     * with multiple simulations, but that's anyway not supported by
-     * tMPI. */
+     * detection is done on the master only. With multiple simulations
+     * the masters of all simulations get here, the caller serializes
+     * them and only the first one sets up modth. */
     if (!SIMMASTER(cr))
     {
         return;
@@ -538,11 +545,17 @@ void gmx_omp_nthreads_init(FILE *fplog, t_commrec *cr,
     bSepPME = ( (cr->duty & DUTY_PP) && !(cr->duty & DUTY_PME)) ||
         (!(cr->duty & DUTY_PP) &&  (cr->duty & DUTY_PME));
 
+#ifdef GMX_THREAD_MPI
+    tMPI_Thread_mutex_lock(&modth_lock);
+#endif
     manage_number_of_openmp_threads(fplog, cr, bOMP,
                                     nthreads_hw_avail,
                                     omp_nthreads_req, omp_nthreads_pme_req,
                                     bThisNodePMEOnly, bFullOmpSupport,
                                     nppn, bSepPME);
+#ifdef GMX_THREAD_MPI
+    tMPI_Thread_mutex_unlock(&modth_lock);
+#endif
 #ifdef GMX_THREAD_MPI
     /* Non-master threads have to wait for the OpenMP management to be
      * done, so that code elsewhere that uses OpenMP can be certain
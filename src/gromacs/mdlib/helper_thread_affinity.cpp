@@ -0,0 +1,75 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2016, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+#include "gmxpre.h"
+
+#include "helper_thread_affinity.h"
+
+#include "config.h"
+
+#ifdef HAVE_SCHED_AFFINITY
+#  include <sched.h>
+#endif
+
+#include "gromacs/utility/fatalerror.h"
+
+#ifdef HAVE_SCHED_AFFINITY
+/* The affinity mask of the process before mdrun set any thread affinity.
+ * It is only written before mdrun starts any thread.
+ */
+static cpu_set_t helperThreadMask;
+static bool      bHelperThreadMaskStored = false;
+#endif
+
+void gmx_store_helper_thread_affinity(void)
+{
+#ifdef HAVE_SCHED_AFFINITY
+    CPU_ZERO(&helperThreadMask);
+    /* A pid of 0 refers to the calling thread */
+    bHelperThreadMaskStored =
+        (sched_getaffinity(0, sizeof(cpu_set_t), &helperThreadMask) == 0);
+#endif
+}
+
+void gmx_set_helper_thread_affinity(void)
+{
+#ifdef HAVE_SCHED_AFFINITY
+    if (bHelperThreadMaskStored &&
+        sched_setaffinity(0, sizeof(cpu_set_t), &helperThreadMask) != 0 &&
+        debug)
+    {
+        fprintf(debug, "Could not set the affinity of a helper thread\n");
+    }
+#endif
+}
@@ -0,0 +1,68 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2016, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ * \brief
+ * Declares functions for setting the affinity of helper threads.
+ *
+ * mdrun can start helper threads, for instance for writing trajectory
+ * frames, from a thread that it has pinned to a core. Such threads
+ * inherit that pinning and would compete for the core with the compute
+ * thread that started them. They should call
+ * gmx_set_helper_thread_affinity() when they start.
+ *
+ * \inlibraryapi
+ * \ingroup module_mdlib
+ */
+#ifndef GMX_MDLIB_HELPER_THREAD_AFFINITY_H
+#define GMX_MDLIB_HELPER_THREAD_AFFINITY_H
+
+/*! \brief Stores the affinity mask of the calling thread for use by helper threads
+ *
+ * Should be called by the main thread of the process before mdrun starts
+ * any other thread or sets any thread affinity. The mask is that of the
+ * process at startup, so it is shared by all simulations that run in
+ * the process.
+ */
+void gmx_store_helper_thread_affinity(void);
+
+/*! \brief Lets the calling helper thread run on all cores of the stored mask
+ *
+ * Does nothing when no mask was stored or when affinities are not
+ * supported. Failure is not an error, then the thread only keeps the
+ * affinity of the thread that started it.
+ */
+void gmx_set_helper_thread_affinity(void);
+
+#endif
@@ -44,6 +44,8 @@
 #include <cstdlib>
 #include <cstring>
 
+#include <string>
+
 #include "gromacs/commandline/filenm.h"
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/gmxlib/network.h"
@@ -54,6 +56,7 @@
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxmpi.h"
+#include "gromacs/utility/path.h"
 #include "gromacs/utility/programcontext.h"
 #include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/snprintf.h"
@@ -267,6 +270,26 @@ void gmx_log_close(FILE *fp)
     }
 }
 
+void prefix_relative_file_names(const char *dir, int nfile, const t_filenm fnm[])
+{
+    for (int i = 0; i < nfile; i++)
+    {
+        if (fnm[i].opt != NULL && strcmp(fnm[i].opt, "-multidir") == 0)
+        {
+            continue;
+        }
+        for (int j = 0; j < fnm[i].nfiles; j++)
+        {
+            if (!gmx::Path::isAbsolute(fnm[i].fns[j]))
+            {
+                std::string fn = gmx::Path::join(dir, fnm[i].fns[j]);
+                sfree(fnm[i].fns[j]);
+                fnm[i].fns[j] = gmx_strdup(fn.c_str());
+            }
+        }
+    }
+}
+
 void init_multisystem(t_commrec *cr, int nsim, char **multidirs,
                       int nfile, const t_filenm fnm[], gmx_bool bParFn)
 {
@@ -353,11 +376,23 @@ void init_multisystem(t_commrec *cr, int nsim, char **multidirs,
 
     if (multidirs)
     {
+#ifdef GMX_THREAD_MPI
+        /* All thread-MPI simulations share the working directory of
+         * this process, so instead of changing directory we prefix
+         * the relative file names with the simulation directory.
+         */
+        if (debug)
+        {
+            fprintf(debug, "Using directory %s for relative file names\n", multidirs[cr->ms->sim]);
+        }
+        prefix_relative_file_names(multidirs[cr->ms->sim], nfile, fnm);
+#else
         if (debug)
         {
             fprintf(debug, "Changing to directory %s\n", multidirs[cr->ms->sim]);
         }
         gmx_chdir(multidirs[cr->ms->sim]);
+#endif
     }
     else if (bParFn)
     {
@@ -66,6 +66,13 @@ void check_multi_int64(FILE *log, const gmx_multisim_t *ms,
  * no output is written.
  */
 
+void prefix_relative_file_names(const char *dir, int nfile, const t_filenm fnm[]);
+/* Prefixes the relative names of all files in fnm, except those of
+ * the -multidir option, with the directory dir. This is used instead of
+ * changing directory for -multidir with thread-MPI, since all
+ * simulations then share the working directory of the process.
+ */
+
 void init_multisystem(t_commrec *cr, int nsim, char **multidirs,
                       int nfile, const t_filenm fnm[], gmx_bool bParFn);
 /* Splits the communication into nsim separate simulations
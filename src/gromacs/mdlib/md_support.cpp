@@ -267,31 +267,25 @@ real compute_conserved_from_auxiliary(t_inputrec *ir, t_state *state, t_extmass
 
 /* TODO Specialize this routine into init-time and loop-time versions?
    e.g. bReadEkin is only true when restoring from checkpoint */
-void compute_globals(FILE *fplog, gmx_global_stat_t gstat, t_commrec *cr, t_inputrec *ir,
-                     t_forcerec *fr, gmx_ekindata_t *ekind,
-                     t_state *state, t_mdatoms *mdatoms,
-                     t_nrnb *nrnb, t_vcm *vcm, gmx_wallcycle_t wcycle,
-                     gmx_enerdata_t *enerd, tensor force_vir, tensor shake_vir, tensor total_vir,
-                     tensor pres, rvec mu_tot, gmx_constr_t constr,
-                     struct gmx_signalling_t *gs, gmx_bool bInterSimGS,
-                     matrix box, gmx_mtop_t *top_global,
-                     gmx_bool *bSumEkinhOld, int flags)
+void compute_globals_start(FILE *fplog, gmx_global_stat_t gstat, t_commrec *cr, t_inputrec *ir,
+                           gmx_ekindata_t *ekind,
+                           t_state *state, t_mdatoms *mdatoms,
+                           t_nrnb *nrnb, t_vcm *vcm, gmx_wallcycle_t wcycle,
+                           gmx_enerdata_t *enerd, tensor force_vir, tensor shake_vir,
+                           rvec mu_tot, gmx_constr_t constr,
+                           struct gmx_signalling_t *gs, gmx_mtop_t *top_global,
+                           gmx_bool *bSumEkinhOld, int flags)
 {
-    tensor   corr_vir, corr_pres;
-    gmx_bool bEner, bPres, bTemp;
-    gmx_bool bStopCM, bGStat,
-             bReadEkin, bEkinAveVel, bScaleEkin, bConstrain;
-    real     prescorr, enercorr, dvdlcorr, dvdl_ekin;
+    gmx_bool bPres, bTemp;
+    gmx_bool bStopCM, bGStat, bReadEkin, bEkinAveVel;
+    gmx::ArrayRef<real> signalBuffer;
 
     /* translate CGLO flags to gmx_booleans */
     bStopCM       = flags & CGLO_STOPCM;
     bGStat        = flags & CGLO_GSTAT;
     bReadEkin     = (flags & CGLO_READEKIN);
-    bScaleEkin    = (flags & CGLO_SCALEEKIN);
-    bEner         = flags & CGLO_ENERGY;
     bTemp         = flags & CGLO_TEMPERATURE;
     bPres         = (flags & CGLO_PRESSURE);
-    bConstrain    = (flags & CGLO_CONSTRAINT);
 
     /* we calculate a full state kinetic energy either with full-step velocity verlet
        or half step where we need the pressure */
@@ -313,7 +307,7 @@ void compute_globals(FILE *fplog, gmx_global_stat_t gstat, t_commrec *cr, t_inpu
         {
             accumulate_u(cr, &(ir->opts), ekind);
         }
-        if (!bReadEkin)
+        if (!bReadEkin && !(flags & CGLO_EKINHDONE))
         {
             calc_ke_part(state, &(ir->opts), mdatoms, ekind, nrnb, bEkinAveVel);
         }
@@ -326,7 +320,7 @@ void compute_globals(FILE *fplog, gmx_global_stat_t gstat, t_commrec *cr, t_inpu
                      state->x, state->v, vcm);
     }
 
-    if (bTemp || bStopCM || bPres || bEner || bConstrain)
+    if (bTemp || bStopCM || bPres || (flags & CGLO_ENERGY) || (flags & CGLO_CONSTRAINT))
     {
         if (!bGStat)
         {
@@ -338,21 +332,65 @@ void compute_globals(FILE *fplog, gmx_global_stat_t gstat, t_commrec *cr, t_inpu
         }
         else
         {
-            gmx::ArrayRef<real> signalBuffer = prepareSignalBuffer(gs);
+            signalBuffer = prepareSignalBuffer(gs);
             if (PAR(cr))
             {
                 wallcycle_start(wcycle, ewcMoveE);
-                global_stat(fplog, gstat, cr, enerd, force_vir, shake_vir, mu_tot,
-                            ir, ekind, constr, bStopCM ? vcm : NULL,
-                            signalBuffer.size(), signalBuffer.data(),
-                            top_global, state,
-                            *bSumEkinhOld, flags);
+                global_stat_start(fplog, gstat, cr, enerd, force_vir, shake_vir, mu_tot,
+                                  ir, ekind, constr, bStopCM ? vcm : NULL,
+                                  signalBuffer.size(), signalBuffer.data(),
+                                  top_global, state,
+                                  *bSumEkinhOld, flags);
                 wallcycle_stop(wcycle, ewcMoveE);
             }
-            handleSignals(gs, cr, bInterSimGS);
-            *bSumEkinhOld = FALSE;
         }
     }
+}
+
+void compute_globals_finish(FILE *fplog, gmx_global_stat_t gstat, t_commrec *cr, t_inputrec *ir,
+                            t_forcerec *fr, gmx_ekindata_t *ekind,
+                            t_state *state, t_mdatoms *mdatoms,
+                            t_nrnb *nrnb, t_vcm *vcm, gmx_wallcycle_t wcycle,
+                            gmx_enerdata_t *enerd, tensor force_vir, tensor shake_vir, tensor total_vir,
+                            tensor pres,
+                            struct gmx_signalling_t *gs, gmx_bool bInterSimGS,
+                            matrix box, gmx_mtop_t *top_global,
+                            gmx_bool *bSumEkinhOld, int flags)
+{
+    tensor   corr_vir, corr_pres;
+    gmx_bool bEner, bPres, bTemp;
+    gmx_bool bStopCM, bGStat, bReadEkin, bEkinAveVel, bScaleEkin, bConstrain;
+    real     prescorr, enercorr, dvdlcorr, dvdl_ekin;
+
+    /* translate CGLO flags to gmx_booleans */
+    bStopCM       = flags & CGLO_STOPCM;
+    bGStat        = flags & CGLO_GSTAT;
+    bReadEkin     = (flags & CGLO_READEKIN);
+    bScaleEkin    = (flags & CGLO_SCALEEKIN);
+    bEner         = flags & CGLO_ENERGY;
+    bTemp         = flags & CGLO_TEMPERATURE;
+    bPres         = (flags & CGLO_PRESSURE);
+    bConstrain    = (flags & CGLO_CONSTRAINT);
+
+    bEkinAveVel = (ir->eI == eiVV || (ir->eI == eiVVAK && bPres) || bReadEkin);
+
+    if (bEner || bPres || bConstrain)
+    {
+        calc_dispcorr(ir, fr, top_global->natoms, box, state->lambda[efptVDW],
+                      corr_pres, corr_vir, &prescorr, &enercorr, &dvdlcorr);
+    }
+
+    if (bGStat && (bTemp || bStopCM || bPres || bEner || bConstrain))
+    {
+        if (PAR(cr))
+        {
+            wallcycle_start(wcycle, ewcMoveE);
+            global_stat_finish(gstat);
+            wallcycle_stop(wcycle, ewcMoveE);
+        }
+        handleSignals(gs, cr, bInterSimGS);
+        *bSumEkinhOld = FALSE;
+    }
 
     if (!ekind->bNEMD && debug && bTemp && (vcm->nr > 0))
     {
@@ -395,12 +433,6 @@ void compute_globals(FILE *fplog, gmx_global_stat_t gstat, t_commrec *cr, t_inpu
 
     /* ##########  Long range energy information ###### */
 
-    if (bEner || bPres || bConstrain)
-    {
-        calc_dispcorr(ir, fr, top_global->natoms, box, state->lambda[efptVDW],
-                      corr_pres, corr_vir, &prescorr, &enercorr, &dvdlcorr);
-    }
-
     if (bEner)
     {
         enerd->term[F_DISPCORR]  = enercorr;
@@ -432,6 +464,24 @@ void compute_globals(FILE *fplog, gmx_global_stat_t gstat, t_commrec *cr, t_inpu
     }
 }
 
+void compute_globals(FILE *fplog, gmx_global_stat_t gstat, t_commrec *cr, t_inputrec *ir,
+                     t_forcerec *fr, gmx_ekindata_t *ekind,
+                     t_state *state, t_mdatoms *mdatoms,
+                     t_nrnb *nrnb, t_vcm *vcm, gmx_wallcycle_t wcycle,
+                     gmx_enerdata_t *enerd, tensor force_vir, tensor shake_vir, tensor total_vir,
+                     tensor pres, rvec mu_tot, gmx_constr_t constr,
+                     struct gmx_signalling_t *gs, gmx_bool bInterSimGS,
+                     matrix box, gmx_mtop_t *top_global,
+                     gmx_bool *bSumEkinhOld, int flags)
+{
+    compute_globals_start(fplog, gstat, cr, ir, ekind, state, mdatoms, nrnb, vcm,
+                          wcycle, enerd, force_vir, shake_vir, mu_tot,
+                          constr, gs, top_global, bSumEkinhOld, flags);
+    compute_globals_finish(fplog, gstat, cr, ir, fr, ekind, state, mdatoms, nrnb, vcm,
+                           wcycle, enerd, force_vir, shake_vir, total_vir, pres,
+                           gs, bInterSimGS, box, top_global, bSumEkinhOld, flags);
+}
+
 void check_nst_param(FILE *fplog, t_commrec *cr,
                      const char *desc_nst, int nst,
                      const char *desc_p, int *p)
@@ -68,6 +68,8 @@ struct t_trxframe;
 #define CGLO_READEKIN       (1<<10)
 /* we need to reset the ekin rescaling factor here */
 #define CGLO_SCALEEKIN      (1<<11)
+/* the half step kinetic energy has already been computed in update */
+#define CGLO_EKINHDONE      (1<<12)
 
 
 /* return the number of steps between global communcations */
@@ -117,4 +119,31 @@ void compute_globals(FILE *fplog, gmx_global_stat_t gstat, t_commrec *cr, t_inpu
                      matrix box, gmx_mtop_t *top_global, gmx_bool *bSumEkinhOld, int flags);
 /* Compute global variables during integration */
 
+void compute_globals_start(FILE *fplog, gmx_global_stat_t gstat, t_commrec *cr, t_inputrec *ir,
+                           gmx_ekindata_t *ekind,
+                           t_state *state, t_mdatoms *mdatoms,
+                           t_nrnb *nrnb, t_vcm *vcm, gmx_wallcycle_t wcycle,
+                           gmx_enerdata_t *enerd, tensor force_vir, tensor shake_vir,
+                           rvec mu_tot, gmx_constr *constr,
+                           gmx_signalling_t *gs, gmx_mtop_t *top_global,
+                           gmx_bool *bSumEkinhOld, int flags);
+/* Computes the local contributions and starts the global sum of
+ * compute_globals. Work that does not touch any of the passed
+ * quantities can be done before calling compute_globals_finish.
+ * The sum is only nonblocking with an MPI library that supports
+ * MPI_Iallreduce, with thread-MPI it completes here.
+ */
+
+void compute_globals_finish(FILE *fplog, gmx_global_stat_t gstat, t_commrec *cr, t_inputrec *ir,
+                            t_forcerec *fr, gmx_ekindata_t *ekind,
+                            t_state *state, t_mdatoms *mdatoms,
+                            t_nrnb *nrnb, t_vcm *vcm, gmx_wallcycle_t wcycle,
+                            gmx_enerdata_t *enerd, tensor force_vir, tensor shake_vir, tensor total_vir,
+                            tensor pres,
+                            gmx_signalling_t *gs, gmx_bool bInterSimGS,
+                            matrix box, gmx_mtop_t *top_global, gmx_bool *bSumEkinhOld, int flags);
+/* Completes the global sum and computes the global quantities.
+ * The flags should be the same as passed to compute_globals_start.
+ */
+
 #endif
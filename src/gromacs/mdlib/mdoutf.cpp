@@ -36,6 +36,10 @@
 
 #include "mdoutf.h"
 
+#include <stdlib.h>
+
+#include "thread_mpi/threads.h"
+
 #include "gromacs/commandline/filenm.h"
 #include "gromacs/domdec/domdec.h"
 #include "gromacs/domdec/domdec_struct.h"
@@ -46,6 +50,7 @@
 #include "gromacs/fileio/xtcio.h"
 #include "gromacs/fileio/xvgr.h"
 #include "gromacs/math/vec.h"
+#include "gromacs/mdlib/helper_thread_affinity.h"
 #include "gromacs/mdlib/mdrun.h"
 #include "gromacs/mdlib/trajectory_writing.h"
 #include "gromacs/mdtypes/commrec.h"
@@ -55,6 +60,44 @@
 #include "gromacs/utility/pleasecite.h"
 #include "gromacs/utility/smalloc.h"
 
+/* The result of writing a trajectory frame */
+enum {
+    eframeOK, eframeTRR, eframeXTC
+};
+
+/* A copy of the data of one trajectory frame */
+typedef struct {
+    int          mdof_flags; /* What to write, a combination of MDOF_X/V/F/X_COMPRESSED */
+    gmx_int64_t  step;       /* The MD step                                             */
+    double       t;          /* The time                                                */
+    real         lambda;     /* The FEP lambda                                          */
+    matrix       box;        /* The box                                                 */
+    rvec        *x;          /* Global coordinates, when MDOF_X or MDOF_X_COMPRESSED    */
+    rvec        *v;          /* Global velocities, when MDOF_V                          */
+    rvec        *f;          /* Global forces, when MDOF_F                              */
+} t_output_frame;
+
+/* Thread on the master rank which compresses and writes trajectory frames,
+ * so the MD loop only needs to copy a frame instead of waiting for the I/O.
+ * The frames are double buffered: the MD loop fills the pending frame while
+ * the thread writes its own frame. The MD loop only waits when it produces
+ * a new frame before the thread has picked up the previous one.
+ */
+typedef struct {
+    tMPI_Thread_t       thread;
+    tMPI_Thread_mutex_t mutex;
+    tMPI_Thread_cond_t  cond_work; /* Signaled when there is a frame or we should stop */
+    tMPI_Thread_cond_t  cond_done; /* Signaled when a frame was picked up or written   */
+    gmx_bool            bPending;  /* The pending frame is filled                      */
+    gmx_bool            bWriting;  /* The thread is writing a frame                    */
+    gmx_bool            bStop;     /* The thread should stop                           */
+    int                 error;     /* The first failed write, then no more are written */
+    t_output_frame      frame[2];  /* The two frame buffers                            */
+    t_output_frame     *pending;   /* Filled by the MD loop                            */
+    t_output_frame     *writing;   /* Written by the thread                            */
+    struct gmx_mdoutf  *of;        /* The output files to write to                     */
+} t_output_thread;
+
 struct gmx_mdoutf {
     t_fileio         *fp_trn;
     t_fileio         *fp_xtc;
@@ -68,15 +111,321 @@ struct gmx_mdoutf {
     gmx_bool          bExpanded;
     int               elamstats;
     int               simulation_part;
+    int               nstlist_tuned; /* nstlist chosen by run-time tuning, 0 if none */
+    double            replex_ref_t;  /* ref_t reached by replica exchange, 0 if none */
     FILE             *fp_dhdl;
     FILE             *fp_field;
     int               natoms_global;
     int               natoms_x_compressed;
     gmx_groups_t     *groups; /* for compressed position writing */
     gmx_wallcycle_t   wcycle;
+    t_output_thread  *othread; /* Writes frames asynchronously, can be NULL */
 };
 
 
+/* Write the frame data selected by mdof_flags to the trajectory files.
+ * Returns eframeOK, or which file could not be written.
+ */
+static int write_trajectory_frame(gmx_mdoutf_t of, int mdof_flags,
+                                  gmx_int64_t step, double t, real lambda,
+                                  matrix box, rvec *x, rvec *v, rvec *f)
+{
+    int error = eframeOK;
+
+    if (mdof_flags & (MDOF_X | MDOF_V | MDOF_F))
+    {
+        if (of->fp_trn)
+        {
+            gmx_trr_write_frame(of->fp_trn, step, t, lambda,
+                                box, of->natoms_global,
+                                (mdof_flags & MDOF_X) ? x : NULL,
+                                (mdof_flags & MDOF_V) ? v : NULL,
+                                (mdof_flags & MDOF_F) ? f : NULL);
+            if (gmx_fio_flush(of->fp_trn) != 0)
+            {
+                return eframeTRR;
+            }
+        }
+
+        /* If a TNG file is open for uncompressed coordinate output also write
+           velocities and forces to it. */
+        else if (of->tng)
+        {
+            gmx_fwrite_tng(of->tng, FALSE, step, t, lambda,
+                           box,
+                           of->natoms_global,
+                           (mdof_flags & MDOF_X) ? x : NULL,
+                           (mdof_flags & MDOF_V) ? v : NULL,
+                           (mdof_flags & MDOF_F) ? f : NULL);
+        }
+        /* If only a TNG file is open for compressed coordinate output (no uncompressed
+           coordinate output) also write forces and velocities to it. */
+        else if (of->tng_low_prec)
+        {
+            gmx_fwrite_tng(of->tng_low_prec, FALSE, step, t, lambda,
+                           box,
+                           of->natoms_global,
+                           (mdof_flags & MDOF_X) ? x : NULL,
+                           (mdof_flags & MDOF_V) ? v : NULL,
+                           (mdof_flags & MDOF_F) ? f : NULL);
+        }
+    }
+    if (mdof_flags & MDOF_X_COMPRESSED)
+    {
+        rvec *xxtc = NULL;
+
+        if (of->natoms_x_compressed == of->natoms_global)
+        {
+            /* We are writing the positions of all of the atoms to
+               the compressed output */
+            xxtc = x;
+        }
+        else
+        {
+            /* We are writing the positions of only a subset of
+               the atoms to the compressed output, so we have to
+               make a copy of the subset of coordinates. */
+            int i, j;
+
+            snew(xxtc, of->natoms_x_compressed);
+            for (i = 0, j = 0; (i < of->natoms_global); i++)
+            {
+                if (ggrpnr(of->groups, egcCompressedX, i) == 0)
+                {
+                    copy_rvec(x[i], xxtc[j++]);
+                }
+            }
+        }
+        if (write_xtc(of->fp_xtc, of->natoms_x_compressed, step, t,
+                      box, xxtc, of->x_compression_precision) == 0)
+        {
+            error = eframeXTC;
+        }
+        else
+        {
+            gmx_fwrite_tng(of->tng_low_prec,
+                           TRUE,
+                           step,
+                           t,
+                           lambda,
+                           box,
+                           of->natoms_x_compressed,
+                           xxtc,
+                           NULL,
+                           NULL);
+        }
+        if (of->natoms_x_compressed != of->natoms_global)
+        {
+            sfree(xxtc);
+        }
+    }
+
+    return error;
+}
+
+/* Exit with a fatal error when error, returned by write_trajectory_frame, is not eframeOK */
+static void check_trajectory_frame_error(int error)
+{
+    switch (error)
+    {
+        case eframeTRR:
+            gmx_file("Cannot write trajectory; maybe you are out of disk space?");
+            break;
+        case eframeXTC:
+            gmx_fatal(FARGS, "XTC error - maybe you are out of disk space?");
+            break;
+    }
+}
+
+/* Copy the global data of a frame into frame, which is reallocated when needed */
+static void copy_output_frame(t_output_frame *frame, int natoms, int mdof_flags,
+                              gmx_int64_t step, double t, real lambda,
+                              matrix box, rvec *x, rvec *v, rvec *f)
+{
+    frame->mdof_flags = mdof_flags;
+    frame->step       = step;
+    frame->t          = t;
+    frame->lambda     = lambda;
+    copy_mat(box, frame->box);
+    if (mdof_flags & (MDOF_X | MDOF_X_COMPRESSED))
+    {
+        if (frame->x == NULL)
+        {
+            snew(frame->x, natoms);
+        }
+        copy_rvecn(x, frame->x, 0, natoms);
+    }
+    if (mdof_flags & MDOF_V)
+    {
+        if (frame->v == NULL)
+        {
+            snew(frame->v, natoms);
+        }
+        copy_rvecn(v, frame->v, 0, natoms);
+    }
+    if (mdof_flags & MDOF_F)
+    {
+        if (frame->f == NULL)
+        {
+            snew(frame->f, natoms);
+        }
+        copy_rvecn(f, frame->f, 0, natoms);
+    }
+}
+
+/* The main function of the output thread.
+ * Errors are not fatal here, but are passed to the MD loop through ot->error.
+ */
+static void *output_thread_loop(void *arg)
+{
+    t_output_thread *ot = static_cast<t_output_thread *>(arg);
+
+    /* Don't compete for the core of the master thread, which started us */
+    gmx_set_helper_thread_affinity();
+
+    tMPI_Thread_mutex_lock(&ot->mutex);
+    while (TRUE)
+    {
+        while (!ot->bPending && !ot->bStop)
+        {
+            tMPI_Thread_cond_wait(&ot->cond_work, &ot->mutex);
+        }
+        if (!ot->bPending)
+        {
+            /* We should stop and there is nothing left to write */
+            break;
+        }
+
+        /* Take the pending frame and free the pending buffer */
+        t_output_frame *frame = ot->pending;
+        ot->pending           = ot->writing;
+        ot->writing           = frame;
+        ot->bPending          = FALSE;
+        ot->bWriting          = TRUE;
+        tMPI_Thread_cond_broadcast(&ot->cond_done);
+        tMPI_Thread_mutex_unlock(&ot->mutex);
+
+        /* Only this thread sets ot->error, so we can read it unlocked */
+        int error = ot->error;
+        if (error == eframeOK)
+        {
+            error = write_trajectory_frame(ot->of, frame->mdof_flags,
+                                           frame->step, frame->t, frame->lambda,
+                                           frame->box, frame->x, frame->v, frame->f);
+        }
+
+        tMPI_Thread_mutex_lock(&ot->mutex);
+        ot->error    = error;
+        ot->bWriting = FALSE;
+        tMPI_Thread_cond_broadcast(&ot->cond_done);
+    }
+    tMPI_Thread_mutex_unlock(&ot->mutex);
+
+    return NULL;
+}
+
+/* Start an output thread for of */
+static t_output_thread *init_output_thread(gmx_mdoutf_t of)
+{
+    t_output_thread *ot;
+
+    snew(ot, 1);
+    ot->of       = of;
+    ot->pending  = &ot->frame[0];
+    ot->writing  = &ot->frame[1];
+    ot->bPending = FALSE;
+    ot->bWriting = FALSE;
+    ot->bStop    = FALSE;
+    ot->error    = eframeOK;
+    tMPI_Thread_mutex_init(&ot->mutex);
+    tMPI_Thread_cond_init(&ot->cond_work);
+    tMPI_Thread_cond_init(&ot->cond_done);
+    if (tMPI_Thread_create(&ot->thread, output_thread_loop, ot) != 0)
+    {
+        /* We can still write synchronously */
+        tMPI_Thread_cond_destroy(&ot->cond_done);
+        tMPI_Thread_cond_destroy(&ot->cond_work);
+        tMPI_Thread_mutex_destroy(&ot->mutex);
+        sfree(ot);
+        ot = NULL;
+    }
+
+    return ot;
+}
+
+/* Hand a copy of a frame to the output thread, waits when the previous
+ * frame has not been picked up by the thread yet. Exits with a fatal error
+ * when the thread failed to write an earlier frame.
+ */
+static void output_thread_submit_frame(t_output_thread *ot, int natoms, int mdof_flags,
+                                       gmx_int64_t step, double t, real lambda,
+                                       matrix box, rvec *x, rvec *v, rvec *f)
+{
+    int error;
+
+    tMPI_Thread_mutex_lock(&ot->mutex);
+    while (ot->bPending)
+    {
+        tMPI_Thread_cond_wait(&ot->cond_done, &ot->mutex);
+    }
+    error = ot->error;
+    tMPI_Thread_mutex_unlock(&ot->mutex);
+    check_trajectory_frame_error(error);
+
+    /* The thread does not touch the pending buffer until bPending is set */
+    copy_output_frame(ot->pending, natoms, mdof_flags, step, t, lambda, box, x, v, f);
+
+    tMPI_Thread_mutex_lock(&ot->mutex);
+    ot->bPending = TRUE;
+    tMPI_Thread_cond_signal(&ot->cond_work);
+    tMPI_Thread_mutex_unlock(&ot->mutex);
+}
+
+/* Wait until the output thread has written all frames,
+ * exits with a fatal error when writing failed.
+ */
+static void output_thread_wait(t_output_thread *ot)
+{
+    int error;
+
+    tMPI_Thread_mutex_lock(&ot->mutex);
+    while (ot->bPending || ot->bWriting)
+    {
+        tMPI_Thread_cond_wait(&ot->cond_done, &ot->mutex);
+    }
+    error = ot->error;
+    tMPI_Thread_mutex_unlock(&ot->mutex);
+    check_trajectory_frame_error(error);
+}
+
+/* Write all remaining frames, stop the output thread and free ot,
+ * exits with a fatal error when writing failed.
+ */
+static void done_output_thread(t_output_thread *ot)
+{
+    int i, error;
+
+    tMPI_Thread_mutex_lock(&ot->mutex);
+    ot->bStop = TRUE;
+    tMPI_Thread_cond_signal(&ot->cond_work);
+    tMPI_Thread_mutex_unlock(&ot->mutex);
+    tMPI_Thread_join(ot->thread, NULL);
+    error = ot->error;
+
+    tMPI_Thread_cond_destroy(&ot->cond_done);
+    tMPI_Thread_cond_destroy(&ot->cond_work);
+    tMPI_Thread_mutex_destroy(&ot->mutex);
+    for (i = 0; i < 2; i++)
+    {
+        sfree(ot->frame[i].x);
+        sfree(ot->frame[i].v);
+        sfree(ot->frame[i].f);
+    }
+    sfree(ot);
+
+    check_trajectory_frame_error(error);
+}
+
 gmx_mdoutf_t init_mdoutf(FILE *fplog, int nfile, const t_filenm fnm[],
                          int mdrun_flags, const t_commrec *cr,
                          const t_inputrec *ir, gmx_mtop_t *top_global,
@@ -96,11 +445,14 @@ gmx_mdoutf_t init_mdoutf(FILE *fplog, int nfile, const t_filenm fnm[],
     of->tng_low_prec = NULL;
     of->fp_dhdl      = NULL;
     of->fp_field     = NULL;
+    of->othread      = NULL;
 
     of->eIntegrator             = ir->eI;
     of->bExpanded               = ir->bExpanded;
     of->elamstats               = ir->expandedvals->elamstats;
     of->simulation_part         = ir->simulation_part;
+    of->nstlist_tuned           = 0;
+    of->replex_ref_t            = 0;
     of->x_compression_precision = static_cast<int>(ir->x_compression_precision);
     of->wcycle                  = wcycle;
 
@@ -206,20 +558,34 @@ gmx_mdoutf_t init_mdoutf(FILE *fplog, int nfile, const t_filenm fnm[],
                                         "E (V/nm)", oenv);
             }
         }
+    }
 
-        /* Set up atom counts so they can be passed to actual
-           trajectory-writing routines later. Also, XTC writing needs
-           to know what (and how many) atoms might be in the XTC
-           groups, and how to look up later which ones they are. */
-        of->natoms_global       = top_global->natoms;
-        of->groups              = &top_global->groups;
-        of->natoms_x_compressed = 0;
-        for (i = 0; (i < top_global->natoms); i++)
+    /* Set up atom counts so they can be passed to actual
+       trajectory-writing routines later. Also, XTC writing needs
+       to know what (and how many) atoms might be in the XTC
+       groups, and how to look up later which ones they are.
+       All ranks need this, so they can collect only the
+       compressed group atoms with domain decomposition. */
+    of->natoms_global       = top_global->natoms;
+    of->groups              = &top_global->groups;
+    of->natoms_x_compressed = 0;
+    for (i = 0; (i < top_global->natoms); i++)
+    {
+        if (ggrpnr(of->groups, egcCompressedX, i) == 0)
         {
-            if (ggrpnr(of->groups, egcCompressedX, i) == 0)
-            {
-                of->natoms_x_compressed++;
-            }
+            of->natoms_x_compressed++;
+        }
+    }
+
+    /* TNG output stays on the MD thread, since the TNG library is not thread safe */
+    if (MASTER(cr) && (of->fp_trn != NULL || of->fp_xtc != NULL) &&
+        of->tng == NULL && of->tng_low_prec == NULL &&
+        getenv("GMX_NO_OUTPUT_THREAD") == NULL)
+    {
+        of->othread = init_output_thread(of);
+        if (of->othread != NULL && fplog != NULL)
+        {
+            fprintf(fplog, "Using a separate thread for writing trajectory frames\n");
         }
     }
 
@@ -251,10 +617,20 @@ gmx_wallcycle_t mdoutf_get_wcycle(gmx_mdoutf_t of)
     return of->wcycle;
 }
 
+void mdoutf_set_tuned_nstlist(gmx_mdoutf_t of, int nstlist)
+{
+    of->nstlist_tuned = nstlist;
+}
+
+void mdoutf_set_replex_ref_t(gmx_mdoutf_t of, real ref_t)
+{
+    of->replex_ref_t = ref_t;
+}
+
 void mdoutf_write_to_trajectory_files(FILE *fplog, t_commrec *cr,
                                       gmx_mdoutf_t of,
                                       int mdof_flags,
-                                      gmx_mtop_t *top_global,
+                                      gmx_mtop_t gmx_unused *top_global,
                                       gmx_int64_t step, double t,
                                       t_state *state_local, t_state *state_global,
                                       rvec *f_local, rvec *f_global)
@@ -276,11 +652,20 @@ void mdoutf_write_to_trajectory_files(FILE *fplog, t_commrec *cr,
         }
         else
         {
-            if (mdof_flags & (MDOF_X | MDOF_X_COMPRESSED))
+            if (mdof_flags & MDOF_X)
             {
                 dd_collect_vec(cr->dd, state_local, state_local->x,
                                state_global->x);
             }
+            else if (mdof_flags & MDOF_X_COMPRESSED)
+            {
+                /* Only the compressed output group is written,
+                 * so only collect the coordinates of those atoms.
+                 */
+                dd_collect_vec_group(cr->dd, state_local, state_local->x,
+                                     state_global->x,
+                                     of->groups->grpnr[egcCompressedX]);
+            }
             if (mdof_flags & MDOF_V)
             {
                 dd_collect_vec(cr->dd, state_local, local_v,
@@ -314,6 +699,13 @@ void mdoutf_write_to_trajectory_files(FILE *fplog, t_commrec *cr,
     {
         if (mdof_flags & MDOF_CPT)
         {
+            if (of->othread != NULL)
+            {
+                /* The checkpoint stores the positions and checksums
+                 * of the output files, so all frames should be written.
+                 */
+                output_thread_wait(of->othread);
+            }
             fflush_tng(of->tng);
             fflush_tng(of->tng_low_prec);
             ivec one_ivec = { 1, 1, 1 };
@@ -322,91 +714,29 @@ void mdoutf_write_to_trajectory_files(FILE *fplog, t_commrec *cr,
                              DOMAINDECOMP(cr) ? cr->dd->nc : one_ivec,
                              DOMAINDECOMP(cr) ? cr->dd->nnodes : cr->nnodes,
                              of->eIntegrator, of->simulation_part,
-                             of->bExpanded, of->elamstats, step, t, state_global);
+                             of->bExpanded, of->elamstats, of->nstlist_tuned,
+                             of->replex_ref_t,
+                             step, t, state_global);
         }
 
-        if (mdof_flags & (MDOF_X | MDOF_V | MDOF_F))
+        if (mdof_flags & (MDOF_X | MDOF_V | MDOF_F | MDOF_X_COMPRESSED))
         {
-            if (of->fp_trn)
-            {
-                gmx_trr_write_frame(of->fp_trn, step, t, state_local->lambda[efptFEP],
-                                    state_local->box, top_global->natoms,
-                                    (mdof_flags & MDOF_X) ? state_global->x : NULL,
-                                    (mdof_flags & MDOF_V) ? global_v : NULL,
-                                    (mdof_flags & MDOF_F) ? f_global : NULL);
-                if (gmx_fio_flush(of->fp_trn) != 0)
-                {
-                    gmx_file("Cannot write trajectory; maybe you are out of disk space?");
-                }
-            }
+            int flags = mdof_flags & (MDOF_X | MDOF_V | MDOF_F | MDOF_X_COMPRESSED);
 
-            /* If a TNG file is open for uncompressed coordinate output also write
-               velocities and forces to it. */
-            else if (of->tng)
-            {
-                gmx_fwrite_tng(of->tng, FALSE, step, t, state_local->lambda[efptFEP],
-                               state_local->box,
-                               top_global->natoms,
-                               (mdof_flags & MDOF_X) ? state_global->x : NULL,
-                               (mdof_flags & MDOF_V) ? global_v : NULL,
-                               (mdof_flags & MDOF_F) ? f_global : NULL);
-            }
-            /* If only a TNG file is open for compressed coordinate output (no uncompressed
-               coordinate output) also write forces and velocities to it. */
-            else if (of->tng_low_prec)
+            if (of->othread != NULL)
             {
-                gmx_fwrite_tng(of->tng_low_prec, FALSE, step, t, state_local->lambda[efptFEP],
-                               state_local->box,
-                               top_global->natoms,
-                               (mdof_flags & MDOF_X) ? state_global->x : NULL,
-                               (mdof_flags & MDOF_V) ? global_v : NULL,
-                               (mdof_flags & MDOF_F) ? f_global : NULL);
-            }
-        }
-        if (mdof_flags & MDOF_X_COMPRESSED)
-        {
-            rvec *xxtc = NULL;
-
-            if (of->natoms_x_compressed == of->natoms_global)
-            {
-                /* We are writing the positions of all of the atoms to
-                   the compressed output */
-                xxtc = state_global->x;
+                output_thread_submit_frame(of->othread, of->natoms_global, flags,
+                                           step, t, state_local->lambda[efptFEP],
+                                           state_local->box,
+                                           state_global->x, global_v, f_global);
             }
             else
             {
-                /* We are writing the positions of only a subset of
-                   the atoms to the compressed output, so we have to
-                   make a copy of the subset of coordinates. */
-                int i, j;
-
-                snew(xxtc, of->natoms_x_compressed);
-                for (i = 0, j = 0; (i < of->natoms_global); i++)
-                {
-                    if (ggrpnr(of->groups, egcCompressedX, i) == 0)
-                    {
-                        copy_rvec(state_global->x[i], xxtc[j++]);
-                    }
-                }
-            }
-            if (write_xtc(of->fp_xtc, of->natoms_x_compressed, step, t,
-                          state_local->box, xxtc, of->x_compression_precision) == 0)
-            {
-                gmx_fatal(FARGS, "XTC error - maybe you are out of disk space?");
-            }
-            gmx_fwrite_tng(of->tng_low_prec,
-                           TRUE,
-                           step,
-                           t,
-                           state_local->lambda[efptFEP],
-                           state_local->box,
-                           of->natoms_x_compressed,
-                           xxtc,
-                           NULL,
-                           NULL);
-            if (of->natoms_x_compressed != of->natoms_global)
-            {
-                sfree(xxtc);
+                check_trajectory_frame_error(
+                        write_trajectory_frame(of, flags,
+                                               step, t, state_local->lambda[efptFEP],
+                                               state_local->box,
+                                               state_global->x, global_v, f_global));
             }
         }
     }
@@ -425,6 +755,10 @@ void mdoutf_tng_close(gmx_mdoutf_t of)
 
 void done_mdoutf(gmx_mdoutf_t of)
 {
+    if (of->othread != NULL)
+    {
+        done_output_thread(of->othread);
+    }
     if (of->fp_ene != NULL)
     {
         close_enx(of->fp_ene);
@@ -77,6 +77,12 @@ FILE *mdoutf_get_fp_dhdl(gmx_mdoutf_t of);
 /*! \brief Getter for wallcycle timer */
 gmx_wallcycle_t mdoutf_get_wcycle(gmx_mdoutf_t of);
 
+/*! \brief Set the nstlist value chosen by run-time tuning, stored in checkpoints */
+void mdoutf_set_tuned_nstlist(gmx_mdoutf_t of, int nstlist);
+
+/*! \brief Set the reference temperature reached by replica exchange, stored in checkpoints */
+void mdoutf_set_replex_ref_t(gmx_mdoutf_t of, real ref_t);
+
 /*! \brief Close TNG files if they are open.
  *
  * This also measures the time it takes to close the TNG
@@ -91,7 +97,10 @@ void done_mdoutf(gmx_mdoutf_t of);
  *
  * Writes data to trn, xtc and/or checkpoint. What is written is
  * determined by the mdof_flags defined below. Data is collected to
- * the master node only when necessary.
+ * the master node only when necessary. Without TNG output, trn and xtc
+ * frames are copied and written by a separate output thread, so they
+ * are only guaranteed to be on disk after the next checkpoint or
+ * after done_mdoutf.
  */
 void mdoutf_write_to_trajectory_files(FILE *fplog, t_commrec *cr,
                                       gmx_mdoutf_t of,
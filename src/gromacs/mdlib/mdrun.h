@@ -74,6 +74,9 @@ struct t_state;
 #define MD_IMDWAIT        (1<<23)
 #define MD_IMDTERM        (1<<24)
 #define MD_IMDPULL        (1<<25)
+#define MD_TUNENSTLIST    (1<<26)
+#define MD_READ_NSTLIST   (1<<27)
+#define MD_REPLEXPAIR     (1<<28)
 
 /* The options for the domain decomposition MPI task ordering */
 enum {
@@ -756,7 +756,11 @@ static void evaluate_energy(FILE *fplog, t_commrec *cr,
     else
     {
         bNS = FALSE;
-        if (inputrec->nstlist > 0)
+        /* With normal modes only a single atom is displaced by a tiny
+         * amount, which is covered by the buffer of the Verlet list.
+         */
+        if (inputrec->nstlist > 0 &&
+            !(inputrec->eI == eiNM && inputrec->cutoff_scheme == ecutsVERLET))
         {
             bNS = TRUE;
         }
@@ -2719,6 +2723,36 @@ double do_steep(FILE *fplog, t_commrec *cr,
     return 0;
 }   /* That's all folks */
 
+/*! \brief Store the non-zero elements of Hessian row \p row with column
+ * index >= row from the force derivatives \p dfdx in \p entries
+ *
+ * With a cut-off only atoms within interaction range of the displaced
+ * atom contribute, so this gives a compressed row of bounded size.
+ * \returns the number of stored elements.
+ */
+static int hessian_row_to_sparse(int row, int natoms, const rvec dfdx[],
+                                 gmx_sparsematrix_entry_t *entries)
+{
+    int n, j, k, col;
+
+    n = 0;
+    for (j = row/DIM; j < natoms; j++)
+    {
+        for (k = 0; k < DIM; k++)
+        {
+            col = j*DIM + k;
+            if (col >= row && dfdx[j][k] != 0.0)
+            {
+                entries[n].col   = col;
+                entries[n].value = dfdx[j][k];
+                n++;
+            }
+        }
+    }
+
+    return n;
+}
+
 /*! \brief Do normal modes analysis
     \copydoc integrator_t(FILE *fplog, t_commrec *cr,
                           int nfile, const t_filenm fnm[],
@@ -2777,6 +2811,8 @@ double do_nm(FILE *fplog, t_commrec *cr,
     size_t               sz = 0;
     gmx_sparsematrix_t * sparse_matrix           = NULL;
     real           *     full_matrix             = NULL;
+    gmx_sparsematrix_entry_t *row_entries        = NULL;
+    int                  nentry                  = 0;
     em_state_t       *   state_work;
 
     /* added with respect to mdrun */
@@ -2803,6 +2839,16 @@ double do_nm(FILE *fplog, t_commrec *cr,
     snew(fneg, natoms);
     snew(dfdx, natoms);
 
+    if (inputrec->cutoff_scheme == ecutsVERLET)
+    {
+        /* We only search for pairs at the reference configuration.
+         * Buffer the pair list for the displacement of a single atom,
+         * so no pairs within the cut-off can be missed.
+         */
+        fr->ic->rlist = std::max(fr->ic->rlist,
+                                 std::max(fr->ic->rcoulomb, fr->ic->rvdw) + der_range);
+    }
+
 #ifndef GMX_DOUBLE
     if (bIsMaster)
     {
@@ -2834,6 +2880,8 @@ double do_nm(FILE *fplog, t_commrec *cr,
     {
         md_print_info(cr, fplog, "Using compressed symmetric sparse Hessian format.\n");
         bSparse = TRUE;
+        /* Work array for one compressed row of the Hessian */
+        snew(row_entries, DIM*top_global->natoms);
     }
 
     if (bIsMaster)
@@ -2946,6 +2994,13 @@ double do_nm(FILE *fplog, t_commrec *cr,
                 }
             }
 
+            row = atom*DIM + d;
+
+            if (bSparse)
+            {
+                nentry = hessian_row_to_sparse(row, natoms, dfdx, row_entries);
+            }
+
             if (!bIsMaster)
             {
 #ifdef GMX_MPI
@@ -2954,8 +3009,19 @@ double do_nm(FILE *fplog, t_commrec *cr,
 #else
 #define mpi_type MPI_FLOAT
 #endif
-                MPI_Send(dfdx[0], natoms*DIM, mpi_type, MASTER(cr), cr->nodeid,
-                         cr->mpi_comm_mygroup);
+                if (bSparse)
+                {
+                    /* Only send the non-zero elements of the row */
+                    MPI_Send(&nentry, 1, MPI_INT, MASTER(cr), cr->nodeid,
+                             cr->mpi_comm_mygroup);
+                    MPI_Send(row_entries, nentry*sizeof(*row_entries), MPI_BYTE,
+                             MASTER(cr), cr->nodeid, cr->mpi_comm_mygroup);
+                }
+                else
+                {
+                    MPI_Send(dfdx[0], natoms*DIM, mpi_type, MASTER(cr), cr->nodeid,
+                             cr->mpi_comm_mygroup);
+                }
 #endif
             }
             else
@@ -2966,30 +3032,37 @@ double do_nm(FILE *fplog, t_commrec *cr,
                     {
 #ifdef GMX_MPI
                         MPI_Status stat;
-                        MPI_Recv(dfdx[0], natoms*DIM, mpi_type, node, node,
-                                 cr->mpi_comm_mygroup, &stat);
+                        if (bSparse)
+                        {
+                            MPI_Recv(&nentry, 1, MPI_INT, node, node,
+                                     cr->mpi_comm_mygroup, &stat);
+                            MPI_Recv(row_entries, nentry*sizeof(*row_entries), MPI_BYTE,
+                                     node, node, cr->mpi_comm_mygroup, &stat);
+                        }
+                        else
+                        {
+                            MPI_Recv(dfdx[0], natoms*DIM, mpi_type, node, node,
+                                     cr->mpi_comm_mygroup, &stat);
+                        }
 #undef mpi_type
 #endif
                     }
 
                     row = (atom + node)*DIM + d;
 
-                    for (j = 0; j < natoms; j++)
+                    if (bSparse)
+                    {
+                        /* Each row is computed exactly once, in column order */
+                        gmx_sparsematrix_set_row(sparse_matrix, row, nentry, row_entries);
+                    }
+                    else
                     {
-                        for (k = 0; k < DIM; k++)
+                        for (j = 0; j < natoms; j++)
                         {
-                            col = j*DIM + k;
-
-                            if (bSparse)
-                            {
-                                if (col >= row && dfdx[j][k] != 0.0)
-                                {
-                                    gmx_sparsematrix_increment_value(sparse_matrix,
-                                                                     row, col, dfdx[j][k]);
-                                }
-                            }
-                            else
+                            for (k = 0; k < DIM; k++)
                             {
+                                col = j*DIM + k;
+
                                 full_matrix[row*sz+col] = dfdx[j][k];
                             }
                         }
@@ -3016,6 +3089,7 @@ double do_nm(FILE *fplog, t_commrec *cr,
         fprintf(stderr, "\n\nWriting Hessian...\n");
         gmx_mtxio_write(ftp2fn(efMTX, nfile, fnm), sz, sz, full_matrix, sparse_matrix);
     }
+    sfree(row_entries);
 
     finish_em(cr, outf, walltime_accounting, wcycle);
 
@@ -51,6 +51,7 @@
 
 #include "gromacs/math/functions.h"
 #include "gromacs/math/vec.h"
+#include "gromacs/mdlib/gmx_omp_barrier.h"
 #include "gromacs/mdlib/gmx_omp_nthreads.h"
 #include "gromacs/mdlib/nb_verlet.h"
 #include "gromacs/mdlib/nbnxn_consts.h"
@@ -794,8 +795,11 @@ void nbnxn_atomdata_init(FILE *fp,
                                    nbat->nenergrp, 1<<nbat->neg_2log,
                                    nbat->alloc);
     }
-    nbat->buffer_flags.flag        = NULL;
-    nbat->buffer_flags.flag_nalloc = 0;
+    nbat->buffer_flags.flag                = NULL;
+    nbat->buffer_flags.flag_nalloc         = 0;
+    nbat->buffer_flags.nthread_block       = 0;
+    nbat->buffer_flags.thread_block0       = NULL;
+    nbat->buffer_flags.thread_block_nalloc = 0;
 
     nth = gmx_omp_nthreads_get(emntNonbonded);
 
@@ -822,6 +826,15 @@ void nbnxn_atomdata_init(FILE *fp,
         }
         snew(nbat->syncStep, nth);
     }
+    nbat->reduceBarrier = gmx_omp_barrier_init(nth);
+}
+
+void nbnxn_atomdata_done(nbnxn_atomdata_t *nbat)
+{
+    sfree(nbat->syncStep);
+    gmx_omp_barrier_destroy(nbat->reduceBarrier);
+    nbat->syncStep      = NULL;
+    nbat->reduceBarrier = NULL;
 }
 
 static void copy_lj_to_nbat_lj_comb_x4(const real *ljparam_type,
@@ -1413,184 +1426,184 @@ static gmx_inline unsigned char reverse_bits(unsigned char b)
     return (b * 0x0202020202ULL & 0x010884422010ULL) % 1023;
 }
 
+/* Tree reduction of the thread force output buffers into buffer 0,
+ * to be called by thread th of the nth threads of a parallel region.
+ * nbat->syncStep should be cleared before the parallel region.
+ */
 static void nbnxn_atomdata_add_nbat_f_to_f_treereduce(const nbnxn_atomdata_t *nbat,
-                                                      int                     nth)
+                                                      int                     nth,
+                                                      int                     th)
 {
     const nbnxn_buffer_flags_t *flags = &nbat->buffer_flags;
 
     int next_pow2 = 1<<(gmx::log2I(nth-1)+1);
 
-    assert(nbat->nout == nth); /* tree-reduce currently only works for nout==nth */
+    int b0, b1, b;
+    int i0, i1;
+    int group_size;
 
-    memset(nbat->syncStep, 0, sizeof(*(nbat->syncStep))*nth);
-
-#pragma omp parallel num_threads(nth)
+    for (group_size = 2; group_size < 2*next_pow2; group_size *= 2)
     {
-        try
+        int index[2], group_pos, partner_pos, wu;
+        int partner_th = th ^ (group_size/2);
+
+        if (group_size > 2)
         {
-            int   b0, b1, b;
-            int   i0, i1;
-            int   group_size, th;
+#ifdef TMPI_ATOMICS
+            /* wait on partner thread - replaces full barrier */
+            int sync_th, sync_group_size;
 
-            th = gmx_omp_get_thread_num();
+            tMPI_Atomic_memory_barrier();                         /* gurantee data is saved before marking work as done */
+            tMPI_Atomic_set(&(nbat->syncStep[th]), group_size/2); /* mark previous step as completed */
 
-            for (group_size = 2; group_size < 2*next_pow2; group_size *= 2)
+            /* find thread to sync with. Equal to partner_th unless nth is not a power of two. */
+            for (sync_th = partner_th, sync_group_size = group_size; sync_th >= nth && sync_group_size > 2; sync_group_size /= 2)
             {
-                int index[2], group_pos, partner_pos, wu;
-                int partner_th = th ^ (group_size/2);
-
-                if (group_size > 2)
+                sync_th &= ~(sync_group_size/4);
+            }
+            if (sync_th < nth) /* otherwise nothing to sync index[1] will be >=nout */
+            {
+                /* wait on the thread which computed input data in previous step */
+                while (tMPI_Atomic_get((volatile tMPI_Atomic_t*)&(nbat->syncStep[sync_th])) < group_size/2)
                 {
-#ifdef TMPI_ATOMICS
-                    /* wait on partner thread - replaces full barrier */
-                    int sync_th, sync_group_size;
-
-                    tMPI_Atomic_memory_barrier();                         /* gurantee data is saved before marking work as done */
-                    tMPI_Atomic_set(&(nbat->syncStep[th]), group_size/2); /* mark previous step as completed */
-
-                    /* find thread to sync with. Equal to partner_th unless nth is not a power of two. */
-                    for (sync_th = partner_th, sync_group_size = group_size; sync_th >= nth && sync_group_size > 2; sync_group_size /= 2)
-                    {
-                        sync_th &= ~(sync_group_size/4);
-                    }
-                    if (sync_th < nth) /* otherwise nothing to sync index[1] will be >=nout */
-                    {
-                        /* wait on the thread which computed input data in previous step */
-                        while (tMPI_Atomic_get((volatile tMPI_Atomic_t*)&(nbat->syncStep[sync_th])) < group_size/2)
-                        {
-                            gmx_pause();
-                        }
-                        /* guarantee that no later load happens before wait loop is finisehd */
-                        tMPI_Atomic_memory_barrier();
-                    }
-#else               /* TMPI_ATOMICS */
+                    gmx_pause();
+                }
+                /* guarantee that no later load happens before wait loop is finisehd */
+                tMPI_Atomic_memory_barrier();
+            }
+#else       /* TMPI_ATOMICS */
 #pragma omp barrier
 #endif
-                }
+        }
 
-                /* Calculate buffers to sum (result goes into first buffer) */
-                group_pos = th % group_size;
-                index[0]  = th - group_pos;
-                index[1]  = index[0] + group_size/2;
+        /* Calculate buffers to sum (result goes into first buffer) */
+        group_pos = th % group_size;
+        index[0]  = th - group_pos;
+        index[1]  = index[0] + group_size/2;
 
-                /* If no second buffer, nothing to do */
-                if (index[1] >= nbat->nout && group_size > 2)
-                {
-                    continue;
-                }
+        /* If no second buffer, nothing to do */
+        if (index[1] >= nbat->nout && group_size > 2)
+        {
+            continue;
+        }
 
 #if NBNXN_BUFFERFLAG_MAX_THREADS > 256
 #error reverse_bits assumes max 256 threads
 #endif
-                /* Position is permuted so that one of the 2 vectors being added was computed on the same thread in the previous step.
-                   This improves locality and enables to sync with just a single thread between steps (=the levels in the btree).
-                   The permutation which allows this corresponds to reversing the bits of the group position.
-                 */
-                group_pos = reverse_bits(group_pos)/(256/group_size);
+        /* Position is permuted so that one of the 2 vectors being added was computed on the same thread in the previous step.
+           This improves locality and enables to sync with just a single thread between steps (=the levels in the btree).
+           The permutation which allows this corresponds to reversing the bits of the group position.
+         */
+        group_pos = reverse_bits(group_pos)/(256/group_size);
 
-                partner_pos = group_pos ^ 1;
+        partner_pos = group_pos ^ 1;
 
-                /* loop over two work-units (own and partner) */
-                for (wu = 0; wu < 2; wu++)
+        /* loop over two work-units (own and partner) */
+        for (wu = 0; wu < 2; wu++)
+        {
+            if (wu == 1)
+            {
+                if (partner_th < nth)
                 {
-                    if (wu == 1)
-                    {
-                        if (partner_th < nth)
-                        {
-                            break; /* partner exists we don't have to do his work */
-                        }
-                        else
-                        {
-                            group_pos = partner_pos;
-                        }
-                    }
+                    break; /* partner exists we don't have to do his work */
+                }
+                else
+                {
+                    group_pos = partner_pos;
+                }
+            }
 
-                    /* Calculate the cell-block range for our thread */
-                    b0 = (flags->nflag* group_pos   )/group_size;
-                    b1 = (flags->nflag*(group_pos+1))/group_size;
+            /* Calculate the cell-block range for our thread */
+            b0 = (flags->nflag* group_pos   )/group_size;
+            b1 = (flags->nflag*(group_pos+1))/group_size;
 
-                    for (b = b0; b < b1; b++)
-                    {
-                        i0 =  b   *NBNXN_BUFFERFLAG_SIZE*nbat->fstride;
-                        i1 = (b+1)*NBNXN_BUFFERFLAG_SIZE*nbat->fstride;
+            for (b = b0; b < b1; b++)
+            {
+                i0 =  b   *NBNXN_BUFFERFLAG_SIZE*nbat->fstride;
+                i1 = (b+1)*NBNXN_BUFFERFLAG_SIZE*nbat->fstride;
 
-                        if (bitmask_is_set(flags->flag[b], index[1]) || group_size > 2)
-                        {
+                if (bitmask_is_set(flags->flag[b], index[1]) || group_size > 2)
+                {
 #ifdef GMX_NBNXN_SIMD
-                            nbnxn_atomdata_reduce_reals_simd
+                    nbnxn_atomdata_reduce_reals_simd
 #else
-                            nbnxn_atomdata_reduce_reals
+                    nbnxn_atomdata_reduce_reals
 #endif
-                                (nbat->out[index[0]].f,
-                                bitmask_is_set(flags->flag[b], index[0]) || group_size > 2,
-                                &(nbat->out[index[1]].f), 1, i0, i1);
-
-                        }
-                        else if (!bitmask_is_set(flags->flag[b], index[0]))
-                        {
-                            nbnxn_atomdata_clear_reals(nbat->out[index[0]].f,
-                                                       i0, i1);
-                        }
-                    }
+                        (nbat->out[index[0]].f,
+                        bitmask_is_set(flags->flag[b], index[0]) || group_size > 2,
+                        &(nbat->out[index[1]].f), 1, i0, i1);
+
+                }
+                else if (!bitmask_is_set(flags->flag[b], index[0]))
+                {
+                    nbnxn_atomdata_clear_reals(nbat->out[index[0]].f,
+                                               i0, i1);
                 }
             }
         }
-        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
     }
 }
 
 
+/* Reduction of the thread force output buffers into buffer 0,
+ * to be called by thread th of the nth threads of a parallel region.
+ */
 static void nbnxn_atomdata_add_nbat_f_to_f_stdreduce(const nbnxn_atomdata_t *nbat,
-                                                     int                     nth)
+                                                     int                     nth,
+                                                     int                     th)
 {
-#pragma omp parallel for num_threads(nth) schedule(static)
-    for (int th = 0; th < nth; th++)
-    {
-        try
-        {
-            const nbnxn_buffer_flags_t *flags;
-            int   nfptr;
-            real *fptr[NBNXN_BUFFERFLAG_MAX_THREADS];
+    const nbnxn_buffer_flags_t *flags;
+    int   b0, b1;
+    int   nfptr;
+    real *fptr[NBNXN_BUFFERFLAG_MAX_THREADS];
 
-            flags = &nbat->buffer_flags;
+    flags = &nbat->buffer_flags;
 
-            /* Calculate the cell-block range for our thread */
-            int b0 = (flags->nflag* th   )/nth;
-            int b1 = (flags->nflag*(th+1))/nth;
+    /* Calculate the cell-block range for our thread.
+     * The search has balanced the reduction cost over the threads,
+     * use a uniform division when it did so for a different thread count.
+     */
+    if (flags->nthread_block == nth)
+    {
+        b0 = flags->thread_block0[th];
+        b1 = flags->thread_block0[th+1];
+    }
+    else
+    {
+        b0 = (flags->nflag* th   )/nth;
+        b1 = (flags->nflag*(th+1))/nth;
+    }
 
-            for (int b = b0; b < b1; b++)
-            {
-                int i0 =  b   *NBNXN_BUFFERFLAG_SIZE*nbat->fstride;
-                int i1 = (b+1)*NBNXN_BUFFERFLAG_SIZE*nbat->fstride;
+    for (int b = b0; b < b1; b++)
+    {
+        int i0 =  b   *NBNXN_BUFFERFLAG_SIZE*nbat->fstride;
+        int i1 = (b+1)*NBNXN_BUFFERFLAG_SIZE*nbat->fstride;
 
-                nfptr = 0;
-                for (int out = 1; out < nbat->nout; out++)
-                {
-                    if (bitmask_is_set(flags->flag[b], out))
-                    {
-                        fptr[nfptr++] = nbat->out[out].f;
-                    }
-                }
-                if (nfptr > 0)
-                {
+        nfptr = 0;
+        for (int out = 1; out < nbat->nout; out++)
+        {
+            if (bitmask_is_set(flags->flag[b], out))
+            {
+                fptr[nfptr++] = nbat->out[out].f;
+            }
+        }
+        if (nfptr > 0)
+        {
 #ifdef GMX_NBNXN_SIMD
-                    nbnxn_atomdata_reduce_reals_simd
+            nbnxn_atomdata_reduce_reals_simd
 #else
-                    nbnxn_atomdata_reduce_reals
+            nbnxn_atomdata_reduce_reals
 #endif
-                        (nbat->out[0].f,
-                        bitmask_is_set(flags->flag[b], 0),
-                        fptr, nfptr,
-                        i0, i1);
-                }
-                else if (!bitmask_is_set(flags->flag[b], 0))
-                {
-                    nbnxn_atomdata_clear_reals(nbat->out[0].f,
-                                               i0, i1);
-                }
-            }
+                (nbat->out[0].f,
+                bitmask_is_set(flags->flag[b], 0),
+                fptr, nfptr,
+                i0, i1);
+        }
+        else if (!bitmask_is_set(flags->flag[b], 0))
+        {
+            nbnxn_atomdata_clear_reals(nbat->out[0].f,
+                                       i0, i1);
         }
-        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
     }
 }
 
@@ -1620,32 +1633,51 @@ void nbnxn_atomdata_add_nbat_f_to_f(const nbnxn_search_t    nbs,
             break;
     }
 
-    int nth = gmx_omp_nthreads_get(emntNonbonded);
+    int      nth     = gmx_omp_nthreads_get(emntNonbonded);
+    gmx_bool bReduce = (nbat->nout > 1);
 
-    if (nbat->nout > 1)
+    if (bReduce)
     {
         if (locality != eatAll)
         {
             gmx_incons("add_f_to_f called with nout>1 and locality!=eatAll");
         }
+        assert(gmx_omp_barrier_nthreads(nbat->reduceBarrier) == nth);
 
-        /* Reduce the force thread output buffers into buffer 0, before adding
-         * them to the, differently ordered, "real" force buffer.
-         */
         if (nbat->bUseTreeReduce)
         {
-            nbnxn_atomdata_add_nbat_f_to_f_treereduce(nbat, nth);
-        }
-        else
-        {
-            nbnxn_atomdata_add_nbat_f_to_f_stdreduce(nbat, nth);
+            assert(nbat->nout == nth); /* tree-reduce currently only works for nout==nth */
+
+            memset(nbat->syncStep, 0, sizeof(*(nbat->syncStep))*nth);
         }
     }
-#pragma omp parallel for num_threads(nth) schedule(static)
-    for (int th = 0; th < nth; th++)
+
+    /* We first reduce the force thread output buffers into buffer 0
+     * and then add buffer 0 to the, differently ordered, "real" force
+     * buffer. The second part reads blocks reduced by other threads,
+     * for which we use a spin barrier within one parallel region,
+     * which is cheaper than ending the region and starting a new one.
+     */
+#pragma omp parallel num_threads(nth)
     {
         try
         {
+            int th = gmx_omp_get_thread_num();
+
+            if (bReduce)
+            {
+                if (nbat->bUseTreeReduce)
+                {
+                    nbnxn_atomdata_add_nbat_f_to_f_treereduce(nbat, nth, th);
+                }
+                else
+                {
+                    nbnxn_atomdata_add_nbat_f_to_f_stdreduce(nbat, nth, th);
+                }
+
+                gmx_omp_barrier_wait(nbat->reduceBarrier);
+            }
+
             nbnxn_atomdata_add_nbat_f_to_f_part(nbs, nbat,
                                                 nbat->out,
                                                 1,
@@ -87,6 +87,9 @@ void nbnxn_atomdata_init(FILE *fp,
                          nbnxn_alloc_t *alloc,
                          nbnxn_free_t  *free);
 
+/* Frees the thread synchronization data allocated by nbnxn_atomdata_init */
+void nbnxn_atomdata_done(nbnxn_atomdata_t *nbat);
+
 /* Copy the atom data to the non-bonded atom data structure */
 void nbnxn_atomdata_set(nbnxn_atomdata_t    *nbat,
                         int                  locality,
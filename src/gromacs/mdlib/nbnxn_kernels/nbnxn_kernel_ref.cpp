@@ -173,25 +173,22 @@ p_nbk_func_ener p_nbk_c_energrp[coultNR][vdwtNR] =
 };
 
 void
-nbnxn_kernel_ref(const nbnxn_pairlist_set_t *nbl_list,
-                 const nbnxn_atomdata_t     *nbat,
-                 const interaction_const_t  *ic,
-                 rvec                       *shift_vec,
-                 int                         force_flags,
-                 int                         clearF,
-                 real                       *fshift,
-                 real                       *Vc,
-                 real                       *Vvdw)
+nbnxn_kernel_ref_list(const nbnxn_pairlist_set_t *nbl_list,
+                      int                         nb,
+                      const nbnxn_atomdata_t     *nbat,
+                      const interaction_const_t  *ic,
+                      rvec                       *shift_vec,
+                      int                         force_flags,
+                      int                         clearF,
+                      real                       *fshift)
 {
-    int                nnbl;
-    nbnxn_pairlist_t **nbl;
-    int                coult;
-    int                vdwt;
-    int                nb;
-    int                nthreads gmx_unused;
+    const nbnxn_pairlist_t  *nbl;
+    nbnxn_atomdata_output_t *out;
+    real                    *fshift_p;
+    int                      coult;
+    int                      vdwt;
 
-    nnbl = nbl_list->nnbl;
-    nbl  = nbl_list->nbl;
+    nbl = nbl_list->nbl[nb];
 
     if (EEL_RF(ic->eeltype) || ic->eeltype == eelCUT)
     {
@@ -246,86 +243,101 @@ nbnxn_kernel_ref(const nbnxn_pairlist_set_t *nbl_list,
         gmx_incons("Unsupported vdwtype in nbnxn reference kernel");
     }
 
-    // cppcheck-suppress unreadVariable
-    nthreads = gmx_omp_nthreads_get(emntNonbonded);
-#pragma omp parallel for schedule(static) num_threads(nthreads)
-    for (nb = 0; nb < nnbl; nb++)
+    out = &nbat->out[nb];
+
+    if (clearF == enbvClearFYes)
     {
-        // Presently, the kernels do not call C++ code that can throw, so
-        // no need for a try/catch pair in this OpenMP region.
-        nbnxn_atomdata_output_t *out;
-        real                    *fshift_p;
+        clear_f(nbat, nb, out->f);
+    }
 
-        out = &nbat->out[nb];
+    if ((force_flags & GMX_FORCE_VIRIAL) && nbl_list->nnbl == 1)
+    {
+        fshift_p = fshift;
+    }
+    else
+    {
+        fshift_p = out->fshift;
 
         if (clearF == enbvClearFYes)
         {
-            clear_f(nbat, nb, out->f);
+            clear_fshift(fshift_p);
         }
+    }
 
-        if ((force_flags & GMX_FORCE_VIRIAL) && nnbl == 1)
-        {
-            fshift_p = fshift;
-        }
-        else
-        {
-            fshift_p = out->fshift;
+    if (!(force_flags & GMX_FORCE_ENERGY))
+    {
+        /* Don't calculate energies */
+        p_nbk_c_noener[coult][vdwt](nbl, nbat,
+                                    ic,
+                                    shift_vec,
+                                    out->f,
+                                    fshift_p);
+    }
+    else if (out->nV == 1)
+    {
+        /* No energy groups */
+        out->Vvdw[0] = 0;
+        out->Vc[0]   = 0;
 
-            if (clearF == enbvClearFYes)
-            {
-                clear_fshift(fshift_p);
-            }
-        }
+        p_nbk_c_ener[coult][vdwt](nbl, nbat,
+                                  ic,
+                                  shift_vec,
+                                  out->f,
+                                  fshift_p,
+                                  out->Vvdw,
+                                  out->Vc);
+    }
+    else
+    {
+        /* Calculate energy group contributions */
+        int i;
 
-        if (!(force_flags & GMX_FORCE_ENERGY))
+        for (i = 0; i < out->nV; i++)
         {
-            /* Don't calculate energies */
-            p_nbk_c_noener[coult][vdwt](nbl[nb], nbat,
-                                        ic,
-                                        shift_vec,
-                                        out->f,
-                                        fshift_p);
+            out->Vvdw[i] = 0;
         }
-        else if (out->nV == 1)
+        for (i = 0; i < out->nV; i++)
         {
-            /* No energy groups */
-            out->Vvdw[0] = 0;
-            out->Vc[0]   = 0;
-
-            p_nbk_c_ener[coult][vdwt](nbl[nb], nbat,
-                                      ic,
-                                      shift_vec,
-                                      out->f,
-                                      fshift_p,
-                                      out->Vvdw,
-                                      out->Vc);
-        }
-        else
-        {
-            /* Calculate energy group contributions */
-            int i;
-
-            for (i = 0; i < out->nV; i++)
-            {
-                out->Vvdw[i] = 0;
-            }
-            for (i = 0; i < out->nV; i++)
-            {
-                out->Vc[i] = 0;
-            }
-
-            p_nbk_c_energrp[coult][vdwt](nbl[nb], nbat,
-                                         ic,
-                                         shift_vec,
-                                         out->f,
-                                         fshift_p,
-                                         out->Vvdw,
-                                         out->Vc);
+            out->Vc[i] = 0;
         }
+
+        p_nbk_c_energrp[coult][vdwt](nbl, nbat,
+                                     ic,
+                                     shift_vec,
+                                     out->f,
+                                     fshift_p,
+                                     out->Vvdw,
+                                     out->Vc);
+    }
+}
+
+void
+nbnxn_kernel_ref(const nbnxn_pairlist_set_t *nbl_list,
+                 const nbnxn_atomdata_t     *nbat,
+                 const interaction_const_t  *ic,
+                 rvec                       *shift_vec,
+                 int                         force_flags,
+                 int                         clearF,
+                 real                       *fshift,
+                 real                       *Vc,
+                 real                       *Vvdw)
+{
+    int nb;
+    int nthreads gmx_unused;
+
+    // cppcheck-suppress unreadVariable
+    nthreads = gmx_omp_nthreads_get(emntNonbonded);
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+    for (nb = 0; nb < nbl_list->nnbl; nb++)
+    {
+        // Presently, the kernels do not call C++ code that can throw, so
+        // no need for a try/catch pair in this OpenMP region.
+        nbnxn_kernel_ref_list(nbl_list, nb, nbat, ic, shift_vec,
+                              force_flags, clearF, fshift);
     }
 
     if (force_flags & GMX_FORCE_ENERGY)
     {
-        reduce_energies_over_lists(nbat, nnbl, Vvdw, Vc);
+        reduce_energies_over_lists(nbat, nbl_list->nnbl, Vvdw, Vc);
     }
 }
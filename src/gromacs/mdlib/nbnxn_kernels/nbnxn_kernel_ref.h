@@ -45,6 +45,20 @@
 extern "C" {
 #endif
 
+/* Runs the reference kernel for pair list nb of nbl_list.
+ * Does not reduce the energies over the lists. Can be called from
+ * within an OpenMP parallel region, for each list by one thread.
+ */
+void
+nbnxn_kernel_ref_list(const nbnxn_pairlist_set_t *nbl_list,
+                      int                         nb,
+                      const nbnxn_atomdata_t     *nbat,
+                      const interaction_const_t  *ic,
+                      rvec                       *shift_vec,
+                      int                         force_flags,
+                      int                         clearF,
+                      real                       *fshift);
+
 /* Wrapper call for the non-bonded n vs n reference kernels */
 void
 nbnxn_kernel_ref(const nbnxn_pairlist_set_t *nbl_list,
@@ -262,25 +262,23 @@ reduce_group_energies(int ng, int ng_2log,
 #endif /* GMX_NBNXN_SIMD_2XNN */
 
 void
-nbnxn_kernel_simd_2xnn(nbnxn_pairlist_set_t      gmx_unused *nbl_list,
-                       const nbnxn_atomdata_t    gmx_unused *nbat,
-                       const interaction_const_t gmx_unused *ic,
-                       int                       gmx_unused  ewald_excl,
-                       rvec                      gmx_unused *shift_vec,
-                       int                       gmx_unused  force_flags,
-                       int                       gmx_unused  clearF,
-                       real                      gmx_unused *fshift,
-                       real                      gmx_unused *Vc,
-                       real                      gmx_unused *Vvdw)
+nbnxn_kernel_simd_2xnn_list(const nbnxn_pairlist_set_t gmx_unused *nbl_list,
+                            int                        gmx_unused  nb,
+                            const nbnxn_atomdata_t     gmx_unused *nbat,
+                            const interaction_const_t  gmx_unused *ic,
+                            int                        gmx_unused  ewald_excl,
+                            rvec                       gmx_unused *shift_vec,
+                            int                        gmx_unused  force_flags,
+                            int                        gmx_unused  clearF,
+                            real                       gmx_unused *fshift)
 #ifdef GMX_NBNXN_SIMD_2XNN
 {
-    int                nnbl;
-    nbnxn_pairlist_t **nbl;
-    int                coulkt, vdwkt = 0;
-    int                nb, nthreads;
+    const nbnxn_pairlist_t  *nbl;
+    nbnxn_atomdata_output_t *out;
+    real                    *fshift_p;
+    int                      coulkt, vdwkt = 0;
 
-    nnbl = nbl_list->nnbl;
-    nbl  = nbl_list->nbl;
+    nbl = nbl_list->nbl[nb];
 
     if (EEL_RF(ic->eeltype) || ic->eeltype == eelCUT)
     {
@@ -348,91 +346,114 @@ nbnxn_kernel_simd_2xnn(nbnxn_pairlist_set_t      gmx_unused *nbl_list,
     {
         gmx_incons("Unsupported VdW interaction type");
     }
-    // cppcheck-suppress unreadVariable
-    nthreads = gmx_omp_nthreads_get(emntNonbonded);
-#pragma omp parallel for schedule(static) num_threads(nthreads)
-    for (nb = 0; nb < nnbl; nb++)
+
+    out = &nbat->out[nb];
+
+    if (clearF == enbvClearFYes)
     {
-        // Presently, the kernels do not call C++ code that can throw, so
-        // no need for a try/catch pair in this OpenMP region.
-        nbnxn_atomdata_output_t *out;
-        real                    *fshift_p;
+        clear_f(nbat, nb, out->f);
+    }
 
-        out = &nbat->out[nb];
+    if ((force_flags & GMX_FORCE_VIRIAL) && nbl_list->nnbl == 1)
+    {
+        fshift_p = fshift;
+    }
+    else
+    {
+        fshift_p = out->fshift;
 
         if (clearF == enbvClearFYes)
         {
-            clear_f(nbat, nb, out->f);
+            clear_fshift(fshift_p);
         }
+    }
 
-        if ((force_flags & GMX_FORCE_VIRIAL) && nnbl == 1)
-        {
-            fshift_p = fshift;
-        }
-        else
-        {
-            fshift_p = out->fshift;
-
-            if (clearF == enbvClearFYes)
-            {
-                clear_fshift(fshift_p);
-            }
-        }
+    if (!(force_flags & GMX_FORCE_ENERGY))
+    {
+        /* Don't calculate energies */
+        p_nbk_noener[coulkt][vdwkt](nbl, nbat,
+                                    ic,
+                                    shift_vec,
+                                    out->f,
+                                    fshift_p);
+    }
+    else if (out->nV == 1)
+    {
+        /* No energy groups */
+        out->Vvdw[0] = 0;
+        out->Vc[0]   = 0;
+
+        p_nbk_ener[coulkt][vdwkt](nbl, nbat,
+                                  ic,
+                                  shift_vec,
+                                  out->f,
+                                  fshift_p,
+                                  out->Vvdw,
+                                  out->Vc);
+    }
+    else
+    {
+        /* Calculate energy group contributions */
+        int i;
 
-        if (!(force_flags & GMX_FORCE_ENERGY))
+        for (i = 0; i < out->nVS; i++)
         {
-            /* Don't calculate energies */
-            p_nbk_noener[coulkt][vdwkt](nbl[nb], nbat,
-                                        ic,
-                                        shift_vec,
-                                        out->f,
-                                        fshift_p);
+            out->VSvdw[i] = 0;
         }
-        else if (out->nV == 1)
+        for (i = 0; i < out->nVS; i++)
         {
-            /* No energy groups */
-            out->Vvdw[0] = 0;
-            out->Vc[0]   = 0;
-
-            p_nbk_ener[coulkt][vdwkt](nbl[nb], nbat,
-                                      ic,
-                                      shift_vec,
-                                      out->f,
-                                      fshift_p,
-                                      out->Vvdw,
-                                      out->Vc);
+            out->VSc[i] = 0;
         }
-        else
-        {
-            /* Calculate energy group contributions */
-            int i;
 
-            for (i = 0; i < out->nVS; i++)
-            {
-                out->VSvdw[i] = 0;
-            }
-            for (i = 0; i < out->nVS; i++)
-            {
-                out->VSc[i] = 0;
-            }
+        p_nbk_energrp[coulkt][vdwkt](nbl, nbat,
+                                     ic,
+                                     shift_vec,
+                                     out->f,
+                                     fshift_p,
+                                     out->VSvdw,
+                                     out->VSc);
+
+        reduce_group_energies(nbat->nenergrp, nbat->neg_2log,
+                              out->VSvdw, out->VSc,
+                              out->Vvdw, out->Vc);
+    }
+}
+#else
+{
+    gmx_incons("nbnxn_kernel_simd_2xnn_list called when such kernels "
+               " are not enabled.");
+}
+#endif
 
-            p_nbk_energrp[coulkt][vdwkt](nbl[nb], nbat,
-                                         ic,
-                                         shift_vec,
-                                         out->f,
-                                         fshift_p,
-                                         out->VSvdw,
-                                         out->VSc);
-
-            reduce_group_energies(nbat->nenergrp, nbat->neg_2log,
-                                  out->VSvdw, out->VSc,
-                                  out->Vvdw, out->Vc);
-        }
+void
+nbnxn_kernel_simd_2xnn(nbnxn_pairlist_set_t      gmx_unused *nbl_list,
+                       const nbnxn_atomdata_t    gmx_unused *nbat,
+                       const interaction_const_t gmx_unused *ic,
+                       int                       gmx_unused  ewald_excl,
+                       rvec                      gmx_unused *shift_vec,
+                       int                       gmx_unused  force_flags,
+                       int                       gmx_unused  clearF,
+                       real                      gmx_unused *fshift,
+                       real                      gmx_unused *Vc,
+                       real                      gmx_unused *Vvdw)
+#ifdef GMX_NBNXN_SIMD_2XNN
+{
+    int nb, nthreads;
+
+    // cppcheck-suppress unreadVariable
+    nthreads = gmx_omp_nthreads_get(emntNonbonded);
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+    for (nb = 0; nb < nbl_list->nnbl; nb++)
+    {
+        // Presently, the kernels do not call C++ code that can throw, so
+        // no need for a try/catch pair in this OpenMP region.
+        nbnxn_kernel_simd_2xnn_list(nbl_list, nb, nbat, ic, ewald_excl,
+                                    shift_vec, force_flags, clearF, fshift);
     }
 
     if (force_flags & GMX_FORCE_ENERGY)
     {
-        reduce_energies_over_lists(nbat, nnbl, Vvdw, Vc);
+        reduce_energies_over_lists(nbat, nbl_list->nnbl, Vvdw, Vc);
     }
 }
 #else
@@ -55,6 +55,22 @@ nbnxn_kernel_simd_2xnn(nbnxn_pairlist_set_t       *nbl_list,
                        real                       *Vc,
                        real                       *Vvdw);
 
+/*! \brief Runs the nbnxn kernel for pair list \p nb of \p nbl_list.
+ *
+ * Does not reduce the energies over the lists. Can be called from
+ * within an OpenMP parallel region, for each list by one thread.
+ */
+void
+nbnxn_kernel_simd_2xnn_list(const nbnxn_pairlist_set_t *nbl_list,
+                            int                         nb,
+                            const nbnxn_atomdata_t     *nbat,
+                            const interaction_const_t  *ic,
+                            int                         ewald_excl,
+                            rvec                       *shift_vec,
+                            int                         force_flags,
+                            int                         clearF,
+                            real                       *fshift);
+
 /* Need an #include guard so that sim_util.c can include all
  * such files. */
 #ifndef _nbnxn_kernel_simd_include_h
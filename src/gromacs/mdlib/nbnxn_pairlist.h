@@ -213,9 +213,13 @@ typedef struct {
 
 /* Flags for telling if threads write to force output buffers */
 typedef struct {
-    int               nflag;       /* The number of flag blocks                         */
-    gmx_bitmask_t    *flag;        /* Bit i is set when thread i writes to a cell-block */
-    int               flag_nalloc; /* Allocation size of cxy_flag                       */
+    int               nflag;               /* The number of flag blocks                         */
+    gmx_bitmask_t    *flag;                /* Bit i is set when thread i writes to a cell-block */
+    int               flag_nalloc;         /* Allocation size of cxy_flag                       */
+    int               nthread_block;       /* The number of threads for thread_block0           */
+    int              *thread_block0;       /* Start of the flag block range per thread for the
+                                            * reduction, size nthread_block+1, set at search    */
+    int               thread_block_nalloc; /* Allocation size of thread_block0                  */
 } nbnxn_buffer_flags_t;
 
 /* LJ combination rules: geometric, Lorentz-Berthelot, none */
@@ -268,6 +272,7 @@ typedef struct nbnxn_atomdata_t {
     nbnxn_buffer_flags_t     buffer_flags;           /* Flags for buffer zeroing+reduc.  */
     gmx_bool                 bUseTreeReduce;         /* Use tree for force reduction */
     tMPI_Atomic_t           *syncStep;               /* Synchronization step for tree reduce */
+    struct gmx_omp_barrier_t *reduceBarrier;         /* Barrier between reduction and f add */
 } nbnxn_atomdata_t;
 
 #ifdef __cplusplus
@@ -3732,6 +3732,79 @@ static void reduce_buffer_flags(const nbnxn_search_t        nbs,
     }
 }
 
+/* Returns the cost of the force buffer reduction for a flag block,
+ * in units of the number of force buffers to read or write, plus one
+ * for the loop overhead.
+ */
+static int reduction_block_cost(gmx_bitmask_t flag, int nout)
+{
+    int nsrc = 0;
+
+    for (int out = 1; out < nout; out++)
+    {
+        if (bitmask_is_set(flag, out))
+        {
+            nsrc++;
+        }
+    }
+
+    if (nsrc > 0)
+    {
+        /* Read all sources, (read and) write buffer 0 */
+        return 1 + nsrc + (bitmask_is_set(flag, 0) ? 2 : 1);
+    }
+    else
+    {
+        /* Nothing to do or only clearing buffer 0 */
+        return 1 + (bitmask_is_set(flag, 0) ? 0 : 1);
+    }
+}
+
+/* Divide the flag blocks over the threads for the force buffer reduction.
+ * The reduction cost varies strongly between blocks, depending on
+ * how many threads wrote to it, so a uniform division can be badly
+ * imbalanced. As the flags only change at search, we divide here
+ * to equalize the cost instead of dividing at every step.
+ */
+static void balance_reduction_blocks(nbnxn_buffer_flags_t *flags,
+                                     int nout, int nthread)
+{
+    gmx_int64_t cost_tot, cost_sum;
+    int         th;
+
+    if (nthread + 1 > flags->thread_block_nalloc)
+    {
+        flags->thread_block_nalloc = nthread + 1;
+        srenew(flags->thread_block0, flags->thread_block_nalloc);
+    }
+
+    cost_tot = 0;
+    for (int b = 0; b < flags->nflag; b++)
+    {
+        cost_tot += reduction_block_cost(flags->flag[b], nout);
+    }
+
+    flags->thread_block0[0] = 0;
+    cost_sum                = 0;
+    th                      = 0;
+    for (int b = 0; b < flags->nflag; b++)
+    {
+        cost_sum += reduction_block_cost(flags->flag[b], nout);
+        while (th + 1 < nthread && cost_sum*nthread >= cost_tot*(th + 1))
+        {
+            th++;
+            flags->thread_block0[th] = b + 1;
+        }
+    }
+    while (th + 1 < nthread)
+    {
+        th++;
+        flags->thread_block0[th] = flags->nflag;
+    }
+    flags->thread_block0[nthread] = flags->nflag;
+    flags->nthread_block          = nthread;
+}
+
 static void print_reduction_cost(const nbnxn_buffer_flags_t *flags, int nout)
 {
     int           nelem, nkeep, ncopy, nred, out;
@@ -4097,6 +4170,8 @@ void nbnxn_make_pairlist(const nbnxn_search_t  nbs,
     if (nbat->bUseBufferFlags)
     {
         reduce_buffer_flags(nbs, nnbl, &nbat->buffer_flags);
+
+        balance_reduction_blocks(&nbat->buffer_flags, nbat->nout, nnbl);
     }
 
     if (nbs->bFEP)
@@ -0,0 +1,514 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2016, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief This file contains function definitions for tuning
+ * the pair-list update interval nstlist during a run.
+ *
+ * The cost of a larger nstlist is a larger pair-list buffer, which
+ * increases the non-bonded work, the gain is less frequent pair search
+ * and domain decomposition. Which nstlist is optimal depends on the
+ * hardware, the parallel setup and the system, so we time a range
+ * of nstlist values during the first part of the run, each with
+ * the buffer from calc_verlet_buffer_size, and continue with
+ * the fastest one.
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include "nstlist_tuning.h"
+
+#include <algorithm>
+
+#include "gromacs/domdec/domdec.h"
+#include "gromacs/domdec/domdec_struct.h"
+#include "gromacs/gmxlib/network.h"
+#include "gromacs/math/functions.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/calc_verletbuf.h"
+#include "gromacs/mdlib/nbnxn_gpu_data_mgmt.h"
+#include "gromacs/mdtypes/commrec.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/utility/cstringutil.h"
+#include "gromacs/utility/smalloc.h"
+
+/*! \brief The nstlist values to time, the initial nstlist is added */
+static const int  nstlistTry[]  = { 10, 20, 25, 40, 50, 80, 100 };
+//! Number of elements in nstlistTry
+static const int  nNstlistTry   = sizeof(nstlistTry)/sizeof(nstlistTry[0]);
+/*! \brief Time each setup over at least this number of steps */
+static const int  minStepsTimed = 100;
+/*! \brief Time each setup over at least this number of pair-list lifetimes */
+static const int  minListsTimed = 2;
+/*! \brief Continue the scan while a setup is less than 2% slower than the fastest */
+static const real maxRelativeSlowdownAccepted = 1.02;
+
+/*! \brief Enumeration whose values describe the effect limiting the scan to larger nstlist */
+enum enltlim {
+    enltlimNO, enltlimBOX, enltlimDD, enltlimNR
+};
+
+/*! \brief Descriptive strings matching ::enltlim */
+static const char *nltlim_str[enltlimNR] =
+{ "no", "box size", "domain decomposition" };
+
+/*! \brief Timings for one nstlist setup */
+struct nstlist_setup_t {
+    int      nstlist;      /**< the pair-list update interval                   */
+    real     rbuf;         /**< the pair-list buffer for this nstlist           */
+    int      nsteps;       /**< the number of steps timed                       */
+    gmx_bool bTimed;       /**< the timing is complete and averaged over ranks  */
+    double   cycles;       /**< the step cycles                                 */
+    double   cycles_ns;    /**< the pair-search cycles                          */
+    double   cycles_force; /**< the force cycles                                */
+};
+
+struct nstlist_tuning_t {
+    gmx_bool          bActive;     /**< is nstlist tuning active?                          */
+    const gmx_mtop_t *mtop;        /**< the topology, for the buffer estimates             */
+    gmx_bool          bUseGPU;     /**< are the non-bonded interactions computed on a GPU? */
+    int               n;           /**< the number of setups, 0 before the first call      */
+    nstlist_setup_t  *setup;       /**< the setups, in order of increasing nstlist         */
+    nstlist_scan_t    scan;        /**< the scan over the setups                           */
+    gmx_bool          bWarm;       /**< the current setup has been used for one list       */
+    real              rcut;        /**< the maximum of the Coulomb and VdW cut-off         */
+    int               elimited;    /**< what limited the scan to larger nstlist            */
+    int               cycles_n;    /**< the step count at the previous call, -1 initially  */
+    double            cycles_c[3]; /**< the step, search and force cycles at that call     */
+};
+
+bool nstlist_tuning_is_active(const nstlist_tuning_t *nlt)
+{
+    return nlt != NULL && nlt->bActive;
+}
+
+void nstlist_tuning_init(nstlist_tuning_t **nlt_p,
+                         t_commrec         *cr,
+                         const t_inputrec  *ir,
+                         const gmx_mtop_t  *mtop,
+                         gmx_wallcycle_t    wcycle,
+                         gmx_bool           bUseGPU)
+{
+    nstlist_tuning_t *nlt;
+
+    snew(nlt, 1);
+
+    /* We can only change nstlist when we can determine the buffer */
+    nlt->bActive  = (wcycle != NULL && wallcycle_have_counter() &&
+                     ir->cutoff_scheme == ecutsVERLET &&
+                     ir->verletbuf_tol > 0 &&
+                     !(EI_MD(ir->eI) && ir->etc == etcNO) &&
+                     ir->nstlist > 1 &&
+                     !MULTISIM(cr));
+    nlt->mtop     = mtop;
+    nlt->bUseGPU  = bUseGPU;
+    nlt->n        = 0;
+    nlt->setup    = NULL;
+    nlt->elimited = enltlimNO;
+    nlt->cycles_n = -1;
+
+    *nlt_p = nlt;
+}
+
+/*! \brief Add a setup for \p nstlist with the buffer for the current system */
+static void add_setup(nstlist_tuning_t             *nlt,
+                      int                           nstlist,
+                      const t_inputrec             *ir,
+                      const interaction_const_t    *ic,
+                      const matrix                  box,
+                      const verletbuf_list_setup_t *ls)
+{
+    nstlist_setup_t *set;
+    t_inputrec       ir_try;
+    real             rlist;
+
+    set = &nlt->setup[nlt->n];
+    if (nstlist == ir->nstlist)
+    {
+        /* Use the buffer we are running with */
+        set->rbuf  = ic->rlist - nlt->rcut;
+    }
+    else
+    {
+        /* calc_verlet_buffer_size takes nstlist from the inputrec */
+        ir_try         = *ir;
+        ir_try.nstlist = nstlist;
+        calc_verlet_buffer_size(nlt->mtop, det(box), &ir_try, -1, ls, NULL, &rlist);
+        /* PME tuning might have scaled the cut-off's, keep the buffer */
+        set->rbuf      = rlist - std::max(ir->rvdw, ir->rcoulomb);
+    }
+    set->nstlist      = nstlist;
+    set->nsteps       = 0;
+    set->bTimed       = FALSE;
+    set->cycles       = 0;
+    set->cycles_ns    = 0;
+    set->cycles_force = 0;
+    nlt->n++;
+}
+
+std::vector<int> nstlist_tuning_candidates(int nstlist, int *start)
+{
+    std::vector<int> nstlists;
+
+    *start = -1;
+    for (int i = 0; i < nNstlistTry; i++)
+    {
+        if (*start < 0 && nstlist <= nstlistTry[i])
+        {
+            *start = nstlists.size();
+            nstlists.push_back(nstlist);
+        }
+        if (nstlistTry[i] != nstlist)
+        {
+            nstlists.push_back(nstlistTry[i]);
+        }
+    }
+    if (*start < 0)
+    {
+        *start = nstlists.size();
+        nstlists.push_back(nstlist);
+    }
+
+    return nstlists;
+}
+
+/*! \brief Generate the setups, the initial nstlist is put in its place in nstlistTry */
+static void make_setups(nstlist_tuning_t          *nlt,
+                        const t_inputrec          *ir,
+                        const interaction_const_t *ic,
+                        const matrix               box)
+{
+    verletbuf_list_setup_t ls;
+    std::vector<int>       nstlists;
+    int                    start;
+
+    verletbuf_get_list_setup(TRUE, nlt->bUseGPU, &ls);
+
+    nlt->rcut   = std::max(ic->rvdw, ic->rcoulomb);
+    nstlists    = nstlist_tuning_candidates(ir->nstlist, &start);
+    snew(nlt->setup, nstlists.size());
+    for (size_t i = 0; i < nstlists.size(); i++)
+    {
+        add_setup(nlt, nstlists[i], ir, ic, box, &ls);
+    }
+
+    nstlist_scan_init(&nlt->scan, nlt->n, start);
+    nlt->bWarm   = FALSE;
+}
+
+void nstlist_scan_init(nstlist_scan_t *scan, int n, int start)
+{
+    scan->n            = n;
+    scan->start        = start;
+    scan->cur          = start;
+    scan->fastest      = start;
+    scan->cost_fastest = -1;
+    scan->stage        = 0;
+}
+
+int nstlist_scan_next(nstlist_scan_t *scan, double cost)
+{
+    gmx_bool bContinue;
+    int      next;
+
+    if (scan->cost_fastest < 0 || cost < scan->cost_fastest)
+    {
+        scan->fastest      = scan->cur;
+        scan->cost_fastest = cost;
+    }
+    bContinue = (cost < scan->cost_fastest*maxRelativeSlowdownAccepted);
+
+    next = -1;
+    if (scan->stage == 0 && bContinue && scan->cur + 1 < scan->n)
+    {
+        next = scan->cur + 1;
+    }
+    else if (scan->stage == 1 && bContinue && scan->cur > 0)
+    {
+        next = scan->cur - 1;
+    }
+    else if (scan->stage == 0)
+    {
+        scan->stage = 1;
+        if (scan->fastest == scan->start && scan->start > 0)
+        {
+            next = scan->start - 1;
+        }
+    }
+
+    return next;
+}
+
+int nstlist_scan_switch_failed(nstlist_scan_t *scan)
+{
+    int next = -1;
+
+    if (scan->stage == 0 && scan->fastest == scan->start && scan->start > 0)
+    {
+        next = scan->start - 1;
+    }
+    scan->stage = 1;
+
+    return next;
+}
+
+/*! \brief Return the average cost per step of a setup */
+static double setup_cost(const nstlist_setup_t *set)
+{
+    return set->cycles/set->nsteps;
+}
+
+/*! \brief Print the timing of a setup to fp_err and fp_log, when not NULL */
+static void print_setup(FILE                   *fp_err,
+                        FILE                   *fp_log,
+                        const char             *pre,
+                        const char             *desc,
+                        const nstlist_tuning_t *nlt,
+                        const nstlist_setup_t  *set)
+{
+    char buf[STRLEN], buft[64];
+
+    if (set->bTimed)
+    {
+        sprintf(buft, ": %.3f M-cycles per step", setup_cost(set)*1e-6);
+    }
+    else
+    {
+        buft[0] = '\0';
+    }
+    sprintf(buf, "%-11s%10s nstlist %3d, rlist %.3f nm%s",
+            pre, desc, set->nstlist, nlt->rcut + set->rbuf, buft);
+    if (fp_err != NULL)
+    {
+        fprintf(fp_err, "\r%s\n", buf);
+    }
+    if (fp_log != NULL)
+    {
+        fprintf(fp_log, "%s\n", buf);
+    }
+}
+
+/*! \brief Switch to setup \p index, returns FALSE when its cut-off does not fit */
+static gmx_bool switch_setup(nstlist_tuning_t *nlt,
+                             t_commrec        *cr,
+                             t_inputrec       *ir,
+                             t_forcerec       *fr,
+                             t_state          *state,
+                             int               index)
+{
+    real rlist;
+
+    rlist = nlt->rcut + nlt->setup[index].rbuf;
+
+    if (ir->ePBC != epbcNONE &&
+        gmx::square(rlist) > max_cutoff2(ir->ePBC, state->box))
+    {
+        nlt->elimited = enltlimBOX;
+        return FALSE;
+    }
+    if (DOMAINDECOMP(cr) && !change_dd_cutoff(cr, state, ir, rlist))
+    {
+        nlt->elimited = enltlimDD;
+        return FALSE;
+    }
+
+    /* The next pair search, which is at this step, uses the new settings */
+    ir->nstlist     = nlt->setup[index].nstlist;
+    fr->ic->rlist   = rlist;
+    fr->rlist       = rlist;
+    nbnxn_gpu_pme_loadbal_update_param(fr->nbv, fr->ic);
+
+    nlt->scan.cur   = index;
+    nlt->bWarm      = FALSE;
+
+    return TRUE;
+}
+
+void nstlist_tuning_do(nstlist_tuning_t *nlt,
+                       t_commrec        *cr,
+                       FILE             *fp_err,
+                       FILE             *fp_log,
+                       t_inputrec       *ir,
+                       t_forcerec       *fr,
+                       t_state          *state,
+                       gmx_wallcycle_t   wcycle,
+                       gmx_int64_t       step)
+{
+    nstlist_setup_t *set;
+    int              n, n_dum, next;
+    double           c[3];
+    char             buf[32], sbuf[22];
+
+    if (!nlt->bActive)
+    {
+        return;
+    }
+
+    if (nlt->n == 0)
+    {
+        /* We generate the setups here instead of at init, since
+         * the PME tuning, which is done first, can change the cut-off.
+         */
+        make_setups(nlt, ir, fr->ic, state->box);
+    }
+
+    wallcycle_get(wcycle, ewcSTEP, &n, &c[0]);
+    wallcycle_get(wcycle, ewcNS, &n_dum, &c[1]);
+    wallcycle_get(wcycle, ewcFORCE, &n_dum, &c[2]);
+    if (nlt->cycles_n < 0 || n <= nlt->cycles_n)
+    {
+        /* This is the first call or the counters have been reset */
+        nlt->cycles_n = n;
+        std::copy(c, c + 3, nlt->cycles_c);
+        return;
+    }
+
+    set = &nlt->setup[nlt->scan.cur];
+    if (nlt->bWarm)
+    {
+        set->nsteps       += n - nlt->cycles_n;
+        set->cycles       += c[0] - nlt->cycles_c[0];
+        set->cycles_ns    += c[1] - nlt->cycles_c[1];
+        set->cycles_force += c[2] - nlt->cycles_c[2];
+    }
+    else
+    {
+        /* Skip the first list lifetime after a switch, because it is
+         * slower due to allocation and caching effects.
+         */
+        nlt->bWarm = TRUE;
+    }
+    nlt->cycles_n = n;
+    std::copy(c, c + 3, nlt->cycles_c);
+
+    if (set->nsteps < std::max(minStepsTimed, minListsTimed*set->nstlist))
+    {
+        return;
+    }
+
+    /* All PP ranks take the same decision, based on the average cost */
+    if (PAR(cr))
+    {
+        int npp;
+
+        c[0] = set->cycles;
+        c[1] = set->cycles_ns;
+        c[2] = set->cycles_force;
+        gmx_sumd(3, c, cr);
+        /* The sum is over the PP ranks only, cr->nnodes includes PME ranks */
+        npp               = (DOMAINDECOMP(cr) ? cr->dd->nnodes : cr->nnodes);
+        set->cycles       = c[0]/npp;
+        set->cycles_ns    = c[1]/npp;
+        set->cycles_force = c[2]/npp;
+    }
+    set->bTimed = TRUE;
+
+    sprintf(buf, "step %4s: ", gmx_step_str(step, sbuf));
+    print_setup(fp_err, fp_log, buf, "timed with", nlt, set);
+
+    next = nstlist_scan_next(&nlt->scan, setup_cost(set));
+    while (next >= 0 && !switch_setup(nlt, cr, ir, fr, state, next))
+    {
+        /* This returns a new setup at most once, so we try at most twice */
+        next = nstlist_scan_switch_failed(&nlt->scan);
+    }
+
+    if (next < 0)
+    {
+        /* We are done, use the fastest setup */
+        nlt->bActive = FALSE;
+        if (nlt->scan.fastest != nlt->scan.cur &&
+            !switch_setup(nlt, cr, ir, fr, state, nlt->scan.fastest))
+        {
+            /* With DLB the domains can have become too small for
+             * a setup timed earlier, continue with the current one.
+             */
+            nlt->scan.fastest = nlt->scan.cur;
+        }
+        if (DOMAINDECOMP(cr))
+        {
+            /* Avoid DLB limiting the cut-off we chose */
+            set_dd_dlb_max_cutoff(cr, fr->ic->rlist);
+        }
+        print_setup(fp_err, fp_log, buf, "optimal",
+                    nlt, &nlt->setup[nlt->scan.cur]);
+    }
+}
+
+void nstlist_tuning_done(nstlist_tuning_t *nlt,
+                         FILE             *fplog)
+{
+    const nstlist_setup_t *set;
+    int                    i;
+
+    if (fplog != NULL && nlt->n > 0)
+    {
+        fprintf(fplog, "\n");
+        fprintf(fplog, "       N S T L I S T   T U N I N G\n");
+        fprintf(fplog, "\n");
+        if (nlt->bActive)
+        {
+            fprintf(fplog, " NOTE: The run ended before the nstlist tuning finished.\n\n");
+        }
+        if (nlt->elimited != enltlimNO)
+        {
+            fprintf(fplog, " NOTE: Larger nstlist values were limited by the %s.\n\n",
+                    nltlim_str[nlt->elimited]);
+        }
+        fprintf(fplog, " Cost per step averaged over the PP ranks, in M-cycles:\n");
+        fprintf(fplog, "   nstlist   rlist        step    search     force\n");
+        for (i = 0; i < nlt->n; i++)
+        {
+            set = &nlt->setup[i];
+            if (set->bTimed)
+            {
+                fprintf(fplog, "   %7d  %6.3f nm  %8.3f  %8.3f  %8.3f%s\n",
+                        set->nstlist, nlt->rcut + set->rbuf,
+                        set->cycles*1e-6/set->nsteps,
+                        set->cycles_ns*1e-6/set->nsteps,
+                        set->cycles_force*1e-6/set->nsteps,
+                        i == nlt->scan.start ? "  (initial)" : "");
+            }
+        }
+        fprintf(fplog, " Continued with nstlist %d, rlist %.3f nm\n\n",
+                nlt->setup[nlt->scan.cur].nstlist,
+                nlt->rcut + nlt->setup[nlt->scan.cur].rbuf);
+    }
+
+    sfree(nlt->setup);
+    sfree(nlt);
+}
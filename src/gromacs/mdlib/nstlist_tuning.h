@@ -0,0 +1,139 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2016, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ *
+ * \brief This file contains function declarations for tuning
+ * the pair-list update interval nstlist during a run.
+ *
+ * \inlibraryapi
+ * \ingroup module_mdlib
+ */
+
+#ifndef GMX_MDLIB_NSTLIST_TUNING_H
+#define GMX_MDLIB_NSTLIST_TUNING_H
+
+#include <stdio.h>
+
+#include <vector>
+
+#include "gromacs/mdtypes/forcerec.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/mdtypes/state.h"
+#include "gromacs/timing/wallcycle.h"
+
+struct gmx_mtop_t;
+struct t_commrec;
+
+/*! \brief Object to manage the nstlist tuning */
+struct nstlist_tuning_t;
+
+/*! \brief The scan over the nstlist setups, in order of increasing nstlist
+ *
+ * The scan first moves to larger nstlist, while the cost decreases.
+ * If that did not give a faster setup, it moves to smaller nstlist.
+ */
+struct nstlist_scan_t {
+    int    n;            /**< the number of setups                          */
+    int    start;        /**< the setup we started with                     */
+    int    cur;          /**< the setup in use                              */
+    int    fastest;      /**< the fastest setup timed so far                */
+    double cost_fastest; /**< the cost per step of the fastest setup, or -1 */
+    int    stage;        /**< 0: scanning up from start, 1: scanning down   */
+};
+
+/*! \brief Return the nstlist values to time, in increasing order
+ *
+ * The initial \p nstlist is inserted in the list of values to try,
+ * its index is returned in \p start.
+ */
+std::vector<int> nstlist_tuning_candidates(int nstlist, int *start);
+
+/*! \brief Initialize the scan over \p n setups, starting at setup \p start */
+void nstlist_scan_init(nstlist_scan_t *scan, int n, int start);
+
+/*! \brief Process the \p cost per step of the current setup
+ *
+ * Returns the setup to time next, or -1 when the scan is done.
+ * The caller sets scan->cur when it switched to the returned setup.
+ */
+int nstlist_scan_next(nstlist_scan_t *scan, double cost);
+
+/*! \brief Return the setup to try after the one returned last did not fit, or -1
+ *
+ * Only a larger buffer can fail to fit, so scanning up stops and
+ * the scan continues down. A failure while scanning down ends the scan,
+ * so this returns a setup at most once per scan.
+ */
+int nstlist_scan_switch_failed(nstlist_scan_t *scan);
+
+/*! \brief Return whether nstlist tuning is active */
+bool nstlist_tuning_is_active(const nstlist_tuning_t *nlt);
+
+/*! \brief Initialize the nstlist tuning
+ *
+ * Tuning is only active with the Verlet scheme with a buffer tolerance,
+ * with cycle counters and when nstlist can be changed, i.e. not with
+ * NVE, nstlist=1 or multi-simulations.
+ */
+void nstlist_tuning_init(nstlist_tuning_t **nlt_p,
+                         struct t_commrec  *cr,
+                         const t_inputrec  *ir,
+                         const gmx_mtop_t  *mtop,
+                         gmx_wallcycle_t    wcycle,
+                         gmx_bool           bUseGPU);
+
+/*! \brief Process the cycles of the last nstlist steps and switch nstlist when necessary
+ *
+ * Should be called at every pair-search step, before the search,
+ * while the tuning is active and PME load balancing is not.
+ * Times each nstlist value, with its buffer from calc_verlet_buffer_size,
+ * and then continues with the fastest one.
+ * Changes ir->nstlist and the pair-list cut-off in fr.
+ */
+void nstlist_tuning_do(nstlist_tuning_t *nlt,
+                       struct t_commrec *cr,
+                       FILE             *fp_err,
+                       FILE             *fp_log,
+                       t_inputrec       *ir,
+                       t_forcerec       *fr,
+                       t_state          *state,
+                       gmx_wallcycle_t   wcycle,
+                       gmx_int64_t       step);
+
+/*! \brief Print the timings and the chosen nstlist when fplog!=NULL and free nlt */
+void nstlist_tuning_done(nstlist_tuning_t *nlt,
+                         FILE             *fplog);
+
+#endif
@@ -139,6 +139,17 @@ void sum_bin(t_bin *b, t_commrec *cr)
     gmx_sumd(b->maxreal, b->rbuf, cr);
 }
 
+gmx_bool sum_bin_start(t_bin *b, t_commrec *cr, MPI_Request *request)
+{
+    int i;
+
+    for (i = b->nreal; (i < b->maxreal); i++)
+    {
+        b->rbuf[i] = 0;
+    }
+    return gmx_sumd_start(b->maxreal, b->rbuf, cr, request);
+}
+
 void extract_binr(t_bin *b, int index, int nr, real r[])
 {
     int     i;
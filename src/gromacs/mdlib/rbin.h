@@ -37,6 +37,8 @@
 #ifndef GMX_MDLIB_RBIN_H
 #define GMX_MDLIB_RBIN_H
 
+#include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/gmxmpi.h"
 #include "gromacs/utility/real.h"
 
 struct t_commrec;
@@ -63,6 +65,11 @@ int add_bind(t_bin *b, int nr, double r[]);
 void sum_bin(t_bin *b, struct t_commrec *cr);
 /* Globally sum the reals in the bin */
 
+gmx_bool sum_bin_start(t_bin *b, struct t_commrec *cr, MPI_Request *request);
+/* Start globally summing the reals in the bin, returns TRUE when
+ * the sum is nonblocking and should be completed with gmx_sumd_finish
+ */
+
 void extract_binr(t_bin *b, int index, int nr, real r[]);
 void extract_bind(t_bin *b, int index, int nr, double r[]);
 /* Extract values from the bin, starting from index (see add_bin) */
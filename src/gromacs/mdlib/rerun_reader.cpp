@@ -0,0 +1,192 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2016, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+#include "gmxpre.h"
+
+#include "rerun_reader.h"
+
+#include <cstdlib>
+
+#include "thread_mpi/threads.h"
+
+#include "gromacs/fileio/trxio.h"
+#include "gromacs/mdlib/helper_thread_affinity.h"
+#include "gromacs/trajectory/trajectoryframe.h"
+#include "gromacs/utility/smalloc.h"
+
+struct gmx_rerun_reader {
+    tMPI_Thread_t           thread;
+    tMPI_Thread_mutex_t     mutex;
+    tMPI_Thread_cond_t      cond;          /* Signaled when a frame was read or taken, or we should stop */
+    const gmx_output_env_t *oenv;
+    t_trxstatus            *status;
+    t_trxframe              fr;            /* The frame read ahead by the thread                         */
+    gmx_bool                bRead;         /* fr has been read, but not taken yet                        */
+    gmx_bool                bNotLastFrame; /* The last read returned a frame                             */
+    gmx_bool                bStop;         /* The thread should stop                                     */
+};
+
+/* The main function of the reading thread */
+static void *rerun_reader_loop(void *arg)
+{
+    gmx_rerun_reader *rr = static_cast<gmx_rerun_reader *>(arg);
+
+    /* Don't compete for the core of the master thread, which started us */
+    gmx_set_helper_thread_affinity();
+
+    tMPI_Thread_mutex_lock(&rr->mutex);
+    while (TRUE)
+    {
+        while ((rr->bRead || !rr->bNotLastFrame) && !rr->bStop)
+        {
+            tMPI_Thread_cond_wait(&rr->cond, &rr->mutex);
+        }
+        if (rr->bStop)
+        {
+            break;
+        }
+        tMPI_Thread_mutex_unlock(&rr->mutex);
+
+        /* Nobody else touches fr until bRead is set */
+        gmx_bool bNotLastFrame = read_next_frame(rr->oenv, rr->status, &rr->fr);
+
+        tMPI_Thread_mutex_lock(&rr->mutex);
+        rr->bNotLastFrame = bNotLastFrame;
+        rr->bRead         = TRUE;
+        tMPI_Thread_cond_broadcast(&rr->cond);
+    }
+    tMPI_Thread_mutex_unlock(&rr->mutex);
+
+    return NULL;
+}
+
+gmx_rerun_reader_t init_rerun_reader(const gmx_output_env_t *oenv,
+                                     t_trxstatus            *status,
+                                     const t_trxframe       *fr)
+{
+    gmx_rerun_reader *rr;
+
+    if (getenv("GMX_NO_RERUN_READER") != NULL)
+    {
+        return NULL;
+    }
+
+    snew(rr, 1);
+    rr->oenv   = oenv;
+    rr->status = status;
+    /* Copy the reading settings and the time bookkeeping of the first
+     * frame, but read into our own buffers, since the caller uses the
+     * buffers of fr while we read the next frame.
+     */
+    rr->fr   = *fr;
+    rr->fr.x = NULL;
+    rr->fr.v = NULL;
+    rr->fr.f = NULL;
+    if (fr->x != NULL)
+    {
+        snew(rr->fr.x, fr->natoms);
+    }
+    if (fr->v != NULL)
+    {
+        snew(rr->fr.v, fr->natoms);
+    }
+    if (fr->f != NULL)
+    {
+        snew(rr->fr.f, fr->natoms);
+    }
+    rr->bRead         = FALSE;
+    rr->bNotLastFrame = TRUE;
+    rr->bStop         = FALSE;
+    tMPI_Thread_mutex_init(&rr->mutex);
+    tMPI_Thread_cond_init(&rr->cond);
+    if (tMPI_Thread_create(&rr->thread, rerun_reader_loop, rr) != 0)
+    {
+        /* The caller can still read synchronously */
+        tMPI_Thread_cond_destroy(&rr->cond);
+        tMPI_Thread_mutex_destroy(&rr->mutex);
+        sfree(rr->fr.x);
+        sfree(rr->fr.v);
+        sfree(rr->fr.f);
+        sfree(rr);
+        rr = NULL;
+    }
+
+    return rr;
+}
+
+gmx_bool rerun_reader_next_frame(gmx_rerun_reader_t rr, t_trxframe *fr)
+{
+    gmx_bool bNotLastFrame;
+
+    tMPI_Thread_mutex_lock(&rr->mutex);
+    while (!rr->bRead)
+    {
+        tMPI_Thread_cond_wait(&rr->cond, &rr->mutex);
+    }
+    bNotLastFrame = rr->bNotLastFrame;
+    if (bNotLastFrame)
+    {
+        /* Hand over the frame and let the thread read the next one
+         * into the buffers of the frame the caller is done with.
+         */
+        rvec *x   = fr->x;
+        rvec *v   = fr->v;
+        rvec *f   = fr->f;
+        *fr       = rr->fr;
+        rr->fr.x  = x;
+        rr->fr.v  = v;
+        rr->fr.f  = f;
+        rr->bRead = FALSE;
+        tMPI_Thread_cond_broadcast(&rr->cond);
+    }
+    tMPI_Thread_mutex_unlock(&rr->mutex);
+
+    return bNotLastFrame;
+}
+
+void done_rerun_reader(gmx_rerun_reader_t rr)
+{
+    tMPI_Thread_mutex_lock(&rr->mutex);
+    rr->bStop = TRUE;
+    tMPI_Thread_cond_broadcast(&rr->cond);
+    tMPI_Thread_mutex_unlock(&rr->mutex);
+    tMPI_Thread_join(rr->thread, NULL);
+
+    tMPI_Thread_cond_destroy(&rr->cond);
+    tMPI_Thread_mutex_destroy(&rr->mutex);
+    sfree(rr->fr.x);
+    sfree(rr->fr.v);
+    sfree(rr->fr.f);
+    sfree(rr);
+}
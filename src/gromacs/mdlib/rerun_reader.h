@@ -0,0 +1,83 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2016, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ * \brief
+ * Declares functions for reading rerun trajectory frames ahead on a separate thread.
+ *
+ * \inlibraryapi
+ * \ingroup module_mdlib
+ */
+#ifndef GMX_MDLIB_RERUN_READER_H
+#define GMX_MDLIB_RERUN_READER_H
+
+#include "gromacs/utility/basedefinitions.h"
+
+struct gmx_output_env_t;
+struct t_trxframe;
+struct t_trxstatus;
+
+/*! \brief Reads the frames of a rerun trajectory one frame ahead
+ *
+ * A thread reads the next frame while mdrun computes the energies
+ * of the current one, so reading and decompressing the frames overlaps
+ * with the force calculation.
+ */
+typedef struct gmx_rerun_reader *gmx_rerun_reader_t;
+
+/*! \brief Start reading the frames after \p fr from \p status ahead
+ *
+ * \p fr should be the frame returned by read_first_frame().
+ * Returns NULL when reading ahead is disabled with the environment
+ * variable GMX_NO_RERUN_READER or when no thread can be started,
+ * the caller should then use read_next_frame().
+ */
+gmx_rerun_reader_t init_rerun_reader(const gmx_output_env_t *oenv,
+                                     t_trxstatus            *status,
+                                     const t_trxframe       *fr);
+
+/*! \brief Replace the contents of \p fr by the next frame
+ *
+ * Waits until the next frame has been read and returns FALSE when
+ * there are no more frames, as read_next_frame().
+ */
+gmx_bool rerun_reader_next_frame(gmx_rerun_reader_t rr, t_trxframe *fr);
+
+/*! \brief Stop the reading thread and free \p rr
+ *
+ * The trajectory status should be closed after this call.
+ */
+void done_rerun_reader(gmx_rerun_reader_t rr);
+
+#endif
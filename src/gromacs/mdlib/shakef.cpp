@@ -38,24 +38,56 @@
 
 #include <math.h>
 
+#include <algorithm>
+
 #include "gromacs/gmxlib/nrnb.h"
 #include "gromacs/math/functions.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/mdlib/constr.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
 #include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
+#include "gromacs/simd/vector_operations.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/smalloc.h"
 
+#if GMX_SIMD_HAVE_REAL
+/* With SIMD we can SHAKE GMX_SIMD_REAL_WIDTH blocks of equal size at once */
+#    define SHAKE_SIMD
+#endif
+
+/* The maximum number of constraints in blocks which we SHAKE with SIMD */
+static const int shake_simd_max_block_size = 16;
+
+/* Bounds for the over-relaxation factor, SOR diverges for omega >= 2 */
+static const real shake_sor_omega_min = 1.0;
+static const real shake_sor_omega_max = 1.9;
+
+/* Thread local SHAKE working data */
+typedef struct {
+    rvec  *rij;                         /* Initial constraint vectors              */
+    real  *half_of_reduced_mass;        /* Half of the reduced mass per constraint */
+    real  *distance_squared_tolerance;  /* Tolerance factor per constraint         */
+    real  *constraint_distance_squared; /* Squared reference length per constraint */
+    int    nalloc;                      /* Allocation size of the arrays above     */
+    int    block_start;                 /* The first SHAKE block of this thread    */
+    int    block_end;                   /* The end of the blocks of this thread    */
+    int    tnit;                        /* Iteration count for nrnb                */
+    int    trij;                        /* Constraint count for nrnb               */
+    int    error_block;                 /* First block which failed, -1 when OK    */
+    int    error_nblock;                /* The number of blocks in that batch      */
+    tensor vir_r_m_dr;                  /* Thread local constraint virial          */
+} shake_thread_t;
+
 typedef struct gmx_shakedata
 {
-    rvec *rij;
-    real *half_of_reduced_mass;
-    real *distance_squared_tolerance;
-    real *constraint_distance_squared;
-    int   nalloc;
+    int             nthread;        /* The number of threads for SHAKE        */
+    shake_thread_t *th;             /* Thread local data                      */
     /* SOR stuff */
-    real  delta;
-    real  omega;
-    real  gamma;
+    real            delta;
+    real            omega;
+    real            gamma;
 } t_gmx_shakedata;
 
 gmx_shakedata_t shake_init()
@@ -64,11 +96,8 @@ gmx_shakedata_t shake_init()
 
     snew(d, 1);
 
-    d->nalloc                      = 0;
-    d->rij                         = NULL;
-    d->half_of_reduced_mass        = NULL;
-    d->distance_squared_tolerance  = NULL;
-    d->constraint_distance_squared = NULL;
+    d->nthread = 0;
+    d->th      = NULL;
 
     /* SOR initialization */
     d->delta = 0.1;
@@ -97,7 +126,7 @@ gmx_shakedata_t shake_init()
  * \param[in]    initial_displacements         The initial displacements of each constraint
  * \param[in]    half_of_reduced_mass          Half of the reduced mass for each constraint
  * \param[in]    omega                         SHAKE over-relaxation factor (set non-1.0 by
- *                                             using shake-sor=yes in the .mdp, but there is no documentation anywhere)
+ *                                             using shake-sor=yes in the .mdp)
  * \param[in]    invmass                       Inverse mass of each atom
  * \param[in]    distance_squared_tolerance    Multiplicative tolerance on the difference in the
  *                                             square of the constrained distance (see code)
@@ -201,13 +230,265 @@ void cshake(const int iatom[], int ncon, int *nnit, int maxnit,
     *nerror = error;
 }
 
-int vec_shakef(FILE *fplog, gmx_shakedata_t shaked,
-               real invmass[], int ncon,
-               t_iparams ip[], t_iatom *iatom,
-               real tol, rvec x[], rvec prime[], real omega,
-               gmx_bool bFEP, real lambda, real scaled_lagrange_multiplier[],
-               real invdt, rvec *v,
-               gmx_bool bCalcVir, tensor vir_r_m_dr, int econq)
+#ifdef SHAKE_SIMD
+/* The number of SIMD parameters stored per constraint by cshake_simd */
+static const int shake_simd_nparam = 9;
+
+/* Load the positions of the GMX_SIMD_REAL_WIDTH atoms with indices a
+ * from the flat array x into v_S, buf should be aligned and hold
+ * DIM*GMX_SIMD_REAL_WIDTH reals.
+ */
+static gmx_inline void gmx_simdcall
+gather_shake_atoms_simd(const real * gmx_restrict x,
+                        const int *               a,
+                        real * gmx_restrict       buf,
+                        gmx_simd_real_t           v_S[DIM])
+{
+    int s, d;
+
+    for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+    {
+        for (d = 0; d < DIM; d++)
+        {
+            buf[d*GMX_SIMD_REAL_WIDTH + s] = x[a[s]*DIM + d];
+        }
+    }
+    for (d = 0; d < DIM; d++)
+    {
+        v_S[d] = gmx_simd_load_r(buf + d*GMX_SIMD_REAL_WIDTH);
+    }
+}
+
+/* Store v_S to the positions of the GMX_SIMD_REAL_WIDTH atoms with
+ * indices a in the flat array x, all indices should be different.
+ */
+static gmx_inline void gmx_simdcall
+scatter_shake_atoms_simd(real * gmx_restrict   x,
+                         const int *           a,
+                         real * gmx_restrict   buf,
+                         const gmx_simd_real_t v_S[DIM])
+{
+    int s, d;
+
+    for (d = 0; d < DIM; d++)
+    {
+        gmx_simd_store_r(buf + d*GMX_SIMD_REAL_WIDTH, v_S[d]);
+    }
+    for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+    {
+        for (d = 0; d < DIM; d++)
+        {
+            x[a[s]*DIM + d] = buf[d*GMX_SIMD_REAL_WIDTH + s];
+        }
+    }
+}
+
+/* SIMD version of cshake which constrains GMX_SIMD_REAL_WIDTH independent
+ * blocks of ncon constraints each, one block per SIMD lane. Constraint ll
+ * of block s is stored at index s*ncon + ll of the input arrays.
+ * The blocks share the iteration loop, so *nnit returns the iteration
+ * count of the slowest block. Blocks which have converged are not changed.
+ */
+static void gmx_simdcall
+cshake_simd(const int iatom[], int ncon, int *nnit, int maxnit,
+            const real constraint_distance_squared[], real positions[],
+            const real initial_displacements[], const real half_of_reduced_mass[], real omega,
+            const real invmass[], const real distance_squared_tolerance[],
+            real scaled_lagrange_multiplier[], int *nerror)
+{
+    const real      mytol = 1e-10;
+
+    int             ai[shake_simd_max_block_size*GMX_SIMD_REAL_WIDTH];
+    int             aj[shake_simd_max_block_size*GMX_SIMD_REAL_WIDTH];
+    real            param_unaligned[(shake_simd_nparam*shake_simd_max_block_size + DIM + 1)*GMX_SIMD_REAL_WIDTH];
+    real           *param, *buf;
+    int             s, ll, c, d, nit, error;
+    gmx_bool        bUpdated;
+    gmx_simd_real_t one_S, omega_S, mytol_S;
+    gmx_simd_real_t rij_S[DIM], xi_S[DIM], xj_S[DIM], rp_S[DIM];
+    gmx_simd_real_t dist2_S, tol_S, hrm_S, im_S, jm_S, lagr_S;
+    gmx_simd_real_t diff_S, rdr_S, g_S, gim_S, gjm_S;
+    gmx_simd_bool_t bUpdate_S, bError_S;
+
+    /* Per constraint we store, each as a SIMD vector over the blocks:
+     * rij (DIM), the squared length, the tolerance factor, half the
+     * reduced mass, the two inverse masses and the Lagrange multiplier.
+     */
+    param = gmx_simd_align_r(param_unaligned);
+    buf   = param + shake_simd_nparam*ncon*GMX_SIMD_REAL_WIDTH;
+
+    for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+    {
+        for (ll = 0; ll < ncon; ll++)
+        {
+            real *p = param + ll*shake_simd_nparam*GMX_SIMD_REAL_WIDTH + s;
+
+            c                               = s*ncon + ll;
+            ai[ll*GMX_SIMD_REAL_WIDTH + s]  = iatom[c*3 + 1];
+            aj[ll*GMX_SIMD_REAL_WIDTH + s]  = iatom[c*3 + 2];
+            for (d = 0; d < DIM; d++)
+            {
+                p[d*GMX_SIMD_REAL_WIDTH] = initial_displacements[c*DIM + d];
+            }
+            p[3*GMX_SIMD_REAL_WIDTH] = constraint_distance_squared[c];
+            p[4*GMX_SIMD_REAL_WIDTH] = distance_squared_tolerance[c];
+            p[5*GMX_SIMD_REAL_WIDTH] = half_of_reduced_mass[c];
+            p[6*GMX_SIMD_REAL_WIDTH] = invmass[iatom[c*3 + 1]];
+            p[7*GMX_SIMD_REAL_WIDTH] = invmass[iatom[c*3 + 2]];
+            p[8*GMX_SIMD_REAL_WIDTH] = scaled_lagrange_multiplier[c];
+        }
+    }
+
+    one_S   = gmx_simd_set1_r(1.0);
+    omega_S = gmx_simd_set1_r(omega);
+    mytol_S = gmx_simd_set1_r(mytol);
+
+    error    = 0;
+    bUpdated = TRUE;
+    for (nit = 0; nit < maxnit && bUpdated && error == 0; nit++)
+    {
+        bUpdated = FALSE;
+        for (ll = 0; ll < ncon && error == 0; ll++)
+        {
+            real      *p  = param + ll*shake_simd_nparam*GMX_SIMD_REAL_WIDTH;
+            const int *ia = ai + ll*GMX_SIMD_REAL_WIDTH;
+            const int *ja = aj + ll*GMX_SIMD_REAL_WIDTH;
+
+            gather_shake_atoms_simd(positions, ia, buf, xi_S);
+            gather_shake_atoms_simd(positions, ja, buf, xj_S);
+            for (d = 0; d < DIM; d++)
+            {
+                rp_S[d] = gmx_simd_sub_r(xi_S[d], xj_S[d]);
+            }
+            dist2_S   = gmx_simd_load_r(p + 3*GMX_SIMD_REAL_WIDTH);
+            tol_S     = gmx_simd_load_r(p + 4*GMX_SIMD_REAL_WIDTH);
+            diff_S    = gmx_simd_sub_r(dist2_S, gmx_simd_norm2_r(rp_S[XX], rp_S[YY], rp_S[ZZ]));
+            bUpdate_S = gmx_simd_cmplt_r(one_S, gmx_simd_mul_r(gmx_simd_fabs_r(diff_S), tol_S));
+
+            if (!gmx_simd_anytrue_b(bUpdate_S))
+            {
+                continue;
+            }
+            bUpdated = TRUE;
+
+            for (d = 0; d < DIM; d++)
+            {
+                rij_S[d] = gmx_simd_load_r(p + d*GMX_SIMD_REAL_WIDTH);
+            }
+            rdr_S    = gmx_simd_iprod_r(rij_S[XX], rij_S[YY], rij_S[ZZ],
+                                        rp_S[XX], rp_S[YY], rp_S[ZZ]);
+            bError_S = gmx_simd_and_b(bUpdate_S,
+                                      gmx_simd_cmplt_r(rdr_S, gmx_simd_mul_r(dist2_S, mytol_S)));
+            if (gmx_simd_anytrue_b(bError_S))
+            {
+                gmx_simd_store_r(buf, gmx_simd_blendzero_r(one_S, bError_S));
+                for (s = GMX_SIMD_REAL_WIDTH - 1; s >= 0; s--)
+                {
+                    if (buf[s] != 0)
+                    {
+                        error = s*ncon + ll + 1;
+                    }
+                }
+                continue;
+            }
+
+            hrm_S  = gmx_simd_load_r(p + 5*GMX_SIMD_REAL_WIDTH);
+            im_S   = gmx_simd_load_r(p + 6*GMX_SIMD_REAL_WIDTH);
+            jm_S   = gmx_simd_load_r(p + 7*GMX_SIMD_REAL_WIDTH);
+            lagr_S = gmx_simd_load_r(p + 8*GMX_SIMD_REAL_WIDTH);
+
+            /* Converged blocks get a zero correction */
+            g_S    = gmx_simd_blendzero_r(gmx_simd_mul_r(gmx_simd_mul_r(omega_S, diff_S),
+                                                         gmx_simd_mul_r(hrm_S, gmx_simd_inv_r(rdr_S))),
+                                          bUpdate_S);
+            lagr_S = gmx_simd_add_r(lagr_S, g_S);
+            gmx_simd_store_r(p + 8*GMX_SIMD_REAL_WIDTH, lagr_S);
+
+            gim_S  = gmx_simd_mul_r(g_S, im_S);
+            gjm_S  = gmx_simd_mul_r(g_S, jm_S);
+            for (d = 0; d < DIM; d++)
+            {
+                xi_S[d] = gmx_simd_fmadd_r(gim_S, rij_S[d], xi_S[d]);
+                xj_S[d] = gmx_simd_fnmadd_r(gjm_S, rij_S[d], xj_S[d]);
+            }
+            scatter_shake_atoms_simd(positions, ia, buf, xi_S);
+            scatter_shake_atoms_simd(positions, ja, buf, xj_S);
+        }
+    }
+
+    for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+    {
+        for (ll = 0; ll < ncon; ll++)
+        {
+            scaled_lagrange_multiplier[s*ncon + ll] =
+                param[(ll*shake_simd_nparam + 8)*GMX_SIMD_REAL_WIDTH + s];
+        }
+    }
+
+    *nnit   = nit;
+    *nerror = error;
+}
+#endif /* SHAKE_SIMD */
+
+void cshake_blocks(const int iatom[], int nblock, int ncon, int *nnit, int maxnit,
+                   const real constraint_distance_squared[], real positions[],
+                   const real initial_displacements[], const real half_of_reduced_mass[], real omega,
+                   const real invmass[], const real distance_squared_tolerance[],
+                   real scaled_lagrange_multiplier[], int *nerror)
+{
+    int b, c, nit, error;
+
+    *nnit   = 0;
+    *nerror = 0;
+    b       = 0;
+#ifdef SHAKE_SIMD
+    if (ncon <= shake_simd_max_block_size)
+    {
+        for (; b + GMX_SIMD_REAL_WIDTH <= nblock; b += GMX_SIMD_REAL_WIDTH)
+        {
+            c = b*ncon;
+            cshake_simd(iatom + c*3, ncon, &nit, maxnit,
+                        constraint_distance_squared + c, positions,
+                        initial_displacements + c*DIM, half_of_reduced_mass + c, omega,
+                        invmass, distance_squared_tolerance + c,
+                        scaled_lagrange_multiplier + c, &error);
+            *nnit = std::max(*nnit, nit);
+            if (error != 0)
+            {
+                *nerror = c + error;
+                return;
+            }
+        }
+    }
+#endif
+    for (; b < nblock; b++)
+    {
+        c = b*ncon;
+        cshake(iatom + c*3, ncon, &nit, maxnit,
+               constraint_distance_squared + c, positions,
+               initial_displacements + c*DIM, half_of_reduced_mass + c, omega,
+               invmass, distance_squared_tolerance + c,
+               scaled_lagrange_multiplier + c, &error);
+        *nnit = std::max(*nnit, nit);
+        if (error != 0)
+        {
+            *nerror = c + error;
+            return;
+        }
+    }
+}
+
+/* SHAKE or RATTLE nblock consecutive blocks of ncon/nblock constraints
+ * each. Returns the maximum number of iterations over the blocks,
+ * 0 when an error occurred.
+ */
+static int vec_shakef(FILE *fplog, shake_thread_t *shaket,
+                      real invmass[], int nblock, int ncon,
+                      t_iparams ip[], t_iatom *iatom,
+                      real tol, rvec x[], rvec prime[], real omega,
+                      gmx_bool bFEP, real lambda, real scaled_lagrange_multiplier[],
+                      real invdt, rvec *v,
+                      gmx_bool bCalcVir, tensor vir_r_m_dr, int econq)
 {
     rvec    *rij;
     real    *half_of_reduced_mass, *distance_squared_tolerance, *constraint_distance_squared;
@@ -219,18 +500,18 @@ int vec_shakef(FILE *fplog, gmx_shakedata_t shaked,
     int      error = 0;
     real     constraint_distance;
 
-    if (ncon > shaked->nalloc)
+    if (ncon > shaket->nalloc)
     {
-        shaked->nalloc = over_alloc_dd(ncon);
-        srenew(shaked->rij, shaked->nalloc);
-        srenew(shaked->half_of_reduced_mass, shaked->nalloc);
-        srenew(shaked->distance_squared_tolerance, shaked->nalloc);
-        srenew(shaked->constraint_distance_squared, shaked->nalloc);
+        shaket->nalloc = over_alloc_dd(ncon);
+        srenew(shaket->rij, shaket->nalloc);
+        srenew(shaket->half_of_reduced_mass, shaket->nalloc);
+        srenew(shaket->distance_squared_tolerance, shaket->nalloc);
+        srenew(shaket->constraint_distance_squared, shaket->nalloc);
     }
-    rij                          = shaked->rij;
-    half_of_reduced_mass         = shaked->half_of_reduced_mass;
-    distance_squared_tolerance   = shaked->distance_squared_tolerance;
-    constraint_distance_squared  = shaked->constraint_distance_squared;
+    rij                          = shaket->rij;
+    half_of_reduced_mass         = shaket->half_of_reduced_mass;
+    distance_squared_tolerance   = shaket->distance_squared_tolerance;
+    constraint_distance_squared  = shaket->constraint_distance_squared;
 
     L1   = 1.0-lambda;
     ia   = iatom;
@@ -260,7 +541,7 @@ int vec_shakef(FILE *fplog, gmx_shakedata_t shaked,
     switch (econq)
     {
         case econqCoord:
-            cshake(iatom, ncon, &nit, maxnit, constraint_distance_squared, prime[0], rij[0], half_of_reduced_mass, omega, invmass, distance_squared_tolerance, scaled_lagrange_multiplier, &error);
+            cshake_blocks(iatom, nblock, ncon/nblock, &nit, maxnit, constraint_distance_squared, prime[0], rij[0], half_of_reduced_mass, omega, invmass, distance_squared_tolerance, scaled_lagrange_multiplier, &error);
             break;
         case econqVeloc:
             crattle(iatom, ncon, &nit, maxnit, constraint_distance_squared, prime[0], rij[0], half_of_reduced_mass, omega, invmass, distance_squared_tolerance, scaled_lagrange_multiplier, &error, invdt);
@@ -389,6 +670,87 @@ static void check_cons(FILE *log, int nc, rvec x[], rvec prime[], rvec v[],
     }
 }
 
+/* Divide the SHAKE blocks over the threads, balancing the number of
+ * constraints. Blocks are independent, so each thread can SHAKE its own
+ * blocks without any synchronization.
+ */
+static void divide_shake_blocks(gmx_shakedata_t shaked, int nblocks, const int sblock[])
+{
+    int th, b, ncon;
+
+    ncon = (sblock[nblocks] - sblock[0])/3;
+    b    = 0;
+    for (th = 0; th < shaked->nthread; th++)
+    {
+        shake_thread_t *shaket = &shaked->th[th];
+        int             end    = sblock[0] + 3*((ncon*(th + 1))/shaked->nthread);
+
+        shaket->block_start = b;
+        while (b < nblocks && sblock[b] < end)
+        {
+            b++;
+        }
+        shaket->block_end = b;
+    }
+}
+
+/* SHAKE the blocks assigned to one thread. Consecutive blocks of equal
+ * size are passed together, so they can be constrained with SIMD.
+ * Stops at the first block which fails and stores it in error_block.
+ */
+static void shake_thread_blocks(FILE *log, gmx_shakedata_t shaked, shake_thread_t *shaket,
+                                real invmass[], const int sblock[],
+                                t_idef *idef, t_inputrec *ir, rvec x_s[], rvec prime[],
+                                real *scaled_lagrange_multiplier, real lambda,
+                                real invdt, rvec *v, gmx_bool bCalcVir,
+                                int econq)
+{
+    t_iatom *iatoms;
+    real    *lagr;
+    int      b, nb, blen, n0;
+
+    shaket->tnit        = 0;
+    shaket->trij        = 0;
+    shaket->error_block = -1;
+    clear_mat(shaket->vir_r_m_dr);
+
+    for (b = shaket->block_start; b < shaket->block_end; b += nb)
+    {
+        blen = (sblock[b+1] - sblock[b])/3;
+        nb   = 1;
+#ifdef SHAKE_SIMD
+        if (econq == econqCoord && blen <= shake_simd_max_block_size)
+        {
+            while (b + nb < shaket->block_end &&
+                   sblock[b+nb+1] - sblock[b+nb] == 3*blen)
+            {
+                nb++;
+            }
+        }
+#endif
+        iatoms = &(idef->il[F_CONSTR].iatoms[sblock[b]]);
+        lagr   = scaled_lagrange_multiplier + (sblock[b] - sblock[0])/3;
+        n0     = vec_shakef(log, shaket, invmass, nb, nb*blen, idef->iparams,
+                            iatoms, ir->shake_tol, x_s, prime, shaked->omega,
+                            ir->efep != efepNO, lambda, lagr, invdt, v, bCalcVir, shaket->vir_r_m_dr,
+                            econq);
+
+#ifdef DEBUGSHAKE
+        check_cons(log, nb*blen, x_s, prime, v, idef->iparams, iatoms, invmass, econq);
+#endif
+
+        if (n0 == 0)
+        {
+            shaket->error_block  = b;
+            shaket->error_nblock = nb;
+
+            return;
+        }
+        shaket->tnit += n0*nb*blen;
+        shaket->trij += nb*blen;
+    }
+}
+
 gmx_bool bshakef(FILE *log, gmx_shakedata_t shaked,
                  real invmass[], int nblocks, int sblock[],
                  t_idef *idef, t_inputrec *ir, rvec x_s[], rvec prime[],
@@ -396,10 +758,10 @@ gmx_bool bshakef(FILE *log, gmx_shakedata_t shaked,
                  real invdt, rvec *v, gmx_bool bCalcVir, tensor vir_r_m_dr,
                  gmx_bool bDumpOnError, int econq)
 {
-    t_iatom *iatoms;
     real     dt_2, dvdl;
-    int      i, n0, ncon, blen, type, ll;
+    int      nth, th, ncon, type, ll;
     int      tnit = 0, trij = 0;
+    gmx_bool bOK;
 
 #ifdef DEBUG
     fprintf(log, "nblocks=%d, sblock[0]=%d\n", nblocks, sblock[0]);
@@ -412,36 +774,66 @@ gmx_bool bshakef(FILE *log, gmx_shakedata_t shaked,
         scaled_lagrange_multiplier[ll] = 0;
     }
 
-    iatoms = &(idef->il[F_CONSTR].iatoms[sblock[0]]);
-    for (i = 0; (i < nblocks); )
+    nth = gmx_omp_nthreads_get(emntLINCS);
+    if (nth > shaked->nthread)
     {
-        blen  = (sblock[i+1]-sblock[i]);
-        blen /= 3;
-        n0    = vec_shakef(log, shaked, invmass, blen, idef->iparams,
-                           iatoms, ir->shake_tol, x_s, prime, shaked->omega,
-                           ir->efep != efepNO, lambda, scaled_lagrange_multiplier, invdt, v, bCalcVir, vir_r_m_dr,
-                           econq);
+        srenew(shaked->th, nth);
+        for (th = shaked->nthread; th < nth; th++)
+        {
+            shake_thread_t *shaket = &shaked->th[th];
 
-#ifdef DEBUGSHAKE
-        check_cons(log, blen, x_s, prime, v, idef->iparams, iatoms, invmass, econq);
-#endif
+            shaket->rij                         = NULL;
+            shaket->half_of_reduced_mass        = NULL;
+            shaket->distance_squared_tolerance  = NULL;
+            shaket->constraint_distance_squared = NULL;
+            shaket->nalloc                      = 0;
+        }
+    }
+    shaked->nthread = nth;
+    divide_shake_blocks(shaked, nblocks, sblock);
 
-        if (n0 == 0)
+#pragma omp parallel for num_threads(nth) schedule(static)
+    for (th = 0; th < nth; th++)
+    {
+        try
         {
-            if (bDumpOnError && log)
+            shake_thread_blocks(log, shaked, &shaked->th[th], invmass, sblock,
+                                idef, ir, x_s, prime,
+                                scaled_lagrange_multiplier, lambda,
+                                invdt, v, bCalcVir, econq);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+    }
+
+    bOK = TRUE;
+    for (th = 0; th < nth; th++)
+    {
+        const shake_thread_t *shaket = &shaked->th[th];
+
+        if (shaket->error_block >= 0)
+        {
+            if (bOK && bDumpOnError && log)
             {
-                {
-                    check_cons(log, blen, x_s, prime, v, idef->iparams, iatoms, invmass, econq);
-                }
+                int b = shaket->error_block;
+
+                check_cons(log, (sblock[b + shaket->error_nblock] - sblock[b])/3,
+                           x_s, prime, v, idef->iparams,
+                           &(idef->il[F_CONSTR].iatoms[sblock[b]]), invmass, econq);
             }
-            return FALSE;
+            bOK = FALSE;
+        }
+        tnit += shaket->tnit;
+        trij += shaket->trij;
+        if (bCalcVir)
+        {
+            m_add(vir_r_m_dr, shaket->vir_r_m_dr, vir_r_m_dr);
         }
-        tnit                       += n0*blen;
-        trij                       += blen;
-        iatoms                     += 3*blen; /* Increment pointer! */
-        scaled_lagrange_multiplier += blen;
-        i++;
     }
+    if (!bOK)
+    {
+        return FALSE;
+    }
+
     /* only for position part? */
     if (econq == econqCoord)
     {
@@ -467,15 +859,23 @@ gmx_bool bshakef(FILE *log, gmx_shakedata_t shaked,
         }
     }
 #ifdef DEBUG
-    fprintf(log, "tnit: %5d  omega: %10.5f\n", tnit, omega);
+    fprintf(log, "tnit: %5d  omega: %10.5f\n", tnit, shaked->omega);
 #endif
-    if (ir->bShakeSOR)
+    /* Tune omega on the iteration count of the coordinate constraining only,
+     * the velocity constraining converges differently.
+     */
+    if (ir->bShakeSOR && econq == econqCoord)
     {
         if (tnit > shaked->gamma)
         {
             shaked->delta *= -0.5;
         }
         shaked->omega += shaked->delta;
+        if (shaked->omega < shake_sor_omega_min || shaked->omega > shake_sor_omega_max)
+        {
+            shaked->omega  = std::min(std::max(shaked->omega, shake_sor_omega_min), shake_sor_omega_max);
+            shaked->delta *= -0.5;
+        }
         shaked->gamma  = tnit;
     }
     inc_nrnb(nrnb, eNR_SHAKE, tnit);
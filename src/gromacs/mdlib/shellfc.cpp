@@ -78,26 +78,40 @@ typedef struct {
     rvec    step;
 } t_shell;
 
+/* The order k of the always stable predictor-corrector (ASPC) of Kolafa,
+ * J. Comput. Chem. 25, 335 (2004), used for predicting the shell positions.
+ * The prediction uses the shell positions of the last k+2 steps.
+ */
+static const int aspc_order = 3;
+static const int aspc_nstep = aspc_order + 2;
+
 struct gmx_shellfc_t {
-    int         nshell_gl;      /* The number of shells in the system       */
-    t_shell    *shell_gl;       /* All the shells (for DD only)             */
-    int        *shell_index_gl; /* Global shell index (for DD only)         */
-    gmx_bool    bInterCG;       /* Are there inter charge-group shells?     */
-    int         nshell;         /* The number of local shells               */
-    t_shell    *shell;          /* The local shells                         */
-    int         shell_nalloc;   /* The allocation size of shell             */
-    gmx_bool    bPredict;       /* Predict shell positions                  */
-    gmx_bool    bRequireInit;   /* Require initialization of shell positions  */
-    int         nflexcon;       /* The number of flexible constraints       */
-    rvec       *x[2];           /* Array for iterative minimization         */
-    rvec       *f[2];           /* Array for iterative minimization         */
-    int         x_nalloc;       /* The allocation size of x and f           */
-    rvec       *acc_dir;        /* Acceleration direction for flexcon       */
-    rvec       *x_old;          /* Old coordinates for flexcon              */
-    int         flex_nalloc;    /* The allocation size of acc_dir and x_old */
-    rvec       *adir_xnold;     /* Work space for init_adir                 */
-    rvec       *adir_xnew;      /* Work space for init_adir                 */
-    int         adir_nalloc;    /* Work space for init_adir                 */
+    int         nshell_gl;          /* The number of shells in the system       */
+    t_shell    *shell_gl;           /* All the shells (for DD only)             */
+    int        *shell_index_gl;     /* Global shell index (for DD only)         */
+    gmx_bool    bInterCG;           /* Are there inter charge-group shells?     */
+    int         nshell;             /* The number of local shells               */
+    t_shell    *shell;              /* The local shells                         */
+    int         shell_nalloc;       /* The allocation size of shell             */
+    gmx_bool    bPredict;           /* Predict shell positions                  */
+    gmx_bool    bRequireInit;       /* Require initialization of shell positions  */
+    int         nflexcon;           /* The number of flexible constraints       */
+    rvec       *x[2];               /* Array for iterative minimization         */
+    rvec       *f[2];               /* Array for iterative minimization         */
+    int         x_nalloc;           /* The allocation size of x and f           */
+    rvec       *acc_dir;            /* Acceleration direction for flexcon       */
+    rvec       *x_old;              /* Old coordinates for flexcon              */
+    int         flex_nalloc;        /* The allocation size of acc_dir and x_old */
+    rvec       *adir_xnold;         /* Work space for init_adir                 */
+    rvec       *adir_xnew;          /* Work space for init_adir                 */
+    int         adir_nalloc;        /* Work space for init_adir                 */
+    gmx_bool    bASPC;              /* Predict shells with ASPC when possible   */
+    real        aspc_B[aspc_nstep]; /* The ASPC predictor coefficients          */
+    real        aspc_omega;         /* The ASPC corrector weight                */
+    rvec       *aspc_hist;          /* Ring buffer of shell-nucleus vectors     */
+    int         aspc_nhist;         /* The number of valid history steps        */
+    int         aspc_ihist;         /* Ring buffer index of the last step       */
+    int         aspc_nalloc;        /* The allocation size of aspc_hist         */
 };
 
 
@@ -237,6 +251,106 @@ static void predict_shells(FILE *fplog, rvec x[], rvec v[], real dt,
     }
 }
 
+/* Returns the binomial coefficient n over k */
+static double binomial(int n, int k)
+{
+    double b = 1;
+
+    for (int i = 1; i <= k; i++)
+    {
+        b = b*(n - k + i)/i;
+    }
+
+    return b;
+}
+
+/* Set the ASPC predictor coefficients B_j and corrector weight omega */
+static void init_aspc(gmx_shellfc_t *shfc)
+{
+    const int k = aspc_order;
+
+    for (int j = 1; j <= k + 2; j++)
+    {
+        shfc->aspc_B[j - 1] = (j % 2 == 1 ? 1 : -1)*j*
+            binomial(2*k + 4, k + 2 - j)/binomial(2*k + 2, k + 1);
+    }
+    shfc->aspc_omega  = (k + 2)/(2.0*k + 3);
+    shfc->aspc_hist   = NULL;
+    shfc->aspc_nhist  = 0;
+    shfc->aspc_ihist  = 0;
+    shfc->aspc_nalloc = 0;
+}
+
+/* The vector from the first nucleus to the shell */
+static void shell_nucleus_vector(const t_pbc *pbc, rvec x[], const t_shell *s,
+                                 rvec dx)
+{
+    if (pbc)
+    {
+        pbc_dx_aiuc(pbc, x[s->shell], x[s->nucl1], dx);
+    }
+    else
+    {
+        rvec_sub(x[s->shell], x[s->nucl1], dx);
+    }
+}
+
+/* Predict the shell positions from the history of shell-nucleus vectors */
+static void predict_shells_aspc(const gmx_shellfc_t *shfc, rvec x[])
+{
+    int ns = shfc->nshell;
+
+    for (int i = 0; i < ns; i++)
+    {
+        const t_shell *s = &shfc->shell[i];
+        rvec           dx;
+
+        clear_rvec(dx);
+        for (int j = 0; j < aspc_nstep; j++)
+        {
+            int h = (shfc->aspc_ihist - j + aspc_nstep) % aspc_nstep;
+
+            /* x(t+dt) = sum_j B_j x(t-j*dt) */
+            for (int d = 0; d < DIM; d++)
+            {
+                dx[d] += shfc->aspc_B[j]*shfc->aspc_hist[h*ns + i][d];
+            }
+        }
+        rvec_add(x[s->nucl1], dx, x[s->shell]);
+    }
+}
+
+/* Store the corrected shell-nucleus vectors in the ASPC history.
+ * The corrector adds omega times a steepest descent step along
+ * the shell force f to the shell positions x.
+ */
+static void store_shells_aspc(gmx_shellfc_t *shfc, const t_pbc *pbc,
+                              rvec x[], rvec f[])
+{
+    int ns = shfc->nshell;
+
+    if (ns*aspc_nstep > shfc->aspc_nalloc)
+    {
+        shfc->aspc_nalloc = over_alloc_dd(ns*aspc_nstep);
+        srenew(shfc->aspc_hist, shfc->aspc_nalloc);
+        shfc->aspc_nhist  = 0;
+    }
+
+    shfc->aspc_ihist = (shfc->aspc_ihist + 1) % aspc_nstep;
+    for (int i = 0; i < ns; i++)
+    {
+        const t_shell *s  = &shfc->shell[i];
+        real          *dx = shfc->aspc_hist[shfc->aspc_ihist*ns + i];
+
+        shell_nucleus_vector(pbc, x, s, dx);
+        for (int d = 0; d < DIM; d++)
+        {
+            dx[d] += shfc->aspc_omega*s->k_1*f[s->shell][d];
+        }
+    }
+    shfc->aspc_nhist = std::min(shfc->aspc_nhist + 1, aspc_nstep);
+}
+
 gmx_shellfc_t *init_shell_flexcon(FILE *fplog,
                                   gmx_mtop_t *mtop, int nflexcon,
                                   rvec *x)
@@ -544,6 +658,20 @@ gmx_shellfc_t *init_shell_flexcon(FILE *fplog,
         }
     }
 
+    /* The ASPC predictor replaces the prediction from the nuclear
+     * velocities as soon as we have enough history.
+     */
+    shfc->bASPC = (shfc->bPredict && !shfc->bRequireInit &&
+                   getenv("GMX_NO_SHELL_ASPC") == NULL);
+    if (shfc->bASPC)
+    {
+        init_aspc(shfc);
+        if (fplog)
+        {
+            fprintf(fplog, "\nWill predict shell positions using the always stable predictor-corrector of order %d\n", aspc_order);
+        }
+    }
+
     return shfc;
 }
 
@@ -559,6 +687,9 @@ void make_local_shells(t_commrec *cr, t_mdatoms *md,
         dd = cr->dd;
         a0 = 0;
         a1 = dd->nat_home;
+
+        /* The local shell order changes, so we lose the ASPC history */
+        shfc->aspc_nhist = 0;
     }
     else
     {
@@ -955,6 +1086,7 @@ int relax_shell_flexcon(FILE *fplog, t_commrec *cr, gmx_bool bVerbose,
     int        nat, dd_ac0, dd_ac1 = 0, i;
     int        start = 0, homenr = md->homenr, end = start+homenr, cg0, cg1;
     int        nflexcon, number_steps, d, Min = 0, count = 0;
+    t_pbc      pbc, *pbc_null = NULL;
 #define  Try (1-Min)             /* At start Try = 1 */
 
     bCont        = (mdstep == inputrec->init_step) && inputrec->bContinuation;
@@ -1047,11 +1179,31 @@ int relax_shell_flexcon(FILE *fplog, t_commrec *cr, gmx_bool bVerbose,
         }
     }
 
+    if (shfc->bASPC)
+    {
+        if (bInit)
+        {
+            shfc->aspc_nhist = 0;
+        }
+        if (inputrec->ePBC != epbcNONE)
+        {
+            set_pbc(&pbc, inputrec->ePBC, state->box);
+            pbc_null = &pbc;
+        }
+    }
+
     /* Do a prediction of the shell positions */
     if (shfc->bPredict && !bCont)
     {
-        predict_shells(fplog, state->x, state->v, inputrec->delta_t, nshell, shell,
-                       md->massT, NULL, bInit);
+        if (shfc->bASPC && shfc->aspc_nhist == aspc_nstep)
+        {
+            predict_shells_aspc(shfc, state->x);
+        }
+        else
+        {
+            predict_shells(fplog, state->x, state->v, inputrec->delta_t, nshell, shell,
+                           md->massT, NULL, bInit);
+        }
     }
 
     /* do_force expected the charge groups to be in the box */
@@ -1261,6 +1413,12 @@ int relax_shell_flexcon(FILE *fplog, t_commrec *cr, gmx_bool bVerbose,
                 gmx_step_str(mdstep, sbuf), number_steps, df[Min]);
     }
 
+    if (shfc->bASPC)
+    {
+        /* Store the corrected shell positions for the next prediction */
+        store_shells_aspc(shfc, pbc_null, pos[Min], force[Min]);
+    }
+
     /* Copy back the coordinates and the forces */
     memcpy(state->x, pos[Min], nat*sizeof(state->x[0]));
     memcpy(f, force[Min], nat*sizeof(f[0]));
@@ -45,6 +45,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
 #include <array>
 
 #include "gromacs/domdec/domdec.h"
@@ -60,6 +61,7 @@
 #include "gromacs/imd/imd.h"
 #include "gromacs/listed-forces/bonded.h"
 #include "gromacs/listed-forces/disre.h"
+#include "gromacs/listed-forces/listed-forces.h"
 #include "gromacs/listed-forces/orires.h"
 #include "gromacs/math/functions.h"
 #include "gromacs/math/units.h"
@@ -79,6 +81,7 @@
 #include "gromacs/mdlib/nbnxn_search.h"
 #include "gromacs/mdlib/qmmm.h"
 #include "gromacs/mdlib/update.h"
+#include "gromacs/mdlib/nbnxn_kernels/nbnxn_kernel_common.h"
 #include "gromacs/mdlib/nbnxn_kernels/nbnxn_kernel_gpu_ref.h"
 #include "gromacs/mdlib/nbnxn_kernels/nbnxn_kernel_ref.h"
 #include "gromacs/mdlib/nbnxn_kernels/simd_2xnn/nbnxn_kernel_simd_2xnn.h"
@@ -466,6 +469,67 @@ static void post_process_forces(t_commrec *cr,
     }
 }
 
+/* Increments the nrnb flop counters for the non-bonded work of nbvg */
+static void nb_verlet_inc_nrnb(t_forcerec *fr,
+                               interaction_const_t *ic,
+                               nonbonded_verlet_group_t *nbvg,
+                               int flags,
+                               t_nrnb *nrnb)
+{
+    int      enr_nbnxn_kernel_ljc, enr_nbnxn_kernel_lj;
+    gmx_bool bUsingGpuKernels;
+
+    bUsingGpuKernels = (nbvg->kernel_type == nbnxnk8x8x8_GPU);
+
+    if (EEL_RF(ic->eeltype) || ic->eeltype == eelCUT)
+    {
+        enr_nbnxn_kernel_ljc = eNR_NBNXN_LJ_RF;
+    }
+    else if ((!bUsingGpuKernels && nbvg->ewald_excl == ewaldexclAnalytical) ||
+             (bUsingGpuKernels && nbnxn_gpu_is_kernel_ewald_analytical(fr->nbv->gpu_nbv)))
+    {
+        enr_nbnxn_kernel_ljc = eNR_NBNXN_LJ_EWALD;
+    }
+    else
+    {
+        enr_nbnxn_kernel_ljc = eNR_NBNXN_LJ_TAB;
+    }
+    enr_nbnxn_kernel_lj = eNR_NBNXN_LJ;
+    if (flags & GMX_FORCE_ENERGY)
+    {
+        /* In eNR_??? the nbnxn F+E kernels are always the F kernel + 1 */
+        enr_nbnxn_kernel_ljc += 1;
+        enr_nbnxn_kernel_lj  += 1;
+    }
+
+    inc_nrnb(nrnb, enr_nbnxn_kernel_ljc,
+             nbvg->nbl_lists.natpair_ljq);
+    inc_nrnb(nrnb, enr_nbnxn_kernel_lj,
+             nbvg->nbl_lists.natpair_lj);
+    /* The Coulomb-only kernels are offset -eNR_NBNXN_LJ_RF+eNR_NBNXN_RF */
+    inc_nrnb(nrnb, enr_nbnxn_kernel_ljc-eNR_NBNXN_LJ_RF+eNR_NBNXN_RF,
+             nbvg->nbl_lists.natpair_q);
+
+    if (ic->vdw_modifier == eintmodFORCESWITCH)
+    {
+        /* We add up the switch cost separately */
+        inc_nrnb(nrnb, eNR_NBNXN_ADD_LJ_FSW+((flags & GMX_FORCE_ENERGY) ? 1 : 0),
+                 nbvg->nbl_lists.natpair_ljq + nbvg->nbl_lists.natpair_lj);
+    }
+    if (ic->vdw_modifier == eintmodPOTSWITCH)
+    {
+        /* We add up the switch cost separately */
+        inc_nrnb(nrnb, eNR_NBNXN_ADD_LJ_PSW+((flags & GMX_FORCE_ENERGY) ? 1 : 0),
+                 nbvg->nbl_lists.natpair_ljq + nbvg->nbl_lists.natpair_lj);
+    }
+    if (ic->vdwtype == evdwPME)
+    {
+        /* We add up the LJ Ewald cost separately */
+        inc_nrnb(nrnb, eNR_NBNXN_ADD_LJ_EWALD+((flags & GMX_FORCE_ENERGY) ? 1 : 0),
+                 nbvg->nbl_lists.natpair_ljq + nbvg->nbl_lists.natpair_lj);
+    }
+}
+
 static void do_nb_verlet(t_forcerec *fr,
                          interaction_const_t *ic,
                          gmx_enerdata_t *enerd,
@@ -474,7 +538,6 @@ static void do_nb_verlet(t_forcerec *fr,
                          t_nrnb *nrnb,
                          gmx_wallcycle_t wcycle)
 {
-    int                        enr_nbnxn_kernel_ljc, enr_nbnxn_kernel_lj;
     nonbonded_verlet_group_t  *nbvg;
     gmx_bool                   bUsingGpuKernels;
 
@@ -567,53 +630,141 @@ static void do_nb_verlet(t_forcerec *fr,
         wallcycle_sub_stop(wcycle, ewcsNONBONDED);
     }
 
-    if (EEL_RF(ic->eeltype) || ic->eeltype == eelCUT)
-    {
-        enr_nbnxn_kernel_ljc = eNR_NBNXN_LJ_RF;
-    }
-    else if ((!bUsingGpuKernels && nbvg->ewald_excl == ewaldexclAnalytical) ||
-             (bUsingGpuKernels && nbnxn_gpu_is_kernel_ewald_analytical(fr->nbv->gpu_nbv)))
+    nb_verlet_inc_nrnb(fr, ic, nbvg, flags, nrnb);
+}
+
+/* Runs the CPU non-bonded kernel for pair list nb of nbvg */
+static void nbnxn_kernel_cpu_list(t_forcerec *fr,
+                                  interaction_const_t *ic,
+                                  nonbonded_verlet_group_t *nbvg,
+                                  int nb, int flags, int clearF)
+{
+    switch (nbvg->kernel_type)
     {
-        enr_nbnxn_kernel_ljc = eNR_NBNXN_LJ_EWALD;
+        case nbnxnk4x4_PlainC:
+            nbnxn_kernel_ref_list(&nbvg->nbl_lists, nb,
+                                  nbvg->nbat, ic,
+                                  fr->shift_vec,
+                                  flags,
+                                  clearF,
+                                  fr->fshift[0]);
+            break;
+        case nbnxnk4xN_SIMD_4xN:
+            nbnxn_kernel_simd_4xn_list(&nbvg->nbl_lists, nb,
+                                       nbvg->nbat, ic,
+                                       nbvg->ewald_excl,
+                                       fr->shift_vec,
+                                       flags,
+                                       clearF,
+                                       fr->fshift[0]);
+            break;
+        case nbnxnk4xN_SIMD_2xNN:
+            nbnxn_kernel_simd_2xnn_list(&nbvg->nbl_lists, nb,
+                                        nbvg->nbat, ic,
+                                        nbvg->ewald_excl,
+                                        fr->shift_vec,
+                                        flags,
+                                        clearF,
+                                        fr->fshift[0]);
+            break;
+        default:
+            gmx_incons("Invalid CPU nonbonded kernel type passed!");
     }
-    else
+}
+
+/* Computes the local CPU non-bonded forces and the listed forces.
+ *
+ * The two are independent: both only read the coordinates and write
+ * to separate output buffers. Instead of running them in two OpenMP
+ * regions, each thread runs its non-bonded pair list and then its part
+ * of the listed interactions, so threads that are done with their
+ * non-bonded work continue with listed work instead of waiting at
+ * a barrier. The non-bonded and listed outputs are reduced afterwards.
+ */
+static void do_nb_verlet_listed(t_forcerec *fr,
+                                interaction_const_t *ic,
+                                t_commrec *cr,
+                                t_idef *idef,
+                                rvec x[], history_t *hist,
+                                rvec f[], matrix box,
+                                t_mdatoms *mdatoms,
+                                gmx_enerdata_t *enerd, t_fcdata *fcd,
+                                real *lambda,
+                                int flags,
+                                t_nrnb *nrnb,
+                                gmx_wallcycle_t wcycle)
+{
+    nonbonded_verlet_group_t *nbvg;
+    int                       nnbl, nthreads_listed, nthreads, i;
+    t_pbc                     pbc, pbc_full;
+    real                      dvdl[efptNR];
+
+    nbvg = &fr->nbv->grp[eintLocal];
+
+    if (fr->bMolPBC)
     {
-        enr_nbnxn_kernel_ljc = eNR_NBNXN_LJ_TAB;
+        /* Since all atoms are in the rectangular or triclinic unit-cell,
+         * only single box vector shifts (2 in x) are required.
+         */
+        set_pbc_dd(&pbc, fr->ePBC, DOMAINDECOMP(cr) ? cr->dd->nc : nullptr,
+                   TRUE, box);
     }
-    enr_nbnxn_kernel_lj = eNR_NBNXN_LJ;
-    if (flags & GMX_FORCE_ENERGY)
+    if ((idef->il[F_POSRES].nr > 0) ||
+        (idef->il[F_FBPOSRES].nr > 0))
     {
-        /* In eNR_??? the nbnxn F+E kernels are always the F kernel + 1 */
-        enr_nbnxn_kernel_ljc += 1;
-        enr_nbnxn_kernel_lj  += 1;
+        /* Not enough flops to bother counting */
+        set_pbc(&pbc_full, fr->ePBC, box);
     }
 
-    inc_nrnb(nrnb, enr_nbnxn_kernel_ljc,
-             nbvg->nbl_lists.natpair_ljq);
-    inc_nrnb(nrnb, enr_nbnxn_kernel_lj,
-             nbvg->nbl_lists.natpair_lj);
-    /* The Coulomb-only kernels are offset -eNR_NBNXN_LJ_RF+eNR_NBNXN_RF */
-    inc_nrnb(nrnb, enr_nbnxn_kernel_ljc-eNR_NBNXN_LJ_RF+eNR_NBNXN_RF,
-             nbvg->nbl_lists.natpair_q);
+    /* The restraints can require communication, so do them first */
+    calc_listed_restraints(cr->ms, wcycle, idef, (const rvec *) x, hist,
+                           fr, &pbc, &pbc_full,
+                           enerd, nrnb, lambda, mdatoms, fcd);
 
-    if (ic->vdw_modifier == eintmodFORCESWITCH)
+    for (i = 0; i < efptNR; i++)
     {
-        /* We add up the switch cost separately */
-        inc_nrnb(nrnb, eNR_NBNXN_ADD_LJ_FSW+((flags & GMX_FORCE_ENERGY) ? 1 : 0),
-                 nbvg->nbl_lists.natpair_ljq + nbvg->nbl_lists.natpair_lj);
+        dvdl[i] = 0;
     }
-    if (ic->vdw_modifier == eintmodPOTSWITCH)
+
+    nnbl            = nbvg->nbl_lists.nnbl;
+    nthreads_listed = idef->nthreads;
+    nthreads        = std::max(nnbl, nthreads_listed);
+
+    /* Here we can not split the non-bonded and listed cycle sub-counts */
+    wallcycle_sub_start(wcycle, ewcsNONBONDED);
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+    for (int th = 0; th < nthreads; th++)
     {
-        /* We add up the switch cost separately */
-        inc_nrnb(nrnb, eNR_NBNXN_ADD_LJ_PSW+((flags & GMX_FORCE_ENERGY) ? 1 : 0),
-                 nbvg->nbl_lists.natpair_ljq + nbvg->nbl_lists.natpair_lj);
+        try
+        {
+            if (th < nnbl)
+            {
+                nbnxn_kernel_cpu_list(fr, ic, nbvg, th, flags, enbvClearFYes);
+            }
+            if (th < nthreads_listed)
+            {
+                calc_listed_thread(th, idef, (const rvec *) x, f, fr, &pbc,
+                                   NULL, enerd, nrnb, lambda, dvdl,
+                                   mdatoms, fcd,
+                                   DOMAINDECOMP(cr) ? cr->dd->gatindex : NULL,
+                                   flags);
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
     }
-    if (ic->vdwtype == evdwPME)
+    wallcycle_sub_stop(wcycle, ewcsNONBONDED);
+
+    if (flags & GMX_FORCE_ENERGY)
     {
-        /* We add up the LJ Ewald cost separately */
-        inc_nrnb(nrnb, eNR_NBNXN_ADD_LJ_EWALD+((flags & GMX_FORCE_ENERGY) ? 1 : 0),
-                 nbvg->nbl_lists.natpair_ljq + nbvg->nbl_lists.natpair_lj);
+        reduce_energies_over_lists(nbvg->nbat, nnbl,
+                                   fr->bBHAM ?
+                                   enerd->grpp.ener[egBHAMSR] :
+                                   enerd->grpp.ener[egLJSR],
+                                   enerd->grpp.ener[egCOULSR]);
     }
+    nb_verlet_inc_nrnb(fr, ic, nbvg, flags, nrnb);
+
+    reduce_listed_thread_output(wcycle, f, fr, enerd, dvdl, fcd, flags);
 }
 
 static void do_nb_verlet_fep(nbnxn_pairlist_set_t *nbl_lists,
@@ -756,6 +907,7 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
     gmx_bool            bStateChanged, bNS, bFillGrid, bCalcCGCM;
     gmx_bool            bDoForces, bUseGPU, bUseOrEmulGPU;
     gmx_bool            bDiffKernels = FALSE;
+    gmx_bool            bListedWithNonbonded;
     rvec                vzero, box_diag;
     float               cycles_pme, cycles_force, cycles_wait_gpu;
     /* TODO To avoid loss of precision, float can't be used for a
@@ -1183,7 +1335,26 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
      * decomposition load balancing.
      */
 
-    if (!bUseOrEmulGPU)
+    /* With CPU non-bonded kernels we run the listed forces in the same
+     * OpenMP region as the local non-bonded forces, so imbalance in one
+     * can be filled with work of the other. Free-energy, molecular graphs
+     * and QM/MM need the ordering of do_force_lowlevel.
+     */
+    bListedWithNonbonded = (!bUseOrEmulGPU &&
+                            (flags & GMX_FORCE_NONBONDED) &&
+                            (flags & GMX_FORCE_LISTED) &&
+                            fr->efep == efepNO &&
+                            graph == NULL &&
+                            !fr->bQMMM &&
+                            !inputrec->implicit_solvent);
+
+    if (bListedWithNonbonded)
+    {
+        do_nb_verlet_listed(fr, ic, cr, &(top->idef), x, hist, f, box,
+                            mdatoms, enerd, fcd, lambda, flags,
+                            nrnb, wcycle);
+    }
+    else if (!bUseOrEmulGPU)
     {
         /* Maybe we should move this into do_force_lowlevel */
         do_nb_verlet(fr, ic, enerd, flags, eintLocal, enbvClearFYes,
@@ -1268,7 +1439,8 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
                       x, hist, f, enerd, fcd, top, fr->born,
                       bBornRadii, box,
                       inputrec->fepvals, lambda, graph, &(top->excls), fr->mu_tot,
-                      flags, &cycles_pme);
+                      bListedWithNonbonded ? (flags & ~GMX_FORCE_LISTED) : flags,
+                      &cycles_pme);
 
     cycles_force += wallcycle_stop(wcycle, ewcFORCE);
 
@@ -1438,7 +1610,10 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
         if (vsite && !(fr->bF_NoVirSum && !(flags & GMX_FORCE_VIRIAL)))
         {
             wallcycle_start(wcycle, ewcVSITESPREAD);
-            spread_vsite_f(vsite, x, f, fr->fshift, FALSE, NULL, nrnb,
+            /* The shift forces are only used for the virial */
+            spread_vsite_f(vsite, x, f,
+                           (flags & GMX_FORCE_VIRIAL) ? fr->fshift : NULL,
+                           FALSE, NULL, nrnb,
                            &top->idef, fr->ePBC, fr->bMolPBC, graph, box, cr);
             wallcycle_stop(wcycle, ewcVSITESPREAD);
         }
@@ -1825,7 +2000,10 @@ void do_force_cutsGROUP(FILE *fplog, t_commrec *cr,
         if (vsite && !(fr->bF_NoVirSum && !(flags & GMX_FORCE_VIRIAL)))
         {
             wallcycle_start(wcycle, ewcVSITESPREAD);
-            spread_vsite_f(vsite, x, f, fr->fshift, FALSE, NULL, nrnb,
+            /* The shift forces are only used for the virial */
+            spread_vsite_f(vsite, x, f,
+                           (flags & GMX_FORCE_VIRIAL) ? fr->fshift : NULL,
+                           FALSE, NULL, nrnb,
                            &top->idef, fr->ePBC, fr->bMolPBC, graph, box, cr);
             wallcycle_stop(wcycle, ewcVSITESPREAD);
         }
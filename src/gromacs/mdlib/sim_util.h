@@ -94,6 +94,26 @@ void global_stat(FILE *log, gmx_global_stat_t gs,
                  gmx_bool bSumEkinhOld, int flags);
 /* Communicate statistics over cr->mpi_comm_mysim */
 
+void global_stat_start(FILE *log, gmx_global_stat_t gs,
+                       t_commrec *cr, gmx_enerdata_t *enerd,
+                       tensor fvir, tensor svir, rvec mu_tot,
+                       t_inputrec *inputrec,
+                       gmx_ekindata_t *ekind,
+                       gmx_constr *constr, t_vcm *vcm,
+                       int nsig, real *sig,
+                       gmx_mtop_t *top_global, t_state *state_local,
+                       gmx_bool bSumEkinhOld, int flags);
+/* Start communicating statistics as global_stat, but only pack
+ * the data and start the, possibly nonblocking, global sum.
+ * None of the passed quantities can be accessed until the data
+ * has been extracted with global_stat_finish.
+ */
+
+void global_stat_finish(gmx_global_stat_t gs);
+/* Complete the global sum started with global_stat_start and
+ * extract the summed data into the quantities passed there.
+ */
+
 int do_per_step(gmx_int64_t step, gmx_int64_t nstep);
 /* Return TRUE if io should be done */
 
@@ -60,13 +60,41 @@
 #include "gromacs/mdtypes/md_enums.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxassert.h"
 #include "gromacs/utility/smalloc.h"
 
 typedef struct gmx_global_stat
 {
-    t_bin *rb;
-    int   *itc0;
-    int   *itc1;
+    t_bin          *rb;
+    int            *itc0;
+    int            *itc1;
+    /* The state of a global sum started with global_stat_start */
+    gmx_bool        bPending;    /* Is there a nonblocking sum in flight? */
+    MPI_Request     request;     /* The request for the nonblocking sum */
+    FILE           *fplog;
+    t_commrec      *cr;
+    gmx_enerdata_t *enerd;
+    real           *fvir;
+    real           *svir;
+    real           *mu_tot;
+    t_inputrec     *inputrec;
+    gmx_ekindata_t *ekind;
+    gmx_constr_t    constr;
+    t_vcm          *vcm;
+    int             nsig;
+    real           *sig;
+    gmx_mtop_t     *top_global;
+    t_state        *state_local;
+    gmx_bool        bSumEkinhOld;
+    int             flags;
+    /* The buffer indices of the summed quantities */
+    int             ie, ifv, isv, irmsd, imu;
+    int             idedl, idvdll, idvdlnl, iepl, icm, imass, ica, inb;
+    int             isig, icj, ici, icx;
+    int             inn[egNR];
+    int             nener;
+    real            copyenerd[F_NRE];
+    real           *rmsd_data;
 } t_gmx_global_stat;
 
 gmx_global_stat_t global_stat_init(t_inputrec *ir)
@@ -136,30 +164,25 @@ static int filter_enerdterm(real *afrom, gmx_bool bToBuffer, real *ato,
     return to;
 }
 
-void global_stat(FILE *fplog, gmx_global_stat_t gs,
-                 t_commrec *cr, gmx_enerdata_t *enerd,
-                 tensor fvir, tensor svir, rvec mu_tot,
-                 t_inputrec *inputrec,
-                 gmx_ekindata_t *ekind, gmx_constr_t constr,
-                 t_vcm *vcm,
-                 int nsig, real *sig,
-                 gmx_mtop_t *top_global, t_state *state_local,
-                 gmx_bool bSumEkinhOld, int flags)
+void global_stat_start(FILE *fplog, gmx_global_stat_t gs,
+                       t_commrec *cr, gmx_enerdata_t *enerd,
+                       tensor fvir, tensor svir, rvec mu_tot,
+                       t_inputrec *inputrec,
+                       gmx_ekindata_t *ekind, gmx_constr_t constr,
+                       t_vcm *vcm,
+                       int nsig, real *sig,
+                       gmx_mtop_t *top_global, t_state *state_local,
+                       gmx_bool bSumEkinhOld, int flags)
 /* instead of current system, gmx_booleans for summing virial, kinetic energy, and other terms */
 {
     t_bin     *rb;
     int       *itc0, *itc1;
-    int        ie    = 0, ifv = 0, isv = 0, irmsd = 0, imu = 0;
-    int        idedl = 0, idvdll = 0, idvdlnl = 0, iepl = 0, icm = 0, imass = 0, ica = 0, inb = 0;
-    int        isig  = -1;
-    int        icj   = -1, ici = -1, icx = -1;
-    int        inn[egNR];
-    real       copyenerd[F_NRE];
-    int        nener, j;
-    real      *rmsd_data = NULL;
+    int        j;
     double     nb;
     gmx_bool   bVV, bTemp, bEner, bPres, bConstrVir, bEkinAveVel, bReadEkin;
 
+    GMX_RELEASE_ASSERT(!gs->bPending, "global_stat_start called with a global sum in flight");
+
     bVV           = EI_VV(inputrec->eI);
     bTemp         = flags & CGLO_TEMPERATURE;
     bEner         = flags & CGLO_ENERGY;
@@ -172,6 +195,28 @@ void global_stat(FILE *fplog, gmx_global_stat_t gs,
     itc0 = gs->itc0;
     itc1 = gs->itc1;
 
+    /* Store the arguments for extracting the data in global_stat_finish */
+    gs->fplog        = fplog;
+    gs->cr           = cr;
+    gs->enerd        = enerd;
+    gs->fvir         = fvir[0];
+    gs->svir         = svir[0];
+    gs->mu_tot       = mu_tot;
+    gs->inputrec     = inputrec;
+    gs->ekind        = ekind;
+    gs->constr       = constr;
+    gs->vcm          = vcm;
+    gs->nsig         = nsig;
+    gs->sig          = sig;
+    gs->top_global   = top_global;
+    gs->state_local  = state_local;
+    gs->bSumEkinhOld = bSumEkinhOld;
+    gs->flags        = flags;
+    gs->rmsd_data    = NULL;
+    gs->isig         = -1;
+    gs->icj          = -1;
+    gs->ici          = -1;
+    gs->icx          = -1;
 
     reset_bin(rb);
     /* This routine copies all the data to be summed to one big buffer
@@ -183,13 +228,13 @@ void global_stat(FILE *fplog, gmx_global_stat_t gs,
        communicated and summed when they need to be, to avoid repeating
        the sums and overcounting. */
 
-    nener = filter_enerdterm(enerd->term, TRUE, copyenerd, bTemp, bPres, bEner);
+    gs->nener = filter_enerdterm(enerd->term, TRUE, gs->copyenerd, bTemp, bPres, bEner);
 
     /* First, the data that needs to be communicated with velocity verlet every time
        This is just the constraint virial.*/
     if (bConstrVir)
     {
-        isv = add_binr(rb, DIM*DIM, svir[0]);
+        gs->isv = add_binr(rb, DIM*DIM, svir[0]);
         where();
     }
 
@@ -215,9 +260,9 @@ void global_stat(FILE *fplog, gmx_global_stat_t gs,
             }
             /* these probably need to be put into one of these categories */
             where();
-            idedl = add_binr(rb, 1, &(ekind->dekindl));
+            gs->idedl = add_binr(rb, 1, &(ekind->dekindl));
             where();
-            ica   = add_binr(rb, 1, &(ekind->cosacc.mvcos));
+            gs->ica   = add_binr(rb, 1, &(ekind->cosacc.mvcos));
             where();
         }
     }
@@ -225,71 +270,71 @@ void global_stat(FILE *fplog, gmx_global_stat_t gs,
 
     if (bPres || !bVV)
     {
-        ifv = add_binr(rb, DIM*DIM, fvir[0]);
+        gs->ifv = add_binr(rb, DIM*DIM, fvir[0]);
     }
 
 
     if (bEner)
     {
         where();
-        ie  = add_binr(rb, nener, copyenerd);
+        gs->ie  = add_binr(rb, gs->nener, gs->copyenerd);
         where();
         if (constr)
         {
-            rmsd_data = constr_rmsd_data(constr);
-            if (rmsd_data)
+            gs->rmsd_data = constr_rmsd_data(constr);
+            if (gs->rmsd_data)
             {
-                irmsd = add_binr(rb, inputrec->eI == eiSD2 ? 3 : 2, rmsd_data);
+                gs->irmsd = add_binr(rb, inputrec->eI == eiSD2 ? 3 : 2, gs->rmsd_data);
             }
         }
         if (!inputrecNeedMutot(inputrec))
         {
-            imu = add_binr(rb, DIM, mu_tot);
+            gs->imu = add_binr(rb, DIM, mu_tot);
             where();
         }
 
         for (j = 0; (j < egNR); j++)
         {
-            inn[j] = add_binr(rb, enerd->grpp.nener, enerd->grpp.ener[j]);
+            gs->inn[j] = add_binr(rb, enerd->grpp.nener, enerd->grpp.ener[j]);
         }
         where();
         if (inputrec->efep != efepNO)
         {
-            idvdll  = add_bind(rb, efptNR, enerd->dvdl_lin);
-            idvdlnl = add_bind(rb, efptNR, enerd->dvdl_nonlin);
+            gs->idvdll  = add_bind(rb, efptNR, enerd->dvdl_lin);
+            gs->idvdlnl = add_bind(rb, efptNR, enerd->dvdl_nonlin);
             if (enerd->n_lambda > 0)
             {
-                iepl = add_bind(rb, enerd->n_lambda, enerd->enerpart_lambda);
+                gs->iepl = add_bind(rb, enerd->n_lambda, enerd->enerpart_lambda);
             }
         }
     }
 
     if (vcm)
     {
-        icm   = add_binr(rb, DIM*vcm->nr, vcm->group_p[0]);
+        gs->icm   = add_binr(rb, DIM*vcm->nr, vcm->group_p[0]);
         where();
-        imass = add_binr(rb, vcm->nr, vcm->group_mass);
+        gs->imass = add_binr(rb, vcm->nr, vcm->group_mass);
         where();
         if (vcm->mode == ecmANGULAR)
         {
-            icj   = add_binr(rb, DIM*vcm->nr, vcm->group_j[0]);
+            gs->icj   = add_binr(rb, DIM*vcm->nr, vcm->group_j[0]);
             where();
-            icx   = add_binr(rb, DIM*vcm->nr, vcm->group_x[0]);
+            gs->icx   = add_binr(rb, DIM*vcm->nr, vcm->group_x[0]);
             where();
-            ici   = add_binr(rb, DIM*DIM*vcm->nr, vcm->group_i[0][0]);
+            gs->ici   = add_binr(rb, DIM*DIM*vcm->nr, vcm->group_i[0][0]);
             where();
         }
     }
 
     if (DOMAINDECOMP(cr))
     {
-        nb  = cr->dd->nbonded_local;
-        inb = add_bind(rb, 1, &nb);
+        nb      = cr->dd->nbonded_local;
+        gs->inb = add_bind(rb, 1, &nb);
     }
     where();
     if (nsig > 0)
     {
-        isig = add_binr(rb, nsig, sig);
+        gs->isig = add_binr(rb, nsig, sig);
     }
 
     /* Global sum it all */
@@ -297,14 +342,49 @@ void global_stat(FILE *fplog, gmx_global_stat_t gs,
     {
         fprintf(debug, "Summing %d energies\n", rb->maxreal);
     }
-    sum_bin(rb, cr);
+    gs->bPending = sum_bin_start(rb, cr, &gs->request);
     where();
+}
+
+void global_stat_finish(gmx_global_stat_t gs)
+{
+    t_bin          *rb;
+    int            *itc0, *itc1;
+    int             j;
+    double          nb;
+    t_inputrec     *inputrec;
+    gmx_ekindata_t *ekind;
+    gmx_enerdata_t *enerd;
+    t_vcm          *vcm;
+    gmx_bool        bVV, bTemp, bEner, bPres, bConstrVir, bEkinAveVel, bReadEkin;
+
+    if (gs->bPending)
+    {
+        gmx_sumd_finish(&gs->request);
+        gs->bPending = FALSE;
+    }
+
+    inputrec      = gs->inputrec;
+    ekind         = gs->ekind;
+    enerd         = gs->enerd;
+    vcm           = gs->vcm;
+    bVV           = EI_VV(inputrec->eI);
+    bTemp         = gs->flags & CGLO_TEMPERATURE;
+    bEner         = gs->flags & CGLO_ENERGY;
+    bPres         = (gs->flags & CGLO_PRESSURE);
+    bConstrVir    = (gs->flags & CGLO_CONSTRAINT);
+    bEkinAveVel   = (inputrec->eI == eiVV || (inputrec->eI == eiVVAK && bPres));
+    bReadEkin     = (gs->flags & CGLO_READEKIN);
+
+    rb   = gs->rb;
+    itc0 = gs->itc0;
+    itc1 = gs->itc1;
 
     /* Extract all the data locally */
 
     if (bConstrVir)
     {
-        extract_binr(rb, isv, DIM*DIM, svir[0]);
+        extract_binr(rb, gs->isv, DIM*DIM, gs->svir);
     }
 
     /* We need the force virial and the kinetic energy for the first time through with velocity verlet */
@@ -314,7 +394,7 @@ void global_stat(FILE *fplog, gmx_global_stat_t gs,
         {
             for (j = 0; (j < inputrec->opts.ngtc); j++)
             {
-                if (bSumEkinhOld)
+                if (gs->bSumEkinhOld)
                 {
                     extract_binr(rb, itc0[j], DIM*DIM, ekind->tcstat[j].ekinh_old[0]);
                 }
@@ -327,78 +407,94 @@ void global_stat(FILE *fplog, gmx_global_stat_t gs,
                     extract_binr(rb, itc1[j], DIM*DIM, ekind->tcstat[j].ekinh[0]);
                 }
             }
-            extract_binr(rb, idedl, 1, &(ekind->dekindl));
-            extract_binr(rb, ica, 1, &(ekind->cosacc.mvcos));
+            extract_binr(rb, gs->idedl, 1, &(ekind->dekindl));
+            extract_binr(rb, gs->ica, 1, &(ekind->cosacc.mvcos));
             where();
         }
     }
     if (bPres || !bVV)
     {
-        extract_binr(rb, ifv, DIM*DIM, fvir[0]);
+        extract_binr(rb, gs->ifv, DIM*DIM, gs->fvir);
     }
 
     if (bEner)
     {
-        extract_binr(rb, ie, nener, copyenerd);
-        if (rmsd_data)
+        extract_binr(rb, gs->ie, gs->nener, gs->copyenerd);
+        if (gs->rmsd_data)
         {
-            extract_binr(rb, irmsd, inputrec->eI == eiSD2 ? 3 : 2, rmsd_data);
+            extract_binr(rb, gs->irmsd, inputrec->eI == eiSD2 ? 3 : 2, gs->rmsd_data);
         }
         if (!inputrecNeedMutot(inputrec))
         {
-            extract_binr(rb, imu, DIM, mu_tot);
+            extract_binr(rb, gs->imu, DIM, gs->mu_tot);
         }
 
         for (j = 0; (j < egNR); j++)
         {
-            extract_binr(rb, inn[j], enerd->grpp.nener, enerd->grpp.ener[j]);
+            extract_binr(rb, gs->inn[j], enerd->grpp.nener, enerd->grpp.ener[j]);
         }
         if (inputrec->efep != efepNO)
         {
-            extract_bind(rb, idvdll, efptNR, enerd->dvdl_lin);
-            extract_bind(rb, idvdlnl, efptNR, enerd->dvdl_nonlin);
+            extract_bind(rb, gs->idvdll, efptNR, enerd->dvdl_lin);
+            extract_bind(rb, gs->idvdlnl, efptNR, enerd->dvdl_nonlin);
             if (enerd->n_lambda > 0)
             {
-                extract_bind(rb, iepl, enerd->n_lambda, enerd->enerpart_lambda);
+                extract_bind(rb, gs->iepl, enerd->n_lambda, enerd->enerpart_lambda);
             }
         }
-        if (DOMAINDECOMP(cr))
+        if (DOMAINDECOMP(gs->cr))
         {
-            extract_bind(rb, inb, 1, &nb);
-            if ((int)(nb + 0.5) != cr->dd->nbonded_global)
+            extract_bind(rb, gs->inb, 1, &nb);
+            if ((int)(nb + 0.5) != gs->cr->dd->nbonded_global)
             {
-                dd_print_missing_interactions(fplog, cr, (int)(nb + 0.5), top_global, state_local);
+                dd_print_missing_interactions(gs->fplog, gs->cr, (int)(nb + 0.5), gs->top_global, gs->state_local);
             }
         }
         where();
 
-        filter_enerdterm(copyenerd, FALSE, enerd->term, bTemp, bPres, bEner);
+        filter_enerdterm(gs->copyenerd, FALSE, enerd->term, bTemp, bPres, bEner);
     }
 
     if (vcm)
     {
-        extract_binr(rb, icm, DIM*vcm->nr, vcm->group_p[0]);
+        extract_binr(rb, gs->icm, DIM*vcm->nr, vcm->group_p[0]);
         where();
-        extract_binr(rb, imass, vcm->nr, vcm->group_mass);
+        extract_binr(rb, gs->imass, vcm->nr, vcm->group_mass);
         where();
         if (vcm->mode == ecmANGULAR)
         {
-            extract_binr(rb, icj, DIM*vcm->nr, vcm->group_j[0]);
+            extract_binr(rb, gs->icj, DIM*vcm->nr, vcm->group_j[0]);
             where();
-            extract_binr(rb, icx, DIM*vcm->nr, vcm->group_x[0]);
+            extract_binr(rb, gs->icx, DIM*vcm->nr, vcm->group_x[0]);
             where();
-            extract_binr(rb, ici, DIM*DIM*vcm->nr, vcm->group_i[0][0]);
+            extract_binr(rb, gs->ici, DIM*DIM*vcm->nr, vcm->group_i[0][0]);
             where();
         }
     }
 
-    if (nsig > 0)
+    if (gs->nsig > 0)
     {
-        extract_binr(rb, isig, nsig, sig);
+        extract_binr(rb, gs->isig, gs->nsig, gs->sig);
     }
     where();
 }
 
+void global_stat(FILE *fplog, gmx_global_stat_t gs,
+                 t_commrec *cr, gmx_enerdata_t *enerd,
+                 tensor fvir, tensor svir, rvec mu_tot,
+                 t_inputrec *inputrec,
+                 gmx_ekindata_t *ekind, gmx_constr_t constr,
+                 t_vcm *vcm,
+                 int nsig, real *sig,
+                 gmx_mtop_t *top_global, t_state *state_local,
+                 gmx_bool bSumEkinhOld, int flags)
+{
+    global_stat_start(fplog, gs, cr, enerd, fvir, svir, mu_tot,
+                      inputrec, ekind, constr, vcm, nsig, sig,
+                      top_global, state_local, bSumEkinhOld, flags);
+    global_stat_finish(gs);
+}
+
 int do_per_step(gmx_int64_t step, gmx_int64_t nstep)
 {
     if (nstep != 0)
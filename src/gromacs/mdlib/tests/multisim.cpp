@@ -0,0 +1,116 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2016, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief Tests for the file name handling of mdrun -multidir
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/commandline/filenm.h"
+#include "gromacs/fileio/filetypes.h"
+#include "gromacs/mdlib/main.h"
+#include "gromacs/utility/cstringutil.h"
+#include "gromacs/utility/path.h"
+#include "gromacs/utility/smalloc.h"
+
+namespace
+{
+
+//! Returns a file name option \p opt with the file names \p names
+t_filenm makeFileNameOption(int ftp, const char *opt, unsigned long flag,
+                            const std::vector<std::string> &names)
+{
+    t_filenm fnm;
+
+    fnm.ftp    = ftp;
+    fnm.opt    = opt;
+    fnm.fn     = NULL;
+    fnm.flag   = flag;
+    fnm.nfiles = names.size();
+    snew(fnm.fns, fnm.nfiles);
+    for (int i = 0; i < fnm.nfiles; i++)
+    {
+        fnm.fns[i] = gmx_strdup(names[i].c_str());
+    }
+
+    return fnm;
+}
+
+//! Frees the file names of \p fnm
+void freeFileNames(std::vector<t_filenm> *fnm)
+{
+    for (t_filenm &f : *fnm)
+    {
+        for (int i = 0; i < f.nfiles; i++)
+        {
+            sfree(f.fns[i]);
+        }
+        sfree(f.fns);
+    }
+}
+
+TEST(MultiSimTest, PrefixesRelativeFileNamesWithTheSimulationDirectory)
+{
+    const std::string     dir      = "sim1";
+    const std::string     absolute = "/tmp/traj.trr";
+    std::vector<t_filenm> fnm;
+
+    fnm.push_back(makeFileNameOption(efTPR, "-s", ffREAD, { "topol.tpr" }));
+    fnm.push_back(makeFileNameOption(efTRN, "-o", ffWRITE, { absolute }));
+    fnm.push_back(makeFileNameOption(efXVG, "-table", ffREAD, { "a.xvg", gmx::Path::join("tables", "b.xvg") }));
+    fnm.push_back(makeFileNameOption(efRND, "-multidir", ffOPTRDMULT, { "sim0", "sim1" }));
+
+    prefix_relative_file_names(dir.c_str(), fnm.size(), fnm.data());
+
+    EXPECT_EQ(gmx::Path::join(dir, "topol.tpr"), fnm[0].fns[0]);
+    // Absolute file names are not changed
+    EXPECT_EQ(absolute, fnm[1].fns[0]);
+    // All files of an option are prefixed
+    EXPECT_EQ(gmx::Path::join(dir, "a.xvg"), fnm[2].fns[0]);
+    EXPECT_EQ(gmx::Path::join(dir, "tables", "b.xvg"), fnm[2].fns[1]);
+    // The simulation directories themselves are not changed
+    EXPECT_STREQ("sim0", fnm[3].fns[0]);
+    EXPECT_STREQ("sim1", fnm[3].fns[1]);
+
+    freeFileNames(&fnm);
+}
+
+} // namespace
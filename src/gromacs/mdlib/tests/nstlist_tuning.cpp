@@ -0,0 +1,181 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2016, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief Tests for the scan over nstlist values in the run-time nstlist tuning
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/mdlib/nstlist_tuning.h"
+
+namespace
+{
+
+//! The outcome of a scan
+struct ScanResult
+{
+    //! The setups in the order they were timed
+    std::vector<int> timed;
+    //! The setup the run continues with
+    int              chosen;
+};
+
+/*! \brief Run the scan over setups with costs \p costs, starting at \p start
+ *
+ * Setups with index \p numFitting or larger do not fit in the box.
+ * This does the same switching as nstlist_tuning_do.
+ */
+ScanResult runScan(const std::vector<double> &costs, int start, int numFitting)
+{
+    nstlist_scan_t scan;
+    ScanResult     result;
+    int            next;
+
+    nstlist_scan_init(&scan, costs.size(), start);
+    do
+    {
+        /* Guard against a scan that never ends */
+        EXPECT_LE(result.timed.size(), costs.size());
+        if (result.timed.size() > costs.size())
+        {
+            break;
+        }
+        result.timed.push_back(scan.cur);
+        next = nstlist_scan_next(&scan, costs[scan.cur]);
+        while (next >= numFitting)
+        {
+            next = nstlist_scan_switch_failed(&scan);
+        }
+        if (next >= 0)
+        {
+            scan.cur = next;
+        }
+    }
+    while (next >= 0);
+
+    result.chosen = (scan.fastest < numFitting ? scan.fastest : scan.cur);
+
+    return result;
+}
+
+TEST(NstlistTuningTest, CandidatesIncludeTheInitialValue)
+{
+    int start;
+
+    EXPECT_EQ(std::vector<int>({10, 20, 25, 40, 50, 80, 100}),
+              nstlist_tuning_candidates(10, &start));
+    EXPECT_EQ(0, start);
+    EXPECT_EQ(std::vector<int>({10, 20, 25, 30, 40, 50, 80, 100}),
+              nstlist_tuning_candidates(30, &start));
+    EXPECT_EQ(3, start);
+    EXPECT_EQ(std::vector<int>({5, 10, 20, 25, 40, 50, 80, 100}),
+              nstlist_tuning_candidates(5, &start));
+    EXPECT_EQ(0, start);
+    EXPECT_EQ(std::vector<int>({10, 20, 25, 40, 50, 80, 100, 200}),
+              nstlist_tuning_candidates(200, &start));
+    EXPECT_EQ(7, start);
+}
+
+TEST(NstlistTuningTest, ScansUpToTheMinimum)
+{
+    ScanResult result = runScan({ 9, 8, 6, 5, 7, 9, 10 }, 1, 7);
+
+    EXPECT_EQ(std::vector<int>({1, 2, 3, 4}), result.timed);
+    EXPECT_EQ(3, result.chosen);
+}
+
+TEST(NstlistTuningTest, ScansDownWhenLargerIsSlower)
+{
+    ScanResult result = runScan({ 7, 5, 6, 8, 9 }, 2, 5);
+
+    EXPECT_EQ(std::vector<int>({2, 3, 1, 0}), result.timed);
+    EXPECT_EQ(1, result.chosen);
+}
+
+TEST(NstlistTuningTest, ContinuesWhileWithinTwoPercentOfTheFastest)
+{
+    ScanResult result = runScan({ 5, 5.05, 5.08, 6 }, 0, 4);
+
+    EXPECT_EQ(std::vector<int>({0, 1, 2, 3}), result.timed);
+    EXPECT_EQ(0, result.chosen);
+}
+
+TEST(NstlistTuningTest, StopsAtTheLargestSetup)
+{
+    ScanResult result = runScan({ 9, 8, 7 }, 0, 3);
+
+    EXPECT_EQ(std::vector<int>({0, 1, 2}), result.timed);
+    EXPECT_EQ(2, result.chosen);
+}
+
+TEST(NstlistTuningTest, ScansDownWhenLargerDoesNotFit)
+{
+    ScanResult result = runScan({ 6, 5, 7, 4 }, 2, 3);
+
+    EXPECT_EQ(std::vector<int>({2, 1, 0}), result.timed);
+    EXPECT_EQ(1, result.chosen);
+}
+
+TEST(NstlistTuningTest, EndsWhenNoOtherSetupFits)
+{
+    nstlist_scan_t scan;
+
+    nstlist_scan_init(&scan, 5, 2);
+    EXPECT_EQ(3, nstlist_scan_next(&scan, 5));
+    /* Neither the larger nor the smaller setup fits */
+    EXPECT_EQ(1, nstlist_scan_switch_failed(&scan));
+    EXPECT_EQ(-1, nstlist_scan_switch_failed(&scan));
+    EXPECT_EQ(-1, nstlist_scan_switch_failed(&scan));
+    EXPECT_EQ(2, scan.fastest);
+}
+
+TEST(NstlistTuningTest, EndsWhenSmallerDoesNotFitWhileScanningDown)
+{
+    nstlist_scan_t scan;
+
+    nstlist_scan_init(&scan, 5, 2);
+    EXPECT_EQ(3, nstlist_scan_next(&scan, 5));
+    scan.cur = 3;
+    EXPECT_EQ(1, nstlist_scan_next(&scan, 6));
+    EXPECT_EQ(-1, nstlist_scan_switch_failed(&scan));
+    EXPECT_EQ(2, scan.fastest);
+}
+
+} // namespace
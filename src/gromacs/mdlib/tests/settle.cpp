@@ -0,0 +1,353 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2016, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/constr.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+//! Number of ints per settle in the iatoms list
+const int settleStride = 4;
+
+/*! \brief Number of waters in the test system
+ *
+ * When SIMD is supported, SETTLE processes waters in batches of the
+ * SIMD width and the remainder with plain C. We use a number that is
+ * not a multiple of the SIMD width, so both paths are used.
+ */
+#if GMX_SIMD_HAVE_REAL
+const int numWaters = 2*GMX_SIMD_REAL_WIDTH + 3;
+#else
+const int numWaters = 7;
+#endif
+
+//! Number of atoms in the test system
+const int numAtoms = 3*numWaters;
+
+//! The result of one SETTLE call
+struct SettleResult
+{
+    //! Constrained positions
+    std::vector<real> x;
+    //! Velocities
+    std::vector<real> v;
+    //! The virial contribution
+    tensor            virial;
+    //! The error index returned by csettle
+    int               error;
+};
+
+/*! \brief Test fixture for comparing the SIMD and plain-C SETTLE paths
+ *
+ * Sets up waters with varying orientations in a periodic box, with
+ * many of them crossing the periodic boundary. The plain-C reference
+ * is obtained by passing one water at a time, which is always handled
+ * by the plain-C loop.
+ */
+class SettleTest : public ::testing::Test
+{
+    public:
+        //! O-H distance
+        static const real dOH_;
+        //! H-H distance
+        static const real dHH_;
+        //! Oxygen mass
+        static const real mO_;
+        //! Maximum displacement of atoms from the constrained positions
+        static const real maxDisplacement_;
+
+        void SetUp()
+        {
+            const real mH = 1.008;
+
+            settled_ = settle_init(mO_, mH, 1/mO_, 1/mH, dOH_, dHH_);
+
+            clear_mat(box_);
+            box_[XX][XX] = 1.86;
+            box_[YY][YY] = 1.91;
+            box_[ZZ][ZZ] = 1.79;
+            set_pbc(&pbc_, epbcXYZ, box_);
+
+            /* The water geometry with O at the origin */
+            real h = std::sqrt(dOH_*dOH_ - 0.25*dHH_*dHH_);
+            rvec local[3] = {
+                { 0, 0, 0 }, { 0.5f*dHH_, h, 0 }, { -0.5f*dHH_, h, 0 }
+            };
+
+            for (int w = 0; w < numWaters; w++)
+            {
+                iatoms_.push_back(0);
+                rvec center = { 0.37f*w, 0.53f*w, 0.71f*w };
+                /* Rotate about z and then about x */
+                real cz = std::cos(1.1*w), sz = std::sin(1.1*w);
+                real cx = std::cos(0.7*w), sx = std::sin(0.7*w);
+                for (int i = 0; i < 3; i++)
+                {
+                    iatoms_.push_back(3*w + i);
+
+                    rvec r1 = { cz*local[i][XX] - sz*local[i][YY], sz*local[i][XX] + cz*local[i][YY], local[i][ZZ] };
+                    rvec r2 = { r1[XX], cx*r1[YY] - sx*r1[ZZ], sx*r1[YY] + cx*r1[ZZ] };
+                    for (int d = 0; d < DIM; d++)
+                    {
+                        real x = center[d] + r2[d];
+                        x     -= box_[d][d]*std::floor(x/box_[d][d]);
+                        x_.push_back(x);
+                        /* Unconstrained displacements of a few pm */
+                        xprime_.push_back(x + maxDisplacement_*std::sin(3.1*(3*w + i) + 1.7*d));
+                        v_.push_back(std::cos(2.3*(3*w + i) + 0.9*d));
+                    }
+                }
+            }
+        }
+
+        void TearDown()
+        {
+            sfree(static_cast<void *>(settled_));
+        }
+
+        /*! \brief Runs csettle on waters [water0, water0 + n) on a copy of the input
+         *
+         * Accumulates the positions, velocities and virial into \p result.
+         */
+        void runSettle(int water0, int n, int calcvirAtomEnd, SettleResult *result)
+        {
+            int error;
+
+            csettle(settled_, n, &iatoms_[water0*settleStride], &pbc_,
+                    x_.data(), result->x.data(), invdt_, result->v.data(),
+                    calcvirAtomEnd, result->virial, &error);
+            if (error != -1)
+            {
+                result->error = water0 + error;
+            }
+        }
+
+        //! Returns a result initialized with the unconstrained input
+        SettleResult initialResult()
+        {
+            SettleResult result;
+
+            result.x = xprime_;
+            result.v = v_;
+            clear_mat(result.virial);
+            result.error = -1;
+
+            return result;
+        }
+
+        //! Returns the largest absolute element of \p v
+        static real maxAbs(const std::vector<real> &v)
+        {
+            real max = 0;
+
+            for (size_t i = 0; i < v.size(); i++)
+            {
+                max = std::max(max, std::abs(v[i]));
+            }
+
+            return max;
+        }
+
+        //! Checks that two vectors agree to within an absolute tolerance
+        void compareVectors(const std::vector<real> &ref,
+                            const std::vector<real> &test,
+                            real                     tolerance)
+        {
+            ASSERT_EQ(ref.size(), test.size());
+            for (size_t i = 0; i < ref.size(); i++)
+            {
+                EXPECT_REAL_EQ_TOL(ref[i], test[i], gmx::test::absoluteTolerance(tolerance))
+                << "element " << i;
+            }
+        }
+
+        //! Checks that two vectors agree to within a tolerance relative to their largest element
+        void compareVectors(const std::vector<real> &ref,
+                            const std::vector<real> &test)
+        {
+            compareVectors(ref, test, maxAbs(ref)*tolerance_);
+        }
+
+        //! Returns the elements of a virial tensor as a vector
+        static std::vector<real> virialToVector(const tensor vir)
+        {
+            std::vector<real> v;
+
+            for (int d = 0; d < DIM; d++)
+            {
+                for (int d2 = 0; d2 < DIM; d2++)
+                {
+                    v.push_back(vir[d][d2]);
+                }
+            }
+
+            return v;
+        }
+
+        //! Checks csettle for all waters at once against one water at a time
+        void checkSettle(int calcvirAtomEnd)
+        {
+            SettleResult all = initialResult();
+            runSettle(0, numWaters, calcvirAtomEnd, &all);
+
+            SettleResult single = initialResult();
+            for (int w = 0; w < numWaters; w++)
+            {
+                runSettle(w, 1, calcvirAtomEnd, &single);
+            }
+
+            EXPECT_EQ(-1, single.error);
+            EXPECT_EQ(-1, all.error);
+            compareVectors(single.x, all.x);
+            compareVectors(single.v, all.v);
+            /* The plain-C code sums the virial using absolute coordinates,
+             * so the rounding errors scale with the box size times
+             * the mass weighted displacements, not with the result.
+             */
+            real virialTerm = maxAbs(x_)*mO_*maxDisplacement_;
+            compareVectors(virialToVector(single.virial), virialToVector(all.virial),
+                           numAtoms*virialTerm*GMX_REAL_EPS);
+        }
+
+        //! Checks settle_proj for all waters at once against one water at a time
+        void checkSettleProj(int econq, int calcvirAtomEnd)
+        {
+            std::vector<real> derpAll(v_), derpSingle(v_);
+            tensor            virAll, virSingle;
+
+            clear_mat(virAll);
+            settle_proj(settled_, econq, numWaters, iatoms_.data(), &pbc_,
+                        reinterpret_cast<rvec *>(x_.data()), reinterpret_cast<rvec *>(v_.data()),
+                        reinterpret_cast<rvec *>(derpAll.data()), calcvirAtomEnd, virAll);
+
+            clear_mat(virSingle);
+            for (int w = 0; w < numWaters; w++)
+            {
+                settle_proj(settled_, econq, 1, &iatoms_[w*settleStride], &pbc_,
+                            reinterpret_cast<rvec *>(x_.data()), reinterpret_cast<rvec *>(v_.data()),
+                            reinterpret_cast<rvec *>(derpSingle.data()), calcvirAtomEnd, virSingle);
+            }
+
+            compareVectors(derpSingle, derpAll);
+            compareVectors(virialToVector(virSingle), virialToVector(virAll));
+        }
+
+        //! The SETTLE parameters
+        gmx_settledata_t   settled_;
+        //! The periodic box
+        matrix             box_;
+        //! PBC setup for box_
+        t_pbc              pbc_;
+        //! The settle iatoms
+        std::vector<int>   iatoms_;
+        //! Reference positions, satisfying the constraints
+        std::vector<real>  x_;
+        //! Unconstrained updated positions
+        std::vector<real>  xprime_;
+        //! Velocities
+        std::vector<real>  v_;
+        //! Inverse time step
+        static const real  invdt_;
+        //! Relative tolerance for comparing the two paths
+        static const real  tolerance_;
+};
+
+const real SettleTest::dOH_             = 0.09572;
+const real SettleTest::dHH_             = 0.15139;
+const real SettleTest::mO_              = 15.9994;
+const real SettleTest::maxDisplacement_ = 0.02;
+const real SettleTest::invdt_           = 500;
+#ifdef GMX_DOUBLE
+const real SettleTest::tolerance_ = 1e-10;
+#else
+const real SettleTest::tolerance_ = 1e-5;
+#endif
+
+TEST_F(SettleTest, SimdAndPlainCMatch)
+{
+    checkSettle(numAtoms);
+}
+
+TEST_F(SettleTest, SimdAndPlainCMatchWithPartialVirial)
+{
+    /* Leave out the last waters of the second SIMD batch and the remainder */
+    checkSettle(3*(numWaters - 5));
+}
+
+TEST_F(SettleTest, ProjectionSimdAndPlainCMatch)
+{
+    checkSettleProj(econqCoord, numAtoms);
+    checkSettleProj(econqForce, numAtoms);
+}
+
+TEST_F(SettleTest, ProjectionSimdAndPlainCMatchWithPartialVirial)
+{
+    checkSettleProj(econqCoord, 3*(numWaters - 5));
+}
+
+TEST_F(SettleTest, ProjectionPartialVirialOnlyCountsWatersBelowEnd)
+{
+    const int         numHomeWaters = numWaters - 5;
+    std::vector<real> derp(v_);
+    tensor            virPartial, virHome;
+
+    clear_mat(virPartial);
+    settle_proj(settled_, econqCoord, numWaters, iatoms_.data(), &pbc_,
+                reinterpret_cast<rvec *>(x_.data()), reinterpret_cast<rvec *>(v_.data()),
+                reinterpret_cast<rvec *>(derp.data()), 3*numHomeWaters, virPartial);
+
+    clear_mat(virHome);
+    settle_proj(settled_, econqCoord, numHomeWaters, iatoms_.data(), &pbc_,
+                reinterpret_cast<rvec *>(x_.data()), reinterpret_cast<rvec *>(v_.data()),
+                reinterpret_cast<rvec *>(derp.data()), numAtoms, virHome);
+
+    compareVectors(virialToVector(virHome), virialToVector(virPartial));
+}
+
+} // namespace
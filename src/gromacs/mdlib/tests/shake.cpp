@@ -40,7 +40,15 @@
 
 #include <gtest/gtest.h>
 
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/math/vec.h"
 #include "gromacs/mdlib/constr.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/topology/idef.h"
+#include "gromacs/topology/ifunc.h"
+#include "gromacs/utility/smalloc.h"
 
 #include "testutils/refdata.h"
 #include "testutils/testasserts.h"
@@ -343,4 +351,135 @@ TEST_F(ShakeTest, ConstrainsThreeBondsWithCommonAtoms)
     runTest(numAtoms, numConstraints, iatom, constrainedDistances, inverseMasses, positions);
 }
 
+TEST_F(ShakeTest, ThreadedBlocksMatchScalarShake)
+{
+    // Enough blocks for every thread to fill SIMD batches plus remainders,
+    // with smaller blocks in between that break up the batches
+    const int            numBlocks  = 64;
+    const int            numThreads = 3;
+    const real           constrainedDistances[] = { 2.0, 1.0 };
+
+    std::vector<int>     iatom;
+    std::vector<int>     sblock;
+    std::vector<real>    inverseMasses;
+    std::vector<real>    initialPositions;
+    std::vector<real>    positions;
+
+    for (int b = 0; b != numBlocks; ++b)
+    {
+        int numConsInBlock = (b % 13 == 12 ? 2 : 3);
+        int firstAtom      = inverseMasses.size();
+
+        sblock.push_back(iatom.size());
+        for (int c = 0; c != numConsInBlock; ++c)
+        {
+            iatom.push_back(c == 0 ? 0 : 1); // type, with the distance in constrainedDistances
+            iatom.push_back(firstAtom + c);
+            iatom.push_back(firstAtom + c + 1);
+        }
+        for (int a = 0; a <= numConsInBlock; ++a)
+        {
+            inverseMasses.push_back(inverseMassesDatabase_[a]);
+            for (int d = 0; d != DIM; ++d)
+            {
+                initialPositions.push_back(positionsDatabase_[a*DIM + d]);
+                // Perturb each block differently, so they converge differently
+                positions.push_back(positionsDatabase_[a*DIM + d] + 0.01*((b*(a + 1) + d) % 5));
+            }
+        }
+    }
+    sblock.push_back(iatom.size());
+    size_t               numConstraints = iatom.size()/constraintStride;
+
+    // Constrain each block separately with the scalar kernel,
+    // with the same input as bshakef computes for it
+    std::vector<real>    referencePositions = positions;
+    std::vector<real>    referenceLagrangianValues(numConstraints, 0.0);
+    for (int b = 0; b != numBlocks; ++b)
+    {
+        std::vector<int>  blockIatom(iatom.begin() + sblock[b], iatom.begin() + sblock[b + 1]);
+        int               numConsInBlock = blockIatom.size()/constraintStride;
+        std::vector<real> constrainedDistancesSquared;
+        std::vector<real> distanceSquaredTolerances;
+
+        for (int c = 0; c != numConsInBlock; ++c)
+        {
+            real constrainedDistance = constrainedDistances[blockIatom[c*constraintStride]];
+
+            constrainedDistancesSquared.push_back(constrainedDistance*constrainedDistance);
+            distanceSquaredTolerances.push_back(0.5 / (constrainedDistancesSquared.back() * ShakeTest::tolerance_));
+        }
+        std::vector<real> halfOfReducedMasses  = computeHalfOfReducedMasses(blockIatom, inverseMasses);
+        std::vector<real> initialDisplacements = computeDisplacements(blockIatom, initialPositions);
+        int               numIterations        = 0;
+        int               numErrors            = 0;
+
+        cshake(blockIatom.data(), numConsInBlock, &numIterations,
+               ShakeTest::maxNumIterations_, constrainedDistancesSquared.data(),
+               referencePositions.data(), initialDisplacements.data(),
+               halfOfReducedMasses.data(), omega_, inverseMasses.data(),
+               distanceSquaredTolerances.data(),
+               referenceLagrangianValues.data() + sblock[b]/constraintStride,
+               &numErrors);
+        EXPECT_EQ(0, numErrors);
+        EXPECT_LT(numIterations, ShakeTest::maxNumIterations_);
+        // bshakef scales the multipliers by the constraint length
+        for (int c = 0; c != numConsInBlock; ++c)
+        {
+            referenceLagrangianValues[sblock[b]/constraintStride + c] *= constrainedDistances[blockIatom[c*constraintStride]];
+        }
+    }
+
+    // Constrain all blocks with bshakef, which divides them over threads
+    // and, with SIMD support, constrains equal-sized blocks together
+    t_iparams            iparams[2];
+    t_idef              *idef;
+    t_inputrec          *ir;
+    t_nrnb               nrnb;
+    tensor               virial;
+    real                 dvdlambda = 0;
+    std::vector<real>    lagrangianValues(numConstraints, 0.0);
+
+    for (int type = 0; type != 2; ++type)
+    {
+        iparams[type].constr.dA = constrainedDistances[type];
+        iparams[type].constr.dB = constrainedDistances[type];
+    }
+    snew(idef, 1);
+    idef->iparams                = iparams;
+    idef->il[F_CONSTR].nr        = iatom.size();
+    idef->il[F_CONSTR].iatoms    = iatom.data();
+    snew(ir, 1);
+    ir->shake_tol                = ShakeTest::tolerance_;
+    ir->efep                     = efepNO;
+    ir->delta_t                  = 0.002;
+    init_nrnb(&nrnb);
+    clear_mat(virial);
+    gmx_shakedata_t      shaked  = shake_init();
+
+    int                  numThreadsOrig = gmx_omp_nthreads_get(emntLINCS);
+    gmx_omp_nthreads_set(emntLINCS, numThreads);
+    gmx_bool             bOK = bshakef(NULL, shaked, inverseMasses.data(),
+                                       numBlocks, sblock.data(), idef, ir,
+                                       reinterpret_cast<rvec *>(initialPositions.data()),
+                                       reinterpret_cast<rvec *>(positions.data()),
+                                       &nrnb, lagrangianValues.data(), 0, &dvdlambda,
+                                       1/ir->delta_t, NULL, FALSE, virial, FALSE, econqCoord);
+    gmx_omp_nthreads_set(emntLINCS, numThreadsOrig);
+    sfree(ir);
+    sfree(idef);
+
+    EXPECT_TRUE(bOK);
+    for (size_t i = 0; i != positions.size(); ++i)
+    {
+        EXPECT_REAL_EQ_TOL(referencePositions[i], positions[i], gmx::test::defaultRealTolerance())
+        << "coordinate " << i;
+    }
+    for (size_t i = 0; i != numConstraints; ++i)
+    {
+        EXPECT_REAL_EQ_TOL(referenceLagrangianValues[i], lagrangianValues[i], gmx::test::defaultRealTolerance())
+        << "constraint " << i;
+    }
+}
+
 } // namespace
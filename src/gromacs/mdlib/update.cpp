@@ -359,6 +359,67 @@ static void do_update_vv_pos(int start, int nrend, double dt,
     }
 } /* do_update_vv_pos */
 
+/* Velocity half-step followed directly by the position update,
+ * so both only take a single pass over the home atoms.
+ * This gives exactly the same result as do_update_vv_vel
+ * followed by do_update_vv_pos.
+ */
+static void do_update_vv_vel_pos(int start, int nrend, double dt,
+                                 rvec accel[], ivec nFreeze[], real invmass[],
+                                 unsigned short ptype[], unsigned short cFREEZE[],
+                                 unsigned short cACC[],
+                                 rvec x[], rvec xprime[], rvec v[], rvec f[],
+                                 gmx_bool bExtended, real veta, real alpha)
+{
+    double w_dt;
+    int    gf = 0, ga = 0;
+    int    n, d;
+    double g, mv1, mv2, mr1, mr2;
+
+    if (bExtended)
+    {
+        g        = 0.25*dt*veta*alpha;
+        mv1      = exp(-g);
+        mv2      = series_sinhx(g);
+        g        = 0.5*dt*veta;
+        mr1      = exp(g);
+        mr2      = series_sinhx(g);
+    }
+    else
+    {
+        mv1      = 1.0;
+        mv2      = 1.0;
+        mr1      = 1.0;
+        mr2      = 1.0;
+    }
+    for (n = start; n < nrend; n++)
+    {
+        w_dt = invmass[n]*dt;
+        if (cFREEZE)
+        {
+            gf   = cFREEZE[n];
+        }
+        if (cACC)
+        {
+            ga   = cACC[n];
+        }
+
+        for (d = 0; d < DIM; d++)
+        {
+            if ((ptype[n] != eptVSite) && (ptype[n] != eptShell) && !nFreeze[gf][d])
+            {
+                v[n][d]             = mv1*(mv1*v[n][d] + 0.5*(w_dt*mv2*f[n][d]))+0.5*accel[ga][d]*dt;
+                xprime[n][d]        = mr1*(mr1*x[n][d]+mr2*dt*v[n][d]);
+            }
+            else
+            {
+                v[n][d]        = 0.0;
+                xprime[n][d]   = x[n][d];
+            }
+        }
+    }
+} /* do_update_vv_vel_pos */
+
 static void do_update_visc(int start, int nrend, double dt,
                            t_grp_tcstat *tcstat,
                            double nh_vxi[],
@@ -961,13 +1022,12 @@ static void dump_it_all(FILE gmx_unused *fp, const char gmx_unused *title,
 #endif
 }
 
-static void calc_ke_part_normal(rvec v[], t_grpopts *opts, t_mdatoms *md,
-                                gmx_ekindata_t *ekind, t_nrnb *nrnb, gmx_bool bEkinAveVel)
+/* Prepare the kinetic energy data for accumulating a new kinetic energy */
+static void calc_ke_part_normal_init(t_grpopts *opts, gmx_ekindata_t *ekind,
+                                     gmx_bool bEkinAveVel)
 {
     int           g;
     t_grp_tcstat *tcstat  = ekind->tcstat;
-    t_grp_acc    *grpstat = ekind->grpstat;
-    int           nthread, thread;
 
     /* three main: VV with AveVel, vv with AveEkin, leap with AveEkin.  Leap with AveVel is also
        an option, but not supported now.
@@ -992,67 +1052,77 @@ static void calc_ke_part_normal(rvec v[], t_grpopts *opts, t_mdatoms *md,
         }
     }
     ekind->dekindl_old = ekind->dekindl;
-    nthread            = gmx_omp_nthreads_get(emntUpdate);
+}
 
-#pragma omp parallel for num_threads(nthread) schedule(static)
-    for (thread = 0; thread < nthread; thread++)
-    {
-        // This OpenMP only loops over arrays and does not call any functions
-        // or memory allocation. It should not be able to throw, so for now
-        // we do not need a try/catch wrapper.
-        int     start_t, end_t, n;
-        int     ga, gt;
-        rvec    v_corrt;
-        real    hm;
-        int     d, m;
-        matrix *ekin_sum;
-        real   *dekindl_sum;
+/* Accumulate the kinetic energy of atoms start to end
+ * into the work buffers of thread.
+ */
+static void calc_ke_part_normal_thread(const rvec v[], int start, int end,
+                                       const t_grpopts *opts, const t_mdatoms *md,
+                                       gmx_ekindata_t *ekind, int thread)
+{
+    // This function only loops over arrays and does not call any functions
+    // or memory allocation. It should not be able to throw, so for now
+    // we do not need a try/catch wrapper.
+    const t_grp_acc *grpstat = ekind->grpstat;
+    int              n;
+    int              ga, gt;
+    rvec             v_corrt;
+    real             hm;
+    int              d, m;
+    matrix          *ekin_sum;
+    real            *dekindl_sum;
 
-        start_t = ((thread+0)*md->homenr)/nthread;
-        end_t   = ((thread+1)*md->homenr)/nthread;
+    ekin_sum    = ekind->ekin_work[thread];
+    dekindl_sum = ekind->dekindl_work[thread];
 
-        ekin_sum    = ekind->ekin_work[thread];
-        dekindl_sum = ekind->dekindl_work[thread];
+    for (gt = 0; gt < opts->ngtc; gt++)
+    {
+        clear_mat(ekin_sum[gt]);
+    }
+    *dekindl_sum = 0.0;
 
-        for (gt = 0; gt < opts->ngtc; gt++)
+    ga = 0;
+    gt = 0;
+    for (n = start; n < end; n++)
+    {
+        if (md->cACC)
         {
-            clear_mat(ekin_sum[gt]);
+            ga = md->cACC[n];
         }
-        *dekindl_sum = 0.0;
-
-        ga = 0;
-        gt = 0;
-        for (n = start_t; n < end_t; n++)
+        if (md->cTC)
         {
-            if (md->cACC)
-            {
-                ga = md->cACC[n];
-            }
-            if (md->cTC)
-            {
-                gt = md->cTC[n];
-            }
-            hm   = 0.5*md->massT[n];
+            gt = md->cTC[n];
+        }
+        hm   = 0.5*md->massT[n];
 
-            for (d = 0; (d < DIM); d++)
-            {
-                v_corrt[d]  = v[n][d]  - grpstat[ga].u[d];
-            }
-            for (d = 0; (d < DIM); d++)
-            {
-                for (m = 0; (m < DIM); m++)
-                {
-                    /* if we're computing a full step velocity, v_corrt[d] has v(t).  Otherwise, v(t+dt/2) */
-                    ekin_sum[gt][m][d] += hm*v_corrt[m]*v_corrt[d];
-                }
-            }
-            if (md->nMassPerturbed && md->bPerturbed[n])
+        for (d = 0; (d < DIM); d++)
+        {
+            v_corrt[d]  = v[n][d]  - grpstat[ga].u[d];
+        }
+        for (d = 0; (d < DIM); d++)
+        {
+            for (m = 0; (m < DIM); m++)
             {
-                *dekindl_sum +=
-                    0.5*(md->massB[n] - md->massA[n])*iprod(v_corrt, v_corrt);
+                /* if we're computing a full step velocity, v_corrt[d] has v(t).  Otherwise, v(t+dt/2) */
+                ekin_sum[gt][m][d] += hm*v_corrt[m]*v_corrt[d];
             }
         }
+        if (md->nMassPerturbed && md->bPerturbed[n])
+        {
+            *dekindl_sum +=
+                0.5*(md->massB[n] - md->massA[n])*iprod(v_corrt, v_corrt);
+        }
     }
+}
+
+/* Reduce the kinetic energy contributions of nthread threads */
+static void calc_ke_part_normal_reduce(t_grpopts *opts, t_mdatoms *md,
+                                       gmx_ekindata_t *ekind, int nthread,
+                                       t_nrnb *nrnb, gmx_bool bEkinAveVel)
+{
+    t_grp_tcstat *tcstat  = ekind->tcstat;
+    int           thread, g;
 
     ekind->dekindl = 0;
     for (thread = 0; thread < nthread; thread++)
@@ -1077,6 +1147,29 @@ static void calc_ke_part_normal(rvec v[], t_grpopts *opts, t_mdatoms *md,
     inc_nrnb(nrnb, eNR_EKIN, md->homenr);
 }
 
+static void calc_ke_part_normal(rvec v[], t_grpopts *opts, t_mdatoms *md,
+                                gmx_ekindata_t *ekind, t_nrnb *nrnb, gmx_bool bEkinAveVel)
+{
+    int nthread, thread;
+
+    calc_ke_part_normal_init(opts, ekind, bEkinAveVel);
+
+    nthread = gmx_omp_nthreads_get(emntUpdate);
+
+#pragma omp parallel for num_threads(nthread) schedule(static)
+    for (thread = 0; thread < nthread; thread++)
+    {
+        int start_t, end_t;
+
+        start_t = ((thread+0)*md->homenr)/nthread;
+        end_t   = ((thread+1)*md->homenr)/nthread;
+
+        calc_ke_part_normal_thread(v, start_t, end_t, opts, md, ekind, thread);
+    }
+
+    calc_ke_part_normal_reduce(opts, md, ekind, nthread, nrnb, bEkinAveVel);
+}
+
 static void calc_ke_part_visc(matrix box, rvec x[], rvec v[],
                               t_grpopts *opts, t_mdatoms *md,
                               gmx_ekindata_t *ekind,
@@ -1442,24 +1535,25 @@ static rvec *get_xprime(const t_state *state, gmx_update_t upd)
     return upd->xp;
 }
 
-void update_constraints(FILE             *fplog,
-                        gmx_int64_t       step,
-                        real             *dvdlambda, /* the contribution to be added to the bonded interactions */
-                        t_inputrec       *inputrec,  /* input record and box stuff	*/
-                        t_mdatoms        *md,
-                        t_state          *state,
-                        gmx_bool          bMolPBC,
-                        t_graph          *graph,
-                        rvec              force[],   /* forces on home particles */
-                        t_idef           *idef,
-                        tensor            vir_part,
-                        t_commrec        *cr,
-                        t_nrnb           *nrnb,
-                        gmx_wallcycle_t   wcycle,
-                        gmx_update_t      upd,
-                        gmx_constr_t      constr,
-                        gmx_bool          bFirstHalf,
-                        gmx_bool          bCalcVir)
+gmx_bool update_constraints(FILE             *fplog,
+                            gmx_int64_t       step,
+                            real             *dvdlambda, /* the contribution to be added to the bonded interactions */
+                            t_inputrec       *inputrec,  /* input record and box stuff	*/
+                            t_mdatoms        *md,
+                            t_state          *state,
+                            gmx_bool          bMolPBC,
+                            t_graph          *graph,
+                            rvec              force[],   /* forces on home particles */
+                            t_idef           *idef,
+                            tensor            vir_part,
+                            t_commrec        *cr,
+                            t_nrnb           *nrnb,
+                            gmx_wallcycle_t   wcycle,
+                            gmx_update_t      upd,
+                            gmx_constr_t      constr,
+                            gmx_bool          bFirstHalf,
+                            gmx_bool          bCalcVir,
+                            gmx_ekindata_t   *ekind)
 {
     gmx_bool             bLastStep, bLog = FALSE, bEner = FALSE, bDoConstr = FALSE;
     double               dt;
@@ -1467,6 +1561,7 @@ void update_constraints(FILE             *fplog,
     tensor               vir_con;
     rvec                *xprime = NULL;
     int                  nth, th;
+    gmx_bool             bCalcEkinh = FALSE;
 
     if (constr)
     {
@@ -1687,15 +1782,48 @@ void update_constraints(FILE             *fplog,
         }
         else
         {
+            /* With leap-frog the velocities are final here, so we can
+             * compute the half step kinetic energy while we anyhow pass
+             * over all atoms, instead of in a separate pass later.
+             * This uses the same atom division over the threads.
+             */
+            bCalcEkinh = (ekind != NULL && !EI_VV(inputrec->eI) &&
+                          ekind->cosacc.cos_accel == 0 && !ekind->bNEMD);
+
+            if (bCalcEkinh)
+            {
+                calc_ke_part_normal_init(&inputrec->opts, ekind, FALSE);
+            }
+
 #ifndef __clang_analyzer__
             // cppcheck-suppress unreadVariable
             nth = gmx_omp_nthreads_get(emntUpdate);
 #endif
 #pragma omp parallel for num_threads(nth) schedule(static)
-            for (i = start; i < nrend; i++)
+            for (th = 0; th < nth; th++)
             {
-                // Trivial statement, does not throw
-                copy_rvec(upd->xp[i], state->x[i]);
+                // Only loops over arrays, does not throw
+                int start_th, end_th, a;
+
+                start_th = start + ((nrend-start)* th   )/nth;
+                end_th   = start + ((nrend-start)*(th+1))/nth;
+
+                for (a = start_th; a < end_th; a++)
+                {
+                    copy_rvec(upd->xp[a], state->x[a]);
+                }
+
+                if (bCalcEkinh)
+                {
+                    calc_ke_part_normal_thread(state->v, start_th, end_th,
+                                               &inputrec->opts, md, ekind, th);
+                }
+            }
+
+            if (bCalcEkinh)
+            {
+                calc_ke_part_normal_reduce(&inputrec->opts, md, ekind, nth,
+                                           nrnb, FALSE);
             }
         }
         wallcycle_stop(wcycle, ewcUPDATE);
@@ -1704,6 +1832,8 @@ void update_constraints(FILE             *fplog,
                     state->natoms, state->x, upd->xp, state->v, force);
     }
 /* ############# END the update of velocities and positions ######### */
+
+    return bCalcEkinh;
 }
 
 void update_box(FILE             *fplog,
@@ -1825,7 +1955,8 @@ void update_coords(FILE             *fplog,
     bDoConstr = (NULL != constr);
 
     /* Running the velocity half does nothing except for velocity verlet */
-    if ((UpdatePart == etrtVELOCITY1 || UpdatePart == etrtVELOCITY2) &&
+    if ((UpdatePart == etrtVELOCITY1 || UpdatePart == etrtVELOCITY2 ||
+         UpdatePart == etrtVELOCITY2POSITION) &&
         !EI_VV(inputrec->eI))
     {
         gmx_incons("update_coords called for velocity without VV integrator");
@@ -1961,6 +2092,14 @@ void update_coords(FILE             *fplog,
                                              state->v, f,
                                              (bNH || bPR), state->veta, alpha);
                             break;
+                        case etrtVELOCITY2POSITION:
+                            do_update_vv_vel_pos(start_th, end_th, dt,
+                                                 inputrec->opts.acc, inputrec->opts.nFreeze,
+                                                 md->invmass, md->ptype,
+                                                 md->cFREEZE, md->cACC,
+                                                 state->x, xprime, state->v, f,
+                                                 (bNH || bPR), state->veta, alpha);
+                            break;
                         case etrtPOSITION:
                             do_update_vv_pos(start_th, end_th, dt,
                                              inputrec->opts.nFreeze,
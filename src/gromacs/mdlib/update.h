@@ -109,24 +109,31 @@ void update_coords(FILE              *fplog,
 
 extern gmx_bool update_randomize_velocities(t_inputrec *ir, gmx_int64_t step, const t_commrec *cr, t_mdatoms *md, t_state *state, gmx_update_t upd, gmx_constr *constr);
 
-void update_constraints(FILE              *fplog,
-                        gmx_int64_t        step,
-                        real              *dvdlambda, /* FEP stuff */
-                        t_inputrec        *inputrec,  /* input record and box stuff	*/
-                        t_mdatoms         *md,
-                        t_state           *state,
-                        gmx_bool           bMolPBC,
-                        t_graph           *graph,
-                        rvec               force[], /* forces on home particles */
-                        t_idef            *idef,
-                        tensor             vir_part,
-                        t_commrec         *cr,
-                        t_nrnb            *nrnb,
-                        gmx_wallcycle_t    wcycle,
-                        gmx_update_t       upd,
-                        gmx_constr        *constr,
-                        gmx_bool           bFirstHalf,
-                        gmx_bool           bCalcVir);
+/* Constrain the updated coordinates and copy them back to state->x.
+ * When ekind!=NULL, the half step kinetic energy is computed for leap-frog
+ * type integrators in the same pass over the atoms as the final copy,
+ * when this is possible. Returns whether this was done, in which case
+ * compute_globals should be called with CGLO_EKINHDONE.
+ */
+gmx_bool update_constraints(FILE              *fplog,
+                            gmx_int64_t        step,
+                            real              *dvdlambda, /* FEP stuff */
+                            t_inputrec        *inputrec,  /* input record and box stuff	*/
+                            t_mdatoms         *md,
+                            t_state           *state,
+                            gmx_bool           bMolPBC,
+                            t_graph           *graph,
+                            rvec               force[], /* forces on home particles */
+                            t_idef            *idef,
+                            tensor             vir_part,
+                            t_commrec         *cr,
+                            t_nrnb            *nrnb,
+                            gmx_wallcycle_t    wcycle,
+                            gmx_update_t       upd,
+                            gmx_constr        *constr,
+                            gmx_bool           bFirstHalf,
+                            gmx_bool           bCalcVir,
+                            gmx_ekindata_t    *ekind);
 
 /* Return TRUE if OK, FALSE in case of Shake Error */
 
@@ -53,12 +53,36 @@
 #include "gromacs/pbcutil/ishift.h"
 #include "gromacs/pbcutil/mshift.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/pbcutil/pbc-simd.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
+#include "gromacs/simd/vector_operations.h"
 #include "gromacs/topology/mtop_util.h"
+#include "gromacs/utility/bitmask.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 
+#if GMX_SIMD_HAVE_REAL
+/* With SIMD we spread GMX_SIMD_REAL_WIDTH 3FD or 3OUT vsites at once */
+#    define VSITE_SIMD
+#endif
+
+static const int reduction_block_size = 32; /* Force buffer block size in atoms */
+static const int reduction_block_bits =  5; /* log2(reduction_block_size) */
+
+/* Data for reducing the thread-local vsite force buffers */
+struct vsite_reduction_t
+{
+    int            natoms;       /* The number of atoms covered by the buffers */
+    int            nblock_used;  /* The number of force blocks to reduce */
+    int           *block_index;  /* Index of size nblock_used into mask */
+    gmx_bitmask_t *mask;         /* Per block of reduction_block_size atoms,
+                                  * bits set for the threads that write to it */
+    int            block_nalloc; /* Allocation size of block_index and mask */
+};
+
 /* Routines to send/recieve coordinates and force
  * of constructing atoms.
  */
@@ -531,9 +555,18 @@ void construct_vsites(const gmx_vsite_t *vsite,
         {
             try
             {
+                int th = gmx_omp_get_thread_num();
+
+                construct_vsites_thread(vsite,
+                                        x, dt, v,
+                                        ip, vsite->tdata[th].ilist,
+                                        pbc_null);
+                /* The vsites spread through our force buffer only depend
+                 * on non-vsite atoms, so they can be constructed here too.
+                 */
                 construct_vsites_thread(vsite,
                                         x, dt, v,
-                                        ip, vsite->tdata[gmx_omp_get_thread_num()].ilist,
+                                        ip, vsite->tdata[th].ilist_buf,
                                         pbc_null);
             }
             GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
@@ -1301,6 +1334,240 @@ static int spread_vsiten(t_iatom ia[], t_iparams ip[],
 }
 
 
+#ifdef VSITE_SIMD
+/* Load the vectors of GMX_SIMD_REAL_WIDTH atoms with indices a
+ * from the flat array x into the SIMD vector v_S,
+ * buf should be aligned and have space for DIM*GMX_SIMD_REAL_WIDTH reals.
+ */
+static gmx_inline void gmx_simdcall
+gather_vsite_atoms_simd(const real * gmx_restrict x,
+                        const int *               a,
+                        real * gmx_restrict       buf,
+                        gmx_simd_real_t           v_S[DIM])
+{
+    int s, d;
+
+    for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+    {
+        for (d = 0; d < DIM; d++)
+        {
+            buf[d*GMX_SIMD_REAL_WIDTH + s] = x[a[s]*DIM + d];
+        }
+    }
+    for (d = 0; d < DIM; d++)
+    {
+        v_S[d] = gmx_simd_load_r(buf + d*GMX_SIMD_REAL_WIDTH);
+    }
+}
+
+/* Add the SIMD vector v_S to the vectors of the GMX_SIMD_REAL_WIDTH atoms
+ * with indices a in the flat array f. The additions are done lane by lane,
+ * so multiple lanes can add to the same atom.
+ */
+static gmx_inline void gmx_simdcall
+scatter_add_vsite_atoms_simd(real * gmx_restrict   f,
+                             const int *           a,
+                             real * gmx_restrict   buf,
+                             const gmx_simd_real_t v_S[DIM])
+{
+    int s, d;
+
+    for (d = 0; d < DIM; d++)
+    {
+        gmx_simd_store_r(buf + d*GMX_SIMD_REAL_WIDTH, v_S[d]);
+    }
+    for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+    {
+        for (d = 0; d < DIM; d++)
+        {
+            f[a[s]*DIM + d] += buf[d*GMX_SIMD_REAL_WIDTH + s];
+        }
+    }
+}
+
+/* Extract the atom indices and parameters of GMX_SIMD_REAL_WIDTH
+ * vsites with three constructing atoms starting at ia,
+ * the parameters a, b and c are returned in buf, buf+W and buf+2*W.
+ */
+static gmx_inline void
+vsite3_indices_simd(const t_iatom *ia, const t_iparams ip[],
+                    int *av, int *ai, int *aj, int *ak, real *buf)
+{
+    int s;
+
+    for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+    {
+        const t_iatom *ias = ia + s*(1 + NRAL(F_VSITE3));
+
+        av[s] = ias[1];
+        ai[s] = ias[2];
+        aj[s] = ias[3];
+        ak[s] = ias[4];
+        buf[                      s] = ip[ias[0]].vsite.a;
+        buf[  GMX_SIMD_REAL_WIDTH+s] = ip[ias[0]].vsite.b;
+        buf[2*GMX_SIMD_REAL_WIDTH+s] = ip[ias[0]].vsite.c;
+    }
+}
+
+/* SIMD version of spread_vsite3FD without shift force and virial
+ * contributions. Spreads the largest multiple of GMX_SIMD_REAL_WIDTH
+ * vsites in ia and returns the number of ia elements processed.
+ * None of the constructing atoms should be vsites.
+ */
+static int gmx_simdcall
+spread_vsite3FD_simd(int nr, const t_iatom ia[], const t_iparams ip[],
+                     const rvec x[], rvec f[], const t_pbc *pbc)
+{
+    const int       inc = 1 + NRAL(F_VSITE3FD);
+    int             i, s, d;
+    int             av[GMX_SIMD_REAL_WIDTH], ai[GMX_SIMD_REAL_WIDTH];
+    int             aj[GMX_SIMD_REAL_WIDTH], ak[GMX_SIMD_REAL_WIDTH];
+    real            buf_array[3*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *buf;
+    const real     *x_flat = x[0];
+    real           *f_flat = f[0];
+    pbc_simd_t      pbc_simd;
+
+    /* Ensure register memory alignment */
+    buf = gmx_simd_align_r(buf_array);
+
+    set_pbc_simd(pbc, &pbc_simd);
+
+    for (i = 0; i + GMX_SIMD_REAL_WIDTH*inc <= nr; i += GMX_SIMD_REAL_WIDTH*inc)
+    {
+        gmx_simd_real_t a_S, b_S, a1_S, invl_S, c_S, fproj_S;
+        gmx_simd_real_t xi_S[DIM], xj_S[DIM], xk_S[DIM], fv_S[DIM];
+        gmx_simd_real_t xij_S[DIM], xjk_S[DIM], xix_S[DIM];
+        gmx_simd_real_t temp_S[DIM], fi_S[DIM], fj_S[DIM], fk_S[DIM];
+
+        vsite3_indices_simd(ia + i, ip, av, ai, aj, ak, buf);
+        a_S  = gmx_simd_load_r(buf);
+        b_S  = gmx_simd_load_r(buf + GMX_SIMD_REAL_WIDTH);
+        a1_S = gmx_simd_sub_r(gmx_simd_set1_r(1), a_S);
+
+        gather_vsite_atoms_simd(x_flat, ai, buf, xi_S);
+        gather_vsite_atoms_simd(x_flat, aj, buf, xj_S);
+        gather_vsite_atoms_simd(x_flat, ak, buf, xk_S);
+        gather_vsite_atoms_simd(f_flat, av, buf, fv_S);
+
+        for (d = 0; d < DIM; d++)
+        {
+            xij_S[d] = gmx_simd_sub_r(xj_S[d], xi_S[d]);
+            xjk_S[d] = gmx_simd_sub_r(xk_S[d], xj_S[d]);
+        }
+        pbc_correct_dx_simd(&xij_S[XX], &xij_S[YY], &xij_S[ZZ], &pbc_simd);
+        pbc_correct_dx_simd(&xjk_S[XX], &xjk_S[YY], &xjk_S[ZZ], &pbc_simd);
+
+        /* xix goes from i to point x on the line jk */
+        for (d = 0; d < DIM; d++)
+        {
+            xix_S[d] = gmx_simd_fmadd_r(a_S, xjk_S[d], xij_S[d]);
+        }
+
+        invl_S  = gmx_simd_invsqrt_r(gmx_simd_norm2_r(xix_S[XX], xix_S[YY], xix_S[ZZ]));
+        c_S     = gmx_simd_mul_r(b_S, invl_S);
+        fproj_S = gmx_simd_mul_r(gmx_simd_iprod_r(xix_S[XX], xix_S[YY], xix_S[ZZ],
+                                                  fv_S[XX], fv_S[YY], fv_S[ZZ]),
+                                 gmx_simd_mul_r(invl_S, invl_S));
+
+        for (d = 0; d < DIM; d++)
+        {
+            temp_S[d] = gmx_simd_mul_r(c_S, gmx_simd_fnmadd_r(fproj_S, xix_S[d], fv_S[d]));
+            fi_S[d]   = gmx_simd_sub_r(fv_S[d], temp_S[d]);
+            fj_S[d]   = gmx_simd_mul_r(a1_S, temp_S[d]);
+            fk_S[d]   = gmx_simd_mul_r(a_S, temp_S[d]);
+        }
+
+        scatter_add_vsite_atoms_simd(f_flat, ai, buf, fi_S);
+        scatter_add_vsite_atoms_simd(f_flat, aj, buf, fj_S);
+        scatter_add_vsite_atoms_simd(f_flat, ak, buf, fk_S);
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            clear_rvec(f[av[s]]);
+        }
+    }
+
+    return i;
+}
+
+/* SIMD version of spread_vsite3OUT without shift force and virial
+ * contributions. Spreads the largest multiple of GMX_SIMD_REAL_WIDTH
+ * vsites in ia and returns the number of ia elements processed.
+ * None of the constructing atoms should be vsites.
+ */
+static int gmx_simdcall
+spread_vsite3OUT_simd(int nr, const t_iatom ia[], const t_iparams ip[],
+                      const rvec x[], rvec f[], const t_pbc *pbc)
+{
+    const int       inc = 1 + NRAL(F_VSITE3OUT);
+    int             i, s, d;
+    int             av[GMX_SIMD_REAL_WIDTH], ai[GMX_SIMD_REAL_WIDTH];
+    int             aj[GMX_SIMD_REAL_WIDTH], ak[GMX_SIMD_REAL_WIDTH];
+    real            buf_array[3*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *buf;
+    const real     *x_flat = x[0];
+    real           *f_flat = f[0];
+    pbc_simd_t      pbc_simd;
+
+    /* Ensure register memory alignment */
+    buf = gmx_simd_align_r(buf_array);
+
+    set_pbc_simd(pbc, &pbc_simd);
+
+    for (i = 0; i + GMX_SIMD_REAL_WIDTH*inc <= nr; i += GMX_SIMD_REAL_WIDTH*inc)
+    {
+        gmx_simd_real_t a_S, b_S, c_S;
+        gmx_simd_real_t xi_S[DIM], xj_S[DIM], xk_S[DIM], fv_S[DIM];
+        gmx_simd_real_t xij_S[DIM], xik_S[DIM], cf_S[DIM], xcf_S[DIM];
+        gmx_simd_real_t fi_S[DIM], fj_S[DIM], fk_S[DIM];
+
+        vsite3_indices_simd(ia + i, ip, av, ai, aj, ak, buf);
+        a_S = gmx_simd_load_r(buf);
+        b_S = gmx_simd_load_r(buf + GMX_SIMD_REAL_WIDTH);
+        c_S = gmx_simd_load_r(buf + 2*GMX_SIMD_REAL_WIDTH);
+
+        gather_vsite_atoms_simd(x_flat, ai, buf, xi_S);
+        gather_vsite_atoms_simd(x_flat, aj, buf, xj_S);
+        gather_vsite_atoms_simd(x_flat, ak, buf, xk_S);
+        gather_vsite_atoms_simd(f_flat, av, buf, fv_S);
+
+        for (d = 0; d < DIM; d++)
+        {
+            xij_S[d] = gmx_simd_sub_r(xj_S[d], xi_S[d]);
+            xik_S[d] = gmx_simd_sub_r(xk_S[d], xi_S[d]);
+            cf_S[d]  = gmx_simd_mul_r(c_S, fv_S[d]);
+        }
+        pbc_correct_dx_simd(&xij_S[XX], &xij_S[YY], &xij_S[ZZ], &pbc_simd);
+        pbc_correct_dx_simd(&xik_S[XX], &xik_S[YY], &xik_S[ZZ], &pbc_simd);
+
+        /* fj = a*fv + xik x c*fv, fk = b*fv - xij x c*fv */
+        gmx_simd_cprod_r(xik_S[XX], xik_S[YY], xik_S[ZZ],
+                         cf_S[XX], cf_S[YY], cf_S[ZZ],
+                         &xcf_S[XX], &xcf_S[YY], &xcf_S[ZZ]);
+        for (d = 0; d < DIM; d++)
+        {
+            fj_S[d] = gmx_simd_fmadd_r(a_S, fv_S[d], xcf_S[d]);
+        }
+        gmx_simd_cprod_r(xij_S[XX], xij_S[YY], xij_S[ZZ],
+                         cf_S[XX], cf_S[YY], cf_S[ZZ],
+                         &xcf_S[XX], &xcf_S[YY], &xcf_S[ZZ]);
+        for (d = 0; d < DIM; d++)
+        {
+            fk_S[d] = gmx_simd_fmsub_r(b_S, fv_S[d], xcf_S[d]);
+            fi_S[d] = gmx_simd_sub_r(gmx_simd_sub_r(fv_S[d], fj_S[d]), fk_S[d]);
+        }
+
+        scatter_add_vsite_atoms_simd(f_flat, ai, buf, fi_S);
+        scatter_add_vsite_atoms_simd(f_flat, aj, buf, fj_S);
+        scatter_add_vsite_atoms_simd(f_flat, ak, buf, fk_S);
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            clear_rvec(f[av[s]]);
+        }
+    }
+
+    return i;
+}
+#endif /* VSITE_SIMD */
+
 static int vsite_count(const t_ilist *ilist, int ftype)
 {
     if (ftype == F_VSITEN)
@@ -1326,11 +1593,6 @@ static void spread_vsite_f_thread(gmx_vsite_t *vsite,
     t_pbc     *pbc_null2;
     int       *vsite_pbc;
 
-    if (VirCorr)
-    {
-        clear_mat(dxdf);
-    }
-
     bPBCAll = (pbc_null != NULL && !vsite->bHaveChargeGroups);
 
     /* this loop goes backwards to be able to build *
@@ -1356,7 +1618,27 @@ static void spread_vsite_f_thread(gmx_vsite_t *vsite,
                 vsite_pbc = vsite->vsite_pbc_loc[ftype-F_VSITE2];
             }
 
-            for (i = 0; i < nr; )
+            i = 0;
+#ifdef VSITE_SIMD
+            /* Without shift forces and virial corrections we can spread
+             * the common 3FD and 3OUT types with SIMD.
+             */
+            if (vsite->bSpreadSimd && fshift == NULL && !VirCorr &&
+                vsite_pbc == NULL)
+            {
+                if (ftype == F_VSITE3FD)
+                {
+                    i = spread_vsite3FD_simd(nr, ia, ip, x, f, pbc_null2);
+                }
+                else if (ftype == F_VSITE3OUT)
+                {
+                    i = spread_vsite3OUT_simd(nr, ia, ip, x, f, pbc_null2);
+                }
+                ia += i;
+            }
+#endif
+
+            for (; i < nr; )
             {
                 if (vsite_pbc != NULL)
                 {
@@ -1424,6 +1706,68 @@ static void spread_vsite_f_thread(gmx_vsite_t *vsite,
     }
 }
 
+/* Move the forces on the vsites in ilist from f to the thread buffer fbuf */
+static void move_vsite_f_to_buffer(const t_ilist ilist[], const t_iparams ip[],
+                                   rvec f[], rvec fbuf[])
+{
+    int ftype, inc, i;
+
+    for (ftype = 0; ftype < F_NRE; ftype++)
+    {
+        if (interaction_function[ftype].flags & IF_VSITE)
+        {
+            const t_iatom *ia = ilist[ftype].iatoms;
+
+            for (i = 0; i < ilist[ftype].nr; i += inc)
+            {
+                if (ftype == F_VSITEN)
+                {
+                    /* The 3 below is from 1+NRAL(ftype)=3 */
+                    inc = ip[ia[i]].vsiten.n*3;
+                }
+                else
+                {
+                    inc = 1 + NRAL(ftype);
+                }
+                copy_rvec(f[ia[i+1]], fbuf[ia[i+1]]);
+                clear_rvec(f[ia[i+1]]);
+            }
+        }
+    }
+}
+
+/* Add the thread-local vsite force buffers to f and clear the buffers */
+static void reduce_vsite_f_buffers(const gmx_vsite_t *vsite, rvec f[])
+{
+    const vsite_reduction_t *red = vsite->red;
+
+#pragma omp parallel for num_threads(vsite->nthreads) schedule(static)
+    for (int b = 0; b < red->nblock_used; b++)
+    {
+        try
+        {
+            int ind = red->block_index[b];
+            int a0  = ind*reduction_block_size;
+            int a1  = std::min(a0 + reduction_block_size, red->natoms);
+
+            for (int th = 0; th < vsite->nthreads; th++)
+            {
+                if (bitmask_is_set(red->mask[ind], th))
+                {
+                    rvec *fbuf = vsite->tdata[th].f;
+
+                    for (int a = a0; a < a1; a++)
+                    {
+                        rvec_inc(f[a], fbuf[a]);
+                        clear_rvec(fbuf[a]);
+                    }
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+    }
+}
+
 void spread_vsite_f(gmx_vsite_t *vsite,
                     rvec x[], rvec f[], rvec *fshift,
                     gmx_bool VirCorr, matrix vir,
@@ -1452,6 +1796,14 @@ void spread_vsite_f(gmx_vsite_t *vsite,
         dd_clear_f_vsites(cr->dd, f);
     }
 
+    if (VirCorr)
+    {
+        for (th = 0; th < (vsite->nthreads == 1 ? 1 : vsite->nthreads+1); th++)
+        {
+            clear_mat(vsite->tdata[th].dxdf);
+        }
+    }
+
     if (vsite->nthreads == 1)
     {
         spread_vsite_f_thread(vsite,
@@ -1474,10 +1826,12 @@ void spread_vsite_f(gmx_vsite_t *vsite,
         {
             try
             {
-                int   thread;
-                rvec *fshift_t;
+                int                 thread;
+                gmx_vsite_thread_t *tdata;
+                rvec               *fshift_t;
 
                 thread = gmx_omp_get_thread_num();
+                tdata  = &vsite->tdata[thread];
 
                 if (thread == 0 || fshift == NULL)
                 {
@@ -1487,7 +1841,7 @@ void spread_vsite_f(gmx_vsite_t *vsite,
                 {
                     int i;
 
-                    fshift_t = vsite->tdata[thread].fshift;
+                    fshift_t = tdata->fshift;
 
                     for (i = 0; i < SHIFTS; i++)
                     {
@@ -1497,14 +1851,34 @@ void spread_vsite_f(gmx_vsite_t *vsite,
 
                 spread_vsite_f_thread(vsite,
                                       x, f, fshift_t,
-                                      VirCorr, vsite->tdata[thread].dxdf,
+                                      VirCorr, tdata->dxdf,
                                       idef->iparams,
-                                      vsite->tdata[thread].ilist,
+                                      tdata->ilist,
                                       g, pbc_null);
+
+                if (tdata->f != NULL)
+                {
+                    /* Spread the vsites with constructing atoms outside
+                     * our range into our own buffer, which is reduced below.
+                     */
+                    move_vsite_f_to_buffer(tdata->ilist_buf, idef->iparams,
+                                           f, tdata->f);
+                    spread_vsite_f_thread(vsite,
+                                          x, tdata->f, fshift_t,
+                                          VirCorr, tdata->dxdf,
+                                          idef->iparams,
+                                          tdata->ilist_buf,
+                                          g, pbc_null);
+                }
             }
             GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
         }
 
+        if (vsite->red->nblock_used > 0)
+        {
+            reduce_vsite_f_buffers(vsite, f);
+        }
+
         if (fshift != NULL)
         {
             int i;
@@ -1760,6 +2134,39 @@ static int **get_vsite_pbc(t_iparams *iparams, t_ilist *ilist,
 }
 
 
+/* Returns whether none of the constructing atoms of the 3FD and 3OUT vsites,
+ * which we spread with SIMD, are vsites.
+ */
+static gmx_bool simd_vsites_have_atom_constructors(const gmx_mtop_t *mtop)
+{
+    const int ftypes[] = { F_VSITE3FD, F_VSITE3OUT };
+    int       mt, f, i, j, nral1;
+
+    for (mt = 0; mt < mtop->nmoltype; mt++)
+    {
+        const gmx_moltype_t *molt = &mtop->moltype[mt];
+
+        for (f = 0; f < static_cast<int>(sizeof(ftypes)/sizeof(ftypes[0])); f++)
+        {
+            const t_ilist *il = &molt->ilist[ftypes[f]];
+
+            nral1 = 1 + NRAL(ftypes[f]);
+            for (i = 0; i < il->nr; i += nral1)
+            {
+                for (j = 2; j < nral1; j++)
+                {
+                    if (molt->atoms.atom[il->iatoms[i+j]].ptype == eptVSite)
+                    {
+                        return FALSE;
+                    }
+                }
+            }
+        }
+    }
+
+    return TRUE;
+}
+
 gmx_vsite_t *init_vsite(const gmx_mtop_t *mtop, t_commrec *cr,
                         gmx_bool bSerial_NoPBC)
 {
@@ -1829,6 +2236,13 @@ gmx_vsite_t *init_vsite(const gmx_mtop_t *mtop, t_commrec *cr,
     vsite->th_ind        = NULL;
     vsite->th_ind_nalloc = 0;
 
+    if (vsite->nthreads > 1)
+    {
+        snew(vsite->red, 1);
+    }
+
+    vsite->bSpreadSimd = simd_vsites_have_atom_constructors(mtop);
+
     return vsite;
 }
 
@@ -1846,8 +2260,14 @@ static void prepare_vsite_thread(const t_ilist      *ilist,
                 vsite_th->ilist[ftype].nalloc = over_alloc_large(ilist[ftype].nr);
                 srenew(vsite_th->ilist[ftype].iatoms, vsite_th->ilist[ftype].nalloc);
             }
+            if (ilist[ftype].nr > vsite_th->ilist_buf[ftype].nalloc)
+            {
+                vsite_th->ilist_buf[ftype].nalloc = over_alloc_large(ilist[ftype].nr);
+                srenew(vsite_th->ilist_buf[ftype].iatoms, vsite_th->ilist_buf[ftype].nalloc);
+            }
 
-            vsite_th->ilist[ftype].nr = 0;
+            vsite_th->ilist[ftype].nr     = 0;
+            vsite_th->ilist_buf[ftype].nr = 0;
         }
     }
 }
@@ -1865,6 +2285,10 @@ void split_vsites_over_threads(const t_ilist   *ilist,
     t_iatom *iat;
     t_ilist *il_th;
     int      nral1, inc, i, j;
+    gmx_bool bUseBuffers;
+    int      nblock, b;
+
+    vsite_reduction_t *red;
 
     if (vsite->nthreads == 1)
     {
@@ -1973,6 +2397,30 @@ void split_vsites_over_threads(const t_ilist   *ilist,
         }
     }
 
+    /* Vsites with constructing atoms outside the range of their thread
+     * can be spread in parallel through a thread-local force buffer,
+     * when none of their constructing atoms are vsites. We mark which blocks
+     * of the buffers are written by which threads for the reduction.
+     */
+    bUseBuffers = (vsite->nthreads <= BITMASK_SIZE);
+    red         = vsite->red;
+    nblock      = (mdatoms->nr + reduction_block_size - 1) >> reduction_block_bits;
+    if (bUseBuffers)
+    {
+        if (nblock > red->block_nalloc)
+        {
+            red->block_nalloc = over_alloc_large(nblock);
+            srenew(red->mask,        red->block_nalloc);
+            srenew(red->block_index, red->block_nalloc);
+        }
+        for (b = 0; b < nblock; b++)
+        {
+            bitmask_clear(&red->mask[b]);
+        }
+    }
+    red->natoms      = mdatoms->nr;
+    red->nblock_used = 0;
+
     for (ftype = 0; ftype < F_NRE; ftype++)
     {
         if (interaction_function[ftype].flags & IF_VSITE)
@@ -1982,38 +2430,58 @@ void split_vsites_over_threads(const t_ilist   *ilist,
             iat   = ilist[ftype].iatoms;
             for (i = 0; i < ilist[ftype].nr; )
             {
+                gmx_bool bLocal, bVsiteConstr;
+
                 th = iat[1+i]/natperthread;
                 /* We would like to assign this vsite the thread th,
                  * but it might depend on atoms outside the atom range of th
                  * or on another vsite not assigned to thread th.
                  */
-                if (ftype != F_VSITEN)
+                if (ftype == F_VSITEN)
                 {
-                    for (j = i + 2; j < i + nral1; j++)
+                    /* The 3 below is from 1+NRAL(ftype)=3 */
+                    inc = ip[iat[i]].vsiten.n*3;
+                }
+                bLocal       = TRUE;
+                bVsiteConstr = FALSE;
+                for (j = i + 2; j < i + inc; j += (ftype == F_VSITEN ? 3 : 1))
+                {
+                    if (th_ind[iat[j]] != th)
                     {
-                        if (th_ind[iat[j]] != th)
-                        {
-                            /* Some constructing atoms are not assigned to
-                             * thread th, move this vsite to a separate batch.
-                             */
-                            th = vsite->nthreads;
-                        }
+                        bLocal = FALSE;
+                    }
+                    if (mdatoms->ptype[iat[j]] == eptVSite)
+                    {
+                        bVsiteConstr = TRUE;
                     }
                 }
-                else
+
+                if (bLocal)
                 {
-                    /* The 3 below is from 1+NRAL(ftype)=3 */
-                    inc = ip[iat[i]].vsiten.n*3;
-                    for (j = i + 2; j < i + inc; j += 3)
+                    il_th = &vsite->tdata[th].ilist[ftype];
+                }
+                else if (bUseBuffers && !bVsiteConstr && th < vsite->nthreads)
+                {
+                    /* Spread this vsite on thread th through its buffer */
+                    il_th = &vsite->tdata[th].ilist_buf[ftype];
+                    for (j = i + 2; j < i + inc; j += (ftype == F_VSITEN ? 3 : 1))
                     {
-                        if (th_ind[iat[j]] != th)
-                        {
-                            th = vsite->nthreads;
-                        }
+                        bitmask_set_bit(&red->mask[iat[j] >> reduction_block_bits], th);
                     }
+                    /* Vsites depending on this vsite should go
+                     * to the separate batch, which is spread first.
+                     */
+                    th = vsite->nthreads;
+                }
+                else
+                {
+                    /* Some constructing atoms are not assigned to
+                     * thread th, move this vsite to a separate batch.
+                     */
+                    th    = vsite->nthreads;
+                    il_th = &vsite->tdata[th].ilist[ftype];
                 }
                 /* Copy this vsite to the thread data struct of thread th */
-                il_th = &vsite->tdata[th].ilist[ftype];
                 for (j = i; j < i + inc; j++)
                 {
                     il_th->iatoms[il_th->nr++] = iat[j];
@@ -2026,6 +2494,40 @@ void split_vsites_over_threads(const t_ilist   *ilist,
         }
     }
 
+    if (bUseBuffers)
+    {
+        /* Make an index of the blocks to reduce and make sure the threads
+         * that use their buffer have a zeroed buffer covering all atoms.
+         */
+        for (b = 0; b < nblock; b++)
+        {
+            if (!bitmask_is_zero(red->mask[b]))
+            {
+                red->block_index[red->nblock_used++] = b;
+            }
+        }
+        for (th = 0; th < vsite->nthreads; th++)
+        {
+            gmx_vsite_thread_t *tdata = &vsite->tdata[th];
+            gmx_bool            bUsed = FALSE;
+
+            for (ftype = 0; ftype < F_NRE; ftype++)
+            {
+                if ((interaction_function[ftype].flags & IF_VSITE) &&
+                    tdata->ilist_buf[ftype].nr > 0)
+                {
+                    bUsed = TRUE;
+                }
+            }
+            if (bUsed && mdatoms->nr > tdata->f_nalloc)
+            {
+                sfree(tdata->f);
+                tdata->f_nalloc = over_alloc_large(mdatoms->nr);
+                snew(tdata->f, tdata->f_nalloc);
+            }
+        }
+    }
+
     if (debug)
     {
         for (ftype = 0; ftype < F_NRE; ftype++)
@@ -2039,6 +2541,11 @@ void split_vsites_over_threads(const t_ilist   *ilist,
                 {
                     fprintf(debug, " %4d", vsite->tdata[th].ilist[ftype].nr);
                 }
+                fprintf(debug, ", buffered:");
+                for (th = 0; th < vsite->nthreads; th++)
+                {
+                    fprintf(debug, " %4d", vsite->tdata[th].ilist_buf[ftype].nr);
+                }
                 fprintf(debug, "\n");
             }
         }
@@ -50,9 +50,15 @@ struct t_graph;
 struct t_ilist;
 struct t_mdatoms;
 struct t_nrnb;
+struct vsite_reduction_t;
 
 typedef struct gmx_vsite_thread_t {
     t_ilist ilist[F_NRE];     /* vsite ilists for this thread            */
+    t_ilist ilist_buf[F_NRE]; /* vsites of this thread with constructing
+                               * atoms outside our range, spread into f  */
+    rvec   *f;                /* force buffer for ilist_buf, zero outside
+                               * of spread_vsite_f                       */
+    int     f_nalloc;         /* allocation size of f                    */
     rvec    fshift[SHIFTS];   /* fshift accumulation buffer              */
     matrix  dxdf;             /* virial dx*df accumulation buffer        */
 } gmx_vsite_thread_t;
@@ -68,6 +74,9 @@ typedef struct gmx_vsite_t {
     gmx_vsite_thread_t *tdata;                /* Thread local vsites and work structs    */
     int                *th_ind;               /* Work array                              */
     int                 th_ind_nalloc;        /* Size of th_ind                          */
+    vsite_reduction_t  *red;                  /* Reduction data for the thread f buffers */
+    gmx_bool            bSpreadSimd;          /* Spread 3FD and 3OUT vsites with SIMD,
+                                               * none of their constructors are vsites   */
 } gmx_vsite_t;
 
 void construct_vsites(const gmx_vsite_t *vsite,
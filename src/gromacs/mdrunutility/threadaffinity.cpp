@@ -42,6 +42,10 @@
 #include <cstdio>
 #include <cstring>
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #ifdef HAVE_SCHED_AFFINITY
 #  include <sched.h>
 #  include <sys/syscall.h>
@@ -63,6 +67,7 @@
 #include "gromacs/utility/programcontext.h"
 #include "gromacs/utility/scoped_cptr.h"
 #include "gromacs/utility/smalloc.h"
+#include "gromacs/utility/stringutil.h"
 
 
 static int
@@ -97,12 +102,31 @@ get_thread_affinity_layout(FILE *fplog,
         // Just use the value for the first core
         hwThreadsPerCore    = hwTop.machine().sockets[0].cores[0].hwThreads.size();
         snew(*localityOrder, hwThreads);
-        int i = 0;
+
+        /* Order the cores in each socket by last-level cache, so that
+         * consecutive threads, and thus the threads of one rank, share
+         * a cache whenever possible. Without cache information all
+         * indices are -1 and we get the plain socket/core/thread order.
+         */
+        std::vector<int> llcIndex = hwTop.lastLevelCacheIndices();
+        int              i        = 0;
         for (auto &s : hwTop.machine().sockets)
         {
+            std::vector<const gmx::HardwareTopology::Core *> cores;
             for (auto &c : s.cores)
             {
-                for (auto &t : c.hwThreads)
+                cores.push_back(&c);
+            }
+            std::stable_sort(cores.begin(), cores.end(),
+                             [&llcIndex](const gmx::HardwareTopology::Core *a,
+                                         const gmx::HardwareTopology::Core *b)
+                             {
+                                 return (llcIndex[a->hwThreads[0].logicalProcessorId] <
+                                         llcIndex[b->hwThreads[0].logicalProcessorId]);
+                             });
+            for (auto c : cores)
+            {
+                for (auto &t : c->hwThreads)
                 {
                     (*localityOrder)[i++] = t.logicalProcessorId;
                 }
@@ -192,6 +216,106 @@ get_thread_affinity_layout(FILE *fplog,
     return 0;
 }
 
+/* Returns a list of indices formatted as ranges, e.g. "0-3,8-11" */
+static std::string
+format_index_ranges(std::vector<int> list)
+{
+    std::string str;
+
+    std::sort(list.begin(), list.end());
+    list.erase(std::unique(list.begin(), list.end()), list.end());
+    for (std::size_t i = 0; i < list.size(); )
+    {
+        std::size_t j = i;
+        while (j + 1 < list.size() && list[j + 1] == list[j] + 1)
+        {
+            j++;
+        }
+        str += gmx::formatString("%s%d", str.empty() ? "" : ",", list[i]);
+        if (j > i)
+        {
+            str += gmx::formatString("-%d", list[j]);
+        }
+        i = j + 1;
+    }
+    if (str.empty())
+    {
+        str = "-";
+    }
+
+    return str;
+}
+
+/* Prints the logical cores, last-level caches and NUMA nodes used by
+ * each rank on this node and warns when ranks straddle caches.
+ * rank_info contains the thread count and duty of each rank,
+ * in the order in which the threads are placed.
+ */
+static void
+print_thread_placement(FILE                        *fplog,
+                       const t_commrec             *cr,
+                       const gmx::HardwareTopology &hwTop,
+                       int                          nrank_node,
+                       const int                   *rank_info,
+                       int                          offset,
+                       int                          stride,
+                       const int                   *localityOrder)
+{
+    std::vector<int> llcIndex     = hwTop.lastLevelCacheIndices();
+    std::vector<int> numaIndex    = hwTop.numaNodeIndices();
+    int              thread0      = 0;
+    int              nrank_spread = 0;
+
+    fprintf(fplog, "\nThread placement of the ranks on this node:\n");
+    fprintf(fplog, "  rank  duty    threads  logical cores    last-level caches  NUMA nodes\n");
+    for (int r = 0; r < nrank_node; r++)
+    {
+        int              nthread = rank_info[2*r];
+        int              duty    = rank_info[2*r + 1];
+        std::vector<int> cores, caches, nodes;
+
+        for (int t = 0; t < nthread; t++)
+        {
+            int index = offset + (thread0 + t)*stride;
+            int core  = (localityOrder != nullptr ? localityOrder[index] : index);
+
+            cores.push_back(core);
+            if (core < static_cast<int>(llcIndex.size()) && llcIndex[core] >= 0)
+            {
+                caches.push_back(llcIndex[core]);
+            }
+            if (core < static_cast<int>(numaIndex.size()) && numaIndex[core] >= 0)
+            {
+                nodes.push_back(numaIndex[core]);
+            }
+        }
+        thread0 += nthread;
+
+        if (std::any_of(caches.begin(), caches.end(),
+                        [&caches](int c) { return c != caches[0]; }))
+        {
+            nrank_spread++;
+        }
+        fprintf(fplog, "  %4d  %-6s  %7d  %-15s  %-17s  %s\n",
+                r,
+                (duty & DUTY_PP) ? ((duty & DUTY_PME) ? "PP+PME" : "PP") : "PME",
+                nthread,
+                format_index_ranges(cores).c_str(),
+                format_index_ranges(caches).c_str(),
+                format_index_ranges(nodes).c_str());
+    }
+
+    if (nrank_spread > 0)
+    {
+        md_print_warn(cr, fplog,
+                      "NOTE: %d of the %d ranks on this node have threads on multiple last-level caches.\n"
+                      "      Performance can improve with a number of threads per rank (-ntomp)\n"
+                      "      that fits within the %d logical cores that share a cache.",
+                      nrank_spread, nrank_node,
+                      static_cast<int>(hwTop.machine().lastLevelCaches[0].logicalProcessorId.size()));
+    }
+}
+
 /* Set CPU affinity. Can be important for performance.
    On some systems (e.g. Cray) CPU Affinity is set by default.
    But default assigning doesn't work (well) with only some ranks
@@ -212,6 +336,9 @@ gmx_set_thread_affinity(FILE                *fplog,
     int        offset;
     int *      localityOrder = nullptr;
     int        rc;
+    int        nrank_node, intranode_rank;
+    int        rank_info_local[2];
+    int       *rank_info;
 
     if (hw_opt->thread_affinity == threadaffOFF)
     {
@@ -245,8 +372,15 @@ gmx_set_thread_affinity(FILE                *fplog,
     }
 
     /* map the current process to cores */
-    thread0_id_node = 0;
-    nthread_node    = nthread_local;
+    thread0_id_node    = 0;
+    nthread_node       = nthread_local;
+    nrank_node         = 1;
+    intranode_rank     = 0;
+    rank_info_local[0] = nthread_local;
+    rank_info_local[1] = cr->duty;
+    snew(rank_info, 2);
+    rank_info[0]       = rank_info_local[0];
+    rank_info[1]       = rank_info_local[1];
 #ifdef GMX_MPI
     if (PAR(cr) || MULTISIM(cr))
     {
@@ -263,9 +397,15 @@ gmx_set_thread_affinity(FILE                *fplog,
         thread0_id_node -= nthread_local;
         /* Get the total number of threads on this physical node */
         MPI_Allreduce(&nthread_local, &nthread_node, 1, MPI_INT, MPI_SUM, comm_intra);
+        /* Collect the thread counts and duties for reporting the placement */
+        MPI_Comm_size(comm_intra, &nrank_node);
+        MPI_Comm_rank(comm_intra, &intranode_rank);
+        srenew(rank_info, 2*nrank_node);
+        MPI_Gather(rank_info_local, 2, MPI_INT, rank_info, 2, MPI_INT, 0, comm_intra);
         MPI_Comm_free(&comm_intra);
     }
 #endif
+    gmx::scoped_guard_sfree rankInfoGuard(rank_info);
 
     if (hw_opt->thread_affinity == threadaffAUTO &&
         nthread_node != hwinfo->nthreads_hw_avail)
@@ -302,6 +442,13 @@ gmx_set_thread_affinity(FILE                *fplog,
         return;
     }
 
+    if (fplog != NULL && intranode_rank == 0)
+    {
+        print_thread_placement(fplog, cr, *hwinfo->hardwareTopology,
+                               nrank_node, rank_info,
+                               offset, core_pinning_stride, localityOrder);
+    }
+
     /* Set the per-thread affinity. In order to be able to check the success
      * of affinity settings, we will set nth_affinity_set to 1 on threads
      * where the affinity setting succeded and to 0 where it failed.
@@ -119,7 +119,8 @@ extern const char *erefscaling_names[erscNR+1];
 //! Trotter decomposition extended variable parts.
 enum {
     etrtNONE, etrtNHC, etrtBAROV, etrtBARONHC, etrtNHC2, etrtBAROV2, etrtBARONHC2,
-    etrtVELOCITY1, etrtVELOCITY2, etrtPOSITION, etrtSKIPALL, etrtNR
+    etrtVELOCITY1, etrtVELOCITY2, etrtPOSITION, etrtVELOCITY2POSITION,
+    etrtSKIPALL, etrtNR
 };
 
 //! Sequenced parts of the trotter decomposition.
@@ -45,7 +45,9 @@
 #include <cstdlib>
 #include <cstring>
 
+#include <algorithm>
 #include <exception>
+#include <vector>
 
 #include "thread_mpi/threads.h"
 
@@ -69,7 +71,15 @@ static tMPI_Thread_mutex_t where_mutex    = TMPI_THREAD_MUTEX_INITIALIZER;
 FILE                      *debug          = NULL;
 gmx_bool                   gmx_debug_at   = FALSE;
 
-static FILE               *log_file       = NULL;
+/* The log file is set per thread, since with thread-MPI the ranks of
+ * several simulations can run in one process, each with its own log.
+ * Threads without a log file, such as OpenMP threads, use the log file
+ * of the process when exactly one thread has set a log file.
+ */
+static tMPI_Thread_once_t  log_file_once  = TMPI_THREAD_ONCE_INIT;
+static tMPI_Thread_key_t   log_file_key;
+static std::vector<FILE *> log_files;
+static tMPI_Thread_mutex_t log_file_mutex = TMPI_THREAD_MUTEX_INITIALIZER;
 static tMPI_Thread_mutex_t error_mutex    = TMPI_THREAD_MUTEX_INITIALIZER;
 
 void gmx_init_debug(const int dbglevel, const char *dbgfile)
@@ -91,6 +101,31 @@ gmx_bool bDebugMode(void)
     return bDebug;
 }
 
+static void create_log_file_key(void)
+{
+    tMPI_Thread_key_create(&log_file_key, NULL);
+}
+
+/*! \brief Returns the log file of this thread, or of the process, or NULL */
+static FILE *get_log_file(void)
+{
+    FILE *fp;
+
+    tMPI_Thread_once(&log_file_once, create_log_file_key);
+    fp = static_cast<FILE *>(tMPI_Thread_getspecific(log_file_key));
+    if (fp == NULL)
+    {
+        tMPI_Thread_mutex_lock(&log_file_mutex);
+        if (log_files.size() == 1)
+        {
+            fp = log_files[0];
+        }
+        tMPI_Thread_mutex_unlock(&log_file_mutex);
+    }
+
+    return fp;
+}
+
 void _where(const char *file, int line)
 {
     static gmx_bool bFirst = TRUE;
@@ -119,11 +154,7 @@ void _where(const char *file, int line)
         /* Skip the first n occasions, this allows to see where it goes wrong */
         if (nwhere >= nskip)
         {
-            if (log_file)
-            {
-                fp = log_file;
-            }
-            else
+            if ((fp = get_log_file()) == NULL)
             {
                 fp = stderr;
             }
@@ -135,12 +166,29 @@ void _where(const char *file, int line)
 
 void gmx_fatal_set_log_file(FILE *fp)
 {
-    log_file = fp;
+    FILE *fp_prev;
+
+    tMPI_Thread_once(&log_file_once, create_log_file_key);
+    fp_prev = static_cast<FILE *>(tMPI_Thread_getspecific(log_file_key));
+    tMPI_Thread_setspecific(log_file_key, fp);
+
+    tMPI_Thread_mutex_lock(&log_file_mutex);
+    if (fp_prev != NULL)
+    {
+        log_files.erase(std::find(log_files.begin(), log_files.end(), fp_prev));
+    }
+    if (fp != NULL)
+    {
+        log_files.push_back(fp);
+    }
+    tMPI_Thread_mutex_unlock(&log_file_mutex);
 }
 
 static void default_error_handler(const char *title, const char *msg,
                                   const char *file, int line)
 {
+    FILE *log_file = get_log_file();
+
     if (log_file)
     {
         gmx::internal::printFatalErrorHeader(log_file, title, NULL, file, line);
@@ -207,6 +255,8 @@ static void call_error_handler(const char *key, const char *file, int line, cons
 
 void gmx_exit_on_fatal_error(ExitType exitType, int returnValue)
 {
+    FILE *log_file = get_log_file();
+
     if (log_file)
     {
         std::fflush(log_file);
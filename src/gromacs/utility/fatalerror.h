@@ -88,7 +88,14 @@ _where(const char *file, int line);
 /** Prints filename and line to stdlog. */
 #define where() _where(__FILE__, __LINE__)
 
-/** Sets the log file for printing error messages. */
+/*! \brief
+ * Sets the log file for printing error messages for the calling thread.
+ *
+ * With thread-MPI the ranks of several simulations can run in one process,
+ * so each thread uses its own log file. Other threads, e.g. OpenMP threads,
+ * use the log file only when a single thread in the process has set one.
+ * Pass NULL to unset the log file of the calling thread.
+ */
 void
 gmx_fatal_set_log_file(FILE *fp);
 
@@ -76,6 +76,15 @@ int gmx_omp_get_num_procs(void)
 #endif
 }
 
+int gmx_omp_get_num_threads(void)
+{
+#ifdef GMX_OPENMP
+    return omp_get_num_threads();
+#else
+    return 1;
+#endif
+}
+
 int gmx_omp_get_thread_num(void)
 {
 #ifdef GMX_OPENMP
@@ -93,6 +93,13 @@ int gmx_omp_get_max_threads(void);
  */
 int gmx_omp_get_num_procs(void);
 
+/*! \brief
+ * Returns the number of threads in the current team.
+ *
+ * Acts as a wrapper for omp_get_num_threads().
+ */
+int gmx_omp_get_num_threads(void);
+
 /*! \brief
  * Returns the thread number of the thread executing within its thread team.
  *
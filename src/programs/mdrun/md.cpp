@@ -40,6 +40,7 @@
 
 #include "config.h"
 
+#include <algorithm>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -77,6 +78,8 @@
 #include "gromacs/mdlib/nb_verlet.h"
 #include "gromacs/mdlib/nbnxn_gpu_data_mgmt.h"
 #include "gromacs/mdlib/ns.h"
+#include "gromacs/mdlib/nstlist_tuning.h"
+#include "gromacs/mdlib/rerun_reader.h"
 #include "gromacs/mdlib/shellfc.h"
 #include "gromacs/mdlib/sighandler.h"
 #include "gromacs/mdlib/sim_util.h"
@@ -154,6 +157,53 @@ static void reset_all_counters(FILE *fplog, t_commrec *cr,
     print_date_and_time(fplog, cr->nodeid, "Restarted time", gmx_gettime());
 }
 
+/*! \brief Return whether the pair list of the last search frame can be used for a rerun frame
+ *
+ * This is the case when the box did not change and all atoms moved
+ * less than \p max_displacement, half the pair-list buffer, from
+ * their positions \p x_ns_frame in the search frame. Then the list
+ * contains all pairs within the cut-off. Since the search put the atoms
+ * in the box, giving \p x_ns, the atoms are then moved to the same
+ * periodic images as in the search.
+ */
+static gmx_bool rerun_reuse_pairlist(int natoms, rvec x[], const matrix box,
+                                     const rvec x_ns_frame[], const rvec x_ns[],
+                                     const matrix box_ns, real max_displacement)
+{
+    real max_displacement2;
+    rvec dx;
+    int  i, d, e;
+
+    for (d = 0; d < DIM; d++)
+    {
+        for (e = 0; e < DIM; e++)
+        {
+            if (box[d][e] != box_ns[d][e])
+            {
+                return FALSE;
+            }
+        }
+    }
+
+    max_displacement2 = gmx::square(max_displacement);
+    for (i = 0; i < natoms; i++)
+    {
+        rvec_sub(x[i], x_ns_frame[i], dx);
+        if (norm2(dx) >= max_displacement2)
+        {
+            return FALSE;
+        }
+    }
+
+    for (i = 0; i < natoms; i++)
+    {
+        rvec_sub(x[i], x_ns_frame[i], dx);
+        rvec_add(x_ns[i], dx, x[i]);
+    }
+
+    return TRUE;
+}
+
 /*! \libinternal
     \copydoc integrator_t (FILE *fplog, t_commrec *cr,
                            int nfile, const t_filenm fnm[],
@@ -205,13 +255,24 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
                       bForceUpdate = FALSE, bCPT;
     gmx_bool          bMasterState;
     int               force_flags, cglo_flags;
-    tensor            force_vir, shake_vir, total_vir, tmp_vir, pres;
+    tensor            force_vir, shake_vir, total_vir, tmp_vir, trotter_vir, pres;
     int               i, m;
     t_trxstatus      *status;
     rvec              mu_tot;
     t_vcm            *vcm;
     matrix            pcoupl_mu, M;
     t_trxframe        rerun_fr;
+    gmx_rerun_reader_t rerun_reader           = NULL;
+    /* With the Verlet scheme the pair list can be reused for rerun frames
+     * with small displacements, for this we store the last search frame.
+     */
+    gmx_bool           bRerunReuseList        = FALSE;
+    real               rerun_max_displacement = 0;
+    rvec              *rerun_x_ns_frame       = NULL;
+    rvec              *rerun_x_ns             = NULL;
+    matrix             rerun_box_ns;
+    int                rerun_nframes          = 0;
+    int                rerun_nframes_reuse    = 0;
     gmx_repl_ex_t     repl_ex = NULL;
     int               nchkpt  = 1;
     gmx_localtop_t   *top;
@@ -229,9 +290,9 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
     gmx_shellfc_t    *shellfc;
     int               count, nconverged = 0;
     double            tcount                 = 0;
-    gmx_bool          bConverged             = TRUE, bSumEkinhOld, bDoReplEx, bExchanged, bNeedRepartition;
+    gmx_bool          bConverged             = TRUE, bSumEkinhOld, bDoReplEx, bExchanged, bReplExState, bNeedRepartition;
     gmx_bool          bResetCountersHalfMaxH = FALSE;
-    gmx_bool          bTemp, bPres, bTrotter;
+    gmx_bool          bTemp, bPres, bTrotter, bEkinhDone, bGlobalsDone, bDoGlobals, bInterSimGS;
     real              dvdl_constr;
     rvec             *cbuf        = NULL;
     int               cbuf_nalloc = 0;
@@ -253,6 +314,8 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
     pme_load_balancing_t *pme_loadbal      = NULL;
     gmx_bool              bPMETune         = FALSE;
     gmx_bool              bPMETunePrinting = FALSE;
+    nstlist_tuning_t     *nstlist_tune     = NULL;
+    gmx_bool              bNstlistTune     = FALSE;
 
     /* Interactive MD */
     gmx_bool          bIMDstep = FALSE;
@@ -470,7 +533,13 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
     if (repl_ex_nst > 0 && MASTER(cr))
     {
         repl_ex = init_replica_exchange(fplog, cr->ms, state_global, ir,
-                                        repl_ex_nst, repl_ex_nex, repl_ex_seed);
+                                        repl_ex_nst, repl_ex_nex, repl_ex_seed,
+                                        (Flags & MD_REPLEXPAIR));
+        if (replica_exchange_swaps_parameters(repl_ex))
+        {
+            /* Checkpoints store our current place in the temperature ladder */
+            mdoutf_set_replex_ref_t(outf, ir->opts.ref_t[0]);
+        }
     }
 
     /* PME tuning is only supported with PME for Coulomb. Is is not supported
@@ -485,6 +554,21 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
                          &bPMETunePrinting);
     }
 
+    /* nstlist tuning is done after PME tuning, since both change rlist */
+    bNstlistTune = ((Flags & MD_TUNENSTLIST) && !bRerunMD &&
+                    !(Flags & MD_REPRODUCIBLE));
+    if (bNstlistTune)
+    {
+        nstlist_tuning_init(&nstlist_tune, cr, ir, top_global, wcycle,
+                            use_GPU(fr->nbv));
+        bNstlistTune = nstlist_tuning_is_active(nstlist_tune);
+    }
+    if (Flags & MD_READ_NSTLIST)
+    {
+        /* Keep the nstlist of the tuning before the checkpoint */
+        mdoutf_set_tuned_nstlist(outf, ir->nstlist);
+    }
+
     if (!ir->bContinuation && !bRerunMD)
     {
         if (mdatoms->cFREEZE && (state->flags & (1<<estV)))
@@ -692,6 +776,9 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
                     gmx_fatal(FARGS, "Rerun trajectory frame step %d time %f has too small box dimensions", rerun_fr.step, rerun_fr.time);
                 }
             }
+
+            /* Read the next frame on a separate thread while we compute */
+            rerun_reader = init_rerun_reader(oenv, status, &rerun_fr);
         }
 
         if (PAR(cr))
@@ -706,6 +793,27 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
              */
             calc_shifts(rerun_fr.box, fr->shift_vec);
         }
+
+        /* With the Verlet scheme the pair list has a buffer, so we can
+         * reuse the list for frames where all atoms moved less than
+         * half the buffer. Without domain decomposition, shells and
+         * a graph, the search only puts the atoms in the box.
+         */
+        bRerunReuseList = (ir->cutoff_scheme == ecutsVERLET &&
+                           !DOMAINDECOMP(cr) && shellfc == NULL && graph == NULL &&
+                           ir->nstlist > 0 &&
+                           getenv("GMX_NO_RERUN_LIST_REUSE") == NULL);
+        if (bRerunReuseList)
+        {
+            rerun_max_displacement = 0.5*(fr->ic->rlist - std::max(fr->ic->rvdw, fr->ic->rcoulomb));
+            bRerunReuseList        = (rerun_max_displacement > 0);
+        }
+        if (bRerunReuseList)
+        {
+            snew(rerun_x_ns_frame, state->natoms);
+            snew(rerun_x_ns, state->natoms);
+            clear_mat(rerun_box_ns);
+        }
     }
 
     /* loop over MD steps or if rerunMD to end of input trajectory */
@@ -749,6 +857,22 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
                            &bPMETunePrinting);
         }
 
+        if (bNstlistTune && bNStList && !pme_loadbal_is_active(pme_loadbal))
+        {
+            nstlist_tuning_do(nstlist_tune, cr,
+                              (bVerbose && MASTER(cr)) ? stderr : NULL,
+                              fplog,
+                              ir, fr, state,
+                              wcycle,
+                              step);
+            if (!nstlist_tuning_is_active(nstlist_tune))
+            {
+                /* Store the choice in checkpoints, so continuations use it */
+                mdoutf_set_tuned_nstlist(outf, ir->nstlist);
+                bNstlistTune = FALSE;
+            }
+        }
+
         wallcycle_start(wcycle, ewcSTEP);
 
         if (bRerunMD)
@@ -856,9 +980,28 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
 
         if (bRerunMD)
         {
-            /* for rerun MD always do Neighbour Searching */
+            /* for rerun MD always do Neighbour Searching,
+             * unless we can reuse the pair list of the last search frame
+             */
             bNS      = (bFirstStep || ir->nstlist != 0);
             bNStList = bNS;
+            if (bRerunReuseList && !bFirstStep &&
+                rerun_reuse_pairlist(state->natoms, state->x, state->box,
+                                     rerun_x_ns_frame, rerun_x_ns,
+                                     rerun_box_ns, rerun_max_displacement))
+            {
+                bNS = FALSE;
+                rerun_nframes_reuse++;
+            }
+            else if (bRerunReuseList)
+            {
+                for (i = 0; i < state->natoms; i++)
+                {
+                    copy_rvec(state->x[i], rerun_x_ns_frame[i]);
+                }
+                copy_mat(state->box, rerun_box_ns);
+            }
+            rerun_nframes++;
         }
         else
         {
@@ -957,8 +1100,11 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
             /* We need the kinetic energy at minus the half step for determining
              * the full step kinetic energy and possibly for T-coupling.*/
             /* This may not be quite working correctly yet . . . . */
+            /* With leap-frog the force virial is summed as well,
+             * so we need to pass it, it is cleared below.
+             */
             compute_globals(fplog, gstat, cr, ir, fr, ekind, state, mdatoms, nrnb, vcm,
-                            wcycle, enerd, NULL, NULL, NULL, NULL, mu_tot,
+                            wcycle, enerd, force_vir, shake_vir, total_vir, pres, mu_tot,
                             constr, NULL, FALSE, state->box,
                             top_global, &bSumEkinhOld,
                             CGLO_GSTAT | CGLO_TEMPERATURE);
@@ -1055,6 +1201,15 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
                      (bNS ? GMX_FORCE_NS : 0) | force_flags);
         }
 
+        if (bRerunReuseList && bNS)
+        {
+            /* Store the coordinates as put in the box by the search */
+            for (i = 0; i < state->natoms; i++)
+            {
+                copy_rvec(state->x[i], rerun_x_ns[i]);
+            }
+        }
+
         if (EI_VV(ir->eI) && !startingFromCheckpoint && !bRerunMD)
         /*  ############### START FIRST UPDATE HALF-STEP FOR VV METHODS############### */
         {
@@ -1089,7 +1244,7 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
                                    state, fr->bMolPBC, graph, f,
                                    &top->idef, shake_vir,
                                    cr, nrnb, wcycle, upd, constr,
-                                   TRUE, bCalcVir);
+                                   TRUE, bCalcVir, NULL);
                 wallcycle_start(wcycle, ewcUPDATE);
             }
             else if (graph)
@@ -1319,7 +1474,7 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
                                        state, fr->bMolPBC, graph, f,
                                        &top->idef, tmp_vir,
                                        cr, nrnb, wcycle, upd, constr,
-                                       TRUE, bCalcVir);
+                                       TRUE, bCalcVir, NULL);
                 }
             }
         }
@@ -1331,7 +1486,11 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
          */
         copy_mat(state->box, lastbox);
 
-        dvdl_constr = 0;
+        dvdl_constr  = 0;
+        bEkinhDone   = FALSE;
+        bGlobalsDone = FALSE;
+        bInterSimGS  = ((step_rel % gs.nstms == 0) &&
+                        (multisim_nsteps < 0 || (step_rel < multisim_nsteps)));
 
         if (!bRerunMD || rerun_fr.bV || bForceUpdate)
         {
@@ -1352,19 +1511,6 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
                 update_pcouple(fplog, step, ir, state, pcoupl_mu, M, bInitStep);
             }
 
-            if (EI_VV(ir->eI))
-            {
-                /* velocity half-step update */
-                update_coords(fplog, step, ir, mdatoms, state, f, fcd,
-                              ekind, M, upd, FALSE, etrtVELOCITY2,
-                              cr, constr);
-            }
-
-            /* Above, initialize just copies ekinh into ekin,
-             * it doesn't copy position (for VV),
-             * and entire integrator for MD.
-             */
-
             if (ir->eI == eiVVAK)
             {
                 /* We probably only need md->homenr, not state->natoms */
@@ -1376,28 +1522,54 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
                 copy_rvecn(state->x, cbuf, 0, state->natoms);
             }
 
-            update_coords(fplog, step, ir, mdatoms, state, f, fcd,
-                          ekind, M, upd, bInitStep, etrtPOSITION, cr, constr);
+            if (EI_VV(ir->eI))
+            {
+                /* velocity half-step and position update in one pass */
+                update_coords(fplog, step, ir, mdatoms, state, f, fcd,
+                              ekind, M, upd, bInitStep, etrtVELOCITY2POSITION,
+                              cr, constr);
+            }
+            else
+            {
+                update_coords(fplog, step, ir, mdatoms, state, f, fcd,
+                              ekind, M, upd, bInitStep, etrtPOSITION, cr, constr);
+            }
             wallcycle_stop(wcycle, ewcUPDATE);
 
-            update_constraints(fplog, step, &dvdl_constr, ir, mdatoms, state,
-                               fr->bMolPBC, graph, f,
-                               &top->idef, shake_vir,
-                               cr, nrnb, wcycle, upd, constr,
-                               FALSE, bCalcVir);
+            /* With leap-frog, let the update compute the kinetic energy
+             * when compute_globals below needs it.
+             */
+            bEkinhDone = update_constraints(fplog, step, &dvdl_constr, ir, mdatoms, state,
+                                            fr->bMolPBC, graph, f,
+                                            &top->idef, shake_vir,
+                                            cr, nrnb, wcycle, upd, constr,
+                                            FALSE, bCalcVir,
+                                            (!EI_VV(ir->eI) &&
+                                             (bGStat || do_per_step(step+1, nstglobalcomm))) ? ekind : NULL);
 
             if (ir->eI == eiVVAK)
             {
+                /* The constraint virial does not change after this point,
+                 * so at global communication steps we sum it here together
+                 * with the half step kinetic energy and the signals,
+                 * which saves the second global reduction below.
+                 * The trotter step still needs the old total virial.
+                 */
+                bGlobalsDone = (bGStat && !bRerunMD);
+                copy_mat(total_vir, trotter_vir);
+
                 /* erase F_EKIN and F_TEMP here? */
                 /* just compute the kinetic energy at the half step to perform a trotter step */
                 compute_globals(fplog, gstat, cr, ir, fr, ekind, state, mdatoms, nrnb, vcm,
                                 wcycle, enerd, force_vir, shake_vir, total_vir, pres, mu_tot,
-                                constr, NULL, FALSE, lastbox,
+                                constr, bGlobalsDone ? &gs : NULL,
+                                bGlobalsDone && bInterSimGS, lastbox,
                                 top_global, &bSumEkinhOld,
                                 (bGStat ? CGLO_GSTAT : 0) | CGLO_TEMPERATURE
+                                | (bGlobalsDone ? CGLO_CONSTRAINT : 0)
                                 );
                 wallcycle_start(wcycle, ewcUPDATE);
-                trotter_update(ir, step, ekind, enerd, state, total_vir, mdatoms, &MassQ, trotter_seq, ettTSEQ4);
+                trotter_update(ir, step, ekind, enerd, state, trotter_vir, mdatoms, &MassQ, trotter_seq, ettTSEQ4);
                 /* now we know the scaling, we can compute the positions again again */
                 copy_rvecn(cbuf, state->x, 0, state->natoms);
 
@@ -1414,7 +1586,7 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
                                    state, fr->bMolPBC, graph, f,
                                    &top->idef, tmp_vir,
                                    cr, nrnb, wcycle, upd, NULL,
-                                   FALSE, bCalcVir);
+                                   FALSE, bCalcVir, NULL);
             }
             if (EI_VV(ir->eI))
             {
@@ -1445,6 +1617,32 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
             unshift_self(graph, state->box, state->x);
         }
 
+        /* ############## IF NOT VV, Calculate globals HERE  ############ */
+        /* With Leap-Frog we can skip compute_globals at
+         * non-communication steps, but we need to calculate
+         * the kinetic energy one step before communication.
+         * The virtual sites do not contribute to the globals,
+         * so we construct them while the global sum is in flight.
+         * This only overlaps with an MPI library that supports
+         * nonblocking collectives, with thread-MPI the sum is
+         * complete after compute_globals_start.
+         */
+        bDoGlobals = ((bGStat || (!EI_VV(ir->eI) && do_per_step(step+1, nstglobalcomm))) &&
+                      !bGlobalsDone);
+        cglo_flags = ((bGStat ? CGLO_GSTAT : 0)
+                      | (!EI_VV(ir->eI) || bRerunMD ? CGLO_ENERGY : 0)
+                      | (!EI_VV(ir->eI) && bStopCM ? CGLO_STOPCM : 0)
+                      | (!EI_VV(ir->eI) ? CGLO_TEMPERATURE : 0)
+                      | (!EI_VV(ir->eI) || bRerunMD ? CGLO_PRESSURE : 0)
+                      | CGLO_CONSTRAINT
+                      | (bEkinhDone ? CGLO_EKINHDONE : 0));
+        if (bDoGlobals)
+        {
+            compute_globals_start(fplog, gstat, cr, ir, ekind, state, mdatoms, nrnb, vcm,
+                                  wcycle, enerd, force_vir, shake_vir, mu_tot,
+                                  constr, &gs, top_global, &bSumEkinhOld, cglo_flags);
+        }
+
         if (vsite != NULL)
         {
             wallcycle_start(wcycle, ewcVSITECONSTR);
@@ -1463,27 +1661,13 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
             wallcycle_stop(wcycle, ewcVSITECONSTR);
         }
 
-        /* ############## IF NOT VV, Calculate globals HERE  ############ */
-        /* With Leap-Frog we can skip compute_globals at
-         * non-communication steps, but we need to calculate
-         * the kinetic energy one step before communication.
-         */
-        if (bGStat || (!EI_VV(ir->eI) && do_per_step(step+1, nstglobalcomm)))
+        if (bDoGlobals)
         {
-            compute_globals(fplog, gstat, cr, ir, fr, ekind, state, mdatoms, nrnb, vcm,
-                            wcycle, enerd, force_vir, shake_vir, total_vir, pres, mu_tot,
-                            constr, &gs,
-                            (step_rel % gs.nstms == 0) &&
-                            (multisim_nsteps < 0 || (step_rel < multisim_nsteps)),
-                            lastbox,
-                            top_global, &bSumEkinhOld,
-                            (bGStat ? CGLO_GSTAT : 0)
-                            | (!EI_VV(ir->eI) || bRerunMD ? CGLO_ENERGY : 0)
-                            | (!EI_VV(ir->eI) && bStopCM ? CGLO_STOPCM : 0)
-                            | (!EI_VV(ir->eI) ? CGLO_TEMPERATURE : 0)
-                            | (!EI_VV(ir->eI) || bRerunMD ? CGLO_PRESSURE : 0)
-                            | CGLO_CONSTRAINT
-                            );
+            compute_globals_finish(fplog, gstat, cr, ir, fr, ekind, state, mdatoms, nrnb, vcm,
+                                   wcycle, enerd, force_vir, shake_vir, total_vir, pres,
+                                   &gs, bInterSimGS,
+                                   lastbox,
+                                   top_global, &bSumEkinhOld, cglo_flags);
         }
 
         /* #############  END CALC EKIN AND PRESSURE ################# */
@@ -1616,15 +1800,21 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
         }
 
         /* Replica exchange */
-        bExchanged = FALSE;
+        bExchanged   = FALSE;
+        bReplExState = FALSE;
         if (bDoReplEx)
         {
-            bExchanged = replica_exchange(fplog, cr, repl_ex,
+            bExchanged = replica_exchange(fplog, cr, repl_ex, ir,
                                           state_global, enerd,
-                                          state, step, t);
+                                          state, step, t, &bReplExState);
+            if (bExchanged && MASTER(cr) &&
+                replica_exchange_swaps_parameters(repl_ex))
+            {
+                mdoutf_set_replex_ref_t(outf, ir->opts.ref_t[0]);
+            }
         }
 
-        if ( (bExchanged || bNeedRepartition) && DOMAINDECOMP(cr) )
+        if ( (bReplExState || bNeedRepartition) && DOMAINDECOMP(cr) )
         {
             dd_partition_system(fplog, step, cr, TRUE, 1,
                                 state_global, top_global, ir,
@@ -1663,7 +1853,14 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
             if (MASTER(cr))
             {
                 /* read next frame from input trajectory */
-                bNotLastFrame = read_next_frame(oenv, status, &rerun_fr);
+                if (rerun_reader)
+                {
+                    bNotLastFrame = rerun_reader_next_frame(rerun_reader, &rerun_fr);
+                }
+                else
+                {
+                    bNotLastFrame = read_next_frame(oenv, status, &rerun_fr);
+                }
             }
 
             if (PAR(cr))
@@ -1738,9 +1935,24 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
 
     if (bRerunMD && MASTER(cr))
     {
+        if (rerun_reader)
+        {
+            done_rerun_reader(rerun_reader);
+        }
         close_trj(status);
     }
 
+    if (bRerunReuseList)
+    {
+        if (fplog)
+        {
+            fprintf(fplog, "\nReused the pair list for %d of the %d rerun frames\n",
+                    rerun_nframes_reuse, rerun_nframes);
+        }
+        sfree(rerun_x_ns_frame);
+        sfree(rerun_x_ns);
+    }
+
     if (!(cr->duty & DUTY_PME))
     {
         /* Tell the PME only node to finish */
@@ -1763,6 +1975,11 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
         pme_loadbal_done(pme_loadbal, cr, fplog, use_GPU(fr->nbv));
     }
 
+    if (nstlist_tune != NULL)
+    {
+        nstlist_tuning_done(nstlist_tune, fplog);
+    }
+
     if (shellfc && fplog)
     {
         fprintf(fplog, "Fraction of iterations that converged:           %.2f %%\n",
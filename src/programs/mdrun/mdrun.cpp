@@ -61,6 +61,7 @@
 #include "gromacs/commandline/pargs.h"
 #include "gromacs/fileio/readinp.h"
 #include "gromacs/gmxlib/network.h"
+#include "gromacs/mdlib/helper_thread_affinity.h"
 #include "gromacs/mdlib/main.h"
 #include "gromacs/mdlib/mdrun.h"
 #include "gromacs/mdrunutility/handlerestart.h"
@@ -266,6 +267,7 @@ int gmx_mdrun(int argc, char *argv[])
     gmx_bool          bDDBondCheck  = TRUE;
     gmx_bool          bDDBondComm   = TRUE;
     gmx_bool          bTunePME      = TRUE;
+    gmx_bool          bTuneNstlist  = TRUE;
     gmx_bool          bVerbose      = FALSE;
     gmx_bool          bRerunVSite   = FALSE;
     gmx_bool          bConfout      = TRUE;
@@ -280,6 +282,7 @@ int gmx_mdrun(int argc, char *argv[])
     int               nstglobalcomm = -1;
     int               repl_ex_nst   = 0;
     int               repl_ex_seed  = -1;
+    gmx_bool          bReplExPair   = FALSE;
     int               repl_ex_nex   = 0;
     int               nstepout      = 100;
     int               resetstep     = -1;
@@ -369,6 +372,8 @@ int gmx_mdrun(int argc, char *argv[])
           "Set nstlist when using a Verlet buffer tolerance (0 is guess)" },
         { "-tunepme", FALSE, etBOOL, {&bTunePME},
           "Optimize PME load between PP/PME ranks or GPU/CPU" },
+        { "-tunenstlist", FALSE, etBOOL, {&bTuneNstlist},
+          "Optimize nstlist using the measured pair search and force cost (Verlet scheme)" },
         { "-v",       FALSE, etBOOL, {&bVerbose},
           "Be loud and noisy" },
         { "-pforce",  FALSE, etREAL, {&pforce},
@@ -393,6 +398,8 @@ int gmx_mdrun(int argc, char *argv[])
           "Number of random exchanges to carry out each exchange interval (N^3 is one suggestion).  -nex zero or not specified gives neighbor replica exchange." },
         { "-reseed",  FALSE, etINT, {&repl_ex_seed},
           "Seed for replica exchange, -1 is generate a seed" },
+        { "-replexpair", FALSE, etBOOL, {&bReplExPair},
+          "Only communicate between the replicas of each neighbor pair and exchange temperatures instead of configurations when possible" },
         { "-imdport",    FALSE, etINT, {&imdport},
           "HIDDENIMD listening port" },
         { "-imdwait",  FALSE, etBOOL, {&bIMDwait},
@@ -419,6 +426,7 @@ int gmx_mdrun(int argc, char *argv[])
     FILE           *fplog;
     int             rc;
     char          **multidir = NULL;
+    gmx_bool        bThreadMPIMultiSim = FALSE;
 
     cr = init_commrec();
 
@@ -471,6 +479,16 @@ int gmx_mdrun(int argc, char *argv[])
     }
 
 
+    /* With thread-MPI all simulations run in this process as separate
+     * thread-MPI ranks, which only exist after mdrunner() has started
+     * them. Setting up the multi-simulation, restart handling and
+     * opening the log files is then done in mdrunner() for each
+     * simulation.
+     */
+#ifdef GMX_THREAD_MPI
+    bThreadMPIMultiSim = (nmultisim >= 1);
+#endif
+
     if (repl_ex_nst != 0 && nmultisim < 2)
     {
         gmx_fatal(FARGS, "Need at least two replicas for replica exchange (option -multi)");
@@ -481,24 +499,28 @@ int gmx_mdrun(int argc, char *argv[])
         gmx_fatal(FARGS, "Replica exchange number of exchanges needs to be positive");
     }
 
-    if (nmultisim >= 1)
+    if (nmultisim >= 1 && !bThreadMPIMultiSim)
     {
-#ifndef GMX_THREAD_MPI
         gmx_bool bParFn = (multidir == NULL);
         init_multisystem(cr, nmultisim, multidir, NFILE, fnm, bParFn);
-#else
-        gmx_fatal(FARGS, "mdrun -multi or -multidir are not supported with the thread-MPI library. "
-                  "Please compile GROMACS with a proper external MPI library.");
-#endif
     }
 
-    handleRestart(cr, bTryToAppendFiles, NFILE, fnm,
-                  &bDoAppendFiles, &bStartFromCpt);
+    if (bThreadMPIMultiSim)
+    {
+        bDoAppendFiles = FALSE;
+        bStartFromCpt  = FALSE;
+    }
+    else
+    {
+        handleRestart(cr, bTryToAppendFiles, NFILE, fnm,
+                      &bDoAppendFiles, &bStartFromCpt);
+    }
 
     Flags = opt2bSet("-rerun", NFILE, fnm) ? MD_RERUN : 0;
     Flags = Flags | (bDDBondCheck  ? MD_DDBONDCHECK  : 0);
     Flags = Flags | (bDDBondComm   ? MD_DDBONDCOMM   : 0);
     Flags = Flags | (bTunePME      ? MD_TUNEPME      : 0);
+    Flags = Flags | (bTuneNstlist  ? MD_TUNENSTLIST  : 0);
     Flags = Flags | (bConfout      ? MD_CONFOUT      : 0);
     Flags = Flags | (bRerunVSite   ? MD_RERUN_VSITE  : 0);
     Flags = Flags | (bReproducible ? MD_REPRODUCIBLE : 0);
@@ -511,11 +533,12 @@ int gmx_mdrun(int argc, char *argv[])
     Flags = Flags | (bIMDwait      ? MD_IMDWAIT      : 0);
     Flags = Flags | (bIMDterm      ? MD_IMDTERM      : 0);
     Flags = Flags | (bIMDpull      ? MD_IMDPULL      : 0);
+    Flags = Flags | (bReplExPair   ? MD_REPLEXPAIR   : 0);
 
     /* We postpone opening the log file if we are appending, so we can
        first truncate the old log file and append to the correct position
        there instead.  */
-    if (MASTER(cr) && !bDoAppendFiles)
+    if (MASTER(cr) && !bDoAppendFiles && !bThreadMPIMultiSim)
     {
         gmx_log_open(ftp2fn(efLOG, NFILE, fnm), cr,
                      Flags & MD_APPENDFILES, &fplog);
@@ -529,12 +552,16 @@ int gmx_mdrun(int argc, char *argv[])
     ddxyz[YY] = (int)(realddxyz[YY] + 0.5);
     ddxyz[ZZ] = (int)(realddxyz[ZZ] + 0.5);
 
+    /* Helper threads should not inherit the pinning of the thread starting them */
+    gmx_store_helper_thread_affinity();
+
     rc = gmx::mdrunner(&hw_opt, fplog, cr, NFILE, fnm, oenv, bVerbose,
                        nstglobalcomm, ddxyz, dd_node_order, rdd, rconstr,
                        dddlb_opt[0], dlb_scale, ddcsx, ddcsy, ddcsz,
                        nbpu_opt[0], nstlist,
                        nsteps, nstepout, resetstep,
-                       nmultisim, repl_ex_nst, repl_ex_nex, repl_ex_seed,
+                       nmultisim, multidir, bTryToAppendFiles,
+                       repl_ex_nst, repl_ex_nex, repl_ex_seed,
                        pforce, cpt_period, max_hours, imdport, Flags);
 
     /* Log file has to be closed in mdrunner if we are appending to it
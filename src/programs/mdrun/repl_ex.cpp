@@ -42,6 +42,9 @@
 #include "config.h"
 
 #include <math.h>
+#include <string.h>
+
+#include <algorithm>
 
 #include "gromacs/domdec/domdec.h"
 #include "gromacs/gmxlib/network.h"
@@ -49,6 +52,7 @@
 #include "gromacs/math/vec.h"
 #include "gromacs/mdlib/main.h"
 #include "gromacs/mdtypes/commrec.h"
+#include "gromacs/mdtypes/inputrec.h"
 #include "gromacs/mdtypes/md_enums.h"
 #include "gromacs/random/random.h"
 #include "gromacs/utility/fatalerror.h"
@@ -61,6 +65,11 @@
 //! Rank in the multisimulaiton
 #define MSRANK(ms, nodeid)  (nodeid)
 
+/* Message tags for the communication between pairs of replicas */
+enum {
+    eretagSTATE, eretagENERGY, eretagHOLDER, eretagNEIGHBOR
+};
+
 enum {
     ereTEMP, ereLAMBDA, ereENDSINGLE, ereTL, ereNR
 };
@@ -106,6 +115,11 @@ typedef struct gmx_repl_ex
     real  *Vol;
     real **de;
 
+    /* pairwise neighbor exchange */
+    gmx_bool              bPairwise;   /* only communicate within the tested pairs */
+    gmx_bool              bSwapParams; /* exchange temperatures, not configurations */
+    t_repl_ladder         ladder;      /* our ladder position and neighbors */
+    const gmx_multisim_t *ms;          /* for summing the statistics at the end */
 } t_gmx_repl_ex;
 
 static gmx_bool repl_quantity(const gmx_multisim_t *ms,
@@ -143,11 +157,65 @@ static gmx_bool repl_quantity(const gmx_multisim_t *ms,
     return bDiff;
 }
 
+/* Returns whether our own setup allows to swap the reference temperature
+ * instead of the configuration, the other replicas are not checked.
+ */
+static gmx_bool can_swap_ref_t(const t_inputrec *ir)
+{
+    gmx_bool bSwap;
+    int      i;
+
+    bSwap = ((ir->etc == etcVRESCALE ||
+              EI_SD(ir->eI) || ir->eI == eiBD) &&
+             !ir->bSimTemp && !ir->bExpanded &&
+             !inputrecNptTrotter(ir) && !inputrecNphTrotter(ir));
+    for (i = 0; i < ir->opts.ngtc; i++)
+    {
+        if (ir->opts.ref_t[i] != ir->opts.ref_t[0] ||
+            ir->opts.annealing[i] != eannNO)
+        {
+            bSwap = FALSE;
+        }
+    }
+
+    return bSwap;
+}
+
+real replica_exchange_buffer_temperature(const gmx_multisim_t *ms,
+                                         const t_inputrec     *ir)
+{
+    real *ref_t_all;
+    real  ref_t_max;
+    int   s;
+
+    if (ms == NULL)
+    {
+        return -1;
+    }
+
+    snew(ref_t_all, ms->nsim);
+    ref_t_all[ms->sim] = ir->opts.ref_t[0];
+    gmx_sum_sim(ms->nsim, ref_t_all, ms);
+
+    ref_t_max = -1;
+    if (can_swap_ref_t(ir))
+    {
+        for (s = 0; s < ms->nsim; s++)
+        {
+            ref_t_max = std::max(ref_t_max, ref_t_all[s]);
+        }
+    }
+    sfree(ref_t_all);
+
+    return ref_t_max;
+}
+
 gmx_repl_ex_t init_replica_exchange(FILE *fplog,
                                     const gmx_multisim_t *ms,
                                     const t_state *state,
                                     const t_inputrec *ir,
-                                    int nst, int nex, int init_seed)
+                                    int nst, int nex, int init_seed,
+                                    gmx_bool bPairwise)
 {
     real                pres;
     int                 i, j, k;
@@ -175,10 +243,17 @@ gmx_repl_ex_t init_replica_exchange(FILE *fplog,
          * if we are using DD. */
     }
 
+    if (bPairwise && nex > 0)
+    {
+        gmx_fatal(FARGS, "Pairwise replica exchange only supports neighbor exchange, not multiple exchanges with -nex");
+    }
+
     snew(re, 1);
 
-    re->repl     = ms->sim;
-    re->nrepl    = ms->nsim;
+    re->repl      = ms->sim;
+    re->nrepl     = ms->nsim;
+    re->bPairwise = bPairwise;
+    re->ms        = ms;
     snew(re->q, ereENDSINGLE);
 
     fprintf(fplog, "Repl  There are %d replicas:\n", re->nrepl);
@@ -267,6 +342,37 @@ gmx_repl_ex_t init_replica_exchange(FILE *fplog,
         gmx_sum_sim(re->nrepl, re->pres, ms);
     }
 
+    if (re->bPairwise && re->type == ereTEMP)
+    {
+        /* We can swap the reference temperatures instead of the
+         * configurations when the temperature only enters through
+         * the reference temperature used at every step and when
+         * nothing else differs between the replicas.
+         */
+        re->bSwapParams = can_swap_ref_t(ir);
+        for (i = 1; re->bNPT && i < re->nrepl; i++)
+        {
+            if (re->pres[i] != re->pres[0])
+            {
+                re->bSwapParams = FALSE;
+            }
+        }
+        /* All replicas should make the same choice */
+        k = (re->bSwapParams ? 0 : 1);
+        gmx_sumi_sim(1, &k, ms);
+        re->bSwapParams = (k == 0);
+    }
+    if (re->bPairwise)
+    {
+        fprintf(fplog, "\nRepl  Using pairwise neighbor exchange, exchanging %s\n",
+                re->bSwapParams ? "reference temperatures" : "configurations");
+        if (re->type == ereTEMP && !re->bSwapParams)
+        {
+            fprintf(fplog, "Repl  Temperatures can only be exchanged with a single reference temperature,\n"
+                    "Repl  the v-rescale thermostat or the sd or bd integrator and equal pressures\n");
+        }
+    }
+
     /* Make an index for increasing replica order */
     /* only makes sense if one or the other is varying, not both!
        if both are varying, we trust the order the person gave. */
@@ -288,12 +394,17 @@ gmx_repl_ex_t init_replica_exchange(FILE *fplog,
                     /* Unordered replicas are supposed to work, but there
                      * is still an issues somewhere.
                      * Note that at this point still re->ind[i]=i.
+                     * When swapping temperatures, the replicas are
+                     * unordered after a continuation from checkpoint.
                      */
-                    gmx_fatal(FARGS, "Replicas with indices %d < %d have %ss %g > %g, please order your replicas on increasing %s",
-                              i, j,
-                              erename[re->type],
-                              re->q[re->type][i], re->q[re->type][j],
-                              erename[re->type]);
+                    if (!re->bSwapParams)
+                    {
+                        gmx_fatal(FARGS, "Replicas with indices %d < %d have %ss %g > %g, please order your replicas on increasing %s",
+                                  i, j,
+                                  erename[re->type],
+                                  re->q[re->type][i], re->q[re->type][j],
+                                  erename[re->type]);
+                    }
 
                     k          = re->ind[i];
                     re->ind[i] = re->ind[j];
@@ -307,6 +418,11 @@ gmx_repl_ex_t init_replica_exchange(FILE *fplog,
         }
     }
 
+    if (re->bPairwise)
+    {
+        repl_ladder_init(&re->ladder, re->nrepl, re->ind, re->repl);
+    }
+
     /* keep track of all the swaps, starting with the initial placement. */
     snew(re->allswaps, re->nrepl);
     for (i = 0; i < re->nrepl; i++)
@@ -427,125 +543,91 @@ gmx_repl_ex_t init_replica_exchange(FILE *fplog,
     return re;
 }
 
-static void exchange_reals(const gmx_multisim_t gmx_unused *ms, int gmx_unused b, real *v, int n)
+/* Sends nbytes from sbuf to replica b and receives nbytes from b in rbuf */
+static void exchange_with_replica(const gmx_multisim_t gmx_unused *ms, int gmx_unused b,
+                                  int gmx_unused tag,
+                                  void gmx_unused *sbuf, void gmx_unused *rbuf,
+                                  int gmx_unused nbytes)
 {
-    real *buf;
-    int   i;
-
-    if (v)
-    {
-        snew(buf, n);
 #ifdef GMX_MPI
-        /*
-           MPI_Sendrecv(v,  n*sizeof(real),MPI_BYTE,MSRANK(ms,b),0,
-           buf,n*sizeof(real),MPI_BYTE,MSRANK(ms,b),0,
-           ms->mpi_comm_masters,MPI_STATUS_IGNORE);
-         */
-        {
-            MPI_Request mpi_req;
+    MPI_Request mpi_req[2];
 
-            MPI_Isend(v, n*sizeof(real), MPI_BYTE, MSRANK(ms, b), 0,
-                      ms->mpi_comm_masters, &mpi_req);
-            MPI_Recv(buf, n*sizeof(real), MPI_BYTE, MSRANK(ms, b), 0,
-                     ms->mpi_comm_masters, MPI_STATUS_IGNORE);
-            MPI_Wait(&mpi_req, MPI_STATUS_IGNORE);
-        }
+    MPI_Isend(sbuf, nbytes, MPI_BYTE, MSRANK(ms, b), tag,
+              ms->mpi_comm_masters, &mpi_req[0]);
+    MPI_Irecv(rbuf, nbytes, MPI_BYTE, MSRANK(ms, b), tag,
+              ms->mpi_comm_masters, &mpi_req[1]);
+    MPI_Waitall(2, mpi_req, MPI_STATUSES_IGNORE);
 #endif
-        for (i = 0; i < n; i++)
-        {
-            v[i] = buf[i];
-        }
-        sfree(buf);
-    }
 }
 
-
-static void exchange_doubles(const gmx_multisim_t gmx_unused *ms, int gmx_unused b, double *v, int n)
+/* Copies n elements of size bytes from v to buf at *offset with bPack,
+ * from buf to v otherwise. With buf=NULL only *offset is incremented.
+ */
+static void pack_data(void *v, size_t size, int n,
+                      char *buf, size_t *offset, gmx_bool bPack)
 {
-    double *buf;
-    int     i;
-
-    if (v)
+    if (v != NULL && n > 0)
     {
-        snew(buf, n);
-#ifdef GMX_MPI
-        /*
-           MPI_Sendrecv(v,  n*sizeof(double),MPI_BYTE,MSRANK(ms,b),0,
-           buf,n*sizeof(double),MPI_BYTE,MSRANK(ms,b),0,
-           ms->mpi_comm_masters,MPI_STATUS_IGNORE);
-         */
-        {
-            MPI_Request mpi_req;
-
-            MPI_Isend(v, n*sizeof(double), MPI_BYTE, MSRANK(ms, b), 0,
-                      ms->mpi_comm_masters, &mpi_req);
-            MPI_Recv(buf, n*sizeof(double), MPI_BYTE, MSRANK(ms, b), 0,
-                     ms->mpi_comm_masters, MPI_STATUS_IGNORE);
-            MPI_Wait(&mpi_req, MPI_STATUS_IGNORE);
-        }
-#endif
-        for (i = 0; i < n; i++)
+        if (buf != NULL)
         {
-            v[i] = buf[i];
+            if (bPack)
+            {
+                memcpy(buf + *offset, v, n*size);
+            }
+            else
+            {
+                memcpy(v, buf + *offset, n*size);
+            }
         }
-        sfree(buf);
+        *offset += n*size;
     }
 }
 
-static void exchange_rvecs(const gmx_multisim_t gmx_unused *ms, int gmx_unused b, rvec *v, int n)
+/* Packs the state into buf with bPack, unpacks it otherwise,
+ * returns the number of bytes.
+ */
+static size_t pack_state(t_state *state, char *buf, gmx_bool bPack)
 {
-    rvec *buf;
-    int   i;
-
-    if (v)
-    {
-        snew(buf, n);
-#ifdef GMX_MPI
-        /*
-           MPI_Sendrecv(v[0],  n*sizeof(rvec),MPI_BYTE,MSRANK(ms,b),0,
-           buf[0],n*sizeof(rvec),MPI_BYTE,MSRANK(ms,b),0,
-           ms->mpi_comm_masters,MPI_STATUS_IGNORE);
-         */
-        {
-            MPI_Request mpi_req;
+    /* When t_state changes, this code should be updated. */
+    int    ngtc, nnhpres;
+    size_t offset = 0;
 
-            MPI_Isend(v[0], n*sizeof(rvec), MPI_BYTE, MSRANK(ms, b), 0,
-                      ms->mpi_comm_masters, &mpi_req);
-            MPI_Recv(buf[0], n*sizeof(rvec), MPI_BYTE, MSRANK(ms, b), 0,
-                     ms->mpi_comm_masters, MPI_STATUS_IGNORE);
-            MPI_Wait(&mpi_req, MPI_STATUS_IGNORE);
-        }
-#endif
-        for (i = 0; i < n; i++)
-        {
-            copy_rvec(buf[i], v[i]);
-        }
-        sfree(buf);
-    }
+    ngtc    = state->ngtc * state->nhchainlength;
+    nnhpres = state->nnhpres* state->nhchainlength;
+    pack_data(state->box, sizeof(rvec), DIM, buf, &offset, bPack);
+    pack_data(state->box_rel, sizeof(rvec), DIM, buf, &offset, bPack);
+    pack_data(state->boxv, sizeof(rvec), DIM, buf, &offset, bPack);
+    pack_data(&(state->veta), sizeof(real), 1, buf, &offset, bPack);
+    pack_data(&(state->vol0), sizeof(real), 1, buf, &offset, bPack);
+    pack_data(state->svir_prev, sizeof(rvec), DIM, buf, &offset, bPack);
+    pack_data(state->fvir_prev, sizeof(rvec), DIM, buf, &offset, bPack);
+    pack_data(state->pres_prev, sizeof(rvec), DIM, buf, &offset, bPack);
+    pack_data(state->nosehoover_xi, sizeof(double), ngtc, buf, &offset, bPack);
+    pack_data(state->nosehoover_vxi, sizeof(double), ngtc, buf, &offset, bPack);
+    pack_data(state->nhpres_xi, sizeof(double), nnhpres, buf, &offset, bPack);
+    pack_data(state->nhpres_vxi, sizeof(double), nnhpres, buf, &offset, bPack);
+    pack_data(state->therm_integral, sizeof(double), state->ngtc, buf, &offset, bPack);
+    pack_data(state->x, sizeof(rvec), state->natoms, buf, &offset, bPack);
+    pack_data(state->v, sizeof(rvec), state->natoms, buf, &offset, bPack);
+    pack_data(state->sd_X, sizeof(rvec), state->natoms, buf, &offset, bPack);
+
+    return offset;
 }
 
 static void exchange_state(const gmx_multisim_t *ms, int b, t_state *state)
 {
-    /* When t_state changes, this code should be updated. */
-    int ngtc, nnhpres;
-    ngtc    = state->ngtc * state->nhchainlength;
-    nnhpres = state->nnhpres* state->nhchainlength;
-    exchange_rvecs(ms, b, state->box, DIM);
-    exchange_rvecs(ms, b, state->box_rel, DIM);
-    exchange_rvecs(ms, b, state->boxv, DIM);
-    exchange_reals(ms, b, &(state->veta), 1);
-    exchange_reals(ms, b, &(state->vol0), 1);
-    exchange_rvecs(ms, b, state->svir_prev, DIM);
-    exchange_rvecs(ms, b, state->fvir_prev, DIM);
-    exchange_rvecs(ms, b, state->pres_prev, DIM);
-    exchange_doubles(ms, b, state->nosehoover_xi, ngtc);
-    exchange_doubles(ms, b, state->nosehoover_vxi, ngtc);
-    exchange_doubles(ms, b, state->nhpres_xi, nnhpres);
-    exchange_doubles(ms, b, state->nhpres_vxi, nnhpres);
-    exchange_doubles(ms, b, state->therm_integral, state->ngtc);
-    exchange_rvecs(ms, b, state->x, state->natoms);
-    exchange_rvecs(ms, b, state->v, state->natoms);
-    exchange_rvecs(ms, b, state->sd_X, state->natoms);
+    char   *sbuf, *rbuf;
+    size_t  nbytes;
+
+    /* Exchange all data in a single message */
+    nbytes = pack_state(state, NULL, TRUE);
+    snew(sbuf, nbytes);
+    snew(rbuf, nbytes);
+    pack_state(state, sbuf, TRUE);
+    exchange_with_replica(ms, b, eretagSTATE, sbuf, rbuf, nbytes);
+    pack_state(state, rbuf, FALSE);
+    sfree(sbuf);
+    sfree(rbuf);
 }
 
 static void copy_rvecs(rvec *s, rvec *d, int n)
@@ -1095,6 +1177,243 @@ test_for_replica_exchange(FILE                 *fplog,
     fflush(fplog); /* make sure we can see what the last exchange was */
 }
 
+/* Returns the inverse temperature at ladder position pos */
+static real ladder_beta(const struct gmx_repl_ex *re, int pos)
+{
+    if (re->type == ereTEMP || re->type == ereTL)
+    {
+        return 1.0/(re->q[ereTEMP][re->ind[pos]]*BOLTZ);
+    }
+    else
+    {
+        return 1.0/(re->temp*BOLTZ);
+    }
+}
+
+void repl_ladder_init(t_repl_ladder *ladder,
+                      int nrepl, const int *ind, int repl)
+{
+    int i;
+
+    for (i = 0; i < nrepl; i++)
+    {
+        if (ind[i] == repl)
+        {
+            ladder->pos = i;
+        }
+    }
+    ladder->nbsim[0] = (ladder->pos > 0 ? ind[ladder->pos - 1] : -1);
+    ladder->nbsim[1] = (ladder->pos + 1 < nrepl ? ind[ladder->pos + 1] : -1);
+}
+
+int repl_ladder_pair_side(const t_repl_ladder *ladder, int nrepl, int parity)
+{
+    /* As with standard exchange, we test positions i-1 and i with i%2=parity */
+    if (ladder->pos > 0 && ladder->pos % 2 == parity)
+    {
+        return 0;
+    }
+    else if (ladder->pos + 1 < nrepl && (ladder->pos + 1) % 2 == parity)
+    {
+        return 1;
+    }
+    else
+    {
+        return -1;
+    }
+}
+
+void repl_ladder_update(t_repl_ladder *ladder, int side, gmx_bool bEx,
+                        const int newnb[2], int nb_partner)
+{
+    int s;
+
+    if (bEx)
+    {
+        int outer = 1 - side;
+
+        /* We take the position of our partner, which takes ours */
+        ladder->pos          += (side == 1 ? 1 : -1);
+        ladder->nbsim[outer]  = ladder->nbsim[side];
+        ladder->nbsim[side]   = nb_partner;
+    }
+    else
+    {
+        for (s = 0; s < 2; s++)
+        {
+            if (s != side)
+            {
+                ladder->nbsim[s] = newnb[s];
+            }
+        }
+    }
+}
+
+/* Updates our ladder neighbors after a pairwise exchange attempt.
+ * We tell each neighbor outside our pair which replica now holds our
+ * old position and get the same information back. The two replicas
+ * of an exchanged pair then pass that on to each other.
+ */
+static void
+update_ladder_neighbors(const gmx_multisim_t *ms,
+                        struct gmx_repl_ex   *re,
+                        int                   side,
+                        gmx_bool              bEx)
+{
+    t_repl_ladder *ladder = &re->ladder;
+    int            partner, holder, newnb[2], nb_partner;
+
+    partner  = (side >= 0 ? ladder->nbsim[side] : -1);
+    holder   = (bEx ? partner : re->repl);
+    newnb[0] = ladder->nbsim[0];
+    newnb[1] = ladder->nbsim[1];
+
+#ifdef GMX_MPI
+    {
+        MPI_Request mpi_req[4];
+        int         nreq = 0, s;
+
+        for (s = 0; s < 2; s++)
+        {
+            if (s != side && ladder->nbsim[s] >= 0)
+            {
+                MPI_Isend(&holder, sizeof(int), MPI_BYTE, MSRANK(ms, ladder->nbsim[s]),
+                          eretagHOLDER, ms->mpi_comm_masters, &mpi_req[nreq++]);
+                MPI_Irecv(&newnb[s], sizeof(int), MPI_BYTE, MSRANK(ms, ladder->nbsim[s]),
+                          eretagHOLDER, ms->mpi_comm_masters, &mpi_req[nreq++]);
+            }
+        }
+        MPI_Waitall(nreq, mpi_req, MPI_STATUSES_IGNORE);
+    }
+#endif
+
+    nb_partner = -1;
+    if (bEx)
+    {
+        exchange_with_replica(ms, partner, eretagNEIGHBOR,
+                              &newnb[1 - side], &nb_partner, sizeof(int));
+    }
+
+    repl_ladder_update(ladder, side, bEx, newnb, nb_partner);
+}
+
+/* Neighbor replica exchange that only communicates between the two
+ * replicas of the pair this replica is part of. Both replicas compute
+ * the same acceptance from the same data and random numbers.
+ * Returns the replica we exchange with, -1 when we do not exchange.
+ */
+static int
+test_for_pairwise_exchange(FILE                 *fplog,
+                           const gmx_multisim_t *ms,
+                           struct gmx_repl_ex   *re,
+                           gmx_enerdata_t       *enerd,
+                           real                  vol,
+                           gmx_int64_t           step,
+                           real                  time)
+{
+    int      m, i, side, partner, a, b, pos_new;
+    real     delta, prob, sbuf[3], rbuf[3];
+    gmx_bool bEx = FALSE;
+
+    fprintf(fplog, "Replica exchange at step %" GMX_PRId64 " time %.5f\n", step, time);
+
+    m       = (step / re->nst) % 2;
+    side    = repl_ladder_pair_side(&re->ladder, re->nrepl, m);
+    i       = (side >= 0 ? re->ladder.pos + side : -1);
+    partner = (side >= 0 ? re->ladder.nbsim[side] : -1);
+    pos_new = re->ladder.pos;
+    re->nattempt[m]++;
+
+    if (partner >= 0)
+    {
+        /* a is the replica at position i-1, b at position i */
+        a = (side == 1 ? re->repl : partner);
+        b = (side == 1 ? partner : re->repl);
+
+        /* Send our energy, volume and the energy of our configuration
+         * in the Hamiltonian of our partner.
+         */
+        sbuf[0] = enerd->term[F_EPOT];
+        sbuf[1] = vol;
+        sbuf[2] = 0;
+        if (re->type == ereLAMBDA || re->type == ereTL)
+        {
+            sbuf[2] = (enerd->enerpart_lambda[(int)re->q[ereLAMBDA][partner]+1] -
+                       enerd->enerpart_lambda[0]);
+        }
+        exchange_with_replica(ms, partner, eretagENERGY, sbuf, rbuf, sizeof(sbuf));
+
+        re->Epot[re->repl]         = sbuf[0];
+        re->Epot[partner]          = rbuf[0];
+        re->Vol[re->repl]          = sbuf[1];
+        re->Vol[partner]           = rbuf[1];
+        re->de[re->repl][re->repl] = 0;
+        re->de[partner][partner]   = 0;
+        re->de[partner][re->repl]  = sbuf[2];
+        re->de[re->repl][partner]  = rbuf[2];
+        re->beta[a]                = ladder_beta(re, i - 1);
+        re->beta[b]                = ladder_beta(re, i);
+
+        delta = calc_delta(fplog, TRUE, re, a, b, a, b);
+        if (delta <= 0)
+        {
+            /* accepted */
+            prob = 1;
+            bEx  = TRUE;
+        }
+        else
+        {
+            double rnd[2];
+
+            if (delta > PROBABILITYCUTOFF)
+            {
+                prob = 0;
+            }
+            else
+            {
+                prob = exp(-delta);
+            }
+            /* roll a number to determine if accepted */
+            gmx_rng_cycle_2uniform(step, i, re->seed, RND_SEED_REPLEX, rnd);
+            bEx = rnd[0] < prob;
+        }
+
+        /* Only the replica at position i records the pair statistics,
+         * so the sum over the replicas at the end counts them once.
+         */
+        if (side == 0)
+        {
+            re->prob_sum[i] += prob;
+            if (bEx)
+            {
+                re->nexchange[i]++;
+            }
+        }
+        if (bEx)
+        {
+            pos_new = (side == 1 ? i : i - 1);
+        }
+        fprintf(fplog, "Repl pair %2d %s %2d  pr %4.2f\n", i - 1, bEx ? "x" : " ", i, prob);
+    }
+
+    /* record the move of the configuration at our position */
+    re->nmoves[re->ind[re->ladder.pos]][re->ind[pos_new]] += 1;
+    re->nmoves[re->ind[pos_new]][re->ind[re->ladder.pos]] += 1;
+
+    if (re->bSwapParams)
+    {
+        update_ladder_neighbors(ms, re, side, bEx);
+        if (bEx)
+        {
+            fprintf(fplog, "Repl  now at position %d, reference temperature %g\n",
+                    re->ladder.pos, re->q[ereTEMP][re->ind[re->ladder.pos]]);
+        }
+    }
+    fflush(fplog);
+
+    return (bEx ? partner : -1);
+}
+
 static void
 cyclic_decomposition(const int *destinations,
                      int      **cyclic,
@@ -1262,24 +1581,49 @@ prepare_to_do_exchange(struct gmx_repl_ex *re,
 }
 
 gmx_bool replica_exchange(FILE *fplog, const t_commrec *cr, struct gmx_repl_ex *re,
-                          t_state *state, gmx_enerdata_t *enerd,
-                          t_state *state_local, gmx_int64_t step, real time)
+                          t_inputrec *ir, t_state *state, gmx_enerdata_t *enerd,
+                          t_state *state_local, gmx_int64_t step, real time,
+                          gmx_bool *bStateExchanged)
 {
-    int j;
-    int replica_id = 0;
-    int exchange_partner;
-    int maxswap = 0;
+    int      j, g;
+    int      replica_id = 0;
+    int      exchange_partner;
+    int      maxswap = 0;
     /* Number of rounds of exchanges needed to deal with any multiple
      * exchanges. */
     /* Where each replica ends up after the exchange attempt(s). */
     /* The order in which multiple exchanges will occur. */
     gmx_bool bThisReplicaExchanged = FALSE;
+    /* The new reference temperature when exchanging temperatures */
+    real     exchange_ref_t        = 0;
 
     if (MASTER(cr))
     {
         replica_id  = re->repl;
-        test_for_replica_exchange(fplog, cr->ms, re, enerd, det(state_local->box), step, time);
-        prepare_to_do_exchange(re, replica_id, &maxswap, &bThisReplicaExchanged);
+        if (re->bPairwise)
+        {
+            exchange_partner = test_for_pairwise_exchange(fplog, cr->ms, re, enerd,
+                                                          det(state_local->box), step, time);
+            if (exchange_partner >= 0)
+            {
+                if (re->bSwapParams)
+                {
+                    exchange_ref_t = re->q[ereTEMP][re->ind[re->ladder.pos]];
+                }
+                else
+                {
+                    bThisReplicaExchanged        = TRUE;
+                    maxswap                      = 1;
+                    re->order[replica_id][0]     = exchange_partner;
+                    re->destinations[replica_id] = exchange_partner;
+                }
+            }
+        }
+        else
+        {
+            test_for_replica_exchange(fplog, cr->ms, re, enerd, det(state_local->box), step, time);
+            prepare_to_do_exchange(re, replica_id, &maxswap, &bThisReplicaExchanged);
+        }
     }
     /* Do intra-simulation broadcast so all processors belonging to
      * each simulation know whether they need to participate in
@@ -1290,9 +1634,27 @@ gmx_bool replica_exchange(FILE *fplog, const t_commrec *cr, struct gmx_repl_ex *
 #ifdef GMX_MPI
         MPI_Bcast(&bThisReplicaExchanged, sizeof(gmx_bool), MPI_BYTE, MASTERRANK(cr),
                   cr->mpi_comm_mygroup);
+        MPI_Bcast(&exchange_ref_t, sizeof(real), MPI_BYTE, MASTERRANK(cr),
+                  cr->mpi_comm_mygroup);
 #endif
     }
 
+    if (exchange_ref_t > 0)
+    {
+        /* We only change the reference temperature, as with simulated
+         * tempering. The local velocities are scaled on each rank,
+         * so no state needs to be communicated.
+         */
+        scale_velocities(state_local, sqrt(exchange_ref_t/ir->opts.ref_t[0]));
+        for (g = 0; g < ir->opts.ngtc; g++)
+        {
+            if (ir->opts.ref_t[g] > 0)
+            {
+                ir->opts.ref_t[g] = exchange_ref_t;
+            }
+        }
+    }
+
     if (bThisReplicaExchanged)
     {
         /* Exchange the states */
@@ -1343,13 +1705,31 @@ gmx_bool replica_exchange(FILE *fplog, const t_commrec *cr, struct gmx_repl_ex *
         }
     }
 
-    return bThisReplicaExchanged;
+    *bStateExchanged = bThisReplicaExchanged;
+
+    return (bThisReplicaExchanged || exchange_ref_t > 0);
+}
+
+gmx_bool replica_exchange_swaps_parameters(const gmx_repl_ex_t re)
+{
+    return re->bSwapParams;
 }
 
 void print_replica_exchange_statistics(FILE *fplog, struct gmx_repl_ex *re)
 {
     int  i;
 
+    if (re->bPairwise)
+    {
+        /* Each replica only recorded the statistics of its own pairs */
+        gmx_sum_sim(re->nrepl, re->prob_sum, re->ms);
+        gmx_sumi_sim(re->nrepl, re->nexchange, re->ms);
+        for (i = 0; i < re->nrepl; i++)
+        {
+            gmx_sumi_sim(re->nrepl, re->nmoves[i], re->ms);
+        }
+    }
+
     fprintf(fplog, "\nReplica exchange statistics\n");
 
     if (re->nex == 0)
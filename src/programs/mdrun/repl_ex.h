@@ -56,24 +56,74 @@ gmx_repl_ex_t init_replica_exchange(FILE *fplog,
                                     const gmx_multisim_t *ms,
                                     const t_state *state,
                                     const t_inputrec *ir,
-                                    int nst, int nmultiex, int init_seed);
-/* Should only be called on the master nodes */
+                                    int nst, int nmultiex, int init_seed,
+                                    gmx_bool bPairwise);
+/* Should only be called on the master nodes.
+ * With bPairwise, neighbor exchange only communicates between the two
+ * replicas of each pair tested and, when the coupling allows it,
+ * swaps the reference temperatures instead of the configurations.
+ */
+
+real replica_exchange_buffer_temperature(const gmx_multisim_t *ms,
+                                         const t_inputrec     *ir);
+/* Returns the highest reference temperature over all replicas when
+ * pairwise exchange could swap our reference temperature, -1 otherwise.
+ * The pair-list buffer should be set for this temperature.
+ * Should be called on the master ranks of all simulations.
+ */
+
+gmx_bool replica_exchange_swaps_parameters(const gmx_repl_ex_t re);
+/* Returns whether temperatures are exchanged instead of configurations */
 
 gmx_bool replica_exchange(FILE *fplog,
                           const t_commrec *cr,
                           gmx_repl_ex_t re,
+                          t_inputrec *ir,
                           t_state *state, gmx_enerdata_t *enerd,
                           t_state *state_local,
-                          gmx_int64_t step, real time);
+                          gmx_int64_t step, real time,
+                          gmx_bool *bStateExchanged);
 /* Attempts replica exchange, should be called on all nodes.
- * Returns TRUE if this state has been exchanged.
+ * Returns TRUE if this state or its reference temperature
+ * has been exchanged.
  * When running each replica in parallel,
  * this routine collects the state on the master node before exchange.
  * With domain decomposition, the global state after exchange is stored
- * in state and still needs to be redistributed over the nodes.
+ * in state and still needs to be redistributed over the nodes,
+ * which is indicated by *bStateExchanged.
  */
 
 void print_replica_exchange_statistics(FILE *fplog, gmx_repl_ex_t re);
 /* Should only be called on the master nodes */
 
+/* The ladder bookkeeping of one replica with pairwise neighbor exchange.
+ * The functions below do no communication, so they can be tested
+ * over a simulated ladder.
+ */
+typedef struct {
+    int pos;      /* position of this replica in the ladder */
+    int nbsim[2]; /* replicas at pos-1 and pos+1, -1 if none */
+} t_repl_ladder;
+
+void repl_ladder_init(t_repl_ladder *ladder,
+                      int nrepl, const int *ind, int repl);
+/* Sets the position and neighbors of replica repl,
+ * ind[pos] is the replica at ladder position pos.
+ */
+
+int repl_ladder_pair_side(const t_repl_ladder *ladder, int nrepl, int parity);
+/* Returns the side, 0 for pos-1 and 1 for pos+1, of the neighbor we form
+ * a pair with when testing the pairs at positions i-1 and i with
+ * i%2=parity. Returns -1 when we are not part of a pair.
+ */
+
+void repl_ladder_update(t_repl_ladder *ladder, int side, gmx_bool bEx,
+                        const int newnb[2], int nb_partner);
+/* Updates our position and neighbors after a pairwise exchange attempt
+ * with the neighbor at side, which is -1 when we were not part of a pair.
+ * newnb[s], for s!=side, should be the replica that now holds the old
+ * position of neighbor s. With bEx, nb_partner should be what our
+ * partner has as newnb for its neighbor outside our pair.
+ */
+
 #endif  /* _repl_ex_h */
@@ -175,6 +175,20 @@ static int nthreads_omp_efficient_max(int gmx_unused       nrank,
     }
 }
 
+/* Returns the number of logical cores that share a last-level cache,
+ * or 0 when this is unknown or when there is only one such cache.
+ */
+static int getLogicalCoresPerLastLevelCache(const gmx::HardwareTopology &hwTop)
+{
+    if (hwTop.supportLevel() < gmx::HardwareTopology::SupportLevel::Full ||
+        hwTop.machine().lastLevelCaches.size() <= 1)
+    {
+        return 0;
+    }
+
+    return hwTop.machine().lastLevelCaches[0].logicalProcessorId.size();
+}
+
 /* Return the number of thread-MPI ranks to use.
  * This is chosen such that we can always obey our own efficiency checks.
  */
@@ -244,6 +258,24 @@ static int get_tmpi_omp_thread_division(const gmx_hw_info_t *hwinfo,
         }
     }
 
+    if (hw_opt->nthreads_omp <= 0 && (ngpu == 0 || gmx_gpu_sharing_supported()))
+    {
+        /* On CPUs with multiple last-level caches per socket, e.g. AMD Zen,
+         * OpenMP threads of one rank that are spread over several caches
+         * share data through memory. Use one rank per cache instead.
+         * The thread pinning places the threads of each rank in one cache.
+         */
+        int ncorePerCache = getLogicalCoresPerLastLevelCache(*hwinfo->hardwareTopology);
+
+        if (ncorePerCache > 0 &&
+            nthreads_tot/nrank > ncorePerCache &&
+            nthreads_tot % ncorePerCache == 0 &&
+            (ngpu == 0 || (nthreads_tot/ncorePerCache) % ngpu == 0))
+        {
+            nrank = nthreads_tot/ncorePerCache;
+        }
+    }
+
     return nrank;
 }
 
@@ -86,6 +86,7 @@
 #include "gromacs/mdlib/qmmm.h"
 #include "gromacs/mdlib/sighandler.h"
 #include "gromacs/mdlib/tpi.h"
+#include "gromacs/mdrunutility/handlerestart.h"
 #include "gromacs/mdrunutility/threadaffinity.h"
 #include "gromacs/mdtypes/inputrec.h"
 #include "gromacs/mdtypes/md_enums.h"
@@ -97,6 +98,7 @@
 #include "gromacs/timing/wallcycle.h"
 #include "gromacs/topology/mtop_util.h"
 #include "gromacs/trajectory/trajectoryframe.h"
+#include "gromacs/utility/basenetwork.h"
 #include "gromacs/utility/cstringutil.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
@@ -154,6 +156,8 @@ struct mdrunner_arglist
     int                     nstepout;
     int                     resetstep;
     int                     nmultisim;
+    char                  **multidir;
+    gmx_bool                bTryAppend;
     int                     repl_ex_nst;
     int                     repl_ex_nex;
     int                     repl_ex_seed;
@@ -197,7 +201,8 @@ static void mdrunner_start_fn(void *arg)
                       mc.ddcsx, mc.ddcsy, mc.ddcsz,
                       mc.nbpu_opt, mc.nstlist_cmdline,
                       mc.nsteps_cmdline, mc.nstepout, mc.resetstep,
-                      mc.nmultisim, mc.repl_ex_nst, mc.repl_ex_nex, mc.repl_ex_seed, mc.pforce,
+                      mc.nmultisim, mc.multidir, mc.bTryAppend,
+                      mc.repl_ex_nst, mc.repl_ex_nex, mc.repl_ex_seed, mc.pforce,
                       mc.cpt_period, mc.max_hours, mc.imdport, mc.Flags);
     }
     GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
@@ -218,7 +223,8 @@ static t_commrec *mdrunner_start_threads(gmx_hw_opt_t *hw_opt,
                                          const char *nbpu_opt, int nstlist_cmdline,
                                          gmx_int64_t nsteps_cmdline,
                                          int nstepout, int resetstep,
-                                         int nmultisim, int repl_ex_nst, int repl_ex_nex, int repl_ex_seed,
+                                         int nmultisim, char **multidir, gmx_bool bTryToAppendFiles,
+                                         int repl_ex_nst, int repl_ex_nex, int repl_ex_seed,
                                          real pforce, real cpt_period, real max_hours,
                                          unsigned long Flags)
 {
@@ -227,8 +233,9 @@ static t_commrec *mdrunner_start_threads(gmx_hw_opt_t *hw_opt,
     t_commrec               *crn; /* the new commrec */
     t_filenm                *fnmn;
 
-    /* first check whether we even need to start tMPI */
-    if (hw_opt->nthreads_tmpi < 2)
+    /* first check whether we even need to start tMPI,
+     * multi-simulations always need it for their communicators */
+    if (hw_opt->nthreads_tmpi < 2 && nmultisim < 1)
     {
         return cr;
     }
@@ -264,6 +271,8 @@ static t_commrec *mdrunner_start_threads(gmx_hw_opt_t *hw_opt,
     mda->nstepout        = nstepout;
     mda->resetstep       = resetstep;
     mda->nmultisim       = nmultisim;
+    mda->multidir        = multidir;
+    mda->bTryAppend      = bTryToAppendFiles;
     mda->repl_ex_nst     = repl_ex_nst;
     mda->repl_ex_nex     = repl_ex_nex;
     mda->repl_ex_seed    = repl_ex_seed;
@@ -285,6 +294,45 @@ static t_commrec *mdrunner_start_threads(gmx_hw_opt_t *hw_opt,
     return crn;
 }
 
+/*! \brief Set up a thread-MPI rank as part of a multi-simulation
+ *
+ * With thread-MPI all simulations share this process, so the setup
+ * that mdrun does before calling mdrunner() with real MPI can only be
+ * done after the threads have been started: splitting the
+ * communicators, patching the file names, checking for restarts and
+ * opening the log file. The file names are patched in a copy owned
+ * by this rank, which is returned in \p fnm.
+ *
+ * \returns the log file of this simulation on its master rank, NULL otherwise.
+ */
+static FILE *init_multisim_thread(t_commrec *cr, int nmultisim, char **multidir,
+                                  gmx_bool bTryToAppendFiles,
+                                  int nfile, const t_filenm **fnm,
+                                  unsigned long *Flags)
+{
+    t_filenm *fnm_sim;
+    gmx_bool  bDoAppendFiles, bStartFromCpt;
+    FILE     *fplog = NULL;
+
+    fnm_sim = dup_tfn(nfile, *fnm);
+    init_multisystem(cr, nmultisim, multidir, nfile, fnm_sim, multidir == NULL);
+
+    handleRestart(cr, bTryToAppendFiles, nfile, fnm_sim,
+                  &bDoAppendFiles, &bStartFromCpt);
+    *Flags = *Flags | (bDoAppendFiles ? MD_APPENDFILES  : 0);
+    *Flags = *Flags | (bStartFromCpt ? MD_STARTFROMCPT : 0);
+
+    /* As in mdrun, the log file is opened later when appending */
+    if (MASTER(cr) && !bDoAppendFiles)
+    {
+        gmx_log_open(ftp2fn(efLOG, nfile, fnm_sim), cr, FALSE, &fplog);
+    }
+
+    *fnm = fnm_sim;
+
+    return fplog;
+}
+
 #endif /* GMX_THREAD_MPI */
 
 
@@ -574,6 +622,97 @@ static void prepare_verlet_scheme(FILE                           *fplog,
     }
 }
 
+/*! \brief Set nstlist to the value chosen by the tuning in the run that wrote the checkpoint
+ *
+ * Returns FALSE, and leaves \p ir unchanged, when the buffer for
+ * \p nstlist_cpt does not fit in the box or the domain decomposition.
+ */
+static gmx_bool set_nstlist_from_checkpoint(FILE             *fp,
+                                            t_commrec        *cr,
+                                            t_inputrec       *ir,
+                                            int               nstlist_cpt,
+                                            const gmx_mtop_t *mtop,
+                                            matrix            box,
+                                            gmx_bool          bGPU)
+{
+    verletbuf_list_setup_t ls;
+    int                    nstlist_orig;
+    real                   rlist_new;
+    t_state                state_tmp;
+    gmx_bool               bFits;
+    char                   buf[STRLEN];
+
+    verletbuf_get_list_setup(TRUE, bGPU, &ls);
+
+    nstlist_orig = ir->nstlist;
+    ir->nstlist  = nstlist_cpt;
+    calc_verlet_buffer_size(mtop, det(box), ir, -1, &ls, NULL, &rlist_new);
+
+    bFits = (gmx::square(rlist_new) < max_cutoff2(ir->ePBC, box));
+    if (bFits && DOMAINDECOMP(cr))
+    {
+        copy_mat(box, state_tmp.box);
+        bFits = change_dd_cutoff(cr, &state_tmp, ir, rlist_new);
+    }
+
+    if (bFits)
+    {
+        sprintf(buf, "Using nstlist=%d from the nstlist tuning stored in the checkpoint, changing rlist from %g to %g",
+                nstlist_cpt, ir->rlist, rlist_new);
+        ir->rlist   = rlist_new;
+    }
+    else
+    {
+        sprintf(buf, "Can not use nstlist=%d from the checkpoint, because its pair-list buffer does not fit, will tune nstlist again",
+                nstlist_cpt);
+        ir->nstlist = nstlist_orig;
+    }
+    if (MASTER(cr))
+    {
+        fprintf(stderr, "%s\n\n", buf);
+    }
+    if (fp != NULL)
+    {
+        fprintf(fp, "%s\n\n", buf);
+    }
+
+    return bFits;
+}
+
+/*! \brief Set the Verlet buffer for reference temperature \p temperature
+ *
+ * Keeps nstlist and only updates rlist.
+ */
+static void set_verlet_buffer_temperature(FILE             *fplog,
+                                          t_inputrec       *ir,
+                                          const gmx_mtop_t *mtop,
+                                          matrix            box,
+                                          gmx_bool          bUseGPU,
+                                          real              temperature)
+{
+    verletbuf_list_setup_t ls;
+    real                   rlist_new;
+
+    if (ir->verletbuf_tol <= 0)
+    {
+        return;
+    }
+
+    verletbuf_get_list_setup(TRUE, bUseGPU, &ls);
+
+    calc_verlet_buffer_size(mtop, det(box), ir, temperature, &ls, NULL, &rlist_new);
+
+    if (rlist_new != ir->rlist)
+    {
+        if (fplog != NULL)
+        {
+            fprintf(fplog, "\nChanging rlist from %g to %g for a reference temperature of %g K\n\n",
+                    ir->rlist, rlist_new, temperature);
+        }
+        ir->rlist = rlist_new;
+    }
+}
+
 /*! \brief Override the nslist value in inputrec
  *
  * with value passed on the command line (if any)
@@ -663,8 +802,10 @@ int mdrunner(gmx_hw_opt_t *hw_opt,
              const char *ddcsx, const char *ddcsy, const char *ddcsz,
              const char *nbpu_opt, int nstlist_cmdline,
              gmx_int64_t nsteps_cmdline, int nstepout, int resetstep,
-             int gmx_unused nmultisim, int repl_ex_nst, int repl_ex_nex,
-             int repl_ex_seed, real pforce, real cpt_period, real max_hours,
+             int nmultisim, char **multidir,
+             gmx_bool bTryToAppendFiles,
+             int repl_ex_nst, int repl_ex_nex, int repl_ex_seed,
+             real pforce, real cpt_period, real max_hours,
              int imdport, unsigned long Flags)
 {
     gmx_bool                  bForceUseGPU, bTryUseGPU, bRerunMD;
@@ -694,12 +835,53 @@ int mdrunner(gmx_hw_opt_t *hw_opt,
     gmx_hw_info_t            *hwinfo       = NULL;
     /* The master rank decides early on bUseGPU and broadcasts this later */
     gmx_bool                  bUseGPU            = FALSE;
+    gmx_bool                  bThreadMPIMultiSim = FALSE;
 
     /* CAUTION: threads may be started later on in this function, so
        cr doesn't reflect the final parallel state right now */
     snew(inputrec, 1);
     snew(mtop, 1);
 
+#ifdef GMX_THREAD_MPI
+    bThreadMPIMultiSim = (nmultisim >= 1);
+    if (bThreadMPIMultiSim)
+    {
+        /* All simulations run in this process. Each simulation reads
+         * its own input, so we need to start the ranks of all
+         * simulations before anything is read. The ranks share the
+         * hardware detection and the OpenMP thread setup.
+         */
+        if (!gmx_mpi_initialized())
+        {
+            if (hw_opt->nthreads_tmpi <= 0)
+            {
+                hw_opt->nthreads_tmpi = nmultisim;
+            }
+            cr = mdrunner_start_threads(hw_opt, fplog, cr, nfile, fnm,
+                                        oenv, bVerbose, nstglobalcomm,
+                                        ddxyz, dd_node_order, rdd, rconstr,
+                                        dddlb_opt, dlb_scale, ddcsx, ddcsy, ddcsz,
+                                        nbpu_opt, nstlist_cmdline,
+                                        nsteps_cmdline, nstepout, resetstep,
+                                        nmultisim, multidir, bTryToAppendFiles,
+                                        repl_ex_nst, repl_ex_nex, repl_ex_seed, pforce,
+                                        cpt_period, max_hours,
+                                        Flags);
+            if (cr == NULL)
+            {
+                gmx_comm("Failed to spawn threads");
+            }
+        }
+
+        fplog = init_multisim_thread(cr, nmultisim, multidir,
+                                     bTryToAppendFiles, nfile, &fnm, &Flags);
+    }
+#else
+    GMX_UNUSED_VALUE(nmultisim);
+    GMX_UNUSED_VALUE(multidir);
+    GMX_UNUSED_VALUE(bTryToAppendFiles);
+#endif
+
     if (Flags & MD_APPENDFILES)
     {
         fplog = NULL;
@@ -803,7 +985,7 @@ int mdrunner(gmx_hw_opt_t *hw_opt,
                                   hw_opt, hwinfo->nthreads_hw_avail, FALSE);
 
 #ifdef GMX_THREAD_MPI
-    if (SIMMASTER(cr))
+    if (SIMMASTER(cr) && !MULTISIM(cr))
     {
         if (cr->npmenodes > 0 && hw_opt->nthreads_tmpi <= 0)
         {
@@ -831,7 +1013,8 @@ int mdrunner(gmx_hw_opt_t *hw_opt,
                                         ddxyz, dd_node_order, rdd, rconstr,
                                         dddlb_opt, dlb_scale, ddcsx, ddcsy, ddcsz,
                                         nbpu_opt, nstlist_cmdline,
-                                        nsteps_cmdline, nstepout, resetstep, nmultisim,
+                                        nsteps_cmdline, nstepout, resetstep,
+                                        nmultisim, multidir, bTryToAppendFiles,
                                         repl_ex_nst, repl_ex_nex, repl_ex_seed, pforce,
                                         cpt_period, max_hours,
                                         Flags);
@@ -974,6 +1157,7 @@ int mdrunner(gmx_hw_opt_t *hw_opt,
         tMPI_Thread_mutex_unlock(&deform_init_box_mutex);
     }
 
+    int nstlist_tuned = 0;
     if (Flags & MD_STARTFROMCPT)
     {
         /* Check if checkpoint file exists before doing continuation.
@@ -982,7 +1166,7 @@ int mdrunner(gmx_hw_opt_t *hw_opt,
         gmx_bool bReadEkin;
 
         load_checkpoint(opt2fn_master("-cpi", nfile, fnm, cr), &fplog,
-                        cr, ddxyz,
+                        cr, ddxyz, &nstlist_tuned,
                         inputrec, state, &bReadEkin,
                         (Flags & MD_APPENDFILES),
                         (Flags & MD_APPENDFILESSET));
@@ -1012,6 +1196,52 @@ int mdrunner(gmx_hw_opt_t *hw_opt,
         gmx_bcast(sizeof(box), box, cr);
     }
 
+    if (repl_ex_nst > 0 && (Flags & MD_REPLEXPAIR) &&
+        inputrec->cutoff_scheme == ecutsVERLET)
+    {
+        real bufferTemperature = -1;
+
+        /* Pairwise replica exchange can move us up the temperature ladder,
+         * so the pair-list buffer is set for the highest temperature.
+         * This is done after reading the checkpoint, which can change
+         * our reference temperature.
+         */
+        if (MASTER(cr))
+        {
+            bufferTemperature = replica_exchange_buffer_temperature(cr->ms, inputrec);
+        }
+        if (PAR(cr))
+        {
+            gmx_bcast(sizeof(bufferTemperature), &bufferTemperature, cr);
+        }
+        if (bufferTemperature > 0)
+        {
+            set_verlet_buffer_temperature(fplog, inputrec, mtop, box, bUseGPU,
+                                          bufferTemperature);
+            /* The nstlist tuning sets the buffer for our own temperature */
+            Flags &= ~MD_TUNENSTLIST;
+        }
+    }
+
+    if (nstlist_cmdline > 0)
+    {
+        /* The user chose nstlist, do not tune it */
+        Flags &= ~MD_TUNENSTLIST;
+    }
+    if (nstlist_tuned > 0 && (Flags & MD_TUNENSTLIST) &&
+        inputrec->cutoff_scheme == ecutsVERLET && EI_DYNAMICS(inputrec->eI) &&
+        inputrec->verletbuf_tol > 0)
+    {
+        /* Continue with the nstlist chosen by the tuning in the run
+         * that wrote the checkpoint, instead of tuning again.
+         */
+        if (set_nstlist_from_checkpoint(fplog, cr, inputrec, nstlist_tuned,
+                                        mtop, box, bUseGPU))
+        {
+            Flags = (Flags & ~MD_TUNENSTLIST) | MD_READ_NSTLIST;
+        }
+    }
+
     /* Essential dynamics */
     if (opt2bSet("-ei", nfile, fnm))
     {
@@ -1365,6 +1595,8 @@ int mdrunner(gmx_hw_opt_t *hw_opt,
     /* Free GPU memory and context */
     free_gpu_resources(fr, cr, &hwinfo->gpu_info, fr ? fr->gpu_opt : NULL);
 
+    free_nbnxn_atomdata(fr);
+
     if (membed != nullptr)
     {
         free_membed(membed);
@@ -1376,8 +1608,9 @@ int mdrunner(gmx_hw_opt_t *hw_opt,
     print_date_and_time(fplog, cr->nodeid, "Finished mdrun", gmx_gettime());
     walltime_accounting_destroy(walltime_accounting);
 
-    /* Close logfile already here if we were appending to it */
-    if (MASTER(cr) && (Flags & MD_APPENDFILES))
+    /* Close logfile already here if we were appending to it,
+     * or when it was opened here for a thread-MPI multi-simulation */
+    if (MASTER(cr) && ((Flags & MD_APPENDFILES) || bThreadMPIMultiSim))
     {
         gmx_log_close(fplog);
     }
@@ -1389,8 +1622,10 @@ int mdrunner(gmx_hw_opt_t *hw_opt,
 #ifdef GMX_THREAD_MPI
     /* we need to join all threads. The sub-threads join when they
        exit this function, but the master thread needs to be told to
-       wait for that. */
-    if (PAR(cr) && MASTER(cr))
+       wait for that. With multiple simulations that is the master
+       of the first simulation. */
+    if ((PAR(cr) || MULTISIM(cr)) && MASTER(cr) &&
+        (!MULTISIM(cr) || MASTERSIM(cr->ms)))
     {
         tMPI_Finalize();
     }
@@ -82,6 +82,9 @@ namespace gmx
  * \param[in] nstepout     How often to write to the console
  * \param[in] resetstep    Reset the step counter
  * \param[in] nmultisim    Number of parallel simulations to run
+ * \param[in] multidir     Working directories of the simulations with -multidir, or NULL
+ * \param[in] bTryToAppendFiles Whether to append to the output files of a checkpointed run,
+ *                         only used with multiple simulations in one thread-MPI process
  * \param[in] repl_ex_nst  Number steps between replica exchange attempts
  * \param[in] repl_ex_nex  Number of replicas in REMD
  * \param[in] repl_ex_seed The seed for Monte Carlo swaps
@@ -99,8 +102,8 @@ int mdrunner(gmx_hw_opt_t *hw_opt,
              const char *ddcsx, const char *ddcsy, const char *ddcsz,
              const char *nbpu_opt, int nstlist_cmdline,
              gmx_int64_t nsteps_cmdline, int nstepout, int resetstep,
-             int nmultisim, int repl_ex_nst, int repl_ex_nex,
-             int repl_ex_seed, real pforce, real cpt_period, real max_hours,
+             int nmultisim, char **multidir, gmx_bool bTryToAppendFiles,
+             int repl_ex_nst, int repl_ex_nex, int repl_ex_seed, real pforce, real cpt_period, real max_hours,
              int imdport, unsigned long Flags);
 
 
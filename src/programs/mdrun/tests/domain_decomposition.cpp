@@ -42,11 +42,24 @@
  */
 #include "gmxpre.h"
 
+#include "config.h"
+
+#include <cmath>
+#include <cstdlib>
+
+#include <algorithm>
+#include <sstream>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include "gromacs/fileio/trrio.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/textreader.h"
+
 #include "testutils/cmdlinetest.h"
+#include "testutils/testasserts.h"
 
 #include "moduletest.h"
 
@@ -74,4 +87,368 @@ TEST_F(DomainDecompositionSpecialCasesTest, AnEmptyDomainWorks)
     ASSERT_EQ(0, runner_.callMdrun());
 }
 
+#ifdef GMX_THREAD_MPI
+
+/*! \brief Test fixture for the shared-memory halo exchange
+ *
+ * The parameter is the domain decomposition grid.
+ */
+class DomainDecompositionSharedHaloTest : public gmx::test::MdrunTestFixture,
+                                          public ::testing::WithParamInterface<const char *>
+{
+};
+
+//! Returns the forces of all frames in the trajectory file \p filename
+std::vector<std::vector<gmx::RVec> > readForces(const std::string &filename)
+{
+    std::vector<std::vector<gmx::RVec> > forces;
+    t_fileio                            *fio = gmx_trr_open(filename.c_str(), "r");
+    gmx_trr_header_t                     header;
+    gmx_bool                             bOK;
+
+    while (gmx_trr_read_frame_header(fio, &header, &bOK))
+    {
+        std::vector<gmx::RVec> f(header.natoms);
+        EXPECT_TRUE(gmx_trr_read_frame_data(fio, &header, NULL, NULL, NULL,
+                                            header.f_size > 0 ? as_rvec_array(f.data()) : NULL));
+        if (header.f_size > 0)
+        {
+            forces.push_back(f);
+        }
+    }
+    gmx_trr_close(fio);
+
+    return forces;
+}
+
+/*! \brief Appends the domain decomposition \p grid, e.g. "2 2 1", to \p caller
+ *
+ * \returns the number of ranks for the grid
+ */
+int appendGrid(::gmx::test::CommandLine *caller, const char *grid)
+{
+    std::istringstream gridStream(grid);
+    int                numRanks = 1;
+
+    caller->append("-dd");
+    for (int d = 0; d < DIM; d++)
+    {
+        int n;
+        gridStream >> n;
+        caller->append(std::to_string(n));
+        numRanks *= n;
+    }
+
+    return numRanks;
+}
+
+/*! \brief Checks that the energies \p test agree with \p reference up to rounding errors
+ *
+ * A different summation order changes the rounding, and the pressure
+ * terms lose precision by cancellation, so we compare each term with
+ * a tolerance relative to its largest value over the run, but at least
+ * relative to one.
+ */
+void checkEnergiesAgree(const std::vector<std::vector<real> > &reference,
+                        const std::vector<std::vector<real> > &test)
+{
+    ASSERT_EQ(reference.size(), test.size());
+    ASSERT_FALSE(reference.empty());
+    std::vector<real> maxAbsEnergies(reference[0].size(), 1);
+    for (size_t f = 0; f < reference.size(); f++)
+    {
+        ASSERT_EQ(maxAbsEnergies.size(), reference[f].size());
+        ASSERT_EQ(maxAbsEnergies.size(), test[f].size());
+        for (size_t i = 0; i < maxAbsEnergies.size(); i++)
+        {
+            maxAbsEnergies[i] = std::max(maxAbsEnergies[i], std::abs(reference[f][i]));
+        }
+    }
+    for (size_t f = 0; f < reference.size(); f++)
+    {
+        for (size_t i = 0; i < maxAbsEnergies.size(); i++)
+        {
+            EXPECT_REAL_EQ_TOL(reference[f][i], test[f][i],
+                               gmx::test::absoluteTolerance(1e-4*maxAbsEnergies[i]))
+            << "frame " << f << " term " << i;
+        }
+    }
+}
+
+/*! \brief Checks that the forces \p test agree with \p reference up to rounding errors
+ *
+ * The rounding differences grow during the run, so we compare with
+ * a tolerance relative to the largest force component in each frame.
+ */
+void checkForcesAgree(const std::vector<std::vector<gmx::RVec> > &reference,
+                      const std::vector<std::vector<gmx::RVec> > &test)
+{
+    ASSERT_EQ(reference.size(), test.size());
+    for (size_t f = 0; f < reference.size(); f++)
+    {
+        ASSERT_EQ(reference[f].size(), test[f].size());
+        real maxAbsForce = 1;
+        for (const gmx::RVec &force : reference[f])
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                maxAbsForce = std::max(maxAbsForce, std::abs(force[d]));
+            }
+        }
+        for (size_t a = 0; a < reference[f].size(); a++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_REAL_EQ_TOL(reference[f][a][d], test[f][a][d],
+                                   gmx::test::absoluteTolerance(1e-4*maxAbsForce))
+                << "frame " << f << " atom " << a << " dimension " << d;
+            }
+        }
+    }
+}
+
+/* With GMX_DD_SHARED_HALO set, thread-MPI ranks read the halo
+ * coordinates and forces directly from the memory of their neighbors
+ * instead of exchanging messages. The data and the order of the
+ * force summation are the same, so the results should be identical.
+ */
+TEST_P(DomainDecompositionSharedHaloTest, GivesTheSameEnergiesAndForcesAsMessages)
+{
+    runner_.useTopGroAndNdxFromDatabase("spc216");
+    runner_.useStringAsMdpFile("cutoff-scheme   = Verlet\n"
+                               "coulombtype     = Reaction-field\n"
+                               "rcoulomb        = 0.7\n"
+                               "rvdw            = 0.7\n"
+                               "nstlist         = 10\n"
+                               "tcoupl          = v-rescale\n"
+                               "tc-grps         = System\n"
+                               "tau-t           = 0.1\n"
+                               "ref-t           = 300\n"
+                               "nsteps          = 20\n"
+                               "nstfout         = 5\n"
+                               "nstcalcenergy   = 1\n"
+                               "nstenergy       = 1\n");
+    ASSERT_EQ(0, runner_.callGrompp());
+
+    ::gmx::test::CommandLine caller;
+    caller.append("mdrun");
+    runner_.numThreadMpiRanks_ = appendGrid(&caller, GetParam());
+    /* Dynamic load balancing would make the runs differ */
+    caller.addOption("-dlb", "no");
+
+    runner_.fullPrecisionTrajectoryFileName_ = fileManager_.getTemporaryFilePath("messages.trr");
+    runner_.edrFileName_                     = fileManager_.getTemporaryFilePath("messages.edr");
+    ASSERT_EQ(0, runner_.callMdrun(caller));
+    std::string messagesTrr = runner_.fullPrecisionTrajectoryFileName_;
+    std::string messagesEdr = runner_.edrFileName_;
+
+    runner_.fullPrecisionTrajectoryFileName_ = fileManager_.getTemporaryFilePath("shared.trr");
+    runner_.edrFileName_                     = fileManager_.getTemporaryFilePath("shared.edr");
+    runner_.logFileName_                     = fileManager_.getTemporaryFilePath("shared.log");
+    setenv("GMX_DD_SHARED_HALO", "1", 1);
+    int rc = runner_.callMdrun(caller);
+    unsetenv("GMX_DD_SHARED_HALO");
+    ASSERT_EQ(0, rc);
+
+    std::string sharedLog = gmx::TextReader::readFileToString(runner_.logFileName_);
+    EXPECT_NE(std::string::npos, sharedLog.find("GMX_DD_SHARED_HALO"))
+    << "The shared halo exchange was not used";
+
+    std::vector<std::vector<real> > messagesEnergies = gmx::test::readEnergies(messagesEdr);
+    std::vector<std::vector<real> > sharedEnergies   = gmx::test::readEnergies(runner_.edrFileName_);
+    ASSERT_EQ(21U, messagesEnergies.size());
+    ASSERT_EQ(messagesEnergies.size(), sharedEnergies.size());
+    for (size_t f = 0; f < messagesEnergies.size(); f++)
+    {
+        ASSERT_EQ(messagesEnergies[f].size(), sharedEnergies[f].size());
+        for (size_t i = 0; i < messagesEnergies[f].size(); i++)
+        {
+            EXPECT_REAL_EQ_TOL(messagesEnergies[f][i], sharedEnergies[f][i], gmx::test::ulpTolerance(0))
+            << "frame " << f << " term " << i;
+        }
+    }
+
+    std::vector<std::vector<gmx::RVec> > messagesForces = readForces(messagesTrr);
+    std::vector<std::vector<gmx::RVec> > sharedForces   = readForces(runner_.fullPrecisionTrajectoryFileName_);
+    ASSERT_EQ(5U, messagesForces.size());
+    ASSERT_EQ(messagesForces.size(), sharedForces.size());
+    for (size_t f = 0; f < messagesForces.size(); f++)
+    {
+        ASSERT_EQ(messagesForces[f].size(), sharedForces[f].size());
+        for (size_t a = 0; a < messagesForces[f].size(); a++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_REAL_EQ_TOL(messagesForces[f][a][d], sharedForces[f][a][d], gmx::test::ulpTolerance(0))
+                << "frame " << f << " atom " << a << " dimension " << d;
+            }
+        }
+    }
+}
+
+/* With 2x2x2 each dimension has one pulse. With 2x3x1 the cells in y
+ * are smaller than the cut-off, which gives two pulses in y, and these
+ * are not received in place.
+ */
+INSTANTIATE_TEST_CASE_P(WithOneAndTwoPulses, DomainDecompositionSharedHaloTest,
+                            ::testing::Values("2 2 2", "2 3 1"));
+
+/*! \brief Test fixture for the incremental local topology update
+ *
+ * The parameter is the domain decomposition grid.
+ */
+class DomainDecompositionIncrementalTopologyTest : public gmx::test::MdrunTestFixture,
+                                                   public ::testing::WithParamInterface<const char *>
+{
+};
+
+/* With GMX_DD_INCREMENTAL_TOP set, the local bonded interactions are
+ * updated incrementally at repartitioning. The interactions are the
+ * same as with the full generation, but their order differs, which
+ * changes the order of the force summation. So the results should
+ * agree up to rounding errors.
+ */
+TEST_P(DomainDecompositionIncrementalTopologyTest, GivesTheSameEnergiesAndForcesAsFullGeneration)
+{
+    /* Octane has bonds, angles and dihedrals between atoms that
+     * can be in different zones.
+     */
+    runner_.useTopGroAndNdxFromDatabase("OctaneSandwich");
+    runner_.useStringAsMdpFile("cutoff-scheme   = Verlet\n"
+                               "coulombtype     = Reaction-field\n"
+                               "rcoulomb        = 0.9\n"
+                               "rvdw            = 0.9\n"
+                               "nstlist         = 5\n"
+                               "dt              = 0.001\n"
+                               "nsteps          = 20\n"
+                               "nstfout         = 5\n"
+                               "nstcalcenergy   = 1\n"
+                               "nstenergy       = 1\n");
+    ASSERT_EQ(0, runner_.callGrompp());
+
+    ::gmx::test::CommandLine caller;
+    caller.append("mdrun");
+    runner_.numThreadMpiRanks_ = appendGrid(&caller, GetParam());
+    caller.addOption("-dlb", "no");
+    /* Use two threads to also test the combination of the thread data.
+     * The OpenMP setup is done once per process, so this only has
+     * an effect when this is the first test that runs mdrun.
+     */
+    runner_.numOpenMPThreads_ = 2;
+
+    runner_.fullPrecisionTrajectoryFileName_ = fileManager_.getTemporaryFilePath("full.trr");
+    runner_.edrFileName_                     = fileManager_.getTemporaryFilePath("full.edr");
+    ASSERT_EQ(0, runner_.callMdrun(caller));
+    std::string fullTrr = runner_.fullPrecisionTrajectoryFileName_;
+    std::string fullEdr = runner_.edrFileName_;
+
+    runner_.fullPrecisionTrajectoryFileName_ = fileManager_.getTemporaryFilePath("incremental.trr");
+    runner_.edrFileName_                     = fileManager_.getTemporaryFilePath("incremental.edr");
+    runner_.logFileName_                     = fileManager_.getTemporaryFilePath("incremental.log");
+    setenv("GMX_DD_INCREMENTAL_TOP", "1", 1);
+    int rc = runner_.callMdrun(caller);
+    unsetenv("GMX_DD_INCREMENTAL_TOP");
+    ASSERT_EQ(0, rc);
+
+    std::string       incrementalLog = gmx::TextReader::readFileToString(runner_.logFileName_);
+    const std::string countText      = "#incremental local topology updates on this rank:";
+    size_t            countPos       = incrementalLog.find(countText);
+    ASSERT_NE(std::string::npos, countPos) << "The incremental update was not enabled";
+    int numIncrementalUpdates = 0;
+    std::istringstream(incrementalLog.substr(countPos + countText.size())) >> numIncrementalUpdates;
+    EXPECT_GT(numIncrementalUpdates, 0) << "The local topology was not updated incrementally";
+
+    std::vector<std::vector<real> > fullEnergies        = gmx::test::readEnergies(fullEdr);
+    std::vector<std::vector<real> > incrementalEnergies = gmx::test::readEnergies(runner_.edrFileName_);
+    ASSERT_EQ(21U, fullEnergies.size());
+    checkEnergiesAgree(fullEnergies, incrementalEnergies);
+
+    std::vector<std::vector<gmx::RVec> > fullForces        = readForces(fullTrr);
+    std::vector<std::vector<gmx::RVec> > incrementalForces = readForces(runner_.fullPrecisionTrajectoryFileName_);
+    ASSERT_EQ(5U, fullForces.size());
+    checkForcesAgree(fullForces, incrementalForces);
+}
+
+/* The cells are large enough to not require bonded distance checks */
+INSTANTIATE_TEST_CASE_P(WithoutDistanceChecks, DomainDecompositionIncrementalTopologyTest,
+                            ::testing::Values("1 1 4", "2 2 1"));
+
+/*! \brief Test fixture for the neutral-territory zone setup
+ *
+ * The parameter is the domain decomposition grid.
+ */
+class DomainDecompositionNeutralTerritoryTest : public gmx::test::MdrunTestFixture,
+                                                public ::testing::WithParamInterface<const char *>
+{
+};
+
+/* With GMX_DD_NEUTRAL_TERRITORY set, the halo consists of a plate and
+ * a tower of zones and part of the pair interactions are computed on
+ * a different rank than with the eighth shell. This changes the order
+ * of the force summation, so the results should agree up to rounding
+ * errors.
+ */
+TEST_P(DomainDecompositionNeutralTerritoryTest, GivesTheSameEnergiesAndForcesAsTheEighthShell)
+{
+    /* Rounding differences between the two runs grow quickly in
+     * this liquid with a 5 fs time step, so we only run 8 steps.
+     */
+    runner_.useTopGroAndNdxFromDatabase("argon600");
+    runner_.useStringAsMdpFile("cutoff-scheme   = Verlet\n"
+                               "rvdw            = 0.7\n"
+                               "rcoulomb        = 0.7\n"
+                               "nstlist         = 5\n"
+                               "dt              = 0.005\n"
+                               "tcoupl          = v-rescale\n"
+                               "tc-grps         = System\n"
+                               "tau-t           = 0.1\n"
+                               "ref-t           = 120\n"
+                               "nsteps          = 8\n"
+                               "nstfout         = 5\n"
+                               "nstcalcenergy   = 1\n"
+                               "nstenergy       = 1\n");
+    ASSERT_EQ(0, runner_.callGrompp());
+
+    ::gmx::test::CommandLine caller;
+    caller.append("mdrun");
+    runner_.numThreadMpiRanks_ = appendGrid(&caller, GetParam());
+    caller.addOption("-dlb", "no");
+
+    runner_.fullPrecisionTrajectoryFileName_ = fileManager_.getTemporaryFilePath("eighthshell.trr");
+    runner_.edrFileName_                     = fileManager_.getTemporaryFilePath("eighthshell.edr");
+    ASSERT_EQ(0, runner_.callMdrun(caller));
+    std::string eighthShellTrr = runner_.fullPrecisionTrajectoryFileName_;
+    std::string eighthShellEdr = runner_.edrFileName_;
+
+    runner_.fullPrecisionTrajectoryFileName_ = fileManager_.getTemporaryFilePath("neutral.trr");
+    runner_.edrFileName_                     = fileManager_.getTemporaryFilePath("neutral.edr");
+    runner_.logFileName_                     = fileManager_.getTemporaryFilePath("neutral.log");
+    setenv("GMX_DD_NEUTRAL_TERRITORY", "1", 1);
+    int rc = runner_.callMdrun(caller);
+    unsetenv("GMX_DD_NEUTRAL_TERRITORY");
+    ASSERT_EQ(0, rc);
+
+    std::string neutralLog = gmx::TextReader::readFileToString(runner_.logFileName_);
+    EXPECT_NE(std::string::npos, neutralLog.find("Using the neutral-territory zones"))
+    << "The neutral-territory zones were not used";
+
+    std::vector<std::vector<real> > eighthShellEnergies = gmx::test::readEnergies(eighthShellEdr);
+    std::vector<std::vector<real> > neutralEnergies     = gmx::test::readEnergies(runner_.edrFileName_);
+    ASSERT_EQ(9U, eighthShellEnergies.size());
+    checkEnergiesAgree(eighthShellEnergies, neutralEnergies);
+
+    std::vector<std::vector<gmx::RVec> > eighthShellForces = readForces(eighthShellTrr);
+    std::vector<std::vector<gmx::RVec> > neutralForces     = readForces(runner_.fullPrecisionTrajectoryFileName_);
+    ASSERT_EQ(2U, eighthShellForces.size());
+    checkForcesAgree(eighthShellForces, neutralForces);
+}
+
+/* With two cells along y or z, the neighbors above and below are
+ * the same rank, with three cells along z they differ.
+ */
+INSTANTIATE_TEST_CASE_P(WithTwoAndThreeCells, DomainDecompositionNeutralTerritoryTest,
+                            ::testing::Values("2 2 2", "2 2 3"));
+
+#endif
+
 } // namespace
@@ -45,6 +45,7 @@
 
 #include "config.h"
 
+#include "gromacs/fileio/enxio.h"
 #include "gromacs/gmxpreprocess/grompp.h"
 #include "gromacs/options/basicoptions.h"
 #include "gromacs/options/ioptionscontainer.h"
@@ -106,7 +107,9 @@ SimulationRunner::SimulationRunner(IntegrationTestFixture *fixture) :
     tprFileName_(fixture_->fileManager_.getTemporaryFilePath(".tpr")),
     logFileName_(fixture_->fileManager_.getTemporaryFilePath(".log")),
     edrFileName_(fixture_->fileManager_.getTemporaryFilePath(".edr")),
-    nsteps_(-2)
+    nsteps_(-2),
+    numThreadMpiRanks_(0),
+    numOpenMPThreads_(0)
 {
 #ifdef GMX_LIB_MPI
     GMX_RELEASE_ASSERT(gmx_mpi_initialized(), "MPI system not initialized for mdrun tests");
@@ -230,11 +233,18 @@ SimulationRunner::callMdrun(const CommandLine &callerRef)
 #endif
 
 #ifdef GMX_THREAD_MPI
-    caller.addOption("-nt", g_numThreads);
+    if (numThreadMpiRanks_ > 0)
+    {
+        caller.addOption("-ntmpi", numThreadMpiRanks_);
+    }
+    else
+    {
+        caller.addOption("-nt", g_numThreads);
+    }
 #endif
 
 #ifdef GMX_OPENMP
-    caller.addOption("-ntomp", g_numOpenMPThreads);
+    caller.addOption("-ntomp", numOpenMPThreads_ > 0 ? numOpenMPThreads_ : g_numOpenMPThreads);
 #endif
 
     return gmx_mdrun(caller.argc(), caller.argv());
@@ -248,6 +258,33 @@ SimulationRunner::callMdrun()
     return callMdrun(caller);
 }
 
+std::vector<std::vector<real> >
+readEnergies(const std::string &filename)
+{
+    std::vector<std::vector<real> > energies;
+    ener_file_t                     ef  = open_enx(filename.c_str(), "r");
+    int                             nre = 0;
+    gmx_enxnm_t                    *enm = NULL;
+    t_enxframe                      fr;
+
+    do_enxnms(ef, &nre, &enm);
+    init_enxframe(&fr);
+    while (do_enx(ef, &fr))
+    {
+        std::vector<real> terms;
+        for (int i = 0; i < fr.nre; i++)
+        {
+            terms.push_back(fr.ener[i].e);
+        }
+        energies.push_back(terms);
+    }
+    free_enxframe(&fr);
+    free_enxnms(nre, enm);
+    close_enx(ef);
+
+    return energies;
+}
+
 // ====
 
 MdrunTestFixtureBase::MdrunTestFixtureBase()
@@ -41,8 +41,13 @@
 #ifndef GMX_MDRUN_TESTS_MODULETEST_H
 #define GMX_MDRUN_TESTS_MODULETEST_H
 
+#include <string>
+#include <vector>
+
 #include <gtest/gtest.h>
 
+#include "gromacs/utility/real.h"
+
 #include "testutils/cmdlinetest.h"
 #include "testutils/integrationtests.h"
 
@@ -129,8 +134,28 @@ class SimulationRunner
         std::string swapFileName_;
         int         nsteps_;
         //@}
+        /*! \brief Number of thread-MPI ranks for mdrun, when > 0
+         *
+         * Only for tests of code paths that need a particular
+         * decomposition. Otherwise the number of ranks the test
+         * binary was started with is used. Has no effect without
+         * thread-MPI.
+         */
+        int         numThreadMpiRanks_;
+        /*! \brief Number of OpenMP threads per rank for mdrun
+         *
+         * When > 0, overrides the number of OpenMP threads the test
+         * binary was started with. Has no effect without OpenMP.
+         */
+        int         numOpenMPThreads_;
 };
 
+/*! \brief Returns the energy terms of all frames in the energy file \p filename
+ *
+ * \ingroup module_mdrun_integration_tests
+ */
+std::vector<std::vector<real> > readEnergies(const std::string &filename);
+
 /*! \libinternal \brief Declares test fixture base class for
  * integration tests of mdrun functionality
  *
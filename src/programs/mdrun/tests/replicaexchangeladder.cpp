@@ -0,0 +1,236 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2016, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the ladder bookkeeping of pairwise replica exchange
+ *
+ * \ingroup module_mdrun_integration_tests
+ */
+#include "gmxpre.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "programs/mdrun/repl_ex.h"
+
+namespace
+{
+
+/*! \brief Simulates pairwise neighbor exchange over a ladder
+ *
+ * Each replica only knows its own ladder position and neighbors, as
+ * in mdrun. The messages that update_ladder_neighbors() sends between
+ * replicas are passed here directly. A global array of which replica
+ * sits at which position serves as the reference.
+ */
+class ReplicaExchangeLadder
+{
+    public:
+        //! Sets up the ladder with replica ind[pos] at position pos
+        explicit ReplicaExchangeLadder(const std::vector<int> &ind)
+            : ind_(ind), ladder_(ind.size())
+        {
+            for (size_t r = 0; r < ind_.size(); r++)
+            {
+                repl_ladder_init(&ladder_[r], numReplicas(), ind_.data(), r);
+            }
+        }
+
+        //! Returns the number of replicas
+        int numReplicas() const { return ind_.size(); }
+
+        /*! \brief Does one round of exchange attempts
+         *
+         * \param[in] parity   Tests the pairs at positions i-1 and i with i%2=parity
+         * \param[in] accept   accept[i] tells whether the pair with upper position i exchanges
+         */
+        void attemptExchanges(int parity, const std::vector<bool> &accept)
+        {
+            int              nrepl = numReplicas();
+            std::vector<int> side(nrepl), partner(nrepl), holder(nrepl);
+            std::vector<int> newnb(2*nrepl);
+            std::vector<int> exchanged(nrepl);
+
+            for (int r = 0; r < nrepl; r++)
+            {
+                side[r]    = repl_ladder_pair_side(&ladder_[r], nrepl, parity);
+                partner[r] = (side[r] >= 0 ? ladder_[r].nbsim[side[r]] : -1);
+            }
+            for (int r = 0; r < nrepl; r++)
+            {
+                if (side[r] >= 0)
+                {
+                    /* The pair should be formed from both sides */
+                    ASSERT_GE(partner[r], 0);
+                    ASSERT_EQ(r, partner[partner[r]]);
+                    exchanged[r] = accept[ladder_[r].pos + side[r]];
+                }
+                else
+                {
+                    exchanged[r] = false;
+                }
+                holder[r] = (exchanged[r] ? partner[r] : r);
+            }
+            /* The exchange of the replicas holding our old position */
+            for (int r = 0; r < nrepl; r++)
+            {
+                for (int s = 0; s < 2; s++)
+                {
+                    int nb = ladder_[r].nbsim[s];
+
+                    newnb[2*r + s] = nb;
+                    if (s != side[r] && nb >= 0)
+                    {
+                        /* Our neighbor should send to us as well */
+                        ASSERT_NE(1 - s, side[nb]);
+                        ASSERT_EQ(r, ladder_[nb].nbsim[1 - s]);
+                        newnb[2*r + s] = holder[nb];
+                    }
+                }
+            }
+            for (int r = 0; r < nrepl; r++)
+            {
+                int nbPartner = -1;
+
+                if (exchanged[r])
+                {
+                    /* Our partner sends what it got from outside our pair */
+                    nbPartner = newnb[2*partner[r] + side[r]];
+                }
+                repl_ladder_update(&ladder_[r], side[r], exchanged[r],
+                                   &newnb[2*r], nbPartner);
+            }
+
+            /* Update the reference */
+            for (int i = 2 - parity; i < nrepl; i += 2)
+            {
+                if (accept[i])
+                {
+                    std::swap(ind_[i - 1], ind_[i]);
+                }
+            }
+        }
+
+        //! Checks that the replicas agree with the reference ladder
+        void checkLadder() const
+        {
+            int nrepl = numReplicas();
+
+            for (int pos = 0; pos < nrepl; pos++)
+            {
+                const t_repl_ladder &ladder = ladder_[ind_[pos]];
+
+                EXPECT_EQ(pos, ladder.pos) << "replica " << ind_[pos];
+                EXPECT_EQ(pos > 0 ? ind_[pos - 1] : -1, ladder.nbsim[0])
+                << "replica " << ind_[pos];
+                EXPECT_EQ(pos + 1 < nrepl ? ind_[pos + 1] : -1, ladder.nbsim[1])
+                << "replica " << ind_[pos];
+            }
+        }
+
+    private:
+        //! The replica at each position, the reference
+        std::vector<int>           ind_;
+        //! The ladder bookkeeping of each replica
+        std::vector<t_repl_ladder> ladder_;
+};
+
+TEST(ReplicaExchangeLadderTest, InitializesPositionsAndNeighbors)
+{
+    ReplicaExchangeLadder ladder({ 2, 0, 3, 1 });
+
+    ladder.checkLadder();
+}
+
+TEST(ReplicaExchangeLadderTest, AllowsSingleReplica)
+{
+    ReplicaExchangeLadder ladder({ 0 });
+
+    ladder.attemptExchanges(0, { false });
+    ladder.attemptExchanges(1, { false });
+    ladder.checkLadder();
+}
+
+TEST(ReplicaExchangeLadderTest, TracksAlwaysAcceptedExchanges)
+{
+    for (int nrepl = 2; nrepl <= 7; nrepl++)
+    {
+        std::vector<int> ind;
+        for (int r = 0; r < nrepl; r++)
+        {
+            ind.push_back(r);
+        }
+        ReplicaExchangeLadder ladder(ind);
+
+        /* With all exchanges accepted, each replica walks the ladder */
+        for (int step = 0; step < 2*nrepl; step++)
+        {
+            ladder.attemptExchanges(step % 2, std::vector<bool>(nrepl, true));
+            ladder.checkLadder();
+        }
+    }
+}
+
+TEST(ReplicaExchangeLadderTest, TracksMixedExchanges)
+{
+    for (int nrepl = 2; nrepl <= 8; nrepl++)
+    {
+        /* Start with a shuffled placement */
+        std::vector<int> ind;
+        for (int r = 0; r < nrepl; r++)
+        {
+            ind.push_back(r);
+        }
+        std::reverse(ind.begin(), ind.end());
+        std::rotate(ind.begin(), ind.begin() + nrepl/2, ind.end());
+        ReplicaExchangeLadder ladder(ind);
+        ladder.checkLadder();
+
+        for (int step = 0; step < 50; step++)
+        {
+            std::vector<bool> accept(nrepl);
+            for (int i = 0; i < nrepl; i++)
+            {
+                accept[i] = ((step*7 + i*3) % 5 < 2);
+            }
+            ladder.attemptExchanges(step % 2, accept);
+            ladder.checkLadder();
+        }
+    }
+}
+
+} // namespace
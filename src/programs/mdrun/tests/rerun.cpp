@@ -44,11 +44,22 @@
 
 #include "config.h"
 
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "gromacs/options/filenameoption.h"
+#include "gromacs/utility/textreader.h"
 
 #include "testutils/cmdlinetest.h"
+#include "testutils/testasserts.h"
 
 #include "moduletest.h"
 
@@ -101,6 +112,95 @@ INSTANTIATE_TEST_CASE_P(NoFatalErrorFrom,
                         MdrunRerun,
                             ::testing::ValuesIn(gmx::ArrayRef<const char*>(trajectoryFileNames)));
 
+//! Test fixture for reusing the pair list with mdrun -rerun
+typedef gmx::test::MdrunTestFixture MdrunRerunPairListReuse;
+
+/* Reruns of frames with small displacements reuse the pair list of
+ * an earlier frame. This test checks that they give the same energies
+ * as a rerun that searches every frame and reads without read-ahead.
+ */
+TEST_F(MdrunRerunPairListReuse, GivesTheSameEnergies)
+{
+    runner_.useTopGroAndNdxFromDatabase("spc216");
+    runner_.useStringAsMdpFile("cutoff-scheme   = Verlet\n"
+                               "coulombtype     = Reaction-field\n"
+                               "rcoulomb        = 0.7\n"
+                               "rvdw            = 0.7\n"
+                               "nstlist         = 10\n"
+                               "tcoupl          = v-rescale\n"
+                               "tc-grps         = System\n"
+                               "tau-t           = 0.1\n"
+                               "ref-t           = 300\n"
+                               "nsteps          = 20\n"
+                               "nstxout         = 1\n"
+                               "nstcalcenergy   = 1\n"
+                               "nstenergy       = 1\n");
+    ASSERT_EQ(0, runner_.callGrompp());
+
+    /* Write a frame every step, so most frames can reuse the list */
+    std::string trajectoryFileName = fileManager_.getTemporaryFilePath("run.trr");
+    runner_.fullPrecisionTrajectoryFileName_ = trajectoryFileName;
+    ASSERT_EQ(0, runner_.callMdrun());
+    runner_.fullPrecisionTrajectoryFileName_ = fileManager_.getTemporaryFilePath("rerun.trr");
+
+    ::gmx::test::CommandLine rerunCaller;
+    rerunCaller.append("mdrun");
+    rerunCaller.addOption("-rerun", trajectoryFileName);
+
+    runner_.edrFileName_ = fileManager_.getTemporaryFilePath("reuse.edr");
+    runner_.logFileName_ = fileManager_.getTemporaryFilePath("reuse.log");
+    ASSERT_EQ(0, runner_.callMdrun(rerunCaller));
+    std::string reuseEdrFileName = runner_.edrFileName_;
+    std::string reuseLog         = gmx::TextReader::readFileToString(runner_.logFileName_);
+
+    runner_.edrFileName_ = fileManager_.getTemporaryFilePath("search.edr");
+    runner_.logFileName_ = fileManager_.getTemporaryFilePath("search.log");
+    setenv("GMX_NO_RERUN_LIST_REUSE", "1", 1);
+    setenv("GMX_NO_RERUN_READER", "1", 1);
+    int rc = runner_.callMdrun(rerunCaller);
+    unsetenv("GMX_NO_RERUN_LIST_REUSE");
+    unsetenv("GMX_NO_RERUN_READER");
+    ASSERT_EQ(0, rc);
+
+    /* Check that the list was actually reused */
+    const char *reuseLine = "Reused the pair list for ";
+    size_t      pos       = reuseLog.find(reuseLine);
+    ASSERT_NE(std::string::npos, pos);
+    int         numReused = 0, numFrames = 0;
+    ASSERT_EQ(2, std::sscanf(reuseLog.c_str() + pos + std::strlen(reuseLine),
+                             "%d of the %d", &numReused, &numFrames));
+    EXPECT_EQ(21, numFrames);
+    EXPECT_GT(numReused, 0);
+
+    std::vector<std::vector<real> > reuseEnergies  = gmx::test::readEnergies(reuseEdrFileName);
+    std::vector<std::vector<real> > searchEnergies = gmx::test::readEnergies(runner_.edrFileName_);
+    ASSERT_EQ(searchEnergies.size(), reuseEnergies.size());
+    /* Reusing the list changes the summation order, and the pressure
+     * terms lose precision by cancellation, so we compare each term
+     * with a tolerance relative to its largest value over the run,
+     * but at least relative to one.
+     */
+    std::vector<real> maxAbsEnergies(searchEnergies[0].size(), 1);
+    for (size_t f = 0; f < searchEnergies.size(); f++)
+    {
+        ASSERT_EQ(maxAbsEnergies.size(), searchEnergies[f].size());
+        ASSERT_EQ(maxAbsEnergies.size(), reuseEnergies[f].size());
+        for (size_t i = 0; i < maxAbsEnergies.size(); i++)
+        {
+            maxAbsEnergies[i] = std::max(maxAbsEnergies[i], std::abs(searchEnergies[f][i]));
+        }
+    }
+    for (size_t f = 0; f < searchEnergies.size(); f++)
+    {
+        for (size_t i = 0; i < maxAbsEnergies.size(); i++)
+        {
+            EXPECT_REAL_EQ_TOL(searchEnergies[f][i], reuseEnergies[f][i],
+                               gmx::test::absoluteTolerance(1e-4*maxAbsEnergies[i]))
+            << "frame " << f << " term " << i;
+        }
+    }
+}
+
 /*! \todo Add other tests for mdrun -rerun, e.g.
  *
  * - RerunReproducesRunWhenRunOnlyWroteEnergiesOnNeighborSearchSteps